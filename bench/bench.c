@@ -0,0 +1,648 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * mp3tag_bench: micro-benchmarks for the parsing, decoding and
+ * serialization kernels.
+ *
+ *   mp3tag_bench [-r REPS] [-t MS] [-w MS] [-s SEED] [-f FILTER]
+ *                [-o FILE.json] [-l]
+ *
+ * Every benchmark warms up, calibrates an iteration count that fills
+ * one sample, then times REPS samples. Reported ns/op is the median
+ * sample; min, mean and standard deviation come along in the JSON so
+ * bench/compare.py can tell a regression from noise.
+ *
+ * Inputs are synthetic tags from corpus.c. id3v2_read_frames() takes a
+ * file handle, so its input is a temporary file that stays in the page
+ * cache: the figure is parsing plus file layer, without device I/O.
+ * Kernels that allocate results are timed into a batch that is freed
+ * outside the timer, and collection_free is timed the other way round.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* clock_gettime, getopt, mkstemp */
+
+#include "corpus.h"
+#include "id3v2/id3v2_defs.h"
+#include "id3v2/id3v2_reader.h"
+#include "id3v2/id3v2_writer.h"
+#include <mp3tag/mp3tag.h>
+#include <tag_common/buffer.h>
+#include <tag_common/file_io.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------ */
+/*  Fixtures                                                           */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const uint8_t *data;
+    size_t         len;
+} slice_t;
+
+typedef struct {
+    uint8_t             *tag;           /* Synthetic ID3v2 tag */
+    size_t               tag_len;
+    char                 path[256];     /* The tag, in a temporary file */
+    file_handle_t       *fh;
+    id3v2_frame_t       *frames;
+    mp3tag_collection_t *coll;
+    uint8_t              encoding;      /* Text kernels: encoding fed in */
+    slice_t             *texts;
+    size_t               n_texts;
+    const char         **keys;          /* Mapping kernels: IDs or names */
+    size_t               n_keys;
+    size_t               next;          /* Round-robin input index */
+    void               **batch;         /* Results kept out of the timer */
+    uint64_t             batch_cap;
+    double               bytes_per_op;
+} fixture_t;
+
+static volatile uintptr_t g_sink;       /* Keeps results observable */
+
+/* ------------------------------------------------------------------ */
+/*  Kernels                                                            */
+/* ------------------------------------------------------------------ */
+
+typedef enum {
+    K_DECODE,
+    K_TERMINATOR,
+    K_ID_TO_NAME,
+    K_NAME_TO_ID,
+    K_READ_FRAMES,
+    K_TO_COLLECTION,
+    K_SERIALIZE,
+    K_COLLECTION_FREE,
+} kernel_t;
+
+static const slice_t *next_text(fixture_t *fx)
+{
+    const slice_t *s = &fx->texts[fx->next];
+    if (++fx->next == fx->n_texts) fx->next = 0;
+    return s;
+}
+
+static const char *next_key(fixture_t *fx)
+{
+    const char *k = fx->keys[fx->next];
+    if (++fx->next == fx->n_keys) fx->next = 0;
+    return k;
+}
+
+static void run_decode(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        const slice_t *s = next_text(fx);
+        char *text = id3v2_decode_text(fx->encoding, s->data, s->len);
+        if (text) g_sink += (uintptr_t)text[0];
+        free(text);
+    }
+}
+
+static void run_terminator(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        const slice_t *s = next_text(fx);
+        g_sink += id3v2_find_text_terminator(fx->encoding, s->data, s->len);
+    }
+}
+
+static void run_id_to_name(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+        g_sink += (uintptr_t)id3v2_frame_id_to_name(next_key(fx));
+}
+
+static void run_name_to_id(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+        g_sink += (uintptr_t)id3v2_name_to_frame_id(next_key(fx));
+}
+
+static void run_read_frames(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        id3v2_header_t hdr;
+        id3v2_frame_t *frames = NULL;
+        if (id3v2_read_header(fx->fh, 0, &hdr) == MP3TAG_OK)
+            id3v2_read_frames(fx->fh, 0, &hdr, &frames);
+        fx->batch[i] = frames;
+    }
+}
+
+static void run_to_collection(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        mp3tag_collection_t *coll = NULL;
+        id3v2_frames_to_collection(fx->frames, &coll);
+        fx->batch[i] = coll;
+    }
+}
+
+static void run_serialize(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        dyn_buffer_t buf;
+        buffer_init(&buf);
+        id3v2_serialize_frames(fx->coll, &buf);
+        g_sink += buf.size;
+        buffer_free(&buf);
+    }
+}
+
+static void run_collection_free(fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+        mp3tag_collection_free(NULL, fx->batch[i]);
+}
+
+/* Untimed work before a sample */
+static void prepare(kernel_t k, fixture_t *fx, uint64_t n)
+{
+    if (k != K_COLLECTION_FREE) return;
+    for (uint64_t i = 0; i < n; i++) {
+        mp3tag_collection_t *coll = NULL;
+        id3v2_frames_to_collection(fx->frames, &coll);
+        fx->batch[i] = coll;
+    }
+}
+
+/* Untimed work after a sample */
+static void finish(kernel_t k, fixture_t *fx, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        if (k == K_READ_FRAMES)
+            id3v2_free_frames(fx->batch[i]);
+        else if (k == K_TO_COLLECTION)
+            mp3tag_collection_free(NULL, fx->batch[i]);
+    }
+}
+
+static void run(kernel_t k, fixture_t *fx, uint64_t n)
+{
+    switch (k) {
+    case K_DECODE:          run_decode(fx, n);          break;
+    case K_TERMINATOR:      run_terminator(fx, n);      break;
+    case K_ID_TO_NAME:      run_id_to_name(fx, n);      break;
+    case K_NAME_TO_ID:      run_name_to_id(fx, n);      break;
+    case K_READ_FRAMES:     run_read_frames(fx, n);     break;
+    case K_TO_COLLECTION:   run_to_collection(fx, n);   break;
+    case K_SERIALIZE:       run_serialize(fx, n);       break;
+    case K_COLLECTION_FREE: run_collection_free(fx, n); break;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Benchmark table                                                    */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const char *name;
+    kernel_t    kernel;
+    int         version;
+    int         encoding;               /* CORPUS_ENC_* of the tag */
+    uint32_t    frames;
+    uint32_t    apic_bytes;
+} bench_t;
+
+/* Tag shapes: version, text encoding, frame count, picture bytes */
+#define SMALL   3, CORPUS_ENC_LATIN1,    20,   0
+#define MEDIUM  4, CORPUS_ENC_UTF8,      500,  0
+#define LARGE   4, CORPUS_ENC_MIXED,     5000, 0
+#define PICTURE 3, CORPUS_ENC_UTF16_BOM, 20,   1u << 20
+
+static const bench_t benches[] = {
+    { "decode_iso8859_1",        K_DECODE, 3, CORPUS_ENC_LATIN1,    1000, 0 },
+    { "decode_utf16/bom",        K_DECODE, 3, CORPUS_ENC_UTF16_BOM, 1000, 0 },
+    { "decode_utf16/be",         K_DECODE, 4, CORPUS_ENC_UTF16BE,   1000, 0 },
+    { "decode_utf8",             K_DECODE, 4, CORPUS_ENC_UTF8,      1000, 0 },
+    { "find_text_terminator/latin1",
+                             K_TERMINATOR, 3, CORPUS_ENC_LATIN1,    1000, 0 },
+    { "find_text_terminator/utf16",
+                             K_TERMINATOR, 3, CORPUS_ENC_UTF16_BOM, 1000, 0 },
+    { "frame_id_to_name",    K_ID_TO_NAME, 3, CORPUS_ENC_LATIN1,    1000, 0 },
+    { "name_to_frame_id",    K_NAME_TO_ID, 4, CORPUS_ENC_UTF8,      10,   0 },
+    { "id3v2_read_frames/20",                K_READ_FRAMES,     SMALL   },
+    { "id3v2_read_frames/500",               K_READ_FRAMES,     MEDIUM  },
+    { "id3v2_read_frames/5000",              K_READ_FRAMES,     LARGE   },
+    { "id3v2_read_frames/apic_1m",           K_READ_FRAMES,     PICTURE },
+    { "id3v2_frames_to_collection/20",       K_TO_COLLECTION,   SMALL   },
+    { "id3v2_frames_to_collection/500",      K_TO_COLLECTION,   MEDIUM  },
+    { "id3v2_frames_to_collection/5000",     K_TO_COLLECTION,   LARGE   },
+    { "id3v2_serialize_frames/20",           K_SERIALIZE,       SMALL   },
+    { "id3v2_serialize_frames/500",          K_SERIALIZE,       MEDIUM  },
+    { "id3v2_serialize_frames/5000",         K_SERIALIZE,       LARGE   },
+    { "collection_free/20",                  K_COLLECTION_FREE, SMALL   },
+    { "collection_free/500",                 K_COLLECTION_FREE, MEDIUM  },
+    { "collection_free/5000",                K_COLLECTION_FREE, LARGE   },
+};
+
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+/* Results per sample kept in memory at most, for batched kernels */
+#define BATCH_BYTES (64u << 20)
+
+/* ------------------------------------------------------------------ */
+/*  Fixture setup                                                      */
+/* ------------------------------------------------------------------ */
+
+static int add_text(fixture_t *fx, const uint8_t *data, size_t len)
+{
+    slice_t *t = realloc(fx->texts, (fx->n_texts + 1) * sizeof(*t));
+    if (!t) return -1;
+    fx->texts = t;
+    t[fx->n_texts].data = data;
+    t[fx->n_texts].len  = len;
+    fx->n_texts++;
+    return 0;
+}
+
+/*
+ * Text payloads as the reader hands them to the kernels: whole values of
+ * text frames, descriptions and values of TXXX/COMM for decoding, and
+ * the description-plus-value remainder for terminator searches.
+ */
+static int collect_texts(fixture_t *fx, kernel_t k)
+{
+    for (const id3v2_frame_t *f = fx->frames; f; f = f->next) {
+        if (f->data_size < 1) continue;
+        uint8_t enc = f->data[0];
+        int txxx = memcmp(f->id, "TXXX", 4) == 0;
+        int comm = memcmp(f->id, "COMM", 4) == 0;
+        if (f->id[0] != 'T' && !comm) continue;
+        if (enc != fx->encoding) continue;
+
+        size_t skip = comm ? 4 : 1;
+        if (f->data_size < skip) continue;
+        const uint8_t *rest = f->data + skip;
+        size_t rest_len = f->data_size - skip;
+
+        if (k == K_TERMINATOR) {
+            if ((txxx || comm) && add_text(fx, rest, rest_len) != 0)
+                return -1;
+            continue;
+        }
+        if (!txxx && !comm) {
+            if (add_text(fx, rest, rest_len) != 0) return -1;
+            continue;
+        }
+        size_t end = id3v2_find_text_terminator(enc, rest, rest_len);
+        size_t tsz = (enc == 1 || enc == 2) ? 2 : 1;
+        if (add_text(fx, rest, end) != 0) return -1;
+        if (end + tsz <= rest_len &&
+            add_text(fx, rest + end + tsz, rest_len - end - tsz) != 0)
+            return -1;
+    }
+    if (fx->n_texts == 0) return -1;
+
+    double total = 0;
+    for (size_t i = 0; i < fx->n_texts; i++) total += (double)fx->texts[i].len;
+    fx->bytes_per_op = total / (double)fx->n_texts;
+    return 0;
+}
+
+static int collect_keys(fixture_t *fx, kernel_t k)
+{
+    size_t cap = 0;
+    if (k == K_ID_TO_NAME) {
+        for (const id3v2_frame_t *f = fx->frames; f; f = f->next) cap++;
+    } else {
+        for (const id3v2_name_map_t *m = id3v2_name_map; m->name; m++) cap++;
+        cap *= 2;
+    }
+    fx->keys = calloc(cap ? cap : 1, sizeof(*fx->keys));
+    if (!fx->keys) return -1;
+
+    if (k == K_ID_TO_NAME) {
+        /* Frame order of a real tag: hits first, then mostly misses */
+        for (const id3v2_frame_t *f = fx->frames; f; f = f->next)
+            fx->keys[fx->n_keys++] = f->id;
+    } else {
+        /* Half known names in mixed case, half custom TXXX names */
+        static const char *const custom[] = {
+            "REPLAYGAIN_TRACK_GAIN", "MUSICBRAINZ_TRACKID", "MOOD",
+            "CATALOGNUMBER", "BARCODE", "LABEL", "Acoustid Id",
+        };
+        size_t c = 0;
+        for (const id3v2_name_map_t *m = id3v2_name_map; m->name; m++) {
+            fx->keys[fx->n_keys++] = m->name;
+            fx->keys[fx->n_keys++] = custom[c++ % (sizeof(custom) /
+                                                  sizeof(custom[0]))];
+        }
+    }
+    return fx->n_keys ? 0 : -1;
+}
+
+static void fixture_free(fixture_t *fx)
+{
+    if (fx->fh) file_close(fx->fh);
+    if (fx->path[0]) unlink(fx->path);
+    id3v2_free_frames(fx->frames);
+    mp3tag_collection_free(NULL, fx->coll);
+    free(fx->tag);
+    free(fx->texts);
+    free(fx->keys);
+    free(fx->batch);
+    memset(fx, 0, sizeof(*fx));
+}
+
+static int fixture_init(fixture_t *fx, const bench_t *b, uint64_t seed)
+{
+    memset(fx, 0, sizeof(*fx));
+
+    corpus_spec_t spec = {
+        .container    = CORPUS_MP3,
+        .version      = b->version,
+        .encoding     = b->encoding,
+        .frames       = b->frames,
+        .apic_bytes   = b->apic_bytes,
+        .padding      = 1024,
+        .content_seed = seed,
+    };
+    fx->tag = corpus_build_tag(&spec, &fx->tag_len);
+    if (!fx->tag) return -1;
+
+    const char *tmp = getenv("TMPDIR");
+    snprintf(fx->path, sizeof(fx->path), "%s/mp3tag_bench_XXXXXX",
+             tmp && *tmp ? tmp : "/tmp");
+    int fd = mkstemp(fx->path);
+    if (fd < 0) {
+        fx->path[0] = '\0';
+        goto fail;
+    }
+    ssize_t w = write(fd, fx->tag, fx->tag_len);
+    close(fd);
+    if (w != (ssize_t)fx->tag_len) goto fail;
+
+    fx->fh = file_open_read(fx->path);
+    if (!fx->fh) goto fail;
+
+    id3v2_header_t hdr;
+    if (id3v2_read_header(fx->fh, 0, &hdr) != MP3TAG_OK ||
+        id3v2_read_frames(fx->fh, 0, &hdr, &fx->frames) != MP3TAG_OK ||
+        id3v2_frames_to_collection(fx->frames, &fx->coll) != MP3TAG_OK)
+        goto fail;
+
+    uint64_t frame_bytes = 0;
+    for (const id3v2_frame_t *f = fx->frames; f; f = f->next)
+        frame_bytes += ID3V2_FRAME_HEADER_SIZE + f->data_size;
+
+    fx->encoding = (uint8_t)(b->encoding == CORPUS_ENC_MIXED
+                                 ? CORPUS_ENC_LATIN1 : b->encoding);
+    switch (b->kernel) {
+    case K_DECODE:
+    case K_TERMINATOR:
+        if (collect_texts(fx, b->kernel) != 0) goto fail;
+        break;
+    case K_ID_TO_NAME:
+    case K_NAME_TO_ID:
+        if (collect_keys(fx, b->kernel) != 0) goto fail;
+        fx->bytes_per_op = 0;
+        break;
+    case K_READ_FRAMES:
+        fx->bytes_per_op = (double)fx->tag_len;
+        break;
+    default:
+        fx->bytes_per_op = (double)frame_bytes;
+        break;
+    }
+
+    /* Batched kernels hold a sample's results: bound their memory */
+    if (b->kernel == K_READ_FRAMES || b->kernel == K_TO_COLLECTION ||
+        b->kernel == K_COLLECTION_FREE) {
+        uint64_t per = frame_bytes * 4 + 1;
+        fx->batch_cap = BATCH_BYTES / per;
+        if (fx->batch_cap < 1) fx->batch_cap = 1;
+        if (fx->batch_cap > 65536) fx->batch_cap = 65536;
+        fx->batch = calloc(fx->batch_cap, sizeof(*fx->batch));
+        if (!fx->batch) goto fail;
+    }
+    return 0;
+
+fail:
+    fixture_free(fx);
+    return -1;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Measurement                                                        */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint64_t iterations;                /* Per sample */
+    size_t   samples;
+    double   median, mean, min, max, stddev;   /* ns/op */
+    double   bytes_per_op;
+} result_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* One sample of `n` iterations; returns elapsed ns */
+static uint64_t sample(kernel_t k, fixture_t *fx, uint64_t n)
+{
+    prepare(k, fx, n);
+    uint64_t t0 = now_ns();
+    run(k, fx, n);
+    uint64_t t1 = now_ns();
+    finish(k, fx, n);
+    return t1 - t0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void measure(kernel_t k, fixture_t *fx, size_t reps,
+                    uint64_t sample_ns, uint64_t warmup_ns, result_t *r)
+{
+    uint64_t cap = fx->batch_cap ? fx->batch_cap : UINT64_MAX;
+
+    /* Calibrate: grow n until a sample fills its time slot */
+    uint64_t n = 1;
+    for (;;) {
+        uint64_t t = sample(k, fx, n);
+        if (t >= sample_ns || n >= cap) break;
+        uint64_t next = t ? (uint64_t)((double)n * 1.2 * (double)sample_ns
+                                       / (double)t)
+                          : n * 10;
+        if (next <= n) next = n * 2;
+        if (next > n * 10) next = n * 10;
+        n = next < cap ? next : cap;
+    }
+
+    /* Warm caches, branch predictors and the allocator */
+    uint64_t until = now_ns() + warmup_ns;
+    while (now_ns() < until)
+        sample(k, fx, n);
+
+    double *ns = malloc(reps * sizeof(*ns));
+    if (!ns) {
+        memset(r, 0, sizeof(*r));
+        return;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < reps; i++) {
+        ns[i] = (double)sample(k, fx, n) / (double)n;
+        sum += ns[i];
+    }
+    qsort(ns, reps, sizeof(*ns), cmp_double);
+
+    r->iterations   = n;
+    r->samples      = reps;
+    r->mean         = sum / (double)reps;
+    r->min          = ns[0];
+    r->max          = ns[reps - 1];
+    r->median       = reps % 2 ? ns[reps / 2]
+                               : (ns[reps / 2 - 1] + ns[reps / 2]) / 2;
+    double var = 0;
+    for (size_t i = 0; i < reps; i++)
+        var += (ns[i] - r->mean) * (ns[i] - r->mean);
+    r->stddev       = reps > 1 ? sqrt(var / (double)(reps - 1)) : 0;
+    r->bytes_per_op = fx->bytes_per_op;
+    free(ns);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Output                                                             */
+/* ------------------------------------------------------------------ */
+
+static double bytes_per_sec(const result_t *r)
+{
+    return r->median > 0 ? r->bytes_per_op * 1e9 / r->median : 0;
+}
+
+static void print_row(FILE *f, const char *name, const result_t *r)
+{
+    double cv = r->mean > 0 ? 100.0 * r->stddev / r->mean : 0;
+    fprintf(f, "%-34s %12.1f %6.1f%% %10.1f", name, r->median, cv, r->min);
+    if (r->bytes_per_op > 0)
+        fprintf(f, " %10.1f\n", bytes_per_sec(r) / (1024.0 * 1024.0));
+    else
+        fprintf(f, " %10s\n", "-");
+    fflush(f);
+}
+
+static void json_result(FILE *f, const char *name, const result_t *r,
+                        int first)
+{
+    fprintf(f, "%s    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+               "\"ns_per_op_min\": %.3f, \"ns_per_op_max\": %.3f, "
+               "\"ns_per_op_mean\": %.3f, \"ns_per_op_stddev\": %.3f, "
+               "\"bytes_per_op\": %.1f, \"bytes_per_sec\": %.1f, "
+               "\"iterations\": %llu, \"samples\": %zu}",
+            first ? "" : ",\n", name, r->median, r->min, r->max, r->mean,
+            r->stddev, r->bytes_per_op, bytes_per_sec(r),
+            (unsigned long long)r->iterations, r->samples);
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: mp3tag_bench [options]\n"
+        "  -r REPS    timed samples per benchmark (default 15)\n"
+        "  -t MS      target duration of one sample (default 20)\n"
+        "  -w MS      warmup per benchmark (default 200)\n"
+        "  -s SEED    seed for the synthetic tags (default 1)\n"
+        "  -f FILTER  only benchmarks whose name contains FILTER\n"
+        "  -o FILE    write results as JSON (- for stdout)\n"
+        "  -l         list benchmarks and exit\n");
+}
+
+int main(int argc, char **argv)
+{
+    long reps = 15, sample_ms = 20, warmup_ms = 200;
+    unsigned long long seed = 1;
+    const char *filter = NULL, *json_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:t:w:s:f:o:lh")) != -1) {
+        switch (opt) {
+        case 'r': reps      = strtol(optarg, NULL, 10);    break;
+        case 't': sample_ms = strtol(optarg, NULL, 10);    break;
+        case 'w': warmup_ms = strtol(optarg, NULL, 10);    break;
+        case 's': seed      = strtoull(optarg, NULL, 0);   break;
+        case 'f': filter    = optarg;                      break;
+        case 'o': json_path = optarg;                      break;
+        case 'l':
+            for (size_t i = 0; i < BENCH_COUNT; i++)
+                puts(benches[i].name);
+            return 0;
+        case 'h': usage(stdout); return 0;
+        default:  usage(stderr); return 2;
+        }
+    }
+    if (optind != argc || reps < 1 || sample_ms < 0 || warmup_ms < 0) {
+        usage(stderr);
+        return 2;
+    }
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!json) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            return 1;
+        }
+        fprintf(json, "{\n  \"library\": \"libmp3tag\",\n"
+                      "  \"version\": \"%s\",\n  \"seed\": %llu,\n"
+                      "  \"repetitions\": %ld,\n  \"sample_ms\": %ld,\n"
+                      "  \"warmup_ms\": %ld,\n  \"benchmarks\": [\n",
+                mp3tag_version(), seed, reps, sample_ms, warmup_ms);
+    }
+
+    /* The table goes to stderr when JSON takes stdout */
+    FILE *table = json == stdout ? stderr : stdout;
+    fprintf(table, "%-34s %12s %7s %10s %10s\n", "benchmark", "ns/op",
+            "cv", "min ns/op", "MiB/s");
+
+    size_t selected[BENCH_COUNT], n_selected = 0;
+    for (size_t i = 0; i < BENCH_COUNT; i++)
+        if (!filter || strstr(benches[i].name, filter))
+            selected[n_selected++] = i;
+
+    int rc = 0, first = 1;
+    for (size_t s = 0; s < n_selected; s++) {
+        const bench_t *b = &benches[selected[s]];
+        fixture_t fx;
+        if (fixture_init(&fx, b, seed) != 0) {
+            fprintf(stderr, "%s: fixture setup failed\n", b->name);
+            rc = 1;
+            continue;
+        }
+
+        result_t r;
+        measure(b->kernel, &fx, (size_t)reps,
+                (uint64_t)sample_ms * 1000000u,
+                (uint64_t)warmup_ms * 1000000u, &r);
+        fixture_free(&fx);
+
+        print_row(table, b->name, &r);
+        if (json) {
+            json_result(json, b->name, &r, first);
+            first = 0;
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        if (json != stdout && fclose(json) != 0) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            rc = 1;
+        }
+    }
+    return rc;
+}
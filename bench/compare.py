@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Copyright (c) 2025 Morgan Prior
+"""Compare two mp3tag_bench JSON files and flag regressions.
+
+    compare.py BASELINE.json CURRENT.json [--threshold 0.05] [--noise 3]
+
+A benchmark regresses when its median ns/op grows by more than the
+threshold *and* by more than `noise` times the combined coefficient of
+variation of both runs, so a noisy kernel needs a larger change to be
+flagged. Exits 1 if anything regressed, 2 on bad input.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+
+def load(path):
+    try:
+        with open(path) as f:
+            doc = json.load(f)
+        return {b["name"]: b for b in doc["benchmarks"]}
+    except (OSError, ValueError, KeyError, TypeError) as e:
+        sys.exit(f"{path}: not an mp3tag_bench result ({e})")
+
+
+def cv(b):
+    mean = b.get("ns_per_op_mean") or b["ns_per_op"]
+    return b.get("ns_per_op_stddev", 0.0) / mean if mean > 0 else 0.0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("baseline")
+    ap.add_argument("current")
+    ap.add_argument("--threshold", type=float, default=0.05,
+                    help="smallest relative slowdown reported (default 0.05)")
+    ap.add_argument("--noise", type=float, default=3.0,
+                    help="multiples of combined CV a change must exceed "
+                         "(default 3)")
+    args = ap.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+
+    regressions = 0
+    print(f"{'benchmark':<34} {'base ns/op':>12} {'ns/op':>12} "
+          f"{'change':>8}  verdict")
+    for name in sorted(base.keys() | cur.keys()):
+        if name not in cur:
+            print(f"{name:<34} {'':>12} {'':>12} {'':>8}  missing")
+            continue
+        if name not in base:
+            print(f"{name:<34} {'':>12} {cur[name]['ns_per_op']:>12.1f} "
+                  f"{'':>8}  new")
+            continue
+
+        b, c = base[name], cur[name]
+        if b["ns_per_op"] <= 0:
+            continue
+        change = c["ns_per_op"] / b["ns_per_op"] - 1.0
+        bar = max(args.threshold, args.noise * math.hypot(cv(b), cv(c)))
+        if change > bar:
+            verdict = "REGRESSION"
+            regressions += 1
+        elif change < -bar:
+            verdict = "improved"
+        else:
+            verdict = "ok"
+        print(f"{name:<34} {b['ns_per_op']:>12.1f} {c['ns_per_op']:>12.1f} "
+              f"{change:>+7.1%}  {verdict}")
+
+    if regressions:
+        print(f"\n{regressions} regression(s)")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,841 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Synthetic corpus generation.
+ *
+ * Only integer arithmetic decides what a file looks like, so corpora are
+ * identical across compilers and libms. Audio payloads are silence: the
+ * library never decodes them, and zeros keep a large corpus cheap to
+ * write and to compress.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* fseeko */
+#define _FILE_OFFSET_BITS 64
+
+#include "corpus.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* ------------------------------------------------------------------ */
+/*  Random numbers                                                     */
+/* ------------------------------------------------------------------ */
+
+uint64_t corpus_rng_next(corpus_rng_t *rng)
+{
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void corpus_rng_seed(corpus_rng_t *rng, uint64_t seed, uint64_t stream)
+{
+    rng->state = seed;
+    rng->state = corpus_rng_next(rng) ^ (stream * 0xD1B54A32D192ED03ull);
+    corpus_rng_next(rng);
+}
+
+uint32_t corpus_rng_range(corpus_rng_t *rng, uint32_t lo, uint32_t hi)
+{
+    if (hi <= lo) return lo;
+    return lo + (uint32_t)(corpus_rng_next(rng) % ((uint64_t)hi - lo + 1));
+}
+
+static int floor_log2(uint32_t v)
+{
+    int b = 0;
+    while (v >>= 1) b++;
+    return b;
+}
+
+uint32_t corpus_rng_log(corpus_rng_t *rng, uint32_t lo, uint32_t hi)
+{
+    if (lo == 0) lo = 1;
+    if (hi <= lo) return lo;
+
+    /* Pick an octave, then a value inside it */
+    int b = (int)corpus_rng_range(rng, (uint32_t)floor_log2(lo),
+                                  (uint32_t)floor_log2(hi));
+    uint64_t first = (uint64_t)1 << b;
+    uint64_t last  = (first << 1) - 1;
+    if (first < lo) first = lo;
+    if (last > hi)  last = hi;
+    return corpus_rng_range(rng, (uint32_t)first, (uint32_t)last);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Specifications                                                     */
+/* ------------------------------------------------------------------ */
+
+static const corpus_limits_t default_limits = {
+    .max_frames      = 5000,
+    .max_apic_bytes  = 4u << 20,
+    .max_audio_bytes = 1u << 20,
+};
+
+/* Largest WAV data chunk: leaves room for the tag under the RIFF limit */
+#define LARGE_DATA_MAX   0xF0000000u
+#define LARGE_DATA_SPAN  0x10000000u
+
+static int pick_encoding(corpus_rng_t *rng, int version)
+{
+    uint32_t r = corpus_rng_range(rng, 0, 99);
+    if (version == 3) {
+        if (r < 40) return CORPUS_ENC_LATIN1;
+        if (r < 80) return CORPUS_ENC_UTF16_BOM;
+        return CORPUS_ENC_MIXED;
+    }
+    if (r < 20) return CORPUS_ENC_LATIN1;
+    if (r < 40) return CORPUS_ENC_UTF16_BOM;
+    if (r < 50) return CORPUS_ENC_UTF16BE;
+    if (r < 85) return CORPUS_ENC_UTF8;
+    return CORPUS_ENC_MIXED;
+}
+
+static uint32_t pick_padding(corpus_rng_t *rng)
+{
+    uint32_t r = corpus_rng_range(rng, 0, 99);
+    if (r < 25) return 0;
+    if (r < 35) return 256;
+    if (r < 60) return 1024;
+    if (r < 75) return 4096;
+    return corpus_rng_range(rng, 0, 65536);
+}
+
+void corpus_spec(corpus_spec_t *spec, uint64_t seed, uint64_t index,
+                 int large, const corpus_limits_t *limits)
+{
+    if (!limits) limits = &default_limits;
+
+    corpus_rng_t rng;
+    corpus_rng_seed(&rng, seed, index * 2 + (large ? 1 : 0));
+    memset(spec, 0, sizeof(*spec));
+
+    uint32_t r = corpus_rng_range(&rng, 0, 99);
+    if (large)       spec->container = CORPUS_WAV_LARGE;
+    else if (r < 50) spec->container = CORPUS_MP3;
+    else if (r < 60) spec->container = CORPUS_AAC;
+    else if (r < 80) spec->container = CORPUS_WAV;
+    else             spec->container = CORPUS_AIFF;
+
+    spec->version  = corpus_rng_range(&rng, 0, 1) ? 4 : 3;
+    spec->encoding = pick_encoding(&rng, spec->version);
+    spec->frames   = corpus_rng_log(&rng, 10, limits->max_frames > 10
+                                              ? limits->max_frames : 10);
+    if (corpus_rng_range(&rng, 0, 99) >= 40 && limits->max_apic_bytes > 0)
+        spec->apic_bytes = corpus_rng_log(&rng, 1024, limits->max_apic_bytes);
+    spec->padding  = pick_padding(&rng);
+
+    switch (spec->container) {
+    case CORPUS_MP3:
+    case CORPUS_AAC:
+        spec->id3v1 = corpus_rng_range(&rng, 0, 99) < 35;
+        break;
+    case CORPUS_WAV:
+    case CORPUS_AIFF:
+        spec->tag_first = corpus_rng_range(&rng, 0, 99) < 30;
+        break;
+    default:
+        break;
+    }
+
+    if (large) {
+        /* The tag sits behind the hole, where only a seek reaches it */
+        spec->audio_bytes = (LARGE_DATA_MAX -
+                             corpus_rng_range(&rng, 0, LARGE_DATA_SPAN)) & ~3u;
+    } else {
+        uint64_t max = limits->max_audio_bytes;
+        if (max > UINT32_MAX) max = UINT32_MAX;
+        spec->audio_bytes = corpus_rng_log(&rng, 16384 < max ? 16384
+                                                              : (uint32_t)max,
+                                           (uint32_t)max) & ~(uint64_t)3;
+    }
+
+    spec->content_seed = corpus_rng_next(&rng);
+}
+
+const char *corpus_container_name(corpus_container_t c)
+{
+    static const char *const names[CORPUS_CONTAINER_COUNT] = {
+        "mp3", "aac", "wav", "aiff", "wav_large"
+    };
+    return (unsigned)c < CORPUS_CONTAINER_COUNT ? names[c] : "?";
+}
+
+const char *corpus_extension(corpus_container_t c)
+{
+    static const char *const ext[CORPUS_CONTAINER_COUNT] = {
+        "mp3", "aac", "wav", "aiff", "wav"
+    };
+    return (unsigned)c < CORPUS_CONTAINER_COUNT ? ext[c] : "bin";
+}
+
+const char *corpus_encoding_name(int encoding)
+{
+    static const char *const names[] = {
+        "latin1", "utf16", "utf16be", "utf8", "mixed"
+    };
+    return (unsigned)encoding < 5 ? names[encoding] : "?";
+}
+
+/* ------------------------------------------------------------------ */
+/*  Byte buffer                                                        */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint8_t *data;
+    size_t   len;
+    size_t   cap;
+    int      oom;
+} out_buf_t;
+
+static void put(out_buf_t *b, const void *p, size_t n)
+{
+    if (b->oom) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        uint8_t *d = realloc(b->data, cap);
+        if (!d) {
+            b->oom = 1;
+            return;
+        }
+        b->data = d;
+        b->cap  = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void put_byte(out_buf_t *b, uint8_t v)
+{
+    put(b, &v, 1);
+}
+
+static void put_str(out_buf_t *b, const char *s)
+{
+    put(b, s, strlen(s));
+}
+
+static void put_random(out_buf_t *b, corpus_rng_t *rng, size_t n)
+{
+    while (n > 0) {
+        uint64_t v = corpus_rng_next(rng);
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; i++) bytes[i] = (uint8_t)(v >> (8 * i));
+        size_t k = n < 8 ? n : 8;
+        put(b, bytes, k);
+        n -= k;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Text                                                               */
+/* ------------------------------------------------------------------ */
+
+#define MAX_TEXT_CPS 512
+
+static const char *const syllables[] = {
+    "ka", "lo", "mi", "ren", "sa", "tor", "vel", "ne", "dru", "qua",
+    "bel", "ost", "fin", "ga", "hum", "ri", "zen", "pa", "cor", "lis",
+};
+
+/* Representable in ISO-8859-1 */
+static const char *const latin_words[] = {
+    "Café", "Über", "Señora", "Garçon", "Smörgåsbord", "Mañana", "Æther",
+};
+
+/* Need a Unicode encoding; the last one is outside the BMP */
+static const char *const unicode_words[] = {
+    "東京", "Ελλάδα", "Москва", "서울", "🎵",
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Append the code points of UTF-8 `s` */
+static size_t utf8_cps(const char *s, uint32_t *cp, size_t n, size_t max)
+{
+    const uint8_t *p = (const uint8_t *)s;
+    while (*p && n < max) {
+        uint32_t c = *p++;
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        if (extra) c &= 0x3Fu >> extra;
+        while (extra-- > 0 && *p)
+            c = (c << 6) | (*p++ & 0x3Fu);
+        cp[n++] = c;
+    }
+    return n;
+}
+
+/* `words` words of title-cased pseudo text */
+static size_t gen_words(corpus_rng_t *rng, uint32_t *cp, uint32_t words)
+{
+    size_t n = 0;
+    for (uint32_t w = 0; w < words && n + 32 < MAX_TEXT_CPS; w++) {
+        if (w > 0) cp[n++] = ' ';
+        uint32_t r = corpus_rng_range(rng, 0, 23);
+        if (r == 0) {
+            n = utf8_cps(unicode_words[corpus_rng_range(rng, 0,
+                             COUNT_OF(unicode_words) - 1)], cp, n,
+                         MAX_TEXT_CPS);
+        } else if (r < 4) {
+            n = utf8_cps(latin_words[corpus_rng_range(rng, 0,
+                             COUNT_OF(latin_words) - 1)], cp, n,
+                         MAX_TEXT_CPS);
+        } else {
+            size_t start = n;
+            uint32_t k = corpus_rng_range(rng, 1, 4);
+            for (uint32_t s = 0; s < k; s++)
+                n = utf8_cps(syllables[corpus_rng_range(rng, 0,
+                                 COUNT_OF(syllables) - 1)], cp, n,
+                             MAX_TEXT_CPS);
+            cp[start] -= 'a' - 'A';
+        }
+    }
+    return n;
+}
+
+static size_t ascii_cps(const char *s, uint32_t *cp)
+{
+    return utf8_cps(s, cp, 0, MAX_TEXT_CPS);
+}
+
+static void put_utf16_unit(out_buf_t *b, uint32_t u, int le)
+{
+    if (le) {
+        put_byte(b, (uint8_t)u);
+        put_byte(b, (uint8_t)(u >> 8));
+    } else {
+        put_byte(b, (uint8_t)(u >> 8));
+        put_byte(b, (uint8_t)u);
+    }
+}
+
+/* Encode code points; text encoding 1 gets a BOM of either order */
+static void put_text(out_buf_t *b, corpus_rng_t *rng, int enc,
+                     const uint32_t *cp, size_t n, int terminate)
+{
+    int le = 0;
+    if (enc == CORPUS_ENC_UTF16_BOM) {
+        /* Most taggers write little-endian; some write big-endian */
+        le = corpus_rng_range(rng, 0, 3) != 0;
+        put_utf16_unit(b, 0xFEFF, le);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t c = cp[i];
+        switch (enc) {
+        case CORPUS_ENC_LATIN1:
+            put_byte(b, c <= 0xFF ? (uint8_t)c : (uint8_t)'?');
+            break;
+        case CORPUS_ENC_UTF16_BOM:
+        case CORPUS_ENC_UTF16BE:
+            if (c >= 0x10000) {
+                c -= 0x10000;
+                put_utf16_unit(b, 0xD800 | (c >> 10), le);
+                put_utf16_unit(b, 0xDC00 | (c & 0x3FF), le);
+            } else {
+                put_utf16_unit(b, c, le);
+            }
+            break;
+        default: {
+            uint8_t u[4];
+            size_t k;
+            if (c < 0x80) {
+                u[0] = (uint8_t)c;
+                k = 1;
+            } else if (c < 0x800) {
+                u[0] = (uint8_t)(0xC0 | (c >> 6));
+                u[1] = (uint8_t)(0x80 | (c & 0x3F));
+                k = 2;
+            } else if (c < 0x10000) {
+                u[0] = (uint8_t)(0xE0 | (c >> 12));
+                u[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                u[2] = (uint8_t)(0x80 | (c & 0x3F));
+                k = 3;
+            } else {
+                u[0] = (uint8_t)(0xF0 | (c >> 18));
+                u[1] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+                u[2] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                u[3] = (uint8_t)(0x80 | (c & 0x3F));
+                k = 4;
+            }
+            put(b, u, k);
+            break;
+        }
+        }
+    }
+
+    if (terminate) {
+        put_byte(b, 0);
+        if (enc == CORPUS_ENC_UTF16_BOM || enc == CORPUS_ENC_UTF16BE)
+            put_byte(b, 0);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  ID3v2 frames                                                       */
+/* ------------------------------------------------------------------ */
+
+static size_t frame_begin(out_buf_t *b, const char *id)
+{
+    size_t at = b->len;
+    uint8_t hdr[10] = { 0 };
+    memcpy(hdr, id, 4);
+    put(b, hdr, sizeof(hdr));
+    return at;
+}
+
+static void frame_end(out_buf_t *b, size_t at, int version)
+{
+    if (b->oom) return;
+    uint32_t size = (uint32_t)(b->len - at - 10);
+    uint8_t *p = b->data + at + 4;
+    if (version == 4) {
+        p[0] = (uint8_t)((size >> 21) & 0x7F);
+        p[1] = (uint8_t)((size >> 14) & 0x7F);
+        p[2] = (uint8_t)((size >> 7) & 0x7F);
+        p[3] = (uint8_t)(size & 0x7F);
+    } else {
+        p[0] = (uint8_t)(size >> 24);
+        p[1] = (uint8_t)(size >> 16);
+        p[2] = (uint8_t)(size >> 8);
+        p[3] = (uint8_t)size;
+    }
+}
+
+static int frame_encoding(const corpus_spec_t *spec, corpus_rng_t *rng)
+{
+    if (spec->encoding != CORPUS_ENC_MIXED) return spec->encoding;
+    return (int)corpus_rng_range(rng, 0, spec->version == 4 ? 3 : 1);
+}
+
+static void text_frame(out_buf_t *b, const corpus_spec_t *spec,
+                       corpus_rng_t *rng, const char *id,
+                       const uint32_t *cp, size_t n)
+{
+    int enc = frame_encoding(spec, rng);
+    size_t at = frame_begin(b, id);
+    put_byte(b, (uint8_t)enc);
+    put_text(b, rng, enc, cp, n, 0);
+    frame_end(b, at, spec->version);
+}
+
+typedef enum { TEXT_WORDS, TEXT_TRACK, TEXT_DATE, TEXT_GENRE } text_kind_t;
+
+static const struct {
+    const char *id;
+    text_kind_t kind;
+    uint32_t    min_words, max_words;
+} core_frames[] = {
+    { "TIT2", TEXT_WORDS, 1, 6 },
+    { "TPE1", TEXT_WORDS, 1, 3 },
+    { "TALB", TEXT_WORDS, 1, 5 },
+    { "TRCK", TEXT_TRACK, 0, 0 },
+    { "TYER", TEXT_DATE,  0, 0 },   /* TDRC in v2.4 */
+    { "TCON", TEXT_GENRE, 0, 0 },
+    { "TPE2", TEXT_WORDS, 1, 3 },
+    { "TCOM", TEXT_WORDS, 2, 4 },
+    { "TPOS", TEXT_TRACK, 0, 0 },
+    { "TSSE", TEXT_WORDS, 1, 2 },
+};
+
+static const char *const genres[] = {
+    "Rock", "Jazz", "Electronic", "Classical", "Hip-Hop", "Folk", "(17)",
+    "Ambient", "Soundtrack", "Pop",
+};
+
+static void core_frame(out_buf_t *b, const corpus_spec_t *spec,
+                       corpus_rng_t *rng, size_t i)
+{
+    uint32_t cp[MAX_TEXT_CPS];
+    char tmp[32];
+    size_t n;
+    const char *id = core_frames[i].id;
+
+    switch (core_frames[i].kind) {
+    case TEXT_TRACK: {
+        uint32_t total = corpus_rng_range(rng, 1, 24);
+        snprintf(tmp, sizeof(tmp), "%u/%u",
+                 (unsigned)corpus_rng_range(rng, 1, total), (unsigned)total);
+        n = ascii_cps(tmp, cp);
+        break;
+    }
+    case TEXT_DATE:
+        if (spec->version == 4) {
+            id = "TDRC";
+            snprintf(tmp, sizeof(tmp), "%u-%02u-%02u",
+                     (unsigned)corpus_rng_range(rng, 1950, 2025),
+                     (unsigned)corpus_rng_range(rng, 1, 12),
+                     (unsigned)corpus_rng_range(rng, 1, 28));
+        } else {
+            snprintf(tmp, sizeof(tmp), "%u",
+                     (unsigned)corpus_rng_range(rng, 1950, 2025));
+        }
+        n = ascii_cps(tmp, cp);
+        break;
+    case TEXT_GENRE:
+        n = ascii_cps(genres[corpus_rng_range(rng, 0, COUNT_OF(genres) - 1)],
+                      cp);
+        break;
+    default:
+        n = gen_words(rng, cp, corpus_rng_range(rng, core_frames[i].min_words,
+                                                core_frames[i].max_words));
+        break;
+    }
+    text_frame(b, spec, rng, id, cp, n);
+}
+
+static void apic_frame(out_buf_t *b, const corpus_spec_t *spec,
+                       corpus_rng_t *rng)
+{
+    static const uint8_t jpeg[] = {
+        0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00
+    };
+    static const uint8_t png[] = {
+        0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A
+    };
+    int is_png = corpus_rng_range(rng, 0, 4) == 0;
+    const uint8_t *magic = is_png ? png : jpeg;
+    size_t magic_len = is_png ? sizeof(png) : sizeof(jpeg);
+    size_t bytes = spec->apic_bytes > magic_len ? spec->apic_bytes
+                                                : magic_len;
+
+    size_t at = frame_begin(b, "APIC");
+    put_byte(b, CORPUS_ENC_LATIN1);
+    put_str(b, is_png ? "image/png" : "image/jpeg");
+    put_byte(b, 0);
+    put_byte(b, 3);                 /* Front cover */
+    put_byte(b, 0);                 /* Empty description */
+    put(b, magic, magic_len);
+    put_random(b, rng, bytes - magic_len);
+    frame_end(b, at, spec->version);
+}
+
+/* Fill frames: user text, comments and private data, all distinct */
+static void filler_frame(out_buf_t *b, const corpus_spec_t *spec,
+                         corpus_rng_t *rng, uint32_t i)
+{
+    static const char *const langs[] = { "eng", "deu", "fra", "jpn" };
+    uint32_t cp[MAX_TEXT_CPS];
+    char desc[32];
+    uint32_t r = corpus_rng_range(rng, 0, 9);
+
+    if (r < 7) {
+        int enc = frame_encoding(spec, rng);
+        snprintf(desc, sizeof(desc), "BENCH_%05u", (unsigned)i);
+        size_t at = frame_begin(b, "TXXX");
+        put_byte(b, (uint8_t)enc);
+        put_text(b, rng, enc, cp, ascii_cps(desc, cp), 1);
+        put_text(b, rng, enc, cp,
+                 gen_words(rng, cp, corpus_rng_range(rng, 1, 8)), 0);
+        frame_end(b, at, spec->version);
+    } else if (r < 9) {
+        int enc = frame_encoding(spec, rng);
+        snprintf(desc, sizeof(desc), "note %u", (unsigned)i);
+        size_t at = frame_begin(b, "COMM");
+        put_byte(b, (uint8_t)enc);
+        put_str(b, langs[corpus_rng_range(rng, 0, COUNT_OF(langs) - 1)]);
+        put_text(b, rng, enc, cp, ascii_cps(desc, cp), 1);
+        put_text(b, rng, enc, cp,
+                 gen_words(rng, cp, corpus_rng_range(rng, 5, 40)), 0);
+        frame_end(b, at, spec->version);
+    } else {
+        snprintf(desc, sizeof(desc), "org.example.bench.%u", (unsigned)i);
+        size_t at = frame_begin(b, "PRIV");
+        put_str(b, desc);
+        put_byte(b, 0);
+        put_random(b, rng, corpus_rng_range(rng, 16, 256));
+        frame_end(b, at, spec->version);
+    }
+}
+
+uint8_t *corpus_build_tag(const corpus_spec_t *spec, size_t *size)
+{
+    corpus_rng_t rng;
+    corpus_rng_seed(&rng, spec->content_seed, 0);
+
+    out_buf_t b = { 0 };
+    uint8_t hdr[10] = { 'I', 'D', '3', (uint8_t)spec->version, 0, 0 };
+    put(&b, hdr, sizeof(hdr));
+
+    uint32_t frames = spec->frames;
+    if (spec->apic_bytes && frames > 0) {
+        apic_frame(&b, spec, &rng);
+        frames--;
+    }
+    for (size_t i = 0; i < COUNT_OF(core_frames) && frames > 0; i++) {
+        core_frame(&b, spec, &rng, i);
+        frames--;
+    }
+    for (uint32_t i = 0; i < frames; i++)
+        filler_frame(&b, spec, &rng, i);
+
+    for (uint32_t i = 0; i < spec->padding; i++)
+        put_byte(&b, 0);
+
+    if (b.oom) {
+        free(b.data);
+        return NULL;
+    }
+
+    uint32_t body = (uint32_t)(b.len - 10);
+    b.data[6] = (uint8_t)((body >> 21) & 0x7F);
+    b.data[7] = (uint8_t)((body >> 14) & 0x7F);
+    b.data[8] = (uint8_t)((body >> 7) & 0x7F);
+    b.data[9] = (uint8_t)(body & 0x7F);
+
+    *size = b.len;
+    return b.data;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Files                                                              */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    FILE    *f;
+    uint64_t size;
+    uint64_t hash;
+    int      error;
+} out_file_t;
+
+static void fnv(out_file_t *o, const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        o->hash ^= p[i];
+        o->hash *= 0x100000001B3ull;
+    }
+}
+
+static void emit(out_file_t *o, const void *p, size_t n)
+{
+    if (o->error || n == 0) return;
+    if (fwrite(p, 1, n, o->f) != n) {
+        o->error = errno ? errno : EIO;
+        return;
+    }
+    fnv(o, p, n);
+    o->size += n;
+}
+
+static void emit_be32(out_file_t *o, uint32_t v)
+{
+    uint8_t b[4] = {
+        (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v
+    };
+    emit(o, b, 4);
+}
+
+static void emit_le32(out_file_t *o, uint32_t v)
+{
+    uint8_t b[4] = {
+        (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)
+    };
+    emit(o, b, 4);
+}
+
+static void emit_zeros(out_file_t *o, uint64_t n)
+{
+    static const uint8_t zeros[65536];
+    while (n > 0 && !o->error) {
+        size_t k = n < sizeof(zeros) ? (size_t)n : sizeof(zeros);
+        emit(o, zeros, k);
+        n -= k;
+    }
+}
+
+/* Skip `n` bytes, leaving a hole; only its length enters the checksum */
+static void emit_hole(out_file_t *o, uint64_t n)
+{
+    if (o->error) return;
+    if (fseeko(o->f, (off_t)n, SEEK_CUR) != 0) {
+        o->error = errno ? errno : EIO;
+        return;
+    }
+    uint8_t len[8];
+    for (int i = 0; i < 8; i++) len[i] = (uint8_t)(n >> (8 * i));
+    fnv(o, len, sizeof(len));
+    o->size += n;
+}
+
+/* Silent MPEG1 Layer III frames, 128 kbps, 44.1 kHz */
+static void emit_mp3_audio(out_file_t *o, uint64_t bytes)
+{
+    uint8_t frame[417] = { 0xFF, 0xFB, 0x90, 0x00 };
+    uint64_t n = bytes / sizeof(frame);
+    for (uint64_t i = 0; i < (n ? n : 1); i++)
+        emit(o, frame, sizeof(frame));
+}
+
+/* ADTS AAC-LC frames of 256 bytes */
+static void emit_aac_audio(out_file_t *o, uint64_t bytes)
+{
+    uint8_t frame[256] = { 0xFF, 0xF1, 0x50, 0x80, 0x20, 0x1F, 0xFC };
+    uint64_t n = bytes / sizeof(frame);
+    for (uint64_t i = 0; i < (n ? n : 1); i++)
+        emit(o, frame, sizeof(frame));
+}
+
+static void emit_id3v1(out_file_t *o, corpus_rng_t *rng)
+{
+    uint8_t tag[128] = { 'T', 'A', 'G' };
+    uint32_t cp[MAX_TEXT_CPS];
+    static const size_t fields[][2] = {
+        { 3, 30 }, { 33, 30 }, { 63, 30 }, { 97, 28 }   /* title..comment */
+    };
+
+    for (size_t f = 0; f < COUNT_OF(fields); f++) {
+        size_t n = gen_words(rng, cp, corpus_rng_range(rng, 1, 5));
+        for (size_t i = 0; i < n && i < fields[f][1]; i++)
+            tag[fields[f][0] + i] = cp[i] <= 0xFF ? (uint8_t)cp[i]
+                                                 : (uint8_t)'?';
+    }
+    char year[8];
+    snprintf(year, sizeof(year), "%u",
+             (unsigned)corpus_rng_range(rng, 1950, 2025));
+    memcpy(tag + 93, year, 4);
+    tag[126] = (uint8_t)corpus_rng_range(rng, 1, 24);    /* v1.1 track */
+    tag[127] = (uint8_t)corpus_rng_range(rng, 0, 125);   /* Genre */
+    emit(o, tag, sizeof(tag));
+}
+
+static void emit_wav(out_file_t *o, const corpus_spec_t *spec,
+                     const uint8_t *tag, size_t tag_len)
+{
+    uint64_t data = spec->audio_bytes;
+    uint32_t tag_chunk = tag_len ? 8 + (uint32_t)tag_len +
+                                   (uint32_t)(tag_len & 1) : 0;
+
+    emit(o, "RIFF", 4);
+    emit_le32(o, (uint32_t)(4 + 24 + 8 + data + tag_chunk));
+    emit(o, "WAVE", 4);
+
+    /* fmt: PCM, stereo, 44.1 kHz, 16-bit */
+    static const uint8_t fmt[24] = {
+        'f', 'm', 't', ' ', 16, 0, 0, 0,
+        1, 0, 2, 0, 0x44, 0xAC, 0, 0, 0x10, 0xB1, 0x02, 0, 4, 0, 16, 0
+    };
+    emit(o, fmt, sizeof(fmt));
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == (spec->tag_first ? 0 : 1)) {
+            if (!tag_len) continue;
+            emit(o, "id3 ", 4);
+            emit_le32(o, (uint32_t)tag_len);
+            emit(o, tag, tag_len);
+            if (tag_len & 1) emit_zeros(o, 1);
+        } else {
+            emit(o, "data", 4);
+            emit_le32(o, (uint32_t)data);
+            if (spec->container == CORPUS_WAV_LARGE)
+                emit_hole(o, data);
+            else
+                emit_zeros(o, data);
+        }
+    }
+}
+
+static void emit_aiff(out_file_t *o, const corpus_spec_t *spec,
+                      const uint8_t *tag, size_t tag_len)
+{
+    uint64_t data = spec->audio_bytes;
+    uint32_t tag_chunk = tag_len ? 8 + (uint32_t)tag_len +
+                                   (uint32_t)(tag_len & 1) : 0;
+
+    emit(o, "FORM", 4);
+    emit_be32(o, (uint32_t)(4 + 26 + 16 + data + tag_chunk));
+    emit(o, "AIFF", 4);
+
+    /* COMM: stereo, 16-bit, 44.1 kHz as 80-bit extended */
+    emit(o, "COMM", 4);
+    emit_be32(o, 18);
+    uint8_t comm[18] = { 0, 2 };
+    uint32_t frames = (uint32_t)(data / 4);
+    comm[2] = (uint8_t)(frames >> 24);
+    comm[3] = (uint8_t)(frames >> 16);
+    comm[4] = (uint8_t)(frames >> 8);
+    comm[5] = (uint8_t)frames;
+    comm[7] = 16;
+    static const uint8_t rate[10] = { 0x40, 0x0E, 0xAC, 0x44 };
+    memcpy(comm + 8, rate, sizeof(rate));
+    emit(o, comm, sizeof(comm));
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == (spec->tag_first ? 0 : 1)) {
+            if (!tag_len) continue;
+            emit(o, "ID3 ", 4);
+            emit_be32(o, (uint32_t)tag_len);
+            emit(o, tag, tag_len);
+            if (tag_len & 1) emit_zeros(o, 1);
+        } else {
+            emit(o, "SSND", 4);
+            emit_be32(o, (uint32_t)(8 + data));
+            emit_zeros(o, 8 + data);        /* offset, block size, audio */
+        }
+    }
+}
+
+int corpus_write(const char *path, const corpus_spec_t *spec,
+                 corpus_result_t *result)
+{
+    size_t tag_len = 0;
+    uint8_t *tag = NULL;
+    if (spec->frames > 0 && !(tag = corpus_build_tag(spec, &tag_len))) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    out_file_t o = { .hash = 0xCBF29CE484222325ull };
+    o.f = fopen(path, "wb");
+    if (!o.f) {
+        free(tag);
+        return -1;
+    }
+
+    /* Separate stream from the tag, so ID3v1 presence leaves it unchanged */
+    corpus_rng_t rng;
+    corpus_rng_seed(&rng, spec->content_seed, 1);
+
+    switch (spec->container) {
+    case CORPUS_MP3:
+    case CORPUS_AAC:
+        emit(&o, tag, tag_len);
+        if (spec->container == CORPUS_MP3)
+            emit_mp3_audio(&o, spec->audio_bytes);
+        else
+            emit_aac_audio(&o, spec->audio_bytes);
+        if (spec->id3v1) emit_id3v1(&o, &rng);
+        break;
+    case CORPUS_WAV:
+    case CORPUS_WAV_LARGE:
+        emit_wav(&o, spec, tag, tag_len);
+        break;
+    case CORPUS_AIFF:
+        emit_aiff(&o, spec, tag, tag_len);
+        break;
+    default:
+        o.error = EINVAL;
+        break;
+    }
+    free(tag);
+
+    if (fclose(o.f) != 0 && !o.error)
+        o.error = errno ? errno : EIO;
+    if (o.error) {
+        errno = o.error;
+        return -1;
+    }
+
+    if (result) {
+        result->size      = o.size;
+        result->tag_bytes = tag_len;
+        result->checksum  = o.hash;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef MP3TAG_BENCH_CORPUS_H
+#define MP3TAG_BENCH_CORPUS_H
+
+/*
+ * Deterministic synthetic corpus.
+ *
+ * Files are assembled byte by byte here rather than through the library,
+ * so a writer bug cannot hide itself in the data it is measured against.
+ * Everything derives from (seed, index): file i of a corpus is the same
+ * whatever the corpus size, and the same on every platform.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------- Random numbers ---------- */
+
+typedef struct {
+    uint64_t state;
+} corpus_rng_t;
+
+/* Independent stream `stream` of `seed` (splitmix64) */
+void     corpus_rng_seed(corpus_rng_t *rng, uint64_t seed, uint64_t stream);
+uint64_t corpus_rng_next(corpus_rng_t *rng);
+/* Uniform in [lo, hi] */
+uint32_t corpus_rng_range(corpus_rng_t *rng, uint32_t lo, uint32_t hi);
+/* Log-uniform in [lo, hi]: as many files with 10-100 frames as 100-1000 */
+uint32_t corpus_rng_log(corpus_rng_t *rng, uint32_t lo, uint32_t hi);
+
+/* ---------- File specifications ---------- */
+
+typedef enum {
+    CORPUS_MP3,
+    CORPUS_AAC,
+    CORPUS_WAV,
+    CORPUS_AIFF,
+    CORPUS_WAV_LARGE,               /* Sparse data chunk near 4 GiB */
+    CORPUS_CONTAINER_COUNT
+} corpus_container_t;
+
+#define CORPUS_ENC_LATIN1    0
+#define CORPUS_ENC_UTF16_BOM 1
+#define CORPUS_ENC_UTF16BE   2      /* v2.4 only */
+#define CORPUS_ENC_UTF8      3      /* v2.4 only */
+#define CORPUS_ENC_MIXED     4      /* A different encoding per frame */
+
+typedef struct {
+    corpus_container_t container;
+    int      version;               /* ID3v2.3 or v2.4 */
+    int      encoding;              /* CORPUS_ENC_* */
+    uint32_t frames;                /* Total frames, picture included;
+                                       0 writes no ID3v2 tag at all */
+    uint32_t apic_bytes;            /* 0 = no APIC frame */
+    uint32_t padding;
+    int      id3v1;                 /* MP3/AAC: trailing ID3v1 tag */
+    int      tag_first;             /* WAV/AIFF: ID3 chunk before audio */
+    uint64_t audio_bytes;
+    uint64_t content_seed;          /* Text, picture and private data */
+} corpus_spec_t;
+
+typedef struct {
+    uint32_t max_frames;            /* Default 5000 */
+    uint32_t max_apic_bytes;        /* Default 4 MiB */
+    uint64_t max_audio_bytes;       /* Default 1 MiB (large WAVs excepted) */
+} corpus_limits_t;
+
+/*
+ * Draw file `index` of corpus `seed`. `large` picks CORPUS_WAV_LARGE;
+ * everything else is mixed: roughly half MP3, the rest AAC, WAV and AIFF.
+ */
+void corpus_spec(corpus_spec_t *spec, uint64_t seed, uint64_t index,
+                 int large, const corpus_limits_t *limits);
+
+const char *corpus_container_name(corpus_container_t c);
+const char *corpus_extension(corpus_container_t c);
+const char *corpus_encoding_name(int encoding);
+
+/* ---------- Generation ---------- */
+
+/*
+ * The ID3v2 tag of `spec` (header, frames and padding) in a malloc'd
+ * buffer, or NULL when out of memory.
+ */
+uint8_t *corpus_build_tag(const corpus_spec_t *spec, size_t *size);
+
+typedef struct {
+    uint64_t size;                  /* File size, holes included */
+    uint64_t tag_bytes;             /* ID3v2 tag, padding included */
+    uint64_t checksum;              /* FNV-1a of the bytes written */
+} corpus_result_t;
+
+/*
+ * Write `spec` to `path`. Large WAVs leave the audio as a hole, which
+ * the checksum covers by length only. Returns 0 or -1 (errno set).
+ */
+int corpus_write(const char *path, const corpus_spec_t *spec,
+                 corpus_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3TAG_BENCH_CORPUS_H */
@@ -0,0 +1,29 @@
+# Generates one seed twice, at two corpus sizes, and checks that the
+# manifest of the smaller run is a prefix of the larger one. Manifests
+# carry per-file checksums, so equal lines mean equal files.
+
+file(REMOVE_RECURSE ${DIR})
+file(MAKE_DIRECTORY ${DIR})
+
+foreach(run a:24 b:12)
+    string(REPLACE ":" ";" parts ${run})
+    list(GET parts 0 name)
+    list(GET parts 1 count)
+    execute_process(
+        COMMAND ${GEN} -n ${count} -s 7 -f 400 -p 65536 -a 65536 ${DIR}/${name}
+        RESULT_VARIABLE rc
+    )
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "mp3tag_corpus_gen failed (${rc})")
+    endif()
+endforeach()
+
+file(STRINGS ${DIR}/a/manifest.tsv big)
+file(STRINGS ${DIR}/b/manifest.tsv small)
+list(LENGTH small n)
+list(SUBLIST big 0 ${n} head)
+if(NOT n EQUAL 13 OR NOT head STREQUAL small)
+    message(FATAL_ERROR "corpus is not reproducible:\n${head}\n---\n${small}")
+endif()
+
+file(REMOVE_RECURSE ${DIR})
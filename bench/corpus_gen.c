@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * mp3tag_corpus_gen: write a seeded synthetic corpus and its manifest.
+ *
+ *   mp3tag_corpus_gen [-n COUNT] [-l COUNT] [-s SEED] [-f FRAMES]
+ *                     [-p BYTES] [-a BYTES] DIR
+ *
+ * DIR/manifest.tsv lists every file with the parameters it was drawn
+ * with and an FNV-1a checksum, so two runs can be compared line by line.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* getopt */
+
+#include "corpus.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: mp3tag_corpus_gen [options] DIR\n"
+        "  -n COUNT   regular files (default 100)\n"
+        "  -l COUNT   sparse WAVs with a data chunk near 4 GiB (default 0)\n"
+        "  -s SEED    corpus seed (default 1)\n"
+        "  -f FRAMES  most ID3v2 frames per file, at least 10 (default 5000)\n"
+        "  -p BYTES   largest APIC picture, 0 for none (default 4194304)\n"
+        "  -a BYTES   largest audio payload (default 1048576)\n");
+}
+
+static int parse_u64(const char *s, uint64_t *v)
+{
+    char *end;
+    errno = 0;
+    unsigned long long x = strtoull(s, &end, 0);
+    if (errno || end == s || *end || *s == '-') return -1;
+    *v = x;
+    return 0;
+}
+
+static int generate(FILE *manifest, const char *dir, const char *name,
+                    const corpus_spec_t *spec, uint64_t *total)
+{
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+        fprintf(stderr, "%s/%s: path too long\n", dir, name);
+        return -1;
+    }
+
+    corpus_result_t r;
+    if (corpus_write(path, spec, &r) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    *total += r.size;
+
+    fprintf(manifest,
+            "%s\t%s\t2.%d\t%s\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32
+            "\t%d\t%d\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%016" PRIx64
+            "\n",
+            name, corpus_container_name(spec->container), spec->version,
+            corpus_encoding_name(spec->encoding), spec->frames,
+            spec->apic_bytes, spec->padding, spec->id3v1, spec->tag_first,
+            spec->audio_bytes, r.tag_bytes, r.size, r.checksum);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t count = 100, large = 0, seed = 1;
+    uint64_t frames = 5000, apic = 4u << 20, audio = 1u << 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:s:f:p:a:h")) != -1) {
+        uint64_t *target;
+        switch (opt) {
+        case 'n': target = &count;  break;
+        case 'l': target = &large;  break;
+        case 's': target = &seed;   break;
+        case 'f': target = &frames; break;
+        case 'p': target = &apic;   break;
+        case 'a': target = &audio;  break;
+        case 'h': usage(stdout);    return 0;
+        default:  usage(stderr);    return 2;
+        }
+        if (parse_u64(optarg, target) != 0) {
+            fprintf(stderr, "-%c: invalid number '%s'\n", opt, optarg);
+            return 2;
+        }
+    }
+    if (optind != argc - 1 || frames < 10 || frames > 100000 ||
+        apic > (64u << 20) || audio < 4 || audio > UINT32_MAX) {
+        usage(stderr);
+        return 2;
+    }
+    const char *dir = argv[optind];
+
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/manifest.tsv", dir);
+    FILE *manifest = fopen(path, "w");
+    if (!manifest) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    fprintf(manifest, "file\tcontainer\tversion\tencoding\tframes\tapic_bytes"
+                      "\tpadding\tid3v1\ttag_first\taudio_bytes\ttag_bytes"
+                      "\tsize\tfnv1a\n");
+
+    corpus_limits_t limits = {
+        .max_frames      = (uint32_t)frames,
+        .max_apic_bytes  = (uint32_t)apic,
+        .max_audio_bytes = audio,
+    };
+
+    uint64_t total = 0;
+    int rc = 0;
+    for (uint64_t i = 0; i < count + large && rc == 0; i++) {
+        int is_large = i >= count;
+        uint64_t index = is_large ? i - count : i;
+        corpus_spec_t spec;
+        corpus_spec(&spec, seed, index, is_large, &limits);
+
+        char name[64];
+        snprintf(name, sizeof(name), "%s%06" PRIu64 ".%s",
+                 is_large ? "large_" : "", index,
+                 corpus_extension(spec.container));
+        rc = generate(manifest, dir, name, &spec, &total);
+    }
+
+    if (fclose(manifest) != 0 && rc == 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        rc = -1;
+    }
+    if (rc != 0) return 1;
+
+    fprintf(stderr, "%" PRIu64 " files, %.1f MiB apparent, seed %" PRIu64
+            "\n", count + large, (double)total / (1024.0 * 1024.0), seed);
+    return 0;
+}
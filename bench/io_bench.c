@@ -0,0 +1,577 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * mp3tag_io_bench: end-to-end cost of each tag write strategy.
+ *
+ *   mp3tag_io_bench [-d DIR] [-S SIZES] [-r REPS] [-p BYTES] [-f FILTER]
+ *                   [-o FILE.json]
+ *
+ * For every file size, a synthetic file per scenario is generated in a
+ * scratch directory under DIR and written REPS times through the public
+ * API, with fsync on and off, and with the page cache warm or dropped
+ * with posix_fadvise(POSIX_FADV_DONTNEED) before each write. Only
+ * mp3tag_write_tags() is timed; opening, restoring the file and dropping
+ * the cache happen outside the timer.
+ *
+ * Rewrite scenarios write with zero padding and grow the tag by one byte
+ * each time, so every write outgrows the last and the file never needs
+ * restoring from a copy. Appends are undone by truncating the file and
+ * restoring its header. Each write is checked to take the expected
+ * strategy, so a scenario cannot quietly measure the wrong path.
+ *
+ * Files of a few GiB need as much free space again for the rewrite's
+ * temporary copy. WAV data is capped just under the 4 GiB RIFF limit.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* clock_gettime, getopt, mkdtemp */
+
+#include "corpus.h"
+#include <mp3tag/mp3tag.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+/* ------------------------------------------------------------------ */
+/*  Scenarios                                                          */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const char             *name;
+    corpus_container_t      container;
+    uint32_t                frames;     /* Initial tag; 0 = untagged */
+    int                     grow;       /* Every write outgrows the tag */
+    mp3tag_write_strategy_t expect;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "raw_inplace",       CORPUS_MP3, 10, 0, MP3TAG_WRITE_IN_PLACE },
+    { "raw_rewrite",       CORPUS_MP3, 10, 1, MP3TAG_WRITE_RAW_REWRITE },
+    { "container_inplace", CORPUS_WAV, 10, 0, MP3TAG_WRITE_IN_PLACE },
+    { "container_append",  CORPUS_WAV, 0,  0, MP3TAG_WRITE_APPEND },
+    { "container_rewrite", CORPUS_WAV, 10, 1,
+      MP3TAG_WRITE_CONTAINER_REWRITE },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+#define MAX_SIZES   16
+#define WAV_MAX     (UINT32_MAX - (1u << 20))   /* Room for the id3 chunk */
+#define RESTORE_LEN 12                          /* RIFF/FORM header */
+
+/* One generated file and what it takes to put it back */
+typedef struct {
+    const scenario_t *sc;
+    char              path[4096];
+    uint64_t          size;
+    uint64_t          tag_bytes;
+    uint8_t           header[RESTORE_LEN];
+    uint64_t          writes;       /* Drives the value of the next write */
+} work_file_t;
+
+typedef struct {
+    size_t   samples;
+    double   min, p50, p90, p99, max, mean, stddev;    /* ns */
+    double   bytes_copied, bytes_written, fsyncs;      /* Per write */
+    struct {
+        uint64_t count, p50, p99;
+    } phase[MP3TAG_PHASE_COUNT];
+} result_t;
+
+/* ------------------------------------------------------------------ */
+/*  Files                                                              */
+/* ------------------------------------------------------------------ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int work_create(work_file_t *w, const scenario_t *sc,
+                       const char *dir, uint64_t size, uint32_t padding)
+{
+    memset(w, 0, sizeof(*w));
+    w->sc = sc;
+    snprintf(w->path, sizeof(w->path), "%s/%s.%s", dir, sc->name,
+             corpus_extension(sc->container));
+
+    corpus_spec_t spec = {
+        .container    = sc->container,
+        .version      = 3,
+        .encoding     = CORPUS_ENC_LATIN1,
+        .frames       = sc->frames,
+        .padding      = sc->grow ? 0 : padding,
+        .audio_bytes  = size,
+        .content_seed = 1,
+    };
+    if (sc->container == CORPUS_WAV && spec.audio_bytes > WAV_MAX)
+        spec.audio_bytes = WAV_MAX;
+
+    corpus_result_t r;
+    if (corpus_write(w->path, &spec, &r) != 0) {
+        fprintf(stderr, "%s: %s\n", w->path, strerror(errno));
+        return -1;
+    }
+    w->size      = r.size;
+    w->tag_bytes = r.tag_bytes;
+
+    FILE *f = fopen(w->path, "rb");
+    if (!f || fread(w->header, 1, RESTORE_LEN, f) != RESTORE_LEN) {
+        fprintf(stderr, "%s: cannot read back\n", w->path);
+        if (f) fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+/* Undo an append: cut the new chunk off and restore the RIFF size */
+static int work_restore(const work_file_t *w)
+{
+    int fd = open(w->path, O_WRONLY);
+    if (fd < 0) return -1;
+    int rc = ftruncate(fd, (off_t)w->size) == 0 &&
+             pwrite(fd, w->header, RESTORE_LEN, 0) == RESTORE_LEN ? 0 : -1;
+    close(fd);
+    return rc;
+}
+
+/* Write back and evict the file's pages; -1 if the kernel cannot */
+static int drop_cache(const char *path)
+{
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    int rc = fsync(fd) == 0 &&
+             posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0 ? 0 : -1;
+    close(fd);
+    return rc;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+/*
+ * Write back and read the whole file, so a warm run starts with it
+ * cached and its first fsync does not pay for generating it.
+ */
+static void warm_cache(const char *path)
+{
+    static uint8_t buf[1 << 16];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+    close(fd);
+}
+
+/*
+ * The collection for the next write: alternating titles for in-place
+ * and append scenarios, a comment one byte longer each time otherwise.
+ */
+static mp3tag_collection_t *next_tags(mp3tag_context_t *ctx, work_file_t *w)
+{
+    mp3tag_collection_t *coll = mp3tag_collection_create(ctx);
+    mp3tag_tag_t *tag = coll ? mp3tag_collection_add_tag(ctx, coll,
+                                                         MP3TAG_TARGET_ALBUM)
+                             : NULL;
+    if (!tag) goto fail;
+
+    const char *title = w->writes % 2 ? "Take B" : "Take A";
+    if (!mp3tag_tag_add_simple(ctx, tag, "TITLE", title) ||
+        !mp3tag_tag_add_simple(ctx, tag, "ARTIST", "mp3tag_io_bench"))
+        goto fail;
+
+    if (w->sc->grow) {
+        size_t len = (size_t)w->tag_bytes + 16 + (size_t)w->writes;
+        char *text = malloc(len + 1);
+        if (!text) goto fail;
+        memset(text, 'x', len);
+        text[len] = '\0';
+        int ok = mp3tag_tag_add_simple(ctx, tag, "COMMENT", text) != NULL;
+        free(text);
+        if (!ok) goto fail;
+    }
+    w->writes++;
+    return coll;
+
+fail:
+    if (coll) mp3tag_collection_free(ctx, coll);
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Measurement                                                        */
+/* ------------------------------------------------------------------ */
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const uint64_t *ns, size_t n, double p)
+{
+    size_t rank = (size_t)ceil(p / 100.0 * (double)n);
+    return (double)ns[rank ? rank - 1 : 0];
+}
+
+/* REPS timed writes of `w`; returns 0, or -1 after reporting why */
+static int measure(mp3tag_context_t *ctx, mp3tag_histogram_t *hist,
+                   work_file_t *w, size_t reps, int cold, result_t *r)
+{
+    uint64_t *ns = malloc(reps * sizeof(*ns));
+    if (!ns) return -1;
+
+    mp3tag_reset_stats(ctx);
+    mp3tag_histogram_reset(hist);
+    if (!cold) warm_cache(w->path);
+
+    int rc = 0;
+    for (size_t i = 0; i < reps && rc == 0; i++) {
+        if (w->sc->expect == MP3TAG_WRITE_APPEND && work_restore(w) != 0) {
+            fprintf(stderr, "%s: restore failed: %s\n", w->path,
+                    strerror(errno));
+            rc = -1;
+            break;
+        }
+        int err = mp3tag_open_rw(ctx, w->path);
+        if (err != MP3TAG_OK) {
+            fprintf(stderr, "%s: %s\n", w->path, mp3tag_strerror(err));
+            rc = -1;
+            break;
+        }
+        mp3tag_collection_t *coll = next_tags(ctx, w);
+        if (!coll) {
+            mp3tag_close(ctx);
+            rc = -1;
+            break;
+        }
+        if (cold && drop_cache(w->path) != 0) {
+            fprintf(stderr, "%s: cannot drop the page cache\n", w->path);
+            rc = -1;
+        } else {
+            uint64_t t0 = now_ns();
+            err = mp3tag_write_tags(ctx, coll);
+            ns[i] = now_ns() - t0;
+            if (err != MP3TAG_OK) {
+                fprintf(stderr, "%s: write: %s\n", w->path,
+                        mp3tag_strerror(err));
+                rc = -1;
+            }
+        }
+        mp3tag_collection_free(ctx, coll);
+        mp3tag_close(ctx);
+    }
+
+    mp3tag_stats_t st;
+    mp3tag_get_stats(ctx, &st);
+    if (rc == 0 && st.write_strategy[w->sc->expect] != reps) {
+        fprintf(stderr, "%s: %llu of %zu writes took the expected "
+                "strategy\n", w->sc->name,
+                (unsigned long long)st.write_strategy[w->sc->expect], reps);
+        rc = -1;
+    }
+    if (rc != 0) {
+        free(ns);
+        return -1;
+    }
+
+    double sum = 0;
+    for (size_t i = 0; i < reps; i++) sum += (double)ns[i];
+    qsort(ns, reps, sizeof(*ns), cmp_u64);
+
+    memset(r, 0, sizeof(*r));
+    r->samples = reps;
+    r->mean    = sum / (double)reps;
+    r->min     = (double)ns[0];
+    r->p50     = percentile(ns, reps, 50);
+    r->p90     = percentile(ns, reps, 90);
+    r->p99     = percentile(ns, reps, 99);
+    r->max     = (double)ns[reps - 1];
+    double var = 0;
+    for (size_t i = 0; i < reps; i++)
+        var += ((double)ns[i] - r->mean) * ((double)ns[i] - r->mean);
+    r->stddev  = reps > 1 ? sqrt(var / (double)(reps - 1)) : 0;
+
+    r->bytes_copied  = (double)st.bytes_copied / (double)reps;
+    r->bytes_written = (double)st.bytes_written / (double)reps;
+    r->fsyncs        = (double)st.syscalls.fsync / (double)reps;
+    for (int p = 0; p < MP3TAG_PHASE_COUNT; p++) {
+        r->phase[p].count = mp3tag_histogram_count(hist, (mp3tag_phase_t)p);
+        r->phase[p].p50   = mp3tag_histogram_percentile(hist,
+                                (mp3tag_phase_t)p, 50);
+        r->phase[p].p99   = mp3tag_histogram_percentile(hist,
+                                (mp3tag_phase_t)p, 99);
+    }
+    free(ns);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Output                                                             */
+/* ------------------------------------------------------------------ */
+
+/* Phases worth breaking a write into */
+static const mp3tag_phase_t report_phases[] = {
+    MP3TAG_PHASE_INPLACE_WRITE, MP3TAG_PHASE_REWRITE_COPY,
+    MP3TAG_PHASE_FSYNC, MP3TAG_PHASE_RENAME,
+};
+
+#define REPORT_PHASES (sizeof(report_phases) / sizeof(report_phases[0]))
+
+static void print_row(FILE *f, const char *name, const result_t *r)
+{
+    fprintf(f, "%-40s %9.3f %9.3f %9.3f %9.3f %11.2f %6.1f\n", name,
+            r->p50 / 1e6, r->p90 / 1e6, r->p99 / 1e6, r->max / 1e6,
+            r->bytes_copied / (1024.0 * 1024.0), r->fsyncs);
+    fflush(f);
+}
+
+static void json_result(FILE *f, const char *name, const work_file_t *w,
+                        int fsync, int cold, const result_t *r, int first)
+{
+    /* ns_per_op* keep the file readable by bench/compare.py */
+    fprintf(f, "%s    {\"name\": \"%s\", \"scenario\": \"%s\", "
+               "\"file_bytes\": %llu, \"fsync\": %s, \"cache\": \"%s\", "
+               "\"samples\": %zu, \"ns_per_op\": %.0f, "
+               "\"ns_per_op_min\": %.0f, \"ns_per_op_max\": %.0f, "
+               "\"ns_per_op_mean\": %.0f, \"ns_per_op_stddev\": %.0f, "
+               "\"ns_p90\": %.0f, \"ns_p99\": %.0f, "
+               "\"bytes_copied_per_op\": %.0f, "
+               "\"bytes_written_per_op\": %.0f, \"fsync_per_op\": %.2f, "
+               "\"phases\": {",
+            first ? "" : ",\n", name, w->sc->name,
+            (unsigned long long)w->size, fsync ? "true" : "false",
+            cold ? "cold" : "warm", r->samples, r->p50, r->min, r->max,
+            r->mean, r->stddev, r->p90, r->p99, r->bytes_copied,
+            r->bytes_written, r->fsyncs);
+    int sep = 0;
+    for (size_t i = 0; i < REPORT_PHASES; i++) {
+        mp3tag_phase_t p = report_phases[i];
+        if (!r->phase[p].count) continue;
+        fprintf(f, "%s\"%s\": {\"count\": %llu, \"p50_ns\": %llu, "
+                   "\"p99_ns\": %llu}",
+                sep++ ? ", " : "", mp3tag_phase_name(p),
+                (unsigned long long)r->phase[p].count,
+                (unsigned long long)r->phase[p].p50,
+                (unsigned long long)r->phase[p].p99);
+    }
+    fprintf(f, "}}");
+}
+
+/* ------------------------------------------------------------------ */
+/*  Driver                                                             */
+/* ------------------------------------------------------------------ */
+
+/* "64K", "16M", "4G" or plain bytes */
+static int parse_size(const char *s, uint64_t *v)
+{
+    char *end;
+    errno = 0;
+    unsigned long long x = strtoull(s, &end, 10);
+    if (errno || end == s || *s == '-') return -1;
+    switch (*end) {
+    case 'K': case 'k': x <<= 10; end++; break;
+    case 'M': case 'm': x <<= 20; end++; break;
+    case 'G': case 'g': x <<= 30; end++; break;
+    default: break;
+    }
+    if (*end || x == 0 || x > (64ull << 30)) return -1;
+    *v = x;
+    return 0;
+}
+
+static void format_size(char *buf, size_t len, uint64_t v)
+{
+    static const char units[] = "GMK";
+    for (int i = 0; i < 3; i++) {
+        unsigned shift = 30 - 10 * (unsigned)i;
+        if (v % (1ull << shift) == 0) {
+            snprintf(buf, len, "%llu%c",
+                     (unsigned long long)(v >> shift), units[i]);
+            return;
+        }
+    }
+    snprintf(buf, len, "%llu", (unsigned long long)v);
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: mp3tag_io_bench [options]\n"
+        "  -d DIR     parent of the scratch directory (default .)\n"
+        "  -S SIZES   comma-separated file sizes, K/M/G suffixes\n"
+        "             (default 1M,16M,64M)\n"
+        "  -r REPS    timed writes per measurement (default 10)\n"
+        "  -p BYTES   padding of in-place tags and appended chunks\n"
+        "             (default 4096)\n"
+        "  -f FILTER  only measurements whose name contains FILTER,\n"
+        "             e.g. raw_rewrite/16M or /nofsync/cold\n"
+        "  -o FILE    write results as JSON (- for stdout)\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *parent = ".", *sizes_arg = "1M,16M,64M";
+    const char *filter = NULL, *json_path = NULL;
+    long reps = 10;
+    unsigned long padding = 4096;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:S:r:p:f:o:h")) != -1) {
+        switch (opt) {
+        case 'd': parent    = optarg;                     break;
+        case 'S': sizes_arg = optarg;                     break;
+        case 'r': reps      = strtol(optarg, NULL, 10);   break;
+        case 'p': padding   = strtoul(optarg, NULL, 10);  break;
+        case 'f': filter    = optarg;                     break;
+        case 'o': json_path = optarg;                     break;
+        case 'h': usage(stdout); return 0;
+        default:  usage(stderr); return 2;
+        }
+    }
+    if (optind != argc || reps < 1 || padding > (16u << 20)) {
+        usage(stderr);
+        return 2;
+    }
+
+    uint64_t sizes[MAX_SIZES];
+    size_t n_sizes = 0;
+    char list[256];
+    snprintf(list, sizeof(list), "%s", sizes_arg);
+    for (char *save, *tok = strtok_r(list, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        if (n_sizes == MAX_SIZES || parse_size(tok, &sizes[n_sizes]) != 0) {
+            fprintf(stderr, "-S: invalid size '%s'\n", tok);
+            return 2;
+        }
+        n_sizes++;
+    }
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/mp3tag_io_bench.XXXXXX", parent);
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+#ifdef __linux__
+    struct statfs fs;
+    if (statfs(dir, &fs) == 0 && fs.f_type == 0x01021994)  /* TMPFS_MAGIC */
+        fprintf(stderr, "note: %s is tmpfs; cold and warm runs "
+                "will match\n", parent);
+#endif
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_histogram_t *hist = mp3tag_histogram_create();
+    if (!ctx || !hist) {
+        fprintf(stderr, "out of memory\n");
+        mp3tag_histogram_destroy(hist);
+        mp3tag_destroy(ctx);
+        rmdir(dir);
+        return 1;
+    }
+    mp3tag_trace_hooks_t hooks;
+    mp3tag_histogram_hooks(hist, &hooks);
+    mp3tag_set_trace(ctx, &hooks);
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!json) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            mp3tag_histogram_destroy(hist);
+            mp3tag_destroy(ctx);
+            rmdir(dir);
+            return 1;
+        }
+        fprintf(json, "{\n  \"library\": \"libmp3tag\",\n"
+                      "  \"version\": \"%s\",\n  \"repetitions\": %ld,\n"
+                      "  \"padding\": %lu,\n  \"benchmarks\": [\n",
+                mp3tag_version(), reps, padding);
+    }
+
+    /* The table goes to stderr when JSON takes stdout */
+    FILE *table = json == stdout ? stderr : stdout;
+    fprintf(table, "%-40s %9s %9s %9s %9s %11s %6s\n", "write",
+            "p50 ms", "p90 ms", "p99 ms", "max ms", "MiB copied", "fsync");
+
+    int rc = 0, first = 1;
+    for (size_t z = 0; z < n_sizes; z++) {
+        char size_name[32];
+        format_size(size_name, sizeof(size_name), sizes[z]);
+
+        for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+            const scenario_t *sc = &scenarios[s];
+            char prefix[128];
+            snprintf(prefix, sizeof(prefix), "%s/%s", sc->name, size_name);
+
+            /* Skip generating files no measurement will use */
+            int wanted = !filter;
+            for (int m = 0; m < 4 && !wanted; m++) {
+                char name[160];
+                snprintf(name, sizeof(name), "%s/%s/%s", prefix,
+                         m & 2 ? "nofsync" : "fsync", m & 1 ? "cold" : "warm");
+                wanted = strstr(name, filter) != NULL;
+            }
+            if (!wanted) continue;
+
+            work_file_t w;
+            if (work_create(&w, sc, dir, sizes[z], (uint32_t)padding) != 0) {
+                rc = 1;
+                unlink(w.path);
+                continue;
+            }
+            mp3tag_set_padding(ctx, sc->grow ? 0 : (uint32_t)padding);
+
+            for (int m = 0; m < 4; m++) {
+                int fsync = !(m & 2), cold = m & 1;
+                char name[160];
+                snprintf(name, sizeof(name), "%s/%s/%s", prefix,
+                         fsync ? "fsync" : "nofsync", cold ? "cold" : "warm");
+                if (filter && !strstr(name, filter)) continue;
+
+                mp3tag_set_fsync(ctx, fsync);
+                result_t r;
+                if (measure(ctx, hist, &w, (size_t)reps, cold, &r) != 0) {
+                    fprintf(stderr, "%s: failed\n", name);
+                    rc = 1;
+                    continue;
+                }
+                print_row(table, name, &r);
+                if (json) {
+                    json_result(json, name, &w, fsync, cold, &r, first);
+                    first = 0;
+                }
+            }
+            unlink(w.path);
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        if (json != stdout && fclose(json) != 0) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            rc = 1;
+        }
+    }
+    mp3tag_histogram_destroy(hist);
+    mp3tag_destroy(ctx);
+    if (rmdir(dir) != 0)
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+    return rc;
+}
@@ -0,0 +1,38 @@
+# Records reads and rewrites of a small corpus, then checks that the
+# trace decodes, replays against scratch copies (one of them standing in
+# for a deleted original) and prices under a latency model.
+
+file(REMOVE_RECURSE ${DIR})
+file(MAKE_DIRECTORY ${DIR})
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE rc OUTPUT_VARIABLE out)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${ARGN} failed (${rc}):\n${out}")
+    endif()
+    set(out "${out}" PARENT_SCOPE)
+endfunction()
+
+run(${GEN} -n 6 -s 3 -f 50 ${DIR}/corpus)
+file(GLOB files ${DIR}/corpus/*)
+list(FILTER files EXCLUDE REGEX "manifest\\.tsv$")
+
+run(${TOOL} record -w 262144 ${DIR}/trace ${files})
+run(${TOOL} dump ${DIR}/trace)
+if(NOT out MATCHES " rename " OR NOT out MATCHES " sync ")
+    message(FATAL_ERROR "rewrites missing from the trace:\n${out}")
+endif()
+
+list(GET files 0 gone)
+file(REMOVE ${gone})
+run(${TOOL} replay -d ${DIR} -c ${DIR}/trace)
+if(out MATCHES "behaved differently")
+    message(FATAL_ERROR "replay diverged:\n${out}")
+endif()
+run(${TOOL} replay -P nfs -S read_us=250 -o ${DIR}/model.json ${DIR}/trace)
+file(READ ${DIR}/model.json json)
+if(NOT json MATCHES "\"rename\"")
+    message(FATAL_ERROR "model report incomplete:\n${json}")
+endif()
+
+file(REMOVE_RECURSE ${DIR})
@@ -0,0 +1,790 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * mp3tag_iotrace: record, inspect and replay file-layer traces.
+ *
+ *   mp3tag_iotrace record [-w BYTES] TRACE FILE...
+ *   mp3tag_iotrace dump TRACE
+ *   mp3tag_iotrace replay [-d DIR] [-c] [-p] [-o FILE.json] TRACE
+ *   mp3tag_iotrace replay -P PROFILE [-S KEY=VALUE]... [-o FILE.json] TRACE
+ *
+ * Traces come from mp3tag_iotrace_create() in a service, or from
+ * `record`, which reads the tags of each FILE under a recorder. With -w
+ * it also sets a COMMENT of BYTES on each, without padding, so one
+ * larger than the file's padding records a rewrite; use copies.
+ *
+ * `replay -d` re-executes the calls, in recorded order on one thread,
+ * against scratch copies in a new directory under DIR: every file the
+ * trace opens before creating it is copied from its recorded path, or
+ * made as a sparse file of the size the trace saw when that path is
+ * gone. -c drops the copies from the page cache first; -p keeps the
+ * recorded gaps between calls. `replay -P` runs no I/O and prices each
+ * call with a latency model instead: fixed costs per call, transfer
+ * rates, and a penalty for a transfer that does not continue where the
+ * handle's previous one ended. Both compare against the recorded times.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* clock_gettime, mkdtemp, posix_fadvise */
+
+#include "stats/iotrace.h"
+#include <mp3tag/mp3tag.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------ */
+/*  Trace loading                                                      */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    iotrace_reader_t *reader;       /* Kept open for its path table */
+    iotrace_record_t *recs;
+    size_t            count;
+    uint64_t          max_path;
+    uint32_t          max_handle;
+} trace_t;
+
+static int trace_load(trace_t *t, const char *path)
+{
+    memset(t, 0, sizeof(*t));
+    t->reader = iotrace_reader_open(path);
+    if (!t->reader) {
+        fprintf(stderr, "%s: %s\n", path,
+                errno == EINVAL ? "not an mp3tag I/O trace" : strerror(errno));
+        return -1;
+    }
+
+    size_t cap = 0;
+    iotrace_record_t rec;
+    int rc;
+    while ((rc = iotrace_reader_next(t->reader, &rec)) == 1) {
+        if (t->count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            iotrace_record_t *grown = realloc(t->recs, cap * sizeof(*grown));
+            if (!grown) {
+                fprintf(stderr, "out of memory\n");
+                return -1;
+            }
+            t->recs = grown;
+        }
+        t->recs[t->count++] = rec;
+        if (rec.handle > t->max_handle) t->max_handle = rec.handle;
+        if (rec.op == IOTRACE_OPEN && rec.a > t->max_path)
+            t->max_path = rec.a;
+        if (rec.op == IOTRACE_RENAME) {
+            if (rec.a > t->max_path) t->max_path = rec.a;
+            if (rec.b > t->max_path) t->max_path = rec.b;
+        }
+    }
+    if (rc < 0)
+        fprintf(stderr, "%s: truncated after %zu records; replaying those\n",
+                path, t->count);
+    return 0;
+}
+
+static void trace_free(trace_t *t)
+{
+    iotrace_reader_close(t->reader);
+    free(t->recs);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Statistics                                                         */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint64_t  count, bytes;
+    uint64_t  recorded_ns, replayed_ns;
+    uint64_t *samples;              /* Replayed ns, for percentiles */
+} op_stats_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t n, double p)
+{
+    if (n == 0) return 0;
+    size_t rank = (size_t)(p / 100.0 * (double)n + 0.999999);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static uint64_t transfer_bytes(const iotrace_record_t *r)
+{
+    if (r->op == IOTRACE_READ && r->result > 0) return (uint64_t)r->result;
+    if (r->op == IOTRACE_WRITE && r->result == 0) return r->b;
+    return 0;
+}
+
+static int stats_init(op_stats_t *st, const trace_t *t)
+{
+    memset(st, 0, IOTRACE_OP_END * sizeof(*st));
+    for (size_t i = 0; i < t->count; i++)
+        st[t->recs[i].op].count++;
+    for (int op = 0; op < IOTRACE_OP_END; op++) {
+        st[op].samples = calloc(st[op].count ? st[op].count : 1,
+                                sizeof(uint64_t));
+        if (!st[op].samples) return -1;
+        st[op].count = 0;
+    }
+    return 0;
+}
+
+static void stats_add(op_stats_t *st, const iotrace_record_t *r,
+                      uint64_t replayed)
+{
+    op_stats_t *s = &st[r->op];
+    s->samples[s->count++] = replayed;
+    s->bytes       += transfer_bytes(r);
+    s->recorded_ns += r->duration_ns;
+    s->replayed_ns += replayed;
+}
+
+static void report(op_stats_t *st, const char *mode, const char *what,
+                   uint64_t recorded_wall, uint64_t replayed_wall,
+                   const char *json_path)
+{
+    printf("%-7s %9s %11s %13s %13s %10s %10s\n", "op", "calls", "MiB",
+           "recorded ms", what, "p50 us", "p99 us");
+
+    uint64_t rec_total = 0, rep_total = 0;
+    for (int op = IOTRACE_OPEN; op < IOTRACE_OP_END; op++) {
+        op_stats_t *s = &st[op];
+        if (!s->count) continue;
+        qsort(s->samples, s->count, sizeof(uint64_t), cmp_u64);
+        printf("%-7s %9llu %11.2f %13.3f %13.3f %10.1f %10.1f\n",
+               iotrace_op_name((iotrace_op_t)op),
+               (unsigned long long)s->count,
+               (double)s->bytes / (1024.0 * 1024.0),
+               (double)s->recorded_ns / 1e6, (double)s->replayed_ns / 1e6,
+               (double)percentile(s->samples, s->count, 50) / 1e3,
+               (double)percentile(s->samples, s->count, 99) / 1e3);
+        rec_total += s->recorded_ns;
+        rep_total += s->replayed_ns;
+    }
+    printf("%-7s %9s %11s %13.3f %13.3f\n", "total", "", "",
+           (double)rec_total / 1e6, (double)rep_total / 1e6);
+    printf("wall: recorded %.3f ms, %s %.3f ms (%.2fx)\n",
+           (double)recorded_wall / 1e6, what, (double)replayed_wall / 1e6,
+           recorded_wall ? (double)replayed_wall / (double)recorded_wall : 0);
+
+    if (!json_path) return;
+    FILE *f = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+        return;
+    }
+    fprintf(f, "{\n  \"mode\": \"%s\",\n  \"recorded_wall_ns\": %llu,\n"
+               "  \"replayed_wall_ns\": %llu,\n  \"ops\": {",
+            mode, (unsigned long long)recorded_wall,
+            (unsigned long long)replayed_wall);
+    int first = 1;
+    for (int op = IOTRACE_OPEN; op < IOTRACE_OP_END; op++) {
+        op_stats_t *s = &st[op];
+        if (!s->count) continue;
+        fprintf(f, "%s\n    \"%s\": {\"calls\": %llu, \"bytes\": %llu, "
+                   "\"recorded_ns\": %llu, \"replayed_ns\": %llu, "
+                   "\"p50_ns\": %llu, \"p99_ns\": %llu}",
+                first ? "" : ",", iotrace_op_name((iotrace_op_t)op),
+                (unsigned long long)s->count, (unsigned long long)s->bytes,
+                (unsigned long long)s->recorded_ns,
+                (unsigned long long)s->replayed_ns,
+                (unsigned long long)percentile(s->samples, s->count, 50),
+                (unsigned long long)percentile(s->samples, s->count, 99));
+        first = 0;
+    }
+    fprintf(f, "\n  }\n}\n");
+    if (f != stdout) fclose(f);
+}
+
+static uint64_t recorded_wall(const trace_t *t)
+{
+    uint64_t end = 0;
+    for (size_t i = 0; i < t->count; i++) {
+        uint64_t e = t->recs[i].start_ns + t->recs[i].duration_ns;
+        if (e > end) end = e;
+    }
+    return end;
+}
+
+/* ------------------------------------------------------------------ */
+/*  record and dump                                                    */
+/* ------------------------------------------------------------------ */
+
+static int cmd_record(int argc, char **argv)
+{
+    char *comment = NULL, *end;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:")) != -1) {
+        if (opt != 'w') return 2;
+        unsigned long n = strtoul(optarg, &end, 10);
+        if (*end || n == 0 || n > (1ul << 24)) {
+            fprintf(stderr, "-w: expected 1..16777216 bytes\n");
+            return 2;
+        }
+        free(comment);
+        if (!(comment = malloc(n + 1))) return 1;
+        memset(comment, 'c', n);
+        comment[n] = '\0';
+    }
+    if (argc - optind < 2) {
+        free(comment);
+        return 2;
+    }
+
+    mp3tag_iotrace_t *rec = mp3tag_iotrace_create(argv[optind]);
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    if (!rec || !ctx) {
+        fprintf(stderr, "%s: %s\n", argv[optind],
+                rec ? "out of memory" : strerror(errno));
+        mp3tag_destroy(ctx);
+        mp3tag_iotrace_destroy(rec);
+        free(comment);
+        return 1;
+    }
+    mp3tag_set_iotrace(ctx, rec);
+    mp3tag_set_padding(ctx, 0);
+
+    int failed = 0;
+    for (int i = optind + 1; i < argc; i++) {
+        int err = comment ? mp3tag_open_rw(ctx, argv[i])
+                        : mp3tag_open(ctx, argv[i]);
+        if (err == MP3TAG_OK) {
+            mp3tag_collection_t *tags;
+            err = mp3tag_read_tags(ctx, &tags);
+            if (err == MP3TAG_ERR_NO_TAGS) err = MP3TAG_OK;
+        }
+        if (err == MP3TAG_OK && comment)
+            err = mp3tag_set_tag_string(ctx, "COMMENT", comment);
+        if (err != MP3TAG_OK) {
+            fprintf(stderr, "%s: %s\n", argv[i], mp3tag_strerror(err));
+            failed = 1;
+        }
+        mp3tag_close(ctx);
+    }
+
+    mp3tag_set_iotrace(ctx, NULL);
+    mp3tag_destroy(ctx);
+    free(comment);
+    if (mp3tag_iotrace_destroy(rec) != MP3TAG_OK) {
+        fprintf(stderr, "%s: trace incomplete\n", argv[optind]);
+        return 1;
+    }
+    return failed;
+}
+
+static int cmd_dump(int argc, char **argv)
+{
+    if (argc != 2) return 2;
+    trace_t t;
+    if (trace_load(&t, argv[1]) != 0) {
+        trace_free(&t);
+        return 1;
+    }
+    for (size_t i = 0; i < t.count; i++) {
+        const iotrace_record_t *r = &t.recs[i];
+        printf("%12.3f %10.3f %-6s %4u ", (double)r->start_ns / 1e3,
+               (double)r->duration_ns / 1e3, iotrace_op_name(r->op),
+               r->handle);
+        switch (r->op) {
+        case IOTRACE_OPEN:
+            printf("%s %s", r->b ? "rw" : "ro",
+                   iotrace_reader_path(t.reader, r->a));
+            break;
+        case IOTRACE_RENAME:
+            printf("%s -> %s", iotrace_reader_path(t.reader, r->a),
+                   iotrace_reader_path(t.reader, r->b));
+            break;
+        case IOTRACE_SEEK:
+            printf("@%llu", (unsigned long long)r->a);
+            break;
+        case IOTRACE_READ:
+        case IOTRACE_WRITE:
+            printf("@%llu +%llu", (unsigned long long)r->a,
+                   (unsigned long long)r->b);
+            break;
+        default:
+            break;
+        }
+        printf(" = %lld\n", (long long)r->result);
+    }
+    trace_free(&t);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  replay -d: scratch copies                                          */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    char    **scratch;              /* Index = path id */
+    int      *fds;                  /* Index = handle */
+    uint8_t  *buf;
+    size_t    buf_cap;
+} scratch_t;
+
+/* Scratch path for path id `id`: DIR/NNNN-basename */
+static char *scratch_name(const char *dir, uint64_t id, const char *path)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t len = strlen(dir) + strlen(base) + 32;
+    char *name = malloc(len);
+    if (name)
+        snprintf(name, len, "%s/%04llu-%s", dir, (unsigned long long)id,
+                 base);
+    return name;
+}
+
+static int copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb"), *out = in ? fopen(to, "wb") : NULL;
+    static uint8_t chunk[1 << 20];
+    size_t n;
+    int rc = in && out ? 0 : -1;
+    while (rc == 0 && (n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        if (fwrite(chunk, 1, n, out) != n) rc = -1;
+    if (in && ferror(in)) rc = -1;
+    if (in) fclose(in);
+    if (out && fclose(out) != 0) rc = -1;
+    return rc;
+}
+
+/*
+ * Create the scratch copies of files that exist before the trace does
+ * anything to them: those whose first open succeeded. Each is copied
+ * from its recorded path and cut or extended to the size the trace
+ * first saw, since the original may have changed since; one that is
+ * gone becomes a sparse file of that size.
+ */
+static int prepare_scratch(const trace_t *t, scratch_t *s, const char *dir,
+                           int drop)
+{
+    enum { UNSEEN, INITIAL, WRITTEN, CREATED };
+    uint64_t n = t->max_path + 1;
+    uint64_t *size   = calloc(n, sizeof(*size));
+    uint8_t  *sized  = calloc(n, 1);        /* SIZE seen before a write */
+    uint8_t  *state  = calloc(n, 1);
+    uint64_t *handle_path = calloc((size_t)t->max_handle + 1,
+                                   sizeof(*handle_path));
+    int rc = size && sized && state && handle_path ? 0 : -1;
+
+    for (size_t i = 0; rc == 0 && i < t->count; i++) {
+        const iotrace_record_t *r = &t->recs[i];
+        uint64_t p = r->handle && r->handle <= t->max_handle
+                         ? handle_path[r->handle] : 0;
+        switch (r->op) {
+        case IOTRACE_OPEN:
+            handle_path[r->handle] = r->a;
+            if (state[r->a] == UNSEEN)
+                state[r->a] = r->result == 0 ? INITIAL : CREATED;
+            break;
+        case IOTRACE_RENAME:
+            if (state[r->b] == UNSEEN) state[r->b] = CREATED;
+            if (state[r->b] == INITIAL) state[r->b] = WRITTEN;
+            break;
+        case IOTRACE_WRITE:
+            if (p && state[p] == INITIAL) state[p] = WRITTEN;
+            break;
+        case IOTRACE_SIZE:
+            if (p && state[p] == INITIAL && !sized[p] && r->result >= 0) {
+                size[p]  = (uint64_t)r->result;
+                sized[p] = 1;
+            }
+            break;
+        case IOTRACE_READ:
+            if (p && state[p] == INITIAL && !sized[p] && r->result > 0 &&
+                r->a + (uint64_t)r->result > size[p])
+                size[p] = r->a + (uint64_t)r->result;
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (uint64_t id = 1; rc == 0 && id < n; id++) {
+        const char *orig = iotrace_reader_path(t->reader, id);
+        if (!orig || !(s->scratch[id] = scratch_name(dir, id, orig))) {
+            rc = -1;
+            break;
+        }
+        /* Files the trace creates come from read-write opens or renames */
+        if (state[id] == UNSEEN || state[id] == CREATED) continue;
+        struct stat st;
+        if (copy_file(orig, s->scratch[id]) != 0 ||
+            stat(s->scratch[id], &st) != 0 ||
+            (sized[id] && (uint64_t)st.st_size != size[id]) ||
+            (uint64_t)st.st_size < size[id]) {
+            int fd = open(s->scratch[id], O_WRONLY | O_CREAT, 0644);
+            if (fd < 0 || ftruncate(fd, (off_t)size[id]) != 0) rc = -1;
+            if (fd >= 0) close(fd);
+        }
+#ifdef POSIX_FADV_DONTNEED
+        if (rc == 0 && drop) {
+            int fd = open(s->scratch[id], O_RDONLY);
+            if (fd >= 0) {
+                fsync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        }
+#else
+        (void)drop;
+#endif
+    }
+    free(size);
+    free(sized);
+    free(state);
+    free(handle_path);
+    return rc;
+}
+
+static void sleep_until(uint64_t deadline)
+{
+    uint64_t now = now_ns();
+    if (now >= deadline) return;
+    struct timespec ts = {
+        .tv_sec  = (time_t)((deadline - now) / 1000000000u),
+        .tv_nsec = (long)((deadline - now) % 1000000000u),
+    };
+    nanosleep(&ts, NULL);
+}
+
+static int ensure_buf(scratch_t *s, uint64_t n)
+{
+    if (n <= s->buf_cap) return 0;
+    uint8_t *grown = realloc(s->buf, (size_t)n);
+    if (!grown) return -1;
+    memset(grown + s->buf_cap, 0, (size_t)n - s->buf_cap);
+    s->buf     = grown;
+    s->buf_cap = (size_t)n;
+    return 0;
+}
+
+/* One call against the scratch copies; returns 0 if it matched */
+static int replay_one(scratch_t *s, const iotrace_record_t *r)
+{
+    int fd = r->handle ? s->fds[r->handle] : -1;
+    switch (r->op) {
+    case IOTRACE_OPEN:
+        if (r->result != 0) return 0;       /* Failed then too */
+        s->fds[r->handle] = open(s->scratch[r->a],
+                                 r->b ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        return s->fds[r->handle] >= 0 ? 0 : -1;
+    case IOTRACE_CLOSE:
+        if (fd >= 0) close(fd);
+        s->fds[r->handle] = -1;
+        return 0;
+    case IOTRACE_SEEK:
+        return lseek(fd, (off_t)r->a, SEEK_SET) < 0 ? -1 : 0;
+    case IOTRACE_SIZE: {
+        struct stat st;
+        return fstat(fd, &st) == 0 && st.st_size == r->result ? 0 : -1;
+    }
+    case IOTRACE_READ: {
+        if (ensure_buf(s, r->b) != 0) return -1;
+        uint64_t want = r->result > 0 ? (uint64_t)r->result : r->b, got = 0;
+        while (got < want) {
+            ssize_t n = read(fd, s->buf + got, (size_t)(want - got));
+            if (n <= 0) break;
+            got += (uint64_t)n;
+        }
+        return r->result < 0 || got == (uint64_t)r->result ? 0 : -1;
+    }
+    case IOTRACE_WRITE: {
+        if (r->result != 0 || ensure_buf(s, r->b) != 0) return 0;
+        memset(s->buf, 0, (size_t)r->b);
+        uint64_t done = 0;
+        while (done < r->b) {
+            ssize_t n = write(fd, s->buf + done, (size_t)(r->b - done));
+            if (n <= 0) return -1;
+            done += (uint64_t)n;
+        }
+        return 0;
+    }
+    case IOTRACE_SYNC:
+        return fsync(fd) == 0 || r->result != 0 ? 0 : -1;
+    case IOTRACE_RENAME:
+        if (r->result != 0) return 0;
+        return rename(s->scratch[r->a], s->scratch[r->b]);
+    default:
+        return -1;
+    }
+}
+
+static int replay_scratch(const trace_t *t, const char *parent, int drop,
+                          int paced, const char *json_path)
+{
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/mp3tag_iotrace.XXXXXX", parent);
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+
+    scratch_t s = { 0 };
+    op_stats_t st[IOTRACE_OP_END];
+    s.scratch = calloc(t->max_path + 1, sizeof(*s.scratch));
+    s.fds     = malloc(((size_t)t->max_handle + 1) * sizeof(*s.fds));
+    int rc = s.scratch && s.fds && stats_init(st, t) == 0 ? 0 : 1;
+    if (rc == 0 && prepare_scratch(t, &s, dir, drop) != 0) {
+        fprintf(stderr, "%s: cannot prepare scratch copies\n", dir);
+        rc = 1;
+    }
+
+    uint64_t mismatches = 0, t0 = now_ns(), wall = 0;
+    if (rc == 0) {
+        for (uint32_t h = 0; h <= t->max_handle; h++) s.fds[h] = -1;
+        for (size_t i = 0; i < t->count; i++) {
+            const iotrace_record_t *r = &t->recs[i];
+            if (paced) sleep_until(t0 + r->start_ns);
+            uint64_t start = now_ns();
+            if (replay_one(&s, r) != 0) mismatches++;
+            stats_add(st, r, now_ns() - start);
+        }
+        wall = now_ns() - t0;
+        report(st, paced ? "paced" : "replay",
+               paced ? "paced ms" : "replayed ms", recorded_wall(t), wall,
+               json_path);
+        if (mismatches)
+            printf("%llu calls behaved differently from the recording\n",
+                   (unsigned long long)mismatches);
+    }
+
+    for (uint32_t h = 0; s.fds && h <= t->max_handle; h++)
+        if (s.fds[h] >= 0) close(s.fds[h]);
+    for (uint64_t id = 0; s.scratch && id <= t->max_path; id++) {
+        if (s.scratch[id]) unlink(s.scratch[id]);
+        free(s.scratch[id]);
+    }
+    if (rc == 0)
+        for (int op = 0; op < IOTRACE_OP_END; op++) free(st[op].samples);
+    free(s.scratch);
+    free(s.fds);
+    free(s.buf);
+    rmdir(dir);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  replay -P: latency model                                           */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const char *name;
+    double open_us, close_us, seek_us, stat_us;
+    double read_us, write_us, sync_us, rename_us;
+    double read_mib_s, write_mib_s;
+    double random_us;               /* Transfer not where the last ended */
+} profile_t;
+
+/* Round figures for the device classes, meant to be overridden */
+static const profile_t profiles[] = {
+    /* name    open  close seek stat   read   write sync   rename
+                                       rMiB/s wMiB/s random */
+    { "nvme",   5,    2,   0.2, 2,     15,    15,   40,    10,
+                                       2000,  1500, 0 },
+    { "ssd",    10,   3,   0.2, 3,     80,    60,   800,   20,
+                                       500,   450,  20 },
+    { "hdd",    20,   5,   0.2, 5,     150,   150,  10000, 300,
+                                       150,   140,  8000 },
+    { "nfs",    600,  400, 0.2, 300,   500,   400,  3000,  900,
+                                       100,   80,   0 },
+    { "object", 25000, 2000, 0.2, 15000, 20000, 8000, 60000, 120000,
+                                       80,    60,   20000 },
+};
+
+#define PROFILE_COUNT (sizeof(profiles) / sizeof(profiles[0]))
+
+static int profile_set(profile_t *p, const char *kv)
+{
+    static const struct {
+        const char *key;
+        size_t      off;
+    } keys[] = {
+        { "open_us",     offsetof(profile_t, open_us) },
+        { "close_us",    offsetof(profile_t, close_us) },
+        { "seek_us",     offsetof(profile_t, seek_us) },
+        { "stat_us",     offsetof(profile_t, stat_us) },
+        { "read_us",     offsetof(profile_t, read_us) },
+        { "write_us",    offsetof(profile_t, write_us) },
+        { "sync_us",     offsetof(profile_t, sync_us) },
+        { "rename_us",   offsetof(profile_t, rename_us) },
+        { "read_mib_s",  offsetof(profile_t, read_mib_s) },
+        { "write_mib_s", offsetof(profile_t, write_mib_s) },
+        { "random_us",   offsetof(profile_t, random_us) },
+    };
+    const char *eq = strchr(kv, '=');
+    if (!eq) return -1;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strlen(keys[i].key) != (size_t)(eq - kv) ||
+            strncmp(kv, keys[i].key, (size_t)(eq - kv)) != 0)
+            continue;
+        char *end;
+        double v = strtod(eq + 1, &end);
+        if (*end || v < 0) return -1;
+        *(double *)((char *)p + keys[i].off) = v;
+        return 0;
+    }
+    return -1;
+}
+
+static int replay_model(const trace_t *t, const profile_t *p,
+                        const char *json_path)
+{
+    op_stats_t st[IOTRACE_OP_END];
+    uint64_t *next_off = calloc((size_t)t->max_handle + 1, sizeof(*next_off));
+    if (!next_off || stats_init(st, t) != 0) {
+        fprintf(stderr, "out of memory\n");
+        free(next_off);
+        return 1;
+    }
+
+    double total_us = 0;
+    for (size_t i = 0; i < t->count; i++) {
+        const iotrace_record_t *r = &t->recs[i];
+        double us = 0, mib = (double)transfer_bytes(r) / (1024.0 * 1024.0);
+        switch (r->op) {
+        case IOTRACE_OPEN:   us = p->open_us;   break;
+        case IOTRACE_CLOSE:  us = p->close_us;  break;
+        case IOTRACE_SEEK:   us = p->seek_us;   break;
+        case IOTRACE_SIZE:   us = p->stat_us;   break;
+        case IOTRACE_SYNC:   us = p->sync_us;   break;
+        case IOTRACE_RENAME: us = p->rename_us; break;
+        case IOTRACE_READ:
+        case IOTRACE_WRITE: {
+            int reading = r->op == IOTRACE_READ;
+            double rate = reading ? p->read_mib_s : p->write_mib_s;
+            us = (reading ? p->read_us : p->write_us) +
+                 (rate > 0 ? mib / rate * 1e6 : 0);
+            if (r->handle && r->a != next_off[r->handle]) us += p->random_us;
+            if (r->handle) next_off[r->handle] = r->a + transfer_bytes(r);
+            break;
+        }
+        default:
+            break;
+        }
+        if (r->op == IOTRACE_OPEN && r->handle) next_off[r->handle] = 0;
+        total_us += us;
+        stats_add(st, r, (uint64_t)(us * 1e3));
+    }
+
+    printf("model: %s\n", p->name);
+    report(st, p->name, "modeled ms", recorded_wall(t),
+           (uint64_t)(total_us * 1e3), json_path);
+    for (int op = 0; op < IOTRACE_OP_END; op++) free(st[op].samples);
+    free(next_off);
+    return 0;
+}
+
+static int cmd_replay(int argc, char **argv)
+{
+    const char *dir = NULL, *json_path = NULL;
+    const profile_t *base = NULL;
+    profile_t model;
+    const char *overrides[32];
+    size_t n_overrides = 0;
+    int drop = 0, paced = 0, opt;
+
+    while ((opt = getopt(argc, argv, "d:cpP:S:o:")) != -1) {
+        switch (opt) {
+        case 'd': dir = optarg;       break;
+        case 'c': drop = 1;           break;
+        case 'p': paced = 1;          break;
+        case 'o': json_path = optarg; break;
+        case 'P':
+            for (size_t i = 0; i < PROFILE_COUNT; i++)
+                if (strcmp(optarg, profiles[i].name) == 0)
+                    base = &profiles[i];
+            if (!base) {
+                fprintf(stderr, "-P: unknown profile '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'S':
+            if (n_overrides == 32) return 2;
+            overrides[n_overrides++] = optarg;
+            break;
+        default:
+            return 2;
+        }
+    }
+    if (optind != argc - 1 || (dir && base) || (!base && n_overrides))
+        return 2;
+    if (base) {
+        model = *base;
+        for (size_t i = 0; i < n_overrides; i++)
+            if (profile_set(&model, overrides[i]) != 0) {
+                fprintf(stderr, "-S: invalid setting '%s'\n", overrides[i]);
+                return 2;
+            }
+    }
+
+    trace_t t;
+    int rc = trace_load(&t, argv[optind]) != 0 ? 1
+           : base ? replay_model(&t, &model, json_path)
+                  : replay_scratch(&t, dir ? dir : ".", drop, paced,
+                                   json_path);
+    trace_free(&t);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: mp3tag_iotrace record [-w BYTES] TRACE FILE...\n"
+        "       mp3tag_iotrace dump TRACE\n"
+        "       mp3tag_iotrace replay [-d DIR] [-c] [-p] [-o FILE] TRACE\n"
+        "       mp3tag_iotrace replay -P PROFILE [-S KEY=VALUE]... "
+        "[-o FILE] TRACE\n"
+        "  -w BYTES   also set a COMMENT of BYTES, unpadded (use copies)\n"
+        "  -d DIR     parent of the scratch directory (default .)\n"
+        "  -c         drop the scratch copies from the page cache first\n"
+        "  -p         keep the recorded gaps between calls\n"
+        "  -P NAME    latency model: nvme, ssd, hdd, nfs or object\n"
+        "  -S K=V     override a model figure, e.g. read_us=250 or\n"
+        "             read_mib_s=40 (open/close/seek/stat/read/write/sync/\n"
+        "             rename_us, read/write_mib_s, random_us)\n"
+        "  -o FILE    write the comparison as JSON (- for stdout)\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(stderr);
+        return 2;
+    }
+    const char *cmd = argv[1];
+    int rc = 2;
+    if (strcmp(cmd, "record") == 0)
+        rc = cmd_record(argc - 1, argv + 1);
+    else if (strcmp(cmd, "dump") == 0)
+        rc = cmd_dump(argc - 1, argv + 1);
+    else if (strcmp(cmd, "replay") == 0)
+        rc = cmd_replay(argc - 1, argv + 1);
+    else if (strcmp(cmd, "-h") == 0) {
+        usage(stdout);
+        return 0;
+    }
+    if (rc == 2) usage(stderr);
+    return rc;
+}
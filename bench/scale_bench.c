@@ -0,0 +1,696 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * mp3tag_scale_bench: how batch tag I/O scales with threads.
+ *
+ *   mp3tag_scale_bench [-d DIR]... [-n COUNT] [-s SEED] [-t LIST]
+ *                      [-r PASSES] [-m read|inplace|rewrite] [-F]
+ *                      [-o FILE.json]
+ *
+ * A seeded corpus is generated once per target directory (by default
+ * /dev/shm and the current directory, i.e. tmpfs and disk), then worked
+ * through by N threads for every N in LIST, each thread with its own
+ * context claiming files one at a time from a shared counter, like
+ * mp3tag_read_batch(). Every N gets an untimed pass to warm the page
+ * cache and PASSES timed ones, of which the median is reported.
+ *
+ * What the columns point at when scaling flattens:
+ *   cpu%       thread CPU time over N x wall: below 100%, threads are
+ *              blocked (I/O, directory locks taken by rename(), futexes)
+ *   csw/file   voluntary context switches per file, the same from the
+ *              scheduler's side
+ *   malloc ns  a malloc/free pair of the library's mean allocation size,
+ *              timed with N threads running the same number of them as
+ *              the pass made; growth over N = 1 is allocator contention
+ *   imbal      files done by the busiest thread over the mean: above 1,
+ *              some threads were starved of CPU or stuck in the kernel
+ *
+ * "rewrite" writes with zero padding and a comment one byte longer each
+ * pass, so every write is a temp file and rename() in the shared
+ * directory; "inplace" flips the title, so no write leaves the tag.
+ */
+
+#define _GNU_SOURCE                 /* RUSAGE_THREAD, mkdtemp */
+
+#include "corpus.h"
+#include <mp3tag/mp3tag.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+#define MAX_TARGETS  8
+#define MAX_THREADS  256
+#define MAX_COUNTS   32
+#define MAX_PASSES   99
+#define PROBE_LIVE   32             /* Blocks held at once by the probe */
+
+typedef enum { MODE_READ, MODE_INPLACE, MODE_REWRITE } work_mode_t;
+
+static const char *const mode_names[] = { "read", "inplace", "rewrite" };
+
+/* Phases reported per run, worst thread's p99 */
+static const mp3tag_phase_t report_phases[] = {
+    MP3TAG_PHASE_CONTAINER_DETECT, MP3TAG_PHASE_ID3V2_FRAMES,
+    MP3TAG_PHASE_FRAMES_TO_COLLECTION, MP3TAG_PHASE_INPLACE_WRITE,
+    MP3TAG_PHASE_REWRITE_COPY, MP3TAG_PHASE_FSYNC, MP3TAG_PHASE_RENAME,
+};
+
+#define REPORT_PHASES (sizeof(report_phases) / sizeof(report_phases[0]))
+
+/* ------------------------------------------------------------------ */
+/*  Corpus                                                             */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const char *parent;
+    const char *fs;                 /* "tmpfs", "disk" or "fs" */
+    char        dir[4096];
+    char      **paths;
+    size_t      count;
+    uint64_t    bytes;
+} target_t;
+
+static const char *fs_kind(const char *dir)
+{
+#ifdef __linux__
+    struct statfs fs;
+    if (statfs(dir, &fs) == 0)
+        return fs.f_type == 0x01021994 ? "tmpfs" : "disk";  /* TMPFS_MAGIC */
+#endif
+    (void)dir;
+    return "fs";
+}
+
+static void target_remove(target_t *t)
+{
+    char tmp[4200];
+    for (size_t i = 0; i < t->count; i++) {
+        unlink(t->paths[i]);
+        snprintf(tmp, sizeof(tmp), "%s.tmp", t->paths[i]);
+        unlink(tmp);                /* Left by an interrupted rewrite */
+        free(t->paths[i]);
+    }
+    free(t->paths);
+    t->paths = NULL;
+    t->count = 0;
+    if (t->dir[0] && rmdir(t->dir) != 0)
+        fprintf(stderr, "%s: %s\n", t->dir, strerror(errno));
+}
+
+static int target_create(target_t *t, size_t count, uint64_t seed)
+{
+    snprintf(t->dir, sizeof(t->dir), "%s/mp3tag_scale_bench.XXXXXX",
+             t->parent);
+    if (!mkdtemp(t->dir)) {
+        fprintf(stderr, "%s: %s\n", t->dir, strerror(errno));
+        t->dir[0] = '\0';
+        return -1;
+    }
+    t->fs    = fs_kind(t->dir);
+    t->paths = calloc(count, sizeof(*t->paths));
+    if (!t->paths) return -1;
+
+    /* Small enough that a pass is file handling, not bulk copying */
+    corpus_limits_t limits = {
+        .max_frames      = 200,
+        .max_apic_bytes  = 64u << 10,
+        .max_audio_bytes = 256u << 10,
+    };
+    for (size_t i = 0; i < count; i++) {
+        corpus_spec_t spec;
+        corpus_spec(&spec, seed, i, 0, &limits);
+
+        char path[4200];
+        snprintf(path, sizeof(path), "%s/%06zu.%s", t->dir, i,
+                 corpus_extension(spec.container));
+        corpus_result_t r;
+        if (corpus_write(path, &spec, &r) != 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        if (!(t->paths[i] = strdup(path))) return -1;
+        t->count++;
+        t->bytes += r.size;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Workers                                                            */
+/* ------------------------------------------------------------------ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t voluntary_switches(void)
+{
+#ifdef RUSAGE_THREAD
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+        return (uint64_t)ru.ru_nvcsw;
+#endif
+    return 0;
+}
+
+typedef struct job job_t;
+
+typedef struct {
+    job_t              *job;
+    pthread_t           thread;
+    mp3tag_context_t   *ctx;
+    mp3tag_histogram_t *hist;
+
+    /* One pass */
+    uint64_t files, errors;
+    uint64_t start_ns, end_ns, cpu_ns, switches;
+} worker_t;
+
+struct job {
+    const target_t  *target;
+    work_mode_t      mode;
+    unsigned         pass;          /* Drives the value written */
+    const char      *comment;       /* MODE_REWRITE: longest value */
+    int              probe;         /* Run the malloc probe instead */
+    size_t           probe_ops;     /* Per thread */
+    size_t           probe_size;
+
+    atomic_size_t    next;
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    int              go;
+};
+
+static int process(worker_t *w, const char *path)
+{
+    job_t *job = w->job;
+    mp3tag_collection_t *tags;
+    int rc;
+
+    if (job->mode == MODE_READ) {
+        rc = mp3tag_open(w->ctx, path);
+        if (rc == MP3TAG_OK)
+            rc = mp3tag_read_tags(w->ctx, &tags);
+    } else {
+        rc = mp3tag_open_rw(w->ctx, path);
+        if (rc != MP3TAG_OK) {
+            /* Reported by the caller */
+        } else if (job->mode == MODE_INPLACE) {
+            rc = mp3tag_set_tag_string(w->ctx, "TITLE",
+                                       job->pass % 2 ? "Take B" : "Take A");
+        } else {
+            /* One byte longer than the last pass's comment */
+            size_t len = strlen(job->comment);
+            rc = mp3tag_set_tag_string(w->ctx, "COMMENT",
+                                       job->comment + len - 64 - job->pass);
+        }
+    }
+    mp3tag_close(w->ctx);
+    return rc;
+}
+
+/* Allocation shape of a pass without the library around it */
+static void probe(worker_t *w)
+{
+    void *live[PROBE_LIVE];
+    size_t ops = w->job->probe_ops, size = w->job->probe_size;
+    for (size_t done = 0; done < ops; ) {
+        size_t n = ops - done < PROBE_LIVE ? ops - done : PROBE_LIVE;
+        for (size_t i = 0; i < n; i++) {
+            live[i] = malloc(size);
+            if (live[i]) *(volatile char *)live[i] = 0;
+        }
+        for (size_t i = n; i-- > 0; )
+            free(live[i]);
+        done += n;
+    }
+    w->files = ops;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    job_t *job = w->job;
+
+    pthread_mutex_lock(&job->lock);
+    while (!job->go)
+        pthread_cond_wait(&job->cond, &job->lock);
+    pthread_mutex_unlock(&job->lock);
+
+    w->files = w->errors = 0;
+    uint64_t cpu0 = thread_cpu_ns(), sw0 = voluntary_switches();
+    w->start_ns = now_ns();
+
+    if (job->probe) {
+        probe(w);
+    } else {
+        for (;;) {
+            size_t i = atomic_fetch_add_explicit(&job->next, 1,
+                                                 memory_order_relaxed);
+            if (i >= job->target->count)
+                break;
+            if (process(w, job->target->paths[i]) != MP3TAG_OK)
+                w->errors++;
+            w->files++;
+        }
+    }
+
+    w->end_ns   = now_ns();
+    w->cpu_ns   = thread_cpu_ns() - cpu0;
+    w->switches = voluntary_switches() - sw0;
+    return NULL;
+}
+
+/* Run `n` workers to completion; returns the wall time in ns, 0 on error */
+static uint64_t run_pass(job_t *job, worker_t *workers, size_t n)
+{
+    atomic_store(&job->next, 0);
+    job->go = 0;
+
+    size_t spawned = 0;
+    for (; spawned < n; spawned++) {
+        workers[spawned].job = job;
+        if (pthread_create(&workers[spawned].thread, NULL, worker_main,
+                           &workers[spawned]) != 0)
+            break;
+    }
+
+    /* Threads exist before the clock starts */
+    pthread_mutex_lock(&job->lock);
+    uint64_t t0 = now_ns();
+    job->go = 1;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+
+    uint64_t t1 = t0;
+    for (size_t i = 0; i < spawned; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].end_ns > t1) t1 = workers[i].end_ns;
+    }
+    if (spawned < n) {
+        fprintf(stderr, "pthread_create: only %zu of %zu threads\n",
+                spawned, n);
+        return 0;
+    }
+    return t1 > t0 ? t1 - t0 : 1;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Measurement                                                        */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    size_t   threads;
+    uint64_t wall_ns;
+    double   files_per_sec, mib_per_sec;
+    double   cpu_util;              /* Sum of thread CPU / (N x wall) */
+    double   switches_per_file;
+    double   allocs_per_file, bytes_per_alloc;
+    double   malloc_ns;             /* Probe: one malloc/free pair */
+    double   imbalance;             /* Busiest thread's files / mean */
+    uint64_t min_files, max_files;
+    uint64_t errors;
+    uint64_t strategy[MP3TAG_WRITE_STRATEGY_COUNT];
+    uint64_t phase_p99[REPORT_PHASES];
+} run_t;
+
+static int cmp_run_wall(const void *a, const void *b)
+{
+    uint64_t x = ((const run_t *)a)->wall_ns, y = ((const run_t *)b)->wall_ns;
+    return (x > y) - (x < y);
+}
+
+static void summarize(const target_t *t, const worker_t *workers, size_t n,
+                      uint64_t wall, run_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->threads   = n;
+    r->wall_ns   = wall;
+    r->min_files = UINT64_MAX;
+
+    uint64_t cpu = 0, switches = 0, allocs = 0, alloc_bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        const worker_t *w = &workers[i];
+        cpu      += w->cpu_ns;
+        switches += w->switches;
+        r->errors += w->errors;
+        if (w->files < r->min_files) r->min_files = w->files;
+        if (w->files > r->max_files) r->max_files = w->files;
+
+        mp3tag_stats_t st;
+        mp3tag_get_stats(w->ctx, &st);
+        allocs      += st.allocations;
+        alloc_bytes += st.bytes_allocated;
+        for (int s = 0; s < MP3TAG_WRITE_STRATEGY_COUNT; s++)
+            r->strategy[s] += st.write_strategy[s];
+        for (size_t p = 0; p < REPORT_PHASES; p++) {
+            uint64_t v = mp3tag_histogram_percentile(w->hist,
+                                                     report_phases[p], 99);
+            if (v > r->phase_p99[p]) r->phase_p99[p] = v;
+        }
+    }
+
+    double secs  = (double)wall / 1e9;
+    double files = (double)t->count;
+    r->files_per_sec     = files / secs;
+    r->mib_per_sec       = (double)t->bytes / (1024.0 * 1024.0) / secs;
+    r->cpu_util          = (double)cpu / ((double)n * (double)wall);
+    r->switches_per_file = (double)switches / files;
+    r->allocs_per_file   = (double)allocs / files;
+    r->bytes_per_alloc   = allocs ? (double)alloc_bytes / (double)allocs : 0;
+    r->imbalance         = (double)r->max_files / (files / (double)n);
+}
+
+static int measure(job_t *job, worker_t *workers, size_t n, size_t passes,
+                   run_t *out)
+{
+    run_t runs[MAX_PASSES];
+
+    /* Untimed: warms the page cache and settles the tags' layout */
+    if (!run_pass(job, workers, n)) return -1;
+    job->pass++;
+
+    for (size_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < n; i++) {
+            mp3tag_reset_stats(workers[i].ctx);
+            mp3tag_histogram_reset(workers[i].hist);
+        }
+        uint64_t wall = run_pass(job, workers, n);
+        job->pass++;
+        if (!wall) return -1;
+        summarize(job->target, workers, n, wall, &runs[p]);
+    }
+    qsort(runs, passes, sizeof(runs[0]), cmp_run_wall);
+    *out = runs[passes / 2];
+
+    /* Allocator alone, at the same concurrency and volume */
+    size_t allocs = (size_t)(out->allocs_per_file *
+                             (double)job->target->count);
+    job->probe      = 1;
+    job->probe_ops  = allocs / n ? allocs / n : 1;
+    job->probe_size = out->bytes_per_alloc > 0 ? (size_t)out->bytes_per_alloc
+                                               : 64;
+    uint64_t probe_wall = run_pass(job, workers, n);
+    job->probe = 0;
+    if (!probe_wall) return -1;
+
+    double busy = 0;
+    for (size_t i = 0; i < n; i++)
+        busy += (double)(workers[i].end_ns - workers[i].start_ns);
+    out->malloc_ns = busy / (double)(job->probe_ops * n);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Output                                                             */
+/* ------------------------------------------------------------------ */
+
+static void print_header(FILE *f, const target_t *t, const char *mode)
+{
+    fprintf(f, "\n%s (%s): %zu files, %.1f MiB, %s\n", t->parent, t->fs,
+            t->count, (double)t->bytes / (1024.0 * 1024.0), mode);
+    fprintf(f, "%7s %10s %9s %7s %6s %5s %8s %9s %8s %6s\n", "threads",
+            "files/s", "MiB/s", "speedup", "eff", "cpu%", "csw/file",
+            "malloc ns", "allocs/f", "imbal");
+}
+
+/* Throughput over the first thread count's, normally N = 1 */
+static double speedup(const run_t *r, const run_t *base)
+{
+    return r->files_per_sec / base->files_per_sec * (double)base->threads;
+}
+
+static void print_row(FILE *f, const run_t *r, const run_t *base)
+{
+    fprintf(f, "%7zu %10.0f %9.1f %6.2fx %5.0f%% %4.0f%% %8.2f %9.1f %8.0f "
+               "%6.2f\n",
+            r->threads, r->files_per_sec, r->mib_per_sec, speedup(r, base),
+            100.0 * speedup(r, base) / (double)r->threads,
+            100.0 * r->cpu_util,
+            r->switches_per_file, r->malloc_ns, r->allocs_per_file,
+            r->imbalance);
+    fflush(f);
+}
+
+static void json_run(FILE *f, const target_t *t, const run_t *r,
+                     const run_t *base, int first)
+{
+    fprintf(f, "%s    {\"target\": \"%s\", \"fs\": \"%s\", "
+               "\"threads\": %zu, \"wall_ns\": %llu, "
+               "\"files_per_sec\": %.1f, \"mib_per_sec\": %.2f, "
+               "\"speedup\": %.3f, \"efficiency\": %.3f, "
+               "\"cpu_util\": %.3f, \"switches_per_file\": %.3f, "
+               "\"allocs_per_file\": %.1f, \"bytes_per_alloc\": %.1f, "
+               "\"malloc_ns\": %.2f, \"imbalance\": %.3f, "
+               "\"files_per_thread_min\": %llu, "
+               "\"files_per_thread_max\": %llu, \"errors\": %llu, "
+               "\"write_strategy\": [%llu, %llu, %llu, %llu], "
+               "\"phase_p99_ns\": {",
+            first ? "" : ",\n", t->parent, t->fs, r->threads,
+            (unsigned long long)r->wall_ns, r->files_per_sec, r->mib_per_sec,
+            speedup(r, base), speedup(r, base) / (double)r->threads,
+            r->cpu_util,
+            r->switches_per_file, r->allocs_per_file, r->bytes_per_alloc,
+            r->malloc_ns, r->imbalance,
+            (unsigned long long)r->min_files,
+            (unsigned long long)r->max_files,
+            (unsigned long long)r->errors,
+            (unsigned long long)r->strategy[MP3TAG_WRITE_IN_PLACE],
+            (unsigned long long)r->strategy[MP3TAG_WRITE_APPEND],
+            (unsigned long long)r->strategy[MP3TAG_WRITE_CONTAINER_REWRITE],
+            (unsigned long long)r->strategy[MP3TAG_WRITE_RAW_REWRITE]);
+    int sep = 0;
+    for (size_t p = 0; p < REPORT_PHASES; p++) {
+        if (!r->phase_p99[p]) continue;
+        fprintf(f, "%s\"%s\": %llu", sep++ ? ", " : "",
+                mp3tag_phase_name(report_phases[p]),
+                (unsigned long long)r->phase_p99[p]);
+    }
+    fprintf(f, "}}");
+}
+
+/* ------------------------------------------------------------------ */
+/*  Driver                                                             */
+/* ------------------------------------------------------------------ */
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: mp3tag_scale_bench [options]\n"
+        "  -d DIR     target directory, repeatable\n"
+        "             (default /dev/shm if present, and .)\n"
+        "  -n COUNT   corpus files per target (default 256)\n"
+        "  -s SEED    corpus seed (default 1)\n"
+        "  -t LIST    comma-separated thread counts\n"
+        "             (default 1,2,4,... up to the online CPUs)\n"
+        "  -r PASSES  timed passes per thread count; the median is\n"
+        "             reported (default 3)\n"
+        "  -m MODE    read, inplace or rewrite (default read)\n"
+        "  -F         writes skip fsync (see mp3tag_set_fsync())\n"
+        "  -o FILE    write results as JSON (- for stdout)\n");
+}
+
+static size_t default_counts(size_t *counts)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max = cpus > 0 ? (size_t)cpus : 1, n = 0;
+    if (max > MAX_THREADS) max = MAX_THREADS;
+    for (size_t c = 1; c < max && n < MAX_COUNTS - 1; c *= 2)
+        counts[n++] = c;
+    counts[n++] = max;
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    target_t targets[MAX_TARGETS];
+    size_t n_targets = 0, counts[MAX_COUNTS], n_counts = 0;
+    unsigned long long seed = 1;
+    long files = 256, passes = 3;
+    work_mode_t mode = MODE_READ;
+    int fsync = 1, opt;
+    const char *json_path = NULL;
+
+    memset(targets, 0, sizeof(targets));
+    while ((opt = getopt(argc, argv, "d:n:s:t:r:m:Fo:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            if (n_targets == MAX_TARGETS) {
+                fprintf(stderr, "-d: at most %d targets\n", MAX_TARGETS);
+                return 2;
+            }
+            targets[n_targets++].parent = optarg;
+            break;
+        case 'n': files  = strtol(optarg, NULL, 10);    break;
+        case 's': seed   = strtoull(optarg, NULL, 0);   break;
+        case 'r': passes = strtol(optarg, NULL, 10);    break;
+        case 'F': fsync  = 0;                           break;
+        case 'o': json_path = optarg;                   break;
+        case 't': {
+            char *save, *tok;
+            for (tok = strtok_r(optarg, ",", &save); tok;
+                 tok = strtok_r(NULL, ",", &save)) {
+                long c = strtol(tok, NULL, 10);
+                if (n_counts == MAX_COUNTS || c < 1 || c > MAX_THREADS) {
+                    fprintf(stderr, "-t: invalid thread count '%s'\n", tok);
+                    return 2;
+                }
+                counts[n_counts++] = (size_t)c;
+            }
+            break;
+        }
+        case 'm':
+            for (mode = MODE_READ; mode <= MODE_REWRITE; mode++)
+                if (strcmp(optarg, mode_names[mode]) == 0) break;
+            if (mode > MODE_REWRITE) {
+                usage(stderr);
+                return 2;
+            }
+            break;
+        case 'h': usage(stdout); return 0;
+        default:  usage(stderr); return 2;
+        }
+    }
+    if (optind != argc || files < 1 || passes < 1 || passes > MAX_PASSES) {
+        usage(stderr);
+        return 2;
+    }
+    if (!n_counts) n_counts = default_counts(counts);
+    if (!n_targets) {
+        if (access("/dev/shm", W_OK) == 0)
+            targets[n_targets++].parent = "/dev/shm";
+        targets[n_targets++].parent = ".";
+    }
+
+    size_t max_threads = 0;
+    for (size_t i = 0; i < n_counts; i++)
+        if (counts[i] > max_threads) max_threads = counts[i];
+
+    /* Comments for MODE_REWRITE: pass p writes the last 64 + p bytes */
+    size_t comment_len = 64 + (size_t)(passes + 1) * n_counts + 1;
+    char *comment = malloc(comment_len + 1);
+    worker_t *workers = calloc(max_threads, sizeof(*workers));
+    if (!comment || !workers) {
+        fprintf(stderr, "out of memory\n");
+        free(comment);
+        free(workers);
+        return 1;
+    }
+    memset(comment, 'x', comment_len);
+    comment[comment_len] = '\0';
+
+    int rc = 0;
+    for (size_t i = 0; i < max_threads && rc == 0; i++) {
+        workers[i].ctx  = mp3tag_create(NULL);
+        workers[i].hist = mp3tag_histogram_create();
+        if (!workers[i].ctx || !workers[i].hist) {
+            fprintf(stderr, "out of memory\n");
+            rc = 1;
+            break;
+        }
+        mp3tag_trace_hooks_t hooks;
+        mp3tag_histogram_hooks(workers[i].hist, &hooks);
+        mp3tag_set_trace(workers[i].ctx, &hooks);
+        mp3tag_set_fsync(workers[i].ctx, fsync);
+        if (mode == MODE_REWRITE)
+            mp3tag_set_padding(workers[i].ctx, 0);
+    }
+
+    FILE *json = NULL;
+    if (rc == 0 && json_path) {
+        json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!json) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            rc = 1;
+        } else {
+            fprintf(json, "{\n  \"library\": \"libmp3tag\",\n"
+                          "  \"version\": \"%s\",\n  \"seed\": %llu,\n"
+                          "  \"files\": %ld,\n  \"passes\": %ld,\n"
+                          "  \"mode\": \"%s\",\n  \"fsync\": %s,\n"
+                          "  \"runs\": [\n",
+                    mp3tag_version(), seed, files, passes, mode_names[mode],
+                    fsync ? "true" : "false");
+        }
+    }
+
+    /* The table goes to stderr when JSON takes stdout */
+    FILE *table = json == stdout ? stderr : stdout;
+    int first = 1;
+    for (size_t t = 0; t < n_targets && rc == 0; t++) {
+        target_t *target = &targets[t];
+        if (target_create(target, (size_t)files, seed) != 0) {
+            target_remove(target);
+            rc = 1;
+            break;
+        }
+        print_header(table, target, mode_names[mode]);
+
+        job_t job = {
+            .target  = target,
+            .mode    = mode,
+            .comment = comment,
+        };
+        pthread_mutex_init(&job.lock, NULL);
+        pthread_cond_init(&job.cond, NULL);
+
+        run_t base;
+        for (size_t c = 0; c < n_counts; c++) {
+            run_t r;
+            if (measure(&job, workers, counts[c], (size_t)passes, &r) != 0) {
+                rc = 1;
+                break;
+            }
+            if (r.errors) {
+                fprintf(stderr, "%s: %llu files failed\n", target->parent,
+                        (unsigned long long)r.errors);
+                rc = 1;
+            }
+            if (c == 0) base = r;
+            print_row(table, &r, &base);
+            if (json) {
+                json_run(json, target, &r, &base, first);
+                first = 0;
+            }
+        }
+
+        pthread_cond_destroy(&job.cond);
+        pthread_mutex_destroy(&job.lock);
+        target_remove(target);
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        if (json != stdout && fclose(json) != 0) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            rc = 1;
+        }
+    }
+    for (size_t i = 0; i < max_threads; i++) {
+        mp3tag_destroy(workers[i].ctx);
+        mp3tag_histogram_destroy(workers[i].hist);
+    }
+    free(workers);
+    free(comment);
+    return rc;
+}
@@ -28,6 +28,25 @@ SOURCES=(
     src/id3v2/id3v2_writer.c
     src/id3v1/id3v1.c
     src/container/container.c
+    src/batch/batch.c
+    src/batch/scan.c
+    src/batch/location.c
+    src/batch/iter.c
+    src/batch/isolate.c
+    src/flat/flat.c
+    src/flat/flat_view.c
+    src/cache/cache.c
+    src/index/index.c
+    src/watch/watch.c
+    src/snapshot/snapshot.c
+    src/lru/lru.c
+    src/writeback/writeback.c
+    src/stats/stats.c
+    src/stats/histogram.c
+    src/stats/alloc_profile.c
+    src/stats/iotrace.c
+    src/stats/metrics.c
+    src/perf/perf.c
 )
 
 TAG_COMMON_DIR="${SCRIPT_DIR}/deps/libtag_common"
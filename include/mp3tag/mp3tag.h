@@ -29,13 +29,24 @@ int  mp3tag_open_rw(mp3tag_context_t *ctx, const char *path);
 void mp3tag_close(mp3tag_context_t *ctx);
 int  mp3tag_is_open(const mp3tag_context_t *ctx);
 
+/*
+ * Check whether the open file changed since it was probed: a single
+ * stat() of its path is compared (inode, size, mtime and ctime) with the
+ * version fstat() reported for the handle at probe time.
+ * Returns 0 if unchanged, keeping the cached tags; 1 if it changed and
+ * was re-probed (reopened first if it was replaced), which discards the
+ * cached tags; or a negative MP3TAG_ERR_* code.
+ */
+int  mp3tag_revalidate(mp3tag_context_t *ctx);
+
 /* ---------- Tag reading ---------- */
 
 /*
  * Read all tags from the file. The returned collection is owned by
  * the context and must not be freed by the caller. It remains valid
  * until the next call to mp3tag_read_tags, mp3tag_write_tags,
- * mp3tag_set_tag_string, mp3tag_remove_tag, or mp3tag_close.
+ * mp3tag_set_tag_string, mp3tag_remove_tag, or mp3tag_close. It may be
+ * shared with snapshots, so it must not be modified either.
  */
 int mp3tag_read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags);
 
@@ -66,6 +77,21 @@ int mp3tag_set_tag_string(mp3tag_context_t *ctx, const char *name,
  */
 int mp3tag_remove_tag(mp3tag_context_t *ctx, const char *name);
 
+/*
+ * Write settings of a context, kept across opens.
+ *
+ * `padding` is the zeroed space reserved behind the frames whenever a
+ * write lays out a new tag (rewrites and container appends), so later
+ * edits fit in place. Default 4096; at most 16 MiB.
+ *
+ * With fsync off, writes return without fsync() and rewrites rename the
+ * temp file over the original without syncing it first. That is much
+ * faster on rotating or network storage, but after a crash the edit may
+ * be lost, or a rewritten file may be empty. Default on.
+ */
+int mp3tag_set_padding(mp3tag_context_t *ctx, uint32_t padding);
+int mp3tag_set_fsync(mp3tag_context_t *ctx, int enabled);
+
 /* ---------- Collection building ---------- */
 
 mp3tag_collection_t *mp3tag_collection_create(mp3tag_context_t *ctx);
@@ -93,6 +119,507 @@ int mp3tag_simple_tag_set_language(mp3tag_context_t *ctx,
 int mp3tag_tag_add_track_uid(mp3tag_context_t *ctx, mp3tag_tag_t *tag,
                              uint64_t uid);
 
+/* ---------- Statistics ---------- */
+
+/*
+ * Copy the context's counters: I/O calls by type and bytes moved, heap
+ * allocations, frames parsed and skipped, text bytes transcoded per
+ * encoding, write strategies taken with bytes copied, and fsync count
+ * and time. Counting is always on and accumulates across opens and
+ * closes until reset.
+ */
+int  mp3tag_get_stats(const mp3tag_context_t *ctx, mp3tag_stats_t *stats);
+void mp3tag_reset_stats(mp3tag_context_t *ctx);
+
+/* ---------- Allocation profile ---------- */
+
+/*
+ * Process-wide allocation totals per call-site tag, recorded only when
+ * the library is built with MP3TAG_ALLOC_PROFILE (a profiling build:
+ * every tagged allocation and free takes a global lock).
+ *
+ * mp3tag_alloc_profile() copies up to `max` entries and returns the
+ * number of tags, or 0 in normal builds. mp3tag_alloc_profile_dump()
+ * formats the table into `buf` like snprintf and returns the length it
+ * needs. Reset zeroes counts and bytes and restarts peaks from the
+ * current live bytes.
+ */
+int    mp3tag_alloc_profile_enabled(void);
+size_t mp3tag_alloc_profile(mp3tag_alloc_site_t *sites, size_t max);
+size_t mp3tag_alloc_profile_dump(char *buf, size_t size);
+void   mp3tag_alloc_profile_reset(void);
+
+/* ---------- Tracing ---------- */
+
+/*
+ * Install phase hooks on a context (copied), or remove them with NULL.
+ * Every phase that begins also ends, on the same thread, error paths
+ * included. Without hooks each phase boundary costs one branch.
+ */
+int  mp3tag_set_trace(mp3tag_context_t *ctx,
+                      const mp3tag_trace_hooks_t *hooks);
+
+/* Stable snake_case name of a phase, e.g. "rewrite_copy" */
+const char *mp3tag_phase_name(mp3tag_phase_t phase);
+
+/*
+ * Latency histogram sink: fill `hooks` with callbacks that record each
+ * phase's duration in nanoseconds, then pass them to mp3tag_set_trace()
+ * on as many contexts as needed. Percentiles are reported within about
+ * 1.6% of the recorded values.
+ */
+mp3tag_histogram_t *mp3tag_histogram_create(void);
+void     mp3tag_histogram_destroy(mp3tag_histogram_t *h);
+void     mp3tag_histogram_hooks(mp3tag_histogram_t *h,
+                                mp3tag_trace_hooks_t *hooks);
+void     mp3tag_histogram_reset(mp3tag_histogram_t *h);
+uint64_t mp3tag_histogram_count(const mp3tag_histogram_t *h,
+                                mp3tag_phase_t phase);
+uint64_t mp3tag_histogram_bytes(const mp3tag_histogram_t *h,
+                                mp3tag_phase_t phase);
+uint64_t mp3tag_histogram_max(const mp3tag_histogram_t *h,
+                              mp3tag_phase_t phase);
+
+/* Duration in ns below which `percentile` (0-100) of samples fall */
+uint64_t mp3tag_histogram_percentile(const mp3tag_histogram_t *h,
+                                     mp3tag_phase_t phase,
+                                     double percentile);
+
+/* ---------- CPU counters ---------- */
+
+/*
+ * Aggregate CPU counters around mp3tag_open()/mp3tag_open_rw(),
+ * mp3tag_read_tags() and mp3tag_write_tags() on every context the
+ * aggregate is attached to. With `best` = MP3TAG_PERF_HARDWARE each
+ * thread opens cycle, instruction, cache-miss and branch-miss counters
+ * with perf_event_open() (user space only, so perf_event_paranoid <= 2
+ * suffices); where that is refused or unsupported, calls are measured
+ * with thread CPU clocks and getrusage() instead.
+ */
+mp3tag_perf_t *mp3tag_perf_create(mp3tag_perf_source_t best);
+void mp3tag_perf_destroy(mp3tag_perf_t *perf);
+void mp3tag_perf_reset(mp3tag_perf_t *perf);
+
+/* Attach (or detach with NULL); `perf` must outlive the attachment */
+int  mp3tag_set_perf(mp3tag_context_t *ctx, mp3tag_perf_t *perf);
+
+/* Per-call averages of `op` so far */
+int  mp3tag_perf_report(const mp3tag_perf_t *perf, mp3tag_perf_op_t op,
+                        mp3tag_perf_report_t *report);
+
+/* ---------- I/O trace ---------- */
+
+/*
+ * Record every file-layer call of the contexts a recorder is attached
+ * to (open, close, seek, size, read, write, fsync and rename, with
+ * offsets, sizes, results and timings) into a compact binary trace at
+ * `path`, for replay with bench/mp3tag_iotrace. Paths are recorded as
+ * given. Each call costs a mutex and a few bytes of buffered output;
+ * without a recorder, a branch.
+ *
+ * mp3tag_iotrace_create() returns NULL if `path` cannot be created.
+ * Destroy after detaching it from every context; it returns
+ * MP3TAG_ERR_WRITE_FAILED if any part of the trace was lost.
+ */
+mp3tag_iotrace_t *mp3tag_iotrace_create(const char *path);
+int  mp3tag_iotrace_destroy(mp3tag_iotrace_t *rec);
+
+/* Attach (or detach with NULL); `rec` must outlive the attachment */
+int  mp3tag_set_iotrace(mp3tag_context_t *ctx, mp3tag_iotrace_t *rec);
+
+/* ---------- Metrics ---------- */
+
+/*
+ * A registry aggregates what the contexts attached to it do: files
+ * opened, calls and their time, failures by MP3TAG_ERR_* code, bytes
+ * read and written, file-layer calls, write strategies, fsync time and
+ * per-phase latency histograms. Contexts publish when each public call
+ * returns, with a few relaxed atomic adds; without a registry the cost
+ * is a branch. mp3tag_read_batch() and mp3tag_scan_dir() attach their
+ * workers to the registry in their options.
+ *
+ * mp3tag_metrics_render() writes the Prometheus text exposition format
+ * into `buf` like snprintf and returns the length it needs.
+ * mp3tag_metrics_serve() answers every connection to a unix socket at
+ * `socket_path` with the same text (as an HTTP response if the client
+ * sends a GET), from a thread of its own; a stale socket there is
+ * replaced. Destroy stops serving and removes the socket; detach the
+ * registry from every context first.
+ */
+mp3tag_metrics_t *mp3tag_metrics_create(void);
+void   mp3tag_metrics_destroy(mp3tag_metrics_t *metrics);
+
+/* Attach (or detach with NULL); counting starts from the current counters */
+int    mp3tag_set_metrics(mp3tag_context_t *ctx, mp3tag_metrics_t *metrics);
+
+size_t mp3tag_metrics_render(const mp3tag_metrics_t *metrics, char *buf,
+                             size_t size);
+int    mp3tag_metrics_serve(mp3tag_metrics_t *metrics,
+                            const char *socket_path);
+
+/* ---------- Batch reading ---------- */
+
+/*
+ * Read the tags of `count` files in parallel. Each worker thread owns one
+ * reusable context; files are handed out through an atomic cursor.
+ * results[i] always corresponds to paths[i]. Per-file failures are
+ * reported in results[i].error; the return value is only an error when
+ * the batch itself could not run.
+ *
+ * With opts->order_by_location set, files are visited in ascending
+ * physical location (FIEMAP on Linux, F_LOG2PHYS on Apple platforms,
+ * inode number elsewhere) to cut head seeks on rotational media; use a
+ * small thread_count there. Result order is unaffected. With opts->cache
+ * set, every worker context is attached to that cache.
+ */
+int  mp3tag_read_batch(const char *const *paths, size_t count,
+                       const mp3tag_batch_options_t *opts,
+                       mp3tag_batch_result_t *results);
+
+/*
+ * Same contract as mp3tag_read_batch(), but parsing runs in forked worker
+ * processes (opts->thread_count of them) so a crash in one file cannot
+ * take down the caller. Workers claim paths through a cursor in shared
+ * memory and return flat-encoded collections over per-worker pipes.
+ * A crashed worker is replaced and the file it was parsing reports
+ * MP3TAG_ERR_WORKER_CRASHED. Returns MP3TAG_ERR_UNSUPPORTED where fork()
+ * is unavailable (iOS). opts->cache is ignored: updates made in a child
+ * would never reach the parent's cache.
+ */
+int  mp3tag_read_batch_isolated(const char *const *paths, size_t count,
+                                const mp3tag_batch_options_t *opts,
+                                mp3tag_batch_result_t *results);
+
+/*
+ * Free every collection held in a results array and reset the entries.
+ */
+void mp3tag_batch_results_free(mp3tag_batch_result_t *results, size_t count);
+
+/*
+ * Sequential batch iterator. While file i is parsed, the head and tail
+ * of files i+1..i+k are prefetched (posix_fadvise WILLNEED / F_RDADVISE),
+ * with k adapted to observed parse latency. `paths` must outlive the
+ * iterator.
+ */
+mp3tag_batch_iter_t *mp3tag_batch_iter_create(const char *const *paths,
+                                              size_t count,
+                                              const mp3tag_allocator_t *allocator);
+
+/*
+ * Read the next file in order. Returns 1 and fills `result` (the caller
+ * owns result->tags), 0 when all files have been returned, or a negative
+ * error code.
+ */
+int  mp3tag_batch_iter_next(mp3tag_batch_iter_t *it,
+                            mp3tag_batch_result_t *result);
+void mp3tag_batch_iter_destroy(mp3tag_batch_iter_t *it);
+
+/* ---------- Directory scanning ---------- */
+
+/*
+ * Walk the tree under `root` and read the tags of every candidate file
+ * (.mp3, .aac, .wav, .aif, .aiff, .aifc; plus magic-sniffed files when
+ * opts->detect_by_magic is set). Directories and files are scheduled on
+ * per-worker deques with work stealing, so enumeration and parsing
+ * overlap. Symbolic links are not followed.
+ *
+ * `callback` is invoked from worker threads, one call at a time, for
+ * each candidate file and for each directory that could not be opened.
+ */
+int mp3tag_scan_dir(const char *root, const mp3tag_scan_options_t *opts,
+                    mp3tag_scan_callback_t callback, void *user_data);
+
+/* ---------- Flat collections ---------- */
+
+/*
+ * Serialize a collection into one contiguous, position-independent blob:
+ * little-endian integers and offsets instead of pointers, so the bytes can
+ * be written to a file, mmap()ed, or passed to another process as-is.
+ * Free `*data` with mp3tag_flat_free().
+ */
+int  mp3tag_flat_serialize(const mp3tag_collection_t *coll,
+                           uint8_t **data, size_t *size);
+void mp3tag_flat_free(uint8_t *data);
+
+/*
+ * Rebuild a heap collection from a blob. Free it with
+ * mp3tag_collection_free().
+ */
+int  mp3tag_flat_deserialize(const uint8_t *data, size_t size,
+                             mp3tag_collection_t **coll);
+
+/*
+ * Size of the blob starting at `data` as recorded in its header, or 0 if
+ * `avail` bytes do not hold a blob header. Use it to step through blobs
+ * stored back to back.
+ */
+size_t mp3tag_flat_blob_size(const uint8_t *data, size_t avail);
+
+/*
+ * Validate a blob once and set up a view for the accessors below. The
+ * accessors read fields in place and never allocate; strings point
+ * into the blob and stay valid as long as it does.
+ */
+int  mp3tag_flat_open(mp3tag_flat_t *view, const uint8_t *data, size_t size);
+
+size_t               mp3tag_flat_tag_count(const mp3tag_flat_t *view);
+mp3tag_target_type_t mp3tag_flat_tag_target_type(const mp3tag_flat_t *view,
+                                                 size_t tag);
+const char          *mp3tag_flat_tag_target_string(const mp3tag_flat_t *view,
+                                                   size_t tag);
+size_t               mp3tag_flat_tag_uid_count(const mp3tag_flat_t *view,
+                                               size_t tag,
+                                               mp3tag_uid_kind_t kind);
+uint64_t             mp3tag_flat_tag_uid(const mp3tag_flat_t *view, size_t tag,
+                                         mp3tag_uid_kind_t kind, size_t index);
+mp3tag_flat_ref_t    mp3tag_flat_tag_first_simple(const mp3tag_flat_t *view,
+                                                  size_t tag);
+
+const char          *mp3tag_flat_simple_name(const mp3tag_flat_t *view,
+                                             mp3tag_flat_ref_t st);
+const char          *mp3tag_flat_simple_value(const mp3tag_flat_t *view,
+                                              mp3tag_flat_ref_t st);
+const char          *mp3tag_flat_simple_language(const mp3tag_flat_t *view,
+                                                 mp3tag_flat_ref_t st);
+const uint8_t       *mp3tag_flat_simple_binary(const mp3tag_flat_t *view,
+                                               mp3tag_flat_ref_t st,
+                                               size_t *size);
+int                  mp3tag_flat_simple_is_default(const mp3tag_flat_t *view,
+                                                   mp3tag_flat_ref_t st);
+mp3tag_flat_ref_t    mp3tag_flat_simple_nested(const mp3tag_flat_t *view,
+                                               mp3tag_flat_ref_t st);
+mp3tag_flat_ref_t    mp3tag_flat_simple_next(const mp3tag_flat_t *view,
+                                             mp3tag_flat_ref_t st);
+
+/*
+ * Value of the first top-level simple tag named `name` (case-insensitive)
+ * in any tag, or NULL. Same lookup as mp3tag_read_tag_string().
+ */
+const char *mp3tag_flat_find(const mp3tag_flat_t *view, const char *name);
+
+/* ---------- Snapshots ---------- */
+
+/*
+ * Take a reference to the context's current tags (reading them if
+ * needed). The snapshot is immutable and independent of the context:
+ * it stays valid across later writes, mp3tag_close() and
+ * mp3tag_destroy() until released. Taking it shares the parsed
+ * collection rather than copying it.
+ */
+int  mp3tag_snapshot_acquire(mp3tag_context_t *ctx, mp3tag_snapshot_t **snap);
+
+/* Take another reference to `snap`; returns `snap`. */
+mp3tag_snapshot_t *mp3tag_snapshot_retain(mp3tag_snapshot_t *snap);
+
+/*
+ * The collection held by a snapshot. It must not be modified and stays
+ * valid until the reference is released.
+ */
+const mp3tag_collection_t *mp3tag_snapshot_tags(const mp3tag_snapshot_t *snap);
+
+/*
+ * Approximate heap footprint of the snapshot in bytes.
+ */
+size_t mp3tag_snapshot_size(const mp3tag_snapshot_t *snap);
+
+/* Drop a reference; the last one frees the collection. */
+void mp3tag_snapshot_release(mp3tag_snapshot_t *snap);
+
+/* ---------- Shared snapshot cache ---------- */
+
+/*
+ * Create a cache holding at most `max_bytes` of snapshots, keyed by file
+ * identity (device, inode, size, mtime). Lookups take no lock: readers
+ * announce an epoch, and entries that are replaced or evicted are freed
+ * only after every reader that could still see them has left. Eviction
+ * approximates LRU (CLOCK).
+ */
+mp3tag_lru_t *mp3tag_lru_create(size_t max_bytes);
+
+/*
+ * Free the cache. No lookups may be in flight; snapshots already handed
+ * out stay valid.
+ */
+void mp3tag_lru_destroy(mp3tag_lru_t *lru);
+
+/*
+ * Snapshot of the current version of `path`, or NULL if it is not cached.
+ * Release the result with mp3tag_snapshot_release().
+ */
+mp3tag_snapshot_t *mp3tag_lru_get(mp3tag_lru_t *lru, const char *path);
+
+/*
+ * Like mp3tag_lru_get(), but on a miss read the file with `ctx` (which
+ * must not be open) and publish the result.
+ */
+int  mp3tag_lru_load(mp3tag_lru_t *lru, mp3tag_context_t *ctx,
+                     const char *path, mp3tag_snapshot_t **snap);
+
+/*
+ * Publish a copy of `tags` as the current version of `path`, replacing
+ * the previous entry atomically for readers.
+ */
+int  mp3tag_lru_publish(mp3tag_lru_t *lru, const char *path,
+                        const mp3tag_collection_t *tags);
+void mp3tag_lru_invalidate(mp3tag_lru_t *lru, const char *path);
+void mp3tag_lru_get_stats(mp3tag_lru_t *lru, mp3tag_lru_stats_t *stats);
+
+/*
+ * Attach a snapshot cache to a context (NULL detaches). Reads are served
+ * from the cache when it holds the open file's version, and parsed tags
+ * are published to it. After each successful write the tags as they
+ * now stand in the file (what a fresh read would return, decoded from
+ * the written frames without touching the file) are published, and the
+ * entry for the file's previous version is retired.
+ */
+int  mp3tag_set_lru(mp3tag_context_t *ctx, mp3tag_lru_t *lru);
+
+/* ---------- Catalog index ---------- */
+
+/*
+ * Build an index incrementally from read results (e.g. from the
+ * mp3tag_scan_dir() callback) and query it in-process. ARTIST,
+ * ALBUM_ARTIST, ALBUM, GENRE and every field without a standard name
+ * (TXXX descriptions, unnamed text frames such as TKEY) get inverted
+ * postings matched case-insensitively; every frame name is recorded in
+ * per-segment bloom filters with its size for frame queries and stats.
+ *
+ * Callbacks run under the index's read lock and must not modify it.
+ */
+mp3tag_index_t *mp3tag_index_create(void);
+void            mp3tag_index_destroy(mp3tag_index_t *idx);
+
+/*
+ * Add (or replace) the entry for `path`. `tags` is not retained.
+ * Replaced and removed entries are reclaimed once they outnumber the
+ * live ones. Fails with MP3TAG_ERR_NO_MEMORY when 2^32 - 1 entries are
+ * live.
+ */
+int    mp3tag_index_add(mp3tag_index_t *idx, const char *path,
+                        const mp3tag_collection_t *tags);
+int    mp3tag_index_remove(mp3tag_index_t *idx, const char *path);
+size_t mp3tag_index_count(mp3tag_index_t *idx);
+
+/*
+ * Files whose `field` has exactly `value` (case-insensitive).
+ */
+int mp3tag_index_find(mp3tag_index_t *idx, const char *field,
+                      const char *value, mp3tag_index_callback_t callback,
+                      void *user_data);
+
+/*
+ * Files with a frame named `name` of at least `min_size` bytes
+ * (e.g. "APIC", 1 << 20).
+ */
+int mp3tag_index_find_frame(mp3tag_index_t *idx, const char *name,
+                            uint64_t min_size, mp3tag_index_callback_t callback,
+                            void *user_data);
+
+int mp3tag_index_frame_stats(mp3tag_index_t *idx, const char *name,
+                             mp3tag_frame_stats_t *stats);
+
+/* ---------- Change watching ---------- */
+
+/*
+ * Keep a cache and/or index current as files change. On Linux, inotify
+ * reports close-write, move and delete events under each root; paths are
+ * re-read once they have been quiet for opts->debounce_ms. After a queue
+ * overflow, on restart from a stored cursor, and on platforms without
+ * inotify, roots are swept for files whose mtime or ctime is newer than
+ * the cursor instead.
+ */
+mp3tag_watcher_t *mp3tag_watcher_create(const mp3tag_watch_options_t *opts);
+int  mp3tag_watcher_add_root(mp3tag_watcher_t *w, const char *root);
+
+/*
+ * Descriptor that becomes readable when events arrive, for use in an
+ * external poll loop; -1 where no event source exists.
+ */
+int  mp3tag_watcher_fd(const mp3tag_watcher_t *w);
+
+/*
+ * Wait up to `timeout_ms` (-1 = until events arrive) for events, then
+ * re-read every file whose quiet period has elapsed. Returns the number
+ * of files processed, or a negative error code.
+ */
+int  mp3tag_watcher_poll(mp3tag_watcher_t *w, int timeout_ms);
+
+/*
+ * Store the cursor (if configured) and free the watcher.
+ */
+void mp3tag_watcher_destroy(mp3tag_watcher_t *w);
+
+/* ---------- Write-behind ---------- */
+
+/*
+ * Queue single-field edits and write each file once per burst. Edits to
+ * the same field replace each other; a file is flushed opts->delay_ms
+ * after its first pending edit (by a background thread), on
+ * mp3tag_writeback_flush() or on destroy. With opts->journal_path set,
+ * the new tags are made durable in the journal before any file is
+ * touched, and a journal left by a crash is replayed here.
+ */
+mp3tag_writeback_t *mp3tag_writeback_create(const mp3tag_writeback_options_t *opts);
+
+/* Queue setting `name` to `value` in `path` (`value` NULL removes it). */
+int  mp3tag_writeback_set(mp3tag_writeback_t *wb, const char *path,
+                          const char *name, const char *value);
+
+/*
+ * Tags of `path` as they will be after the pending edits are flushed.
+ * The caller owns the result; free it with mp3tag_collection_free().
+ */
+int  mp3tag_writeback_read_tags(mp3tag_writeback_t *wb, const char *path,
+                                mp3tag_collection_t **tags);
+
+/* Like mp3tag_read_tag_string(), seeing pending edits. */
+int  mp3tag_writeback_read_string(mp3tag_writeback_t *wb, const char *path,
+                                  const char *name, char *value, size_t size);
+
+/*
+ * Write pending edits for `path`, or for every file when `path` is NULL
+ * (which also reports the first error of an earlier background flush).
+ */
+int  mp3tag_writeback_flush(mp3tag_writeback_t *wb, const char *path);
+
+/* Number of files with pending edits. */
+size_t mp3tag_writeback_pending(mp3tag_writeback_t *wb);
+
+/*
+ * Flush everything and free the queue. Call mp3tag_writeback_flush()
+ * first to learn about errors.
+ */
+void mp3tag_writeback_destroy(mp3tag_writeback_t *wb);
+
+/* ---------- Persistent cache ---------- */
+
+/*
+ * Open the cache stored at `path`, or start an empty one if the file
+ * does not exist or is not a cache file. Entries are keyed by device and
+ * inode and are only used while the file's size and mtime still match.
+ * Each stored collection carries a fingerprint that is verified on load.
+ */
+mp3tag_cache_t *mp3tag_cache_open(const char *path);
+
+/*
+ * Write the cache back to its file (temp file + fsync + rename).
+ * Does nothing when there are no changes since the last save.
+ */
+int  mp3tag_cache_save(mp3tag_cache_t *cache);
+
+/*
+ * Save (if changed) and free the cache. Detach it from every context first.
+ */
+void mp3tag_cache_close(mp3tag_cache_t *cache);
+
+/*
+ * Attach `cache` to a context (NULL detaches); takes effect on the next
+ * open. While attached, opening a file whose identity is cached skips
+ * probing, reads are served from the cache, and writes through this
+ * library drop the stale entry. The cache may be shared between contexts.
+ */
+int  mp3tag_set_cache(mp3tag_context_t *ctx, mp3tag_cache_t *cache);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,9 @@ extern "C" {
 #define MP3TAG_ERR_SEEK_FAILED    -32
 #define MP3TAG_ERR_RENAME_FAILED  -33
 
+/* Batch errors */
+#define MP3TAG_ERR_WORKER_CRASHED -40
+
 #ifdef __cplusplus
 }
 #endif
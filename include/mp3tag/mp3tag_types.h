@@ -70,6 +70,32 @@ typedef struct {
     size_t        count;
 } mp3tag_collection_t;
 
+/*
+ * Read-only view of a flat (serialized) collection, filled in by
+ * mp3tag_flat_open(). Points into caller-owned memory, e.g. an mmap()ed
+ * file; nothing is copied.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t         size;
+} mp3tag_flat_t;
+
+/*
+ * Index of a simple tag within a flat view. Lists end at MP3TAG_FLAT_NONE.
+ */
+typedef uint32_t mp3tag_flat_ref_t;
+#define MP3TAG_FLAT_NONE ((mp3tag_flat_ref_t)0xFFFFFFFFu)
+
+/*
+ * UID lists carried by a tag.
+ */
+typedef enum {
+    MP3TAG_UID_TRACK = 0,
+    MP3TAG_UID_EDITION,
+    MP3TAG_UID_CHAPTER,
+    MP3TAG_UID_ATTACHMENT
+} mp3tag_uid_kind_t;
+
 /*
  * Custom allocator interface.
  */
@@ -80,6 +106,285 @@ typedef struct {
     void  *user_data;
 } mp3tag_allocator_t;
 
+/*
+ * ID3v2 text encodings, indexing mp3tag_stats_t.transcoded_bytes.
+ */
+typedef enum {
+    MP3TAG_ENC_LATIN1 = 0,
+    MP3TAG_ENC_UTF16,          /* With byte-order mark */
+    MP3TAG_ENC_UTF16BE,
+    MP3TAG_ENC_UTF8,
+    MP3TAG_ENC_COUNT
+} mp3tag_encoding_t;
+
+/*
+ * How a tag write reached the file, indexing mp3tag_stats_t.write_strategy.
+ */
+typedef enum {
+    MP3TAG_WRITE_IN_PLACE = 0,           /* Fit into existing tag space */
+    MP3TAG_WRITE_APPEND,                 /* New chunk appended to container */
+    MP3TAG_WRITE_CONTAINER_REWRITE,      /* Container copied with new chunk */
+    MP3TAG_WRITE_RAW_REWRITE,            /* Stream copied behind new tag */
+    MP3TAG_WRITE_STRATEGY_COUNT
+} mp3tag_write_strategy_t;
+
+/*
+ * Cumulative per-context counters (see mp3tag_get_stats()). I/O counts
+ * are calls into the file layer, each of which is one system call.
+ */
+typedef struct {
+    struct {
+        uint64_t open;
+        uint64_t close;
+        uint64_t read;
+        uint64_t write;
+        uint64_t seek;
+        uint64_t stat;
+        uint64_t fsync;
+        uint64_t rename;
+    } syscalls;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+
+    uint64_t allocations;
+    uint64_t bytes_allocated;
+
+    uint64_t frames_parsed;
+    uint64_t frames_skipped;       /* Compressed or encrypted */
+    uint64_t transcoded_bytes[MP3TAG_ENC_COUNT];  /* Source text bytes */
+
+    uint64_t write_strategy[MP3TAG_WRITE_STRATEGY_COUNT];
+    uint64_t bytes_copied;         /* Moved by rewrites */
+    uint64_t fsync_ns;             /* Total time in fsync */
+} mp3tag_stats_t;
+
+/*
+ * Allocation totals for one call-site tag (see mp3tag_alloc_profile()).
+ */
+typedef struct {
+    const char *tag;               /* e.g. "frame_data", "decoded_text" */
+    uint64_t    allocations;
+    uint64_t    bytes;             /* Requested, summed over allocations */
+    uint64_t    live_bytes;        /* Allocated and not yet freed */
+    uint64_t    peak_bytes;        /* High-water mark of live_bytes */
+} mp3tag_alloc_site_t;
+
+/*
+ * Traced phases of reading and writing (see mp3tag_set_trace()).
+ */
+typedef enum {
+    MP3TAG_PHASE_CONTAINER_DETECT = 0,   /* bytes: read while probing */
+    MP3TAG_PHASE_ID3V2_HEADER,           /* bytes: header size */
+    MP3TAG_PHASE_ID3V2_FRAMES,           /* bytes: tag size */
+    MP3TAG_PHASE_FRAMES_TO_COLLECTION,   /* bytes: frame payloads */
+    MP3TAG_PHASE_SERIALIZE,              /* bytes: serialized frames */
+    MP3TAG_PHASE_INPLACE_WRITE,          /* bytes: tag space rewritten */
+    MP3TAG_PHASE_REWRITE_COPY,           /* bytes: copied to the new file */
+    MP3TAG_PHASE_FSYNC,                  /* bytes: 0 */
+    MP3TAG_PHASE_RENAME,                 /* bytes: 0 */
+    MP3TAG_PHASE_COUNT
+} mp3tag_phase_t;
+
+/*
+ * Phase callbacks, run synchronously on the calling thread; `end`
+ * receives the phase's byte count. Either may be NULL.
+ */
+typedef struct {
+    void (*begin)(mp3tag_phase_t phase, void *user_data);
+    void (*end)(mp3tag_phase_t phase, uint64_t bytes, void *user_data);
+    void  *user_data;
+} mp3tag_trace_hooks_t;
+
+/*
+ * Opaque per-phase latency histogram usable as a trace sink (see
+ * mp3tag_histogram_create()). Thread-safe.
+ */
+typedef struct mp3tag_histogram mp3tag_histogram_t;
+
+/*
+ * Opaque per-operation CPU counter aggregate (see mp3tag_perf_create()).
+ * Thread-safe; may be attached to any number of contexts.
+ */
+typedef struct mp3tag_perf mp3tag_perf_t;
+
+typedef enum {
+    MP3TAG_PERF_OP_OPEN = 0,       /* mp3tag_open(), mp3tag_open_rw() */
+    MP3TAG_PERF_OP_READ,           /* mp3tag_read_tags() */
+    MP3TAG_PERF_OP_WRITE,          /* mp3tag_write_tags() */
+    MP3TAG_PERF_OP_COUNT
+} mp3tag_perf_op_t;
+
+typedef enum {
+    MP3TAG_PERF_SOFTWARE = 0,      /* Clocks and getrusage() only */
+    MP3TAG_PERF_HARDWARE           /* PMU counters via perf_event_open() */
+} mp3tag_perf_source_t;
+
+/*
+ * Per-call averages for one operation. The hardware fields are 0 unless
+ * `source` is MP3TAG_PERF_HARDWARE; they count user space only.
+ */
+typedef struct {
+    uint64_t             calls;
+    mp3tag_perf_source_t source;   /* Least capable source among the calls */
+    double               wall_ns;
+    double               cpu_ns;   /* Thread CPU time */
+    double               page_faults;
+    double               context_switches;
+    double               cycles;
+    double               instructions;
+    double               cache_misses;
+    double               branch_misses;
+} mp3tag_perf_report_t;
+
+/*
+ * Opaque recorder of file-layer calls (see mp3tag_iotrace_create()).
+ * Thread-safe; may be attached to any number of contexts.
+ */
+typedef struct mp3tag_iotrace mp3tag_iotrace_t;
+
+/*
+ * Opaque metrics registry aggregating the counters, errors and phase
+ * latencies of the contexts attached to it (see mp3tag_metrics_create()).
+ * Thread-safe; may be attached to any number of contexts.
+ */
+typedef struct mp3tag_metrics mp3tag_metrics_t;
+
+/*
+ * Opaque persistent cache of probe results and parsed tags, keyed by
+ * file identity (device, inode, size, mtime). Thread-safe.
+ */
+typedef struct mp3tag_cache mp3tag_cache_t;
+
+/*
+ * Opaque immutable, reference-counted collection. Readers in any thread
+ * may use it until they release their reference.
+ */
+typedef struct mp3tag_snapshot mp3tag_snapshot_t;
+
+/*
+ * Opaque shared in-memory cache of snapshots, bounded by total bytes
+ * (binary frames included). Lookups are lock-free.
+ */
+typedef struct mp3tag_lru mp3tag_lru_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t   entries;
+    size_t   bytes;
+} mp3tag_lru_stats_t;
+
+/*
+ * Opaque in-process catalog index over many files. Thread-safe.
+ */
+typedef struct mp3tag_index mp3tag_index_t;
+
+/*
+ * Match callback for index queries. Return non-zero to stop.
+ */
+typedef int (*mp3tag_index_callback_t)(const char *path, void *user_data);
+
+#define MP3TAG_INDEX_SIZE_BUCKETS 32
+
+/*
+ * Size statistics for one frame name across the files in an index.
+ * A frame's size is its value length in bytes, or its binary size.
+ */
+typedef struct {
+    uint64_t count;         /* Frames indexed */
+    uint64_t total_bytes;
+    uint64_t max_bytes;     /* Largest ever seen; not lowered on removal */
+    /* Bucket i counts sizes in [2^i, 2^(i+1)); bucket 0 also holds 0,
+       the last bucket everything larger */
+    uint64_t size_histogram[MP3TAG_INDEX_SIZE_BUCKETS];
+} mp3tag_frame_stats_t;
+
+/*
+ * Options for mp3tag_read_batch(). Zero-initialise for defaults.
+ */
+typedef struct {
+    size_t                    thread_count; /* Worker threads (0 = online CPUs) */
+    const mp3tag_allocator_t *allocator;    /* Context allocator (NULL = malloc) */
+    int                       order_by_location; /* Visit files in on-disk order */
+    mp3tag_cache_t           *cache;        /* Shared cache (NULL = none) */
+    mp3tag_metrics_t         *metrics;      /* Registry (NULL = none) */
+} mp3tag_batch_options_t;
+
+/*
+ * Per-file result of a batch read. On success `tags` is owned by the
+ * caller; release it with mp3tag_collection_free() or
+ * mp3tag_batch_results_free().
+ */
+typedef struct {
+    int                  error;  /* MP3TAG_OK or an MP3TAG_ERR_* code */
+    mp3tag_collection_t *tags;   /* NULL unless error == MP3TAG_OK */
+} mp3tag_batch_result_t;
+
+/*
+ * Options for mp3tag_scan_dir(). Zero-initialise for defaults.
+ */
+typedef struct {
+    size_t                    thread_count;    /* Worker threads (0 = online CPUs) */
+    int                       detect_by_magic; /* Sniff files with unknown extensions */
+    const mp3tag_allocator_t *allocator;       /* Context allocator (NULL = malloc) */
+    mp3tag_cache_t           *cache;           /* Shared cache (NULL = none) */
+    mp3tag_metrics_t         *metrics;         /* Registry (NULL = none) */
+} mp3tag_scan_options_t;
+
+/*
+ * Result callback for mp3tag_scan_dir(). `tags` is NULL unless
+ * `error` is MP3TAG_OK and is only valid for the duration of the call.
+ * Return non-zero to stop the scan.
+ */
+typedef int (*mp3tag_scan_callback_t)(const char *path, int error,
+                                      const mp3tag_collection_t *tags,
+                                      void *user_data);
+
+/*
+ * Opaque change watcher that re-reads modified files (see
+ * mp3tag_watcher_create()).
+ */
+typedef struct mp3tag_watcher mp3tag_watcher_t;
+
+/*
+ * Options for mp3tag_watcher_create(). Zero-initialise for defaults.
+ * `callback` is told about every re-read file (error MP3TAG_ERR_IO for
+ * files that disappeared); its return value is ignored.
+ */
+typedef struct {
+    mp3tag_cache_t           *cache;        /* Updated through re-reads */
+    mp3tag_index_t           *index;        /* Entries added/replaced/removed */
+    unsigned                  debounce_ms;  /* Quiet period (0 = 500 ms) */
+    const char               *cursor_path;  /* Resume cursor file (NULL = none) */
+    const mp3tag_allocator_t *allocator;    /* Context allocator (NULL = malloc) */
+    mp3tag_scan_callback_t    callback;
+    void                     *user_data;
+} mp3tag_watch_options_t;
+
+/*
+ * Opaque write-behind queue that coalesces edits (see
+ * mp3tag_writeback_create()).
+ */
+typedef struct mp3tag_writeback mp3tag_writeback_t;
+
+/*
+ * Options for mp3tag_writeback_create(). Zero-initialise for defaults.
+ */
+typedef struct {
+    unsigned                  delay_ms;     /* Flush this long after a file's
+                                               first pending edit (0 = only
+                                               on explicit flush) */
+    const char               *journal_path; /* Intent log making flushes
+                                               crash-safe (NULL = none) */
+    const mp3tag_allocator_t *allocator;    /* Context allocator (NULL = malloc) */
+} mp3tag_writeback_options_t;
+
+/*
+ * Opaque sequential batch iterator with cross-file readahead.
+ */
+typedef struct mp3tag_batch_iter mp3tag_batch_iter_t;
+
 /*
  * Opaque context — all operations go through this.
  */
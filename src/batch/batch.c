@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE    /* _SC_NPROCESSORS_ONLN on Apple platforms */
+
+#include "batch.h"
+#include "../mp3tag_internal.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------ */
+/*  Shared helpers                                                     */
+/* ------------------------------------------------------------------ */
+
+int batch_read_one(mp3tag_context_t *ctx, const char *path,
+                   mp3tag_collection_t **tags)
+{
+    *tags = NULL;
+
+    int rc = mp3tag_open(ctx, path);
+    if (rc == MP3TAG_OK) {
+        mp3tag_collection_t *coll = NULL;
+        rc = mp3tag_read_tags(ctx, &coll);
+        if (rc == MP3TAG_OK)
+            *tags = ctx_detach_tags(ctx);
+    }
+
+    /* Close even on failure: a failed probe leaves the handle open */
+    mp3tag_close(ctx);
+    return rc;
+}
+
+size_t batch_thread_count(size_t requested, size_t work_items)
+{
+    size_t n = requested;
+    if (n == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (n > BATCH_MAX_THREADS) n = BATCH_MAX_THREADS;
+    if (n > work_items)        n = work_items;
+    if (n == 0)                n = 1;
+    return n;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Worker pool                                                        */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const char *const        *paths;
+    size_t                    count;
+    mp3tag_batch_result_t    *results;
+    const mp3tag_allocator_t *allocator;
+    mp3tag_cache_t           *cache;
+    mp3tag_metrics_t         *metrics;
+
+    /* Visiting order (NULL = input order) */
+    const size_t             *order;
+
+    /* Next unclaimed index; workers claim one path at a time */
+    atomic_size_t             next;
+} batch_job_t;
+
+static void *batch_worker(void *arg)
+{
+    batch_job_t *job = arg;
+
+    mp3tag_context_t *ctx = mp3tag_create(job->allocator);
+    if (ctx) {
+        mp3tag_set_cache(ctx, job->cache);
+        mp3tag_set_metrics(ctx, job->metrics);
+    }
+
+    for (;;) {
+        size_t i = atomic_fetch_add_explicit(&job->next, 1,
+                                             memory_order_relaxed);
+        if (i >= job->count)
+            break;
+        if (job->order)
+            i = job->order[i];
+
+        mp3tag_batch_result_t *res = &job->results[i];
+        if (!ctx) {
+            res->error = MP3TAG_ERR_NO_MEMORY;
+            res->tags  = NULL;
+            continue;
+        }
+        if (!job->paths[i]) {
+            res->error = MP3TAG_ERR_INVALID_ARG;
+            res->tags  = NULL;
+            continue;
+        }
+        res->error = batch_read_one(ctx, job->paths[i], &res->tags);
+    }
+
+    mp3tag_destroy(ctx);
+    return NULL;
+}
+
+int mp3tag_read_batch(const char *const *paths, size_t count,
+                      const mp3tag_batch_options_t *opts,
+                      mp3tag_batch_result_t *results)
+{
+    if ((!paths || !results) && count > 0)
+        return MP3TAG_ERR_INVALID_ARG;
+    if (count == 0)
+        return MP3TAG_OK;
+
+    batch_job_t job;
+    job.paths     = paths;
+    job.count     = count;
+    job.results   = results;
+    job.allocator = opts ? opts->allocator : NULL;
+    job.cache     = opts ? opts->cache : NULL;
+    job.metrics   = opts ? opts->metrics : NULL;
+    job.order     = NULL;
+    atomic_init(&job.next, 0);
+
+    size_t *order = NULL;
+    if (opts && opts->order_by_location) {
+        order = malloc(count * sizeof(*order));
+        if (!order)
+            return MP3TAG_ERR_NO_MEMORY;
+        if (batch_physical_order(paths, count, order) != 0) {
+            free(order);
+            return MP3TAG_ERR_NO_MEMORY;
+        }
+        job.order = order;
+    }
+
+    size_t nthreads = batch_thread_count(opts ? opts->thread_count : 0, count);
+
+    /* The calling thread is worker 0; spawn the rest */
+    pthread_t threads[BATCH_MAX_THREADS];
+    size_t spawned = 0;
+    for (size_t t = 1; t < nthreads; t++) {
+        if (pthread_create(&threads[spawned], NULL, batch_worker, &job) != 0)
+            break;  /* Run with however many we got */
+        spawned++;
+    }
+
+    batch_worker(&job);
+
+    for (size_t t = 0; t < spawned; t++)
+        pthread_join(threads[t], NULL);
+
+    free(order);
+    return MP3TAG_OK;
+}
+
+void mp3tag_batch_results_free(mp3tag_batch_result_t *results, size_t count)
+{
+    if (!results) return;
+    for (size_t i = 0; i < count; i++) {
+        mp3tag_collection_free(NULL, results[i].tags);
+        results[i].tags  = NULL;
+        results[i].error = MP3TAG_OK;
+    }
+}
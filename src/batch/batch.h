@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Upper bound on worker threads for any batch engine */
+#define BATCH_MAX_THREADS 256
+
+/*
+ * Open `path` on a (reusable, closed) context, read its tags and hand
+ * the collection to the caller. The context is closed again on return.
+ */
+int batch_read_one(mp3tag_context_t *ctx, const char *path,
+                   mp3tag_collection_t **tags);
+
+/*
+ * Resolve a requested thread count: 0 means one per online CPU.
+ * The result is clamped to [1, min(BATCH_MAX_THREADS, work_items)].
+ */
+size_t batch_thread_count(size_t requested, size_t work_items);
+
+/*
+ * Fill `order` with a permutation of [0, count) that visits the files in
+ * ascending physical location (device, then first extent via FIEMAP /
+ * F_LOG2PHYS). Files on the same device without an extent map follow by
+ * inode number, and files that cannot be opened sort last in input
+ * order. Returns 0, or -1 if out of memory.
+ */
+int batch_physical_order(const char *const *paths, size_t count,
+                         size_t *order);
+
+/*
+ * True if `name` ends in an extension the directory scanner picks up
+ * (.mp3, .aac, .wav, .aif, .aiff, .aifc; case-insensitive).
+ */
+int batch_has_audio_extension(const char *name);
+
+/*
+ * Join a directory and an entry name with one '/'. Caller frees.
+ */
+char *batch_join_path(const char *dir, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATCH_H */
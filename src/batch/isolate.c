@@ -0,0 +1,415 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS */
+#define _DARWIN_C_SOURCE
+
+#include "batch.h"
+#include "../flat/flat.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/buffer.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
+
+/* fork() is not available to apps on iOS and friends */
+#if defined(__APPLE__) && TARGET_OS_IPHONE
+#define ISOLATE_SUPPORTED 0
+#else
+#define ISOLATE_SUPPORTED 1
+#endif
+
+#if ISOLATE_SUPPORTED
+
+/*
+ * Result record sent from worker to coordinator over the worker's pipe:
+ *   u64 index | i32 error | u32 blob size | flat blob (error == OK only)
+ */
+#define ISO_RECORD_HEADER 16
+#define ISO_READ_CHUNK    65536
+
+/*
+ * Workers in a row that died without answering or claiming a file (for
+ * example because mp3tag_create() failed under memory pressure) before
+ * the coordinator stops replacing them.
+ */
+#define ISO_MAX_IDLE_DEATHS 3
+
+/* ------------------------------------------------------------------ */
+/*  Shared state                                                       */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Lives in a MAP_SHARED mapping created before fork(), so the cursor and
+ * the per-worker "current file" markers survive a worker crash. Paths
+ * themselves are inherited through fork() and never copied.
+ */
+typedef struct {
+    atomic_size_t next;        /* Next unclaimed position */
+    atomic_size_t current[];   /* Per worker: index + 1 being parsed, 0 = idle */
+} iso_shared_t;
+
+typedef struct {
+    pid_t        pid;
+    int          fd;           /* Read end of the result pipe, -1 = none */
+    dyn_buffer_t pending;      /* Bytes of a partially received record */
+    size_t       records;      /* Received since this process was spawned */
+} iso_worker_t;
+
+typedef struct {
+    const char *const        *paths;
+    size_t                    count;
+    const size_t             *order;
+    const mp3tag_allocator_t *allocator;
+
+    mp3tag_batch_result_t    *results;
+    uint8_t                  *answered;
+
+    iso_shared_t             *shared;
+    iso_worker_t             *workers;
+    size_t                    nworkers;
+    unsigned                  idle_deaths;  /* Consecutive, see above */
+} iso_job_t;
+
+/* ------------------------------------------------------------------ */
+/*  Worker process                                                     */
+/* ------------------------------------------------------------------ */
+
+static int write_all(int fd, const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static void put_le(uint8_t *b, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        b[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void worker_main(iso_job_t *job, size_t slot, int fd)
+{
+    mp3tag_context_t *ctx = mp3tag_create(job->allocator);
+    if (!ctx) _exit(1);
+
+    dyn_buffer_t out;
+    buffer_init(&out);
+
+    for (;;) {
+        size_t pos = atomic_fetch_add(&job->shared->next, 1);
+        if (pos >= job->count)
+            break;
+        size_t i = job->order ? job->order[pos] : pos;
+        atomic_store(&job->shared->current[slot], i + 1);
+
+        mp3tag_collection_t *coll = NULL;
+        int rc = job->paths[i]
+                 ? batch_read_one(ctx, job->paths[i], &coll)
+                 : MP3TAG_ERR_INVALID_ARG;
+
+        out.size = 0;
+        uint8_t hdr[ISO_RECORD_HEADER];
+        if (buffer_append(&out, hdr, sizeof(hdr)) != 0)
+            _exit(1);
+        if (rc == MP3TAG_OK)
+            rc = flat_encode(coll, &out);
+        mp3tag_collection_free(NULL, coll);
+        if (rc != MP3TAG_OK)
+            out.size = ISO_RECORD_HEADER;
+
+        put_le(out.data,      i, 8);
+        put_le(out.data + 8,  (uint32_t)rc, 4);
+        put_le(out.data + 12, out.size - ISO_RECORD_HEADER, 4);
+        if (write_all(fd, out.data, out.size) != 0)
+            _exit(1);
+
+        atomic_store(&job->shared->current[slot], 0);
+    }
+
+    buffer_free(&out);
+    mp3tag_destroy(ctx);
+    _exit(0);
+}
+
+static int spawn_worker(iso_job_t *job, size_t slot)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* Drop every read end we inherited, including our own */
+        close(fds[0]);
+        for (size_t k = 0; k < job->nworkers; k++) {
+            if (job->workers[k].fd >= 0)
+                close(job->workers[k].fd);
+        }
+        worker_main(job, slot, fds[1]);
+    }
+
+    close(fds[1]);
+    job->workers[slot].pid = pid;
+    job->workers[slot].fd  = fds[0];
+    job->workers[slot].pending.size = 0;
+    job->workers[slot].records      = 0;
+    atomic_store(&job->shared->current[slot], 0);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Coordinator                                                        */
+/* ------------------------------------------------------------------ */
+
+static uint64_t get_le(const uint8_t *b, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | b[i];
+    return v;
+}
+
+/* Decode every complete record in the worker's pending buffer */
+static void drain_records(iso_job_t *job, iso_worker_t *w)
+{
+    size_t off = 0;
+    while (w->pending.size - off >= ISO_RECORD_HEADER) {
+        const uint8_t *rec = w->pending.data + off;
+        uint64_t idx  = get_le(rec, 8);
+        int      rc   = (int)(int32_t)get_le(rec + 8, 4);
+        uint32_t size = (uint32_t)get_le(rec + 12, 4);
+
+        if (w->pending.size - off - ISO_RECORD_HEADER < size)
+            break;
+
+        if (idx < job->count && !job->answered[idx]) {
+            mp3tag_batch_result_t *res = &job->results[idx];
+            res->tags  = NULL;
+            res->error = rc;
+            if (rc == MP3TAG_OK)
+                res->error = flat_decode(rec + ISO_RECORD_HEADER, size,
+                                         &res->tags);
+            job->answered[idx] = 1;
+        }
+        w->records++;
+        job->idle_deaths = 0;
+        off += ISO_RECORD_HEADER + size;
+    }
+
+    if (off > 0) {
+        memmove(w->pending.data, w->pending.data + off, w->pending.size - off);
+        w->pending.size -= off;
+    }
+}
+
+/*
+ * Reap an exited worker; blame its in-flight file if it did not exit
+ * cleanly. An exit status that cannot be collected (say SIGCHLD is
+ * ignored) counts as unclean. Returns 1 if it died without claiming or
+ * answering anything.
+ */
+static int reap_worker(iso_job_t *job, size_t slot)
+{
+    iso_worker_t *w = &job->workers[slot];
+    int status = 0;
+    pid_t pid;
+
+    close(w->fd);
+    w->fd = -1;
+    while ((pid = waitpid(w->pid, &status, 0)) < 0 && errno == EINTR)
+        ;
+
+    size_t current = atomic_load(&job->shared->current[slot]);
+    int clean = pid == w->pid && WIFEXITED(status) &&
+                WEXITSTATUS(status) == 0;
+    if (!clean && current > 0 && !job->answered[current - 1]) {
+        job->results[current - 1].error = MP3TAG_ERR_WORKER_CRASHED;
+        job->results[current - 1].tags  = NULL;
+        job->answered[current - 1] = 1;
+    }
+    return !clean && current == 0 && w->records == 0;
+}
+
+/* Kill and reap the workers still running; their in-flight files fail */
+static void stop_workers(iso_job_t *job)
+{
+    for (size_t k = 0; k < job->nworkers; k++) {
+        if (job->workers[k].fd < 0) continue;
+        kill(job->workers[k].pid, SIGKILL);
+        reap_worker(job, k);
+    }
+}
+
+static void run_coordinator(iso_job_t *job)
+{
+    struct pollfd *pfds = calloc(job->nworkers, sizeof(*pfds));
+    uint8_t *chunk = malloc(ISO_READ_CHUNK);
+    if (!pfds || !chunk) goto out;
+
+    for (;;) {
+        nfds_t n = 0;
+        for (size_t k = 0; k < job->nworkers; k++) {
+            pfds[k].fd      = job->workers[k].fd;  /* -1 is ignored */
+            pfds[k].events  = POLLIN;
+            pfds[k].revents = 0;
+            if (job->workers[k].fd >= 0) n++;
+        }
+        if (n == 0)
+            break;
+
+        if (poll(pfds, job->nworkers, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (size_t k = 0; k < job->nworkers; k++) {
+            iso_worker_t *w = &job->workers[k];
+            if (w->fd < 0 || !(pfds[k].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            ssize_t got = read(w->fd, chunk, ISO_READ_CHUNK);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got > 0 && buffer_append(&w->pending, chunk, (size_t)got) == 0) {
+                drain_records(job, w);
+                continue;
+            }
+
+            /* EOF, read error or no memory: treat the worker as gone */
+            if (reap_worker(job, k))
+                job->idle_deaths++;
+            /* Past the limit, unclaimed files are reported as lost */
+            if (atomic_load(&job->shared->next) < job->count &&
+                job->idle_deaths < ISO_MAX_IDLE_DEATHS)
+                spawn_worker(job, k);
+        }
+    }
+
+out:
+    /* Only set up or poll failures leave workers behind */
+    stop_workers(job);
+    free(chunk);
+    free(pfds);
+}
+
+int mp3tag_read_batch_isolated(const char *const *paths, size_t count,
+                               const mp3tag_batch_options_t *opts,
+                               mp3tag_batch_result_t *results)
+{
+    if ((!paths || !results) && count > 0)
+        return MP3TAG_ERR_INVALID_ARG;
+    if (count == 0)
+        return MP3TAG_OK;
+
+    iso_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.paths     = paths;
+    job.count     = count;
+    job.results   = results;
+    job.allocator = opts ? opts->allocator : NULL;
+    job.nworkers  = batch_thread_count(opts ? opts->thread_count : 0, count);
+
+    int result = MP3TAG_ERR_NO_MEMORY;
+    size_t *order = NULL;
+    size_t shared_size = sizeof(iso_shared_t) +
+                         job.nworkers * sizeof(atomic_size_t);
+
+    job.answered = calloc(count, 1);
+    job.workers  = calloc(job.nworkers, sizeof(*job.workers));
+    if (!job.answered || !job.workers)
+        goto cleanup;
+
+    if (opts && opts->order_by_location) {
+        order = malloc(count * sizeof(*order));
+        if (!order || batch_physical_order(paths, count, order) != 0)
+            goto cleanup;
+        job.order = order;
+    }
+
+    void *map = mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        result = MP3TAG_ERR_IO;
+        goto cleanup;
+    }
+    job.shared = map;
+    atomic_init(&job.shared->next, 0);
+    for (size_t k = 0; k < job.nworkers; k++) {
+        atomic_init(&job.shared->current[k], 0);
+        job.workers[k].fd = -1;
+        buffer_init(&job.workers[k].pending);
+    }
+
+    size_t started = 0;
+    for (size_t k = 0; k < job.nworkers; k++) {
+        if (spawn_worker(&job, k) == 0)
+            started++;
+    }
+
+    if (started == 0) {
+        result = MP3TAG_ERR_IO;
+    } else {
+        run_coordinator(&job);
+        result = MP3TAG_OK;
+    }
+
+    /* Anything never answered was lost with a worker (or never started) */
+    for (size_t i = 0; i < count; i++) {
+        if (!job.answered[i]) {
+            results[i].error = started ? MP3TAG_ERR_WORKER_CRASHED
+                                       : MP3TAG_ERR_IO;
+            results[i].tags  = NULL;
+        }
+    }
+
+    for (size_t k = 0; k < job.nworkers; k++)
+        buffer_free(&job.workers[k].pending);
+    munmap(map, shared_size);
+
+cleanup:
+    free(order);
+    free(job.workers);
+    free(job.answered);
+    return result;
+}
+
+#else /* !ISOLATE_SUPPORTED */
+
+int mp3tag_read_batch_isolated(const char *const *paths, size_t count,
+                               const mp3tag_batch_options_t *opts,
+                               mp3tag_batch_result_t *results)
+{
+    (void)paths;
+    (void)count;
+    (void)opts;
+    (void)results;
+    return MP3TAG_ERR_UNSUPPORTED;
+}
+
+#endif /* ISOLATE_SUPPORTED */
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _DEFAULT_SOURCE     /* posix_fadvise */
+#define _DARWIN_C_SOURCE    /* F_RDADVISE */
+
+#include "batch.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Head range covers the ID3v2 header and frames of a typical tag with
+ * embedded cover art; tail range covers ID3v1 and an ID3 chunk appended
+ * to the end of a WAV/AIFF file.
+ */
+#define ITER_HEAD_BYTES      (256 * 1024)
+#define ITER_TAIL_BYTES      (64 * 1024)
+
+/* Readahead window bounds (files ahead of the one being parsed) */
+#define ITER_WINDOW_MIN      1
+#define ITER_WINDOW_START    4
+#define ITER_WINDOW_MAX      64
+
+/*
+ * A parse slower than this means the data was not cached yet, so the
+ * window was too short; one faster than ITER_HIT_NS was a cache hit.
+ */
+#define ITER_MISS_NS         1000000ull
+#define ITER_HIT_NS          200000ull
+
+struct mp3tag_batch_iter {
+    const char *const *paths;
+    size_t             count;
+    size_t             pos;       /* Next file to parse */
+    size_t             advised;   /* Files [0, advised) have been advised */
+    size_t             window;    /* Current readahead distance */
+
+    mp3tag_context_t  *ctx;
+};
+
+/* ------------------------------------------------------------------ */
+/*  Readahead                                                          */
+/* ------------------------------------------------------------------ */
+
+static void advise_range(int fd, int64_t offset, int64_t len)
+{
+#if defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd, (off_t)offset, (off_t)len, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+    struct radvisory ra;
+    ra.ra_offset = (off_t)offset;
+    ra.ra_count  = (int)len;
+    fcntl(fd, F_RDADVISE, &ra);
+#else
+    (void)fd;
+    (void)offset;
+    (void)len;
+#endif
+}
+
+static void advise_file(const char *path)
+{
+    if (!path) return;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        int64_t size = (int64_t)st.st_size;
+        int64_t head = size < ITER_HEAD_BYTES ? size : ITER_HEAD_BYTES;
+        advise_range(fd, 0, head);
+        if (size > head) {
+            int64_t tail = size - head < ITER_TAIL_BYTES
+                           ? size - head : ITER_TAIL_BYTES;
+            advise_range(fd, size - tail, tail);
+        }
+    }
+    close(fd);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Widen the window quickly when parses stall on I/O, narrow it slowly
+ * when everything is already cached.
+ */
+static void tune_window(mp3tag_batch_iter_t *it, uint64_t elapsed_ns)
+{
+    if (elapsed_ns > ITER_MISS_NS) {
+        it->window *= 2;
+        if (it->window > ITER_WINDOW_MAX) it->window = ITER_WINDOW_MAX;
+    } else if (elapsed_ns < ITER_HIT_NS && it->window > ITER_WINDOW_MIN) {
+        it->window--;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_batch_iter_t *mp3tag_batch_iter_create(const char *const *paths,
+                                              size_t count,
+                                              const mp3tag_allocator_t *allocator)
+{
+    if (!paths && count > 0) return NULL;
+
+    mp3tag_batch_iter_t *it = calloc(1, sizeof(*it));
+    if (!it) return NULL;
+
+    it->ctx = mp3tag_create(allocator);
+    if (!it->ctx) { free(it); return NULL; }
+
+    it->paths  = paths;
+    it->count  = count;
+    it->window = ITER_WINDOW_START;
+    return it;
+}
+
+int mp3tag_batch_iter_next(mp3tag_batch_iter_t *it,
+                           mp3tag_batch_result_t *result)
+{
+    if (!it || !result) return MP3TAG_ERR_INVALID_ARG;
+    if (it->pos >= it->count) return 0;
+
+    /* Keep the window of upcoming files in flight */
+    size_t target = it->pos + 1 + it->window;
+    if (target > it->count) target = it->count;
+    if (it->advised < it->pos + 1) it->advised = it->pos + 1;
+    while (it->advised < target)
+        advise_file(it->paths[it->advised++]);
+
+    const char *path = it->paths[it->pos++];
+    result->tags = NULL;
+    if (!path) {
+        result->error = MP3TAG_ERR_INVALID_ARG;
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    result->error = batch_read_one(it->ctx, path, &result->tags);
+    tune_window(it, now_ns() - start);
+
+    return 1;
+}
+
+void mp3tag_batch_iter_destroy(mp3tag_batch_iter_t *it)
+{
+    if (!it) return;
+    mp3tag_destroy(it->ctx);
+    free(it);
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE    /* F_LOG2PHYS */
+
+#include "batch.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
+/* ------------------------------------------------------------------ */
+/*  Physical location lookup                                           */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Best-effort physical byte offset of the first extent of an open file.
+ * Returns 0 on success. Filesystems without extent maps (tmpfs, network
+ * filesystems) fail here and the caller falls back to the inode number.
+ */
+static int first_extent(int fd, uint64_t *out)
+{
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+    /* struct fiemap ends in a flexible array: room for one extent */
+    uint64_t req[(sizeof(struct fiemap) +
+                  sizeof(struct fiemap_extent)) / sizeof(uint64_t) + 1];
+    struct fiemap *map = (struct fiemap *)req;
+    memset(req, 0, sizeof(req));
+    map->fm_start        = 0;
+    map->fm_length       = ~(uint64_t)0;
+    map->fm_extent_count = 1;
+
+    if (ioctl(fd, FS_IOC_FIEMAP, map) == 0 &&
+        map->fm_mapped_extents > 0 &&
+        !(map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN)) {
+        *out = map->fm_extents[0].fe_physical;
+        return 0;
+    }
+    return -1;
+#elif defined(F_LOG2PHYS)
+    struct log2phys l2p;
+    memset(&l2p, 0, sizeof(l2p));
+    if (fcntl(fd, F_LOG2PHYS, &l2p) == 0 && l2p.l2p_devoffset >= 0) {
+        *out = (uint64_t)l2p.l2p_devoffset;
+        return 0;
+    }
+    return -1;
+#else
+    (void)fd;
+    (void)out;
+    return -1;
+#endif
+}
+
+/* Key classes: physical offsets and inode numbers are not comparable */
+enum { KEY_PHYSICAL, KEY_INODE, KEY_NONE };
+
+typedef struct {
+    uint64_t device;
+    int      kind;                  /* KEY_* */
+    uint64_t key;
+    size_t   index;
+} location_t;
+
+static int compare_location(const void *a, const void *b)
+{
+    const location_t *x = a;
+    const location_t *y = b;
+    if (x->device != y->device) return x->device < y->device ? -1 : 1;
+    if (x->kind   != y->kind)   return x->kind   < y->kind   ? -1 : 1;
+    if (x->key    != y->key)    return x->key    < y->key    ? -1 : 1;
+    if (x->index  != y->index)  return x->index  < y->index  ? -1 : 1;
+    return 0;
+}
+
+int batch_physical_order(const char *const *paths, size_t count,
+                         size_t *order)
+{
+    location_t *locs = malloc(count * sizeof(*locs));
+    if (!locs) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        locs[i].device = UINT64_MAX;
+        locs[i].kind   = KEY_NONE;
+        locs[i].key    = UINT64_MAX;
+        locs[i].index  = i;
+
+        if (!paths[i]) continue;
+        int fd = open(paths[i], O_RDONLY);
+        if (fd < 0) continue;  /* Unopenable files sort last */
+
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            uint64_t phys;
+            locs[i].device = (uint64_t)st.st_dev;
+            if (first_extent(fd, &phys) == 0) {
+                locs[i].kind = KEY_PHYSICAL;
+                locs[i].key  = phys;
+            } else {
+                locs[i].kind = KEY_INODE;
+                locs[i].key  = (uint64_t)st.st_ino;
+            }
+        }
+        close(fd);
+    }
+
+    qsort(locs, count, sizeof(*locs), compare_location);
+    for (size_t i = 0; i < count; i++)
+        order[i] = locs[i].index;
+
+    free(locs);
+    return 0;
+}
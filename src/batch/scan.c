@@ -0,0 +1,450 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _DEFAULT_SOURCE     /* d_type / DT_* on glibc */
+#define _DARWIN_C_SOURCE
+
+#include "batch.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/string_util.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* How long an idle worker sleeps before re-checking for stealable work */
+#define SCAN_IDLE_WAIT_NS  2000000L
+
+/* ------------------------------------------------------------------ */
+/*  Work items and per-worker deques                                   */
+/* ------------------------------------------------------------------ */
+
+typedef enum {
+    SCAN_DIR = 0,     /* Directory to enumerate */
+    SCAN_FILE,        /* File with a known extension: read tags */
+    SCAN_SNIFF        /* Unknown extension: check magic, then read */
+} scan_kind_t;
+
+typedef struct {
+    char        *path;
+    scan_kind_t  kind;
+} scan_item_t;
+
+/*
+ * The owner pushes and pops at `tail` (LIFO, keeps the working set
+ * small); thieves take from `head`, i.e. the oldest and usually largest
+ * pieces of the tree.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    scan_item_t    *items;
+    size_t          head;
+    size_t          tail;
+    size_t          cap;
+} scan_deque_t;
+
+static int deque_push(scan_deque_t *dq, scan_item_t item)
+{
+    int rc = 0;
+    pthread_mutex_lock(&dq->lock);
+
+    if (dq->tail == dq->cap) {
+        if (dq->head > 0) {
+            /* Reclaim the space thieves left at the front */
+            memmove(dq->items, dq->items + dq->head,
+                    (dq->tail - dq->head) * sizeof(*dq->items));
+            dq->tail -= dq->head;
+            dq->head  = 0;
+        } else {
+            size_t new_cap = dq->cap ? dq->cap * 2 : 64;
+            scan_item_t *n = realloc(dq->items, new_cap * sizeof(*n));
+            if (!n) {
+                rc = -1;
+                goto out;
+            }
+            dq->items = n;
+            dq->cap   = new_cap;
+        }
+    }
+    dq->items[dq->tail++] = item;
+
+out:
+    pthread_mutex_unlock(&dq->lock);
+    return rc;
+}
+
+static int deque_take(scan_deque_t *dq, scan_item_t *item, int steal)
+{
+    int got = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail > dq->head) {
+        *item = steal ? dq->items[dq->head++] : dq->items[--dq->tail];
+        if (dq->head == dq->tail)
+            dq->head = dq->tail = 0;
+        got = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return got;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Scan state                                                         */
+/* ------------------------------------------------------------------ */
+
+typedef struct scan_job scan_job_t;
+
+typedef struct {
+    scan_job_t       *job;
+    size_t            id;
+    scan_deque_t      deque;
+    mp3tag_context_t *ctx;
+} scan_worker_t;
+
+struct scan_job {
+    scan_worker_t          *workers;
+    size_t                  nworkers;
+    int                     detect_by_magic;
+
+    mp3tag_scan_callback_t  callback;
+    void                   *user_data;
+    pthread_mutex_t         callback_lock;
+
+    /* Items queued or in progress; the scan ends when this reaches 0 */
+    atomic_size_t           outstanding;
+    atomic_int              stop;
+
+    pthread_mutex_t         idle_lock;
+    pthread_cond_t          idle_cond;
+    atomic_int              sleepers;
+};
+
+static void report(scan_job_t *job, const char *path, int error,
+                   const mp3tag_collection_t *tags)
+{
+    pthread_mutex_lock(&job->callback_lock);
+    if (!atomic_load(&job->stop) &&
+        job->callback(path, error, tags, job->user_data) != 0)
+        atomic_store(&job->stop, 1);
+    pthread_mutex_unlock(&job->callback_lock);
+}
+
+static void wake_idle(scan_job_t *job)
+{
+    if (atomic_load_explicit(&job->sleepers, memory_order_relaxed) == 0)
+        return;
+    pthread_mutex_lock(&job->idle_lock);
+    pthread_cond_broadcast(&job->idle_cond);
+    pthread_mutex_unlock(&job->idle_lock);
+}
+
+static void enqueue(scan_worker_t *w, char *path, scan_kind_t kind)
+{
+    scan_item_t item = { path, kind };
+
+    atomic_fetch_add(&w->job->outstanding, 1);
+    if (deque_push(&w->deque, item) != 0) {
+        atomic_fetch_sub(&w->job->outstanding, 1);
+        report(w->job, path, MP3TAG_ERR_NO_MEMORY, NULL);
+        free(path);
+        return;
+    }
+    wake_idle(w->job);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Candidate detection                                                */
+/* ------------------------------------------------------------------ */
+
+int batch_has_audio_extension(const char *name)
+{
+    static const char *const exts[] = {
+        "mp3", "aac", "wav", "aif", "aiff", "aifc", NULL
+    };
+
+    const char *dot = strrchr(name, '.');
+    if (!dot || dot == name) return 0;
+
+    for (const char *const *e = exts; *e; e++) {
+        if (str_casecmp(dot + 1, *e) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Same signatures container_detect() and the ID3v2/ADTS readers accept */
+static int has_audio_magic(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    uint8_t m[12];
+    ssize_t n = read(fd, m, sizeof(m));
+    close(fd);
+
+    if (n >= 3 && m[0] == 'I' && m[1] == 'D' && m[2] == '3')
+        return 1;
+    if (n >= 2 && m[0] == 0xFF && (m[1] & 0xE0) == 0xE0)
+        return 1;  /* MPEG audio / ADTS frame sync */
+    if (n == 12 && memcmp(m, "RIFF", 4) == 0 &&
+        (memcmp(m + 8, "WAVE", 4) == 0 || memcmp(m + 8, "AVI ", 4) == 0))
+        return 1;
+    if (n == 12 && memcmp(m, "FORM", 4) == 0 &&
+        (memcmp(m + 8, "AIFF", 4) == 0 || memcmp(m + 8, "AIFC", 4) == 0))
+        return 1;
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Item processing                                                    */
+/* ------------------------------------------------------------------ */
+
+char *batch_join_path(const char *dir, const char *name)
+{
+    size_t dlen = strlen(dir);
+    size_t nlen = strlen(name);
+    int need_sep = dlen > 0 && dir[dlen - 1] != '/';
+
+    char *out = malloc(dlen + (size_t)need_sep + nlen + 1);
+    if (!out) return NULL;
+    memcpy(out, dir, dlen);
+    if (need_sep) out[dlen++] = '/';
+    memcpy(out + dlen, name, nlen + 1);
+    return out;
+}
+
+static void process_dir(scan_worker_t *w, const char *path)
+{
+    DIR *d = opendir(path);
+    if (!d) {
+        report(w->job, path, MP3TAG_ERR_IO, NULL);
+        return;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL && !atomic_load(&w->job->stop)) {
+        const char *name = de->d_name;
+        if (name[0] == '.' &&
+            (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+
+        int is_dir = 0, is_reg = 0;
+#ifdef DT_DIR
+        if (de->d_type == DT_DIR)      is_dir = 1;
+        else if (de->d_type == DT_REG) is_reg = 1;
+        else if (de->d_type != DT_UNKNOWN) continue;  /* links, devices, ... */
+#endif
+
+        /* Cheap rejection before allocating a path */
+        int known = batch_has_audio_extension(name);
+        if (is_reg && !known && !w->job->detect_by_magic)
+            continue;
+
+        char *child = batch_join_path(path, name);
+        if (!child) {
+            report(w->job, path, MP3TAG_ERR_NO_MEMORY, NULL);
+            continue;
+        }
+
+        if (!is_dir && !is_reg) {
+            struct stat st;
+            if (lstat(child, &st) != 0) { free(child); continue; }
+            is_dir = S_ISDIR(st.st_mode);
+            is_reg = S_ISREG(st.st_mode);
+        }
+
+        if (is_dir)
+            enqueue(w, child, SCAN_DIR);
+        else if (is_reg && known)
+            enqueue(w, child, SCAN_FILE);
+        else if (is_reg && w->job->detect_by_magic)
+            enqueue(w, child, SCAN_SNIFF);
+        else
+            free(child);
+    }
+
+    closedir(d);
+}
+
+static void process_file(scan_worker_t *w, const char *path)
+{
+    mp3tag_collection_t *tags = NULL;
+    int rc = batch_read_one(w->ctx, path, &tags);
+    report(w->job, path, rc, tags);
+    mp3tag_collection_free(NULL, tags);
+}
+
+static void process_item(scan_worker_t *w, scan_item_t *item)
+{
+    if (!atomic_load(&w->job->stop)) {
+        switch (item->kind) {
+        case SCAN_DIR:
+            process_dir(w, item->path);
+            break;
+        case SCAN_SNIFF:
+            if (!has_audio_magic(item->path))
+                break;
+            /* fall through */
+        case SCAN_FILE:
+            process_file(w, item->path);
+            break;
+        }
+    }
+    free(item->path);
+
+    if (atomic_fetch_sub(&w->job->outstanding, 1) == 1) {
+        /* Last item: let sleeping workers notice the scan is over */
+        pthread_mutex_lock(&w->job->idle_lock);
+        pthread_cond_broadcast(&w->job->idle_cond);
+        pthread_mutex_unlock(&w->job->idle_lock);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Worker loop                                                        */
+/* ------------------------------------------------------------------ */
+
+static int steal(scan_worker_t *w, scan_item_t *item)
+{
+    scan_job_t *job = w->job;
+    for (size_t k = 1; k < job->nworkers; k++) {
+        scan_worker_t *victim = &job->workers[(w->id + k) % job->nworkers];
+        if (deque_take(&victim->deque, item, 1))
+            return 1;
+    }
+    return 0;
+}
+
+static void idle_wait(scan_job_t *job)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += SCAN_IDLE_WAIT_NS;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&job->idle_lock);
+    atomic_fetch_add(&job->sleepers, 1);
+    if (atomic_load(&job->outstanding) > 0)
+        pthread_cond_timedwait(&job->idle_cond, &job->idle_lock, &ts);
+    atomic_fetch_sub(&job->sleepers, 1);
+    pthread_mutex_unlock(&job->idle_lock);
+}
+
+static void *scan_worker(void *arg)
+{
+    scan_worker_t *w = arg;
+    scan_item_t item;
+
+    for (;;) {
+        if (deque_take(&w->deque, &item, 0) || steal(w, &item)) {
+            process_item(w, &item);
+            continue;
+        }
+        if (atomic_load(&w->job->outstanding) == 0)
+            break;
+        idle_wait(w->job);
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+int mp3tag_scan_dir(const char *root, const mp3tag_scan_options_t *opts,
+                    mp3tag_scan_callback_t callback, void *user_data)
+{
+    if (!root || !callback)
+        return MP3TAG_ERR_INVALID_ARG;
+
+    struct stat st;
+    if (stat(root, &st) != 0)  return MP3TAG_ERR_IO;
+    if (!S_ISDIR(st.st_mode))  return MP3TAG_ERR_INVALID_ARG;
+
+    char *root_copy = str_dup(root);
+    if (!root_copy) return MP3TAG_ERR_NO_MEMORY;
+
+    size_t nworkers = batch_thread_count(opts ? opts->thread_count : 0,
+                                         BATCH_MAX_THREADS);
+    const mp3tag_allocator_t *allocator = opts ? opts->allocator : NULL;
+
+    scan_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.nworkers        = nworkers;
+    job.detect_by_magic = opts ? opts->detect_by_magic : 0;
+    job.callback        = callback;
+    job.user_data       = user_data;
+    atomic_init(&job.outstanding, 0);
+    atomic_init(&job.stop, 0);
+    atomic_init(&job.sleepers, 0);
+    pthread_mutex_init(&job.callback_lock, NULL);
+    pthread_mutex_init(&job.idle_lock, NULL);
+    pthread_cond_init(&job.idle_cond, NULL);
+
+    int result = MP3TAG_OK;
+
+    job.workers = calloc(nworkers, sizeof(*job.workers));
+    if (!job.workers) {
+        free(root_copy);
+        result = MP3TAG_ERR_NO_MEMORY;
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < nworkers; i++) {
+        scan_worker_t *w = &job.workers[i];
+        w->job = &job;
+        w->id  = i;
+        pthread_mutex_init(&w->deque.lock, NULL);
+        w->ctx = mp3tag_create(allocator);
+        if (!w->ctx) {
+            result = MP3TAG_ERR_NO_MEMORY;
+        } else {
+            mp3tag_set_cache(w->ctx, opts ? opts->cache : NULL);
+            mp3tag_set_metrics(w->ctx, opts ? opts->metrics : NULL);
+        }
+    }
+    if (result != MP3TAG_OK) {
+        free(root_copy);
+        goto cleanup;
+    }
+
+    enqueue(&job.workers[0], root_copy, SCAN_DIR);
+
+    /* The calling thread runs worker 0 */
+    pthread_t threads[BATCH_MAX_THREADS];
+    size_t spawned = 0;
+    for (size_t i = 1; i < nworkers; i++) {
+        if (pthread_create(&threads[spawned], NULL, scan_worker,
+                           &job.workers[i]) != 0)
+            break;
+        spawned++;
+    }
+
+    scan_worker(&job.workers[0]);
+
+    for (size_t i = 0; i < spawned; i++)
+        pthread_join(threads[i], NULL);
+
+cleanup:
+    if (job.workers) {
+        for (size_t i = 0; i < nworkers; i++) {
+            mp3tag_destroy(job.workers[i].ctx);
+            free(job.workers[i].deque.items);
+            pthread_mutex_destroy(&job.workers[i].deque.lock);
+        }
+        free(job.workers);
+    }
+    pthread_cond_destroy(&job.idle_cond);
+    pthread_mutex_destroy(&job.idle_lock);
+    pthread_mutex_destroy(&job.callback_lock);
+    return result;
+}
@@ -0,0 +1,525 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE
+
+#include "cache.h"
+#include "../flat/flat.h"
+#include "../stats/stats.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/buffer.h>
+#include <tag_common/string_util.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * On-disk layout (little-endian):
+ *   "M3TC" | u32 version | u32 entry count
+ *   per entry: identity | probe results | u32 tag state |
+ *              u64 fingerprint | u32 blob size | flat blob
+ */
+#define CACHE_MAGIC      "M3TC"
+#define CACHE_VERSION    1
+
+#define CACHE_MIN_BUCKETS 256
+
+typedef struct cache_entry {
+    file_identity_t     id;
+    cache_probe_t       probe;
+    cache_tag_state_t   state;
+    uint64_t            fingerprint;   /* FNV-1a of the flat blob */
+    uint8_t            *blob;
+    uint32_t            blob_size;
+    struct cache_entry *next;
+} cache_entry_t;
+
+struct mp3tag_cache {
+    char            *path;
+    pthread_mutex_t  lock;
+    cache_entry_t  **buckets;
+    size_t           nbuckets;
+    size_t           count;
+    int              dirty;
+};
+
+/* ------------------------------------------------------------------ */
+/*  Identity                                                           */
+/* ------------------------------------------------------------------ */
+
+static void identity_from_stat(const struct stat *st, file_identity_t *id)
+{
+    id->dev  = (uint64_t)st->st_dev;
+    id->ino  = (uint64_t)st->st_ino;
+    id->size = (int64_t)st->st_size;
+#if defined(__APPLE__)
+    id->mtime_ns = (int64_t)st->st_mtimespec.tv_sec * 1000000000 +
+                   st->st_mtimespec.tv_nsec;
+    id->ctime_ns = (int64_t)st->st_ctimespec.tv_sec * 1000000000 +
+                   st->st_ctimespec.tv_nsec;
+#else
+    id->mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 +
+                   st->st_mtim.tv_nsec;
+    id->ctime_ns = (int64_t)st->st_ctim.tv_sec * 1000000000 +
+                   st->st_ctim.tv_nsec;
+#endif
+}
+
+int cache_identity(const char *path, file_identity_t *id)
+{
+    struct stat st;
+    STATS_INC(syscalls.stat);
+    if (stat(path, &st) != 0)
+        return -1;
+    identity_from_stat(&st, id);
+    return 0;
+}
+
+int cache_identity_of(file_handle_t *fh, file_identity_t *id)
+{
+    struct stat st;
+    if (io_stat(fh, &st) != 0)
+        return -1;
+    identity_from_stat(&st, id);
+    return 0;
+}
+
+int cache_identity_same(const file_identity_t *a, const file_identity_t *b)
+{
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+           a->mtime_ns == b->mtime_ns && a->ctime_ns == b->ctime_ns;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Hash table                                                         */
+/* ------------------------------------------------------------------ */
+
+static uint64_t fnv1a(const uint8_t *p, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static size_t bucket_of(const mp3tag_cache_t *c, const file_identity_t *id)
+{
+    uint64_t h = id->ino * 0x9e3779b97f4a7c15ull ^ id->dev;
+    h ^= h >> 29;
+    return (size_t)(h & (c->nbuckets - 1));
+}
+
+static cache_entry_t **find_slot(mp3tag_cache_t *c, const file_identity_t *id)
+{
+    cache_entry_t **pp = &c->buckets[bucket_of(c, id)];
+    while (*pp && ((*pp)->id.dev != id->dev || (*pp)->id.ino != id->ino))
+        pp = &(*pp)->next;
+    return pp;
+}
+
+static void free_entry(cache_entry_t *e)
+{
+    free(e->blob);
+    free(e);
+}
+
+static int grow(mp3tag_cache_t *c)
+{
+    size_t n = c->nbuckets * 2;
+    cache_entry_t **b = calloc(n, sizeof(*b));
+    if (!b) return -1;
+
+    cache_entry_t **old = c->buckets;
+    size_t old_n = c->nbuckets;
+    c->buckets  = b;
+    c->nbuckets = n;
+
+    for (size_t i = 0; i < old_n; i++) {
+        cache_entry_t *e = old[i];
+        while (e) {
+            cache_entry_t *next = e->next;
+            size_t k = bucket_of(c, &e->id);
+            e->next = b[k];
+            b[k] = e;
+            e = next;
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/* Takes ownership of `e`; replaces any entry for the same file */
+static void insert_entry(mp3tag_cache_t *c, cache_entry_t *e)
+{
+    cache_entry_t **pp = find_slot(c, &e->id);
+    if (*pp) {
+        cache_entry_t *old = *pp;
+        e->next = old->next;
+        *pp = e;
+        free_entry(old);
+        return;
+    }
+
+    e->next = NULL;
+    *pp = e;
+    c->count++;
+    if (c->count * 4 > c->nbuckets * 3)
+        grow(c);  /* Failure only costs longer chains */
+}
+
+/* ------------------------------------------------------------------ */
+/*  Internal API                                                       */
+/* ------------------------------------------------------------------ */
+
+int cache_lookup(mp3tag_cache_t *cache, const file_identity_t *id,
+                 cache_probe_t *probe, cache_tag_state_t *state,
+                 mp3tag_collection_t **tags)
+{
+    int rc = MP3TAG_ERR_TAG_NOT_FOUND;
+    *tags = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    cache_entry_t *e = *find_slot(cache, id);
+    if (e && e->id.size == id->size && e->id.mtime_ns == id->mtime_ns) {
+        rc = MP3TAG_OK;
+        if (e->state == CACHE_TAGS_PRESENT)
+            rc = flat_decode(e->blob, e->blob_size, tags);
+        if (rc == MP3TAG_OK) {
+            *probe = e->probe;
+            *state = e->state;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return rc;
+}
+
+void cache_store(mp3tag_cache_t *cache, const file_identity_t *id,
+                 const cache_probe_t *probe, cache_tag_state_t state,
+                 const mp3tag_collection_t *tags)
+{
+    cache_entry_t *e = calloc(1, sizeof(*e));
+    if (!e) return;
+    e->id    = *id;
+    e->probe = *probe;
+    e->state = state;
+
+    if (state == CACHE_TAGS_PRESENT) {
+        dyn_buffer_t buf;
+        buffer_init(&buf);
+        if (!tags || flat_encode(tags, &buf) != MP3TAG_OK) {
+            buffer_free(&buf);
+            free(e);
+            return;
+        }
+        e->blob        = buf.data;  /* Take over the buffer's storage */
+        e->blob_size   = (uint32_t)buf.size;
+        e->fingerprint = fnv1a(e->blob, e->blob_size);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    insert_entry(cache, e);
+    cache->dirty = 1;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cache_remove(mp3tag_cache_t *cache, const file_identity_t *id)
+{
+    pthread_mutex_lock(&cache->lock);
+    cache_entry_t **pp = find_slot(cache, id);
+    if (*pp) {
+        cache_entry_t *e = *pp;
+        *pp = e->next;
+        free_entry(e);
+        cache->count--;
+        cache->dirty = 1;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Serialization                                                      */
+/* ------------------------------------------------------------------ */
+
+static int put_le(dyn_buffer_t *b, uint64_t v, int bytes)
+{
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; i++)
+        tmp[i] = (uint8_t)(v >> (8 * i));
+    return buffer_append(b, tmp, (size_t)bytes);
+}
+
+typedef struct {
+    const uint8_t *p;
+    size_t         left;
+    int            bad;
+} reader_t;
+
+static uint64_t get_le(reader_t *r, int bytes)
+{
+    if (r->left < (size_t)bytes) {
+        r->bad = 1;
+        return 0;
+    }
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | r->p[i];
+    r->p    += bytes;
+    r->left -= (size_t)bytes;
+    return v;
+}
+
+static int put_entry(dyn_buffer_t *b, const cache_entry_t *e)
+{
+    const cache_probe_t *p = &e->probe;
+    int rc = 0;
+
+    rc |= put_le(b, e->id.dev, 8);
+    rc |= put_le(b, e->id.ino, 8);
+    rc |= put_le(b, (uint64_t)e->id.size, 8);
+    rc |= put_le(b, (uint64_t)e->id.mtime_ns, 8);
+
+    rc |= put_le(b, (uint64_t)p->container.type, 4);
+    rc |= put_le(b, p->container.form_total_size, 4);
+    rc |= put_le(b, (uint64_t)p->container.has_id3_chunk, 4);
+    rc |= put_le(b, (uint64_t)p->container.id3_chunk_offset, 8);
+    rc |= put_le(b, p->container.id3_chunk_data_size, 4);
+    rc |= put_le(b, (uint64_t)p->container.id3_chunk_data_offset, 8);
+
+    rc |= put_le(b, (uint64_t)p->has_id3v2, 4);
+    rc |= put_le(b, p->id3v2_hdr.version_major, 1);
+    rc |= put_le(b, p->id3v2_hdr.version_revision, 1);
+    rc |= put_le(b, p->id3v2_hdr.flags, 1);
+    rc |= put_le(b, (uint64_t)p->id3v2_hdr.has_footer, 1);
+    rc |= put_le(b, p->id3v2_hdr.tag_size, 4);
+    rc |= put_le(b, (uint64_t)p->id3v2_offset, 8);
+    rc |= put_le(b, (uint64_t)p->audio_offset, 8);
+    rc |= put_le(b, (uint64_t)p->has_id3v1, 4);
+
+    rc |= put_le(b, (uint64_t)e->state, 4);
+    rc |= put_le(b, e->fingerprint, 8);
+    rc |= put_le(b, e->blob_size, 4);
+    if (e->blob_size > 0)
+        rc |= buffer_append(b, e->blob, e->blob_size);
+    return rc;
+}
+
+static cache_entry_t *get_entry(reader_t *r)
+{
+    cache_entry_t *e = calloc(1, sizeof(*e));
+    if (!e) { r->bad = 1; return NULL; }
+    cache_probe_t *p = &e->probe;
+
+    e->id.dev      = get_le(r, 8);
+    e->id.ino      = get_le(r, 8);
+    e->id.size     = (int64_t)get_le(r, 8);
+    e->id.mtime_ns = (int64_t)get_le(r, 8);
+
+    p->container.type                  = (container_type_t)get_le(r, 4);
+    p->container.form_total_size       = (uint32_t)get_le(r, 4);
+    p->container.has_id3_chunk         = (int)get_le(r, 4);
+    p->container.id3_chunk_offset      = (int64_t)get_le(r, 8);
+    p->container.id3_chunk_data_size   = (uint32_t)get_le(r, 4);
+    p->container.id3_chunk_data_offset = (int64_t)get_le(r, 8);
+
+    p->has_id3v2                  = (int)get_le(r, 4);
+    p->id3v2_hdr.version_major    = (uint8_t)get_le(r, 1);
+    p->id3v2_hdr.version_revision = (uint8_t)get_le(r, 1);
+    p->id3v2_hdr.flags            = (uint8_t)get_le(r, 1);
+    p->id3v2_hdr.has_footer       = (int)get_le(r, 1);
+    p->id3v2_hdr.tag_size         = (uint32_t)get_le(r, 4);
+    p->id3v2_offset               = (int64_t)get_le(r, 8);
+    p->audio_offset               = (int64_t)get_le(r, 8);
+    p->has_id3v1                  = (int)get_le(r, 4);
+
+    e->state       = (cache_tag_state_t)get_le(r, 4);
+    e->fingerprint = get_le(r, 8);
+    e->blob_size   = (uint32_t)get_le(r, 4);
+
+    if (!r->bad && e->blob_size > 0) {
+        if (r->left < e->blob_size) {
+            r->bad = 1;
+        } else {
+            e->blob = malloc(e->blob_size);
+            if (!e->blob) {
+                r->bad = 1;
+            } else {
+                memcpy(e->blob, r->p, e->blob_size);
+                r->p    += e->blob_size;
+                r->left -= e->blob_size;
+            }
+        }
+    }
+
+    if (r->bad) {
+        free_entry(e);
+        return NULL;
+    }
+    return e;
+}
+
+static int load(mp3tag_cache_t *c)
+{
+    FILE *f = fopen(c->path, "rb");
+    if (!f) return 0;  /* No cache yet */
+
+    dyn_buffer_t data;
+    buffer_init(&data);
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (buffer_append(&data, chunk, n) != 0) {
+            fclose(f);
+            buffer_free(&data);
+            return -1;
+        }
+    }
+    fclose(f);
+
+    reader_t r = { data.data, data.size, 0 };
+    if (data.size < 12 || memcmp(data.data, CACHE_MAGIC, 4) != 0) {
+        buffer_free(&data);
+        return 0;  /* Not ours: start empty, overwrite on save */
+    }
+    r.p += 4;
+    r.left -= 4;
+    uint32_t version = (uint32_t)get_le(&r, 4);
+    uint32_t count   = (uint32_t)get_le(&r, 4);
+
+    if (version == CACHE_VERSION) {
+        for (uint32_t i = 0; i < count && !r.bad; i++) {
+            cache_entry_t *e = get_entry(&r);
+            if (!e) break;
+
+            /* Drop entries whose blob no longer matches its fingerprint */
+            if (e->state == CACHE_TAGS_PRESENT &&
+                (e->blob_size == 0 ||
+                 fnv1a(e->blob, e->blob_size) != e->fingerprint ||
+                 flat_validate(e->blob, e->blob_size) != MP3TAG_OK)) {
+                free_entry(e);
+                continue;
+            }
+            insert_entry(c, e);
+        }
+    }
+
+    buffer_free(&data);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_cache_t *mp3tag_cache_open(const char *path)
+{
+    if (!path) return NULL;
+
+    mp3tag_cache_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+
+    c->path     = str_dup(path);
+    c->nbuckets = CACHE_MIN_BUCKETS;
+    c->buckets  = calloc(c->nbuckets, sizeof(*c->buckets));
+    if (!c->path || !c->buckets) {
+        free(c->path);
+        free(c->buckets);
+        free(c);
+        return NULL;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+
+    if (load(c) != 0) {
+        mp3tag_cache_close(c);
+        return NULL;
+    }
+    c->dirty = 0;
+    return c;
+}
+
+int mp3tag_cache_save(mp3tag_cache_t *cache)
+{
+    if (!cache) return MP3TAG_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&cache->lock);
+    if (!cache->dirty) {
+        pthread_mutex_unlock(&cache->lock);
+        return MP3TAG_OK;
+    }
+
+    dyn_buffer_t out;
+    buffer_init(&out);
+    int rc = buffer_append(&out, CACHE_MAGIC, 4);
+    rc |= put_le(&out, CACHE_VERSION, 4);
+    rc |= put_le(&out, cache->count, 4);
+    for (size_t i = 0; i < cache->nbuckets && rc == 0; i++) {
+        for (cache_entry_t *e = cache->buckets[i]; e && rc == 0; e = e->next)
+            rc |= put_entry(&out, e);
+    }
+    if (rc == 0) cache->dirty = 0;
+    pthread_mutex_unlock(&cache->lock);
+
+    if (rc != 0) {
+        buffer_free(&out);
+        return MP3TAG_ERR_NO_MEMORY;
+    }
+
+    /* Write-and-rename so a crash never leaves a torn cache */
+    size_t path_len = strlen(cache->path);
+    char *tmp_path = malloc(path_len + 5);
+    if (!tmp_path) { buffer_free(&out); return MP3TAG_ERR_NO_MEMORY; }
+    memcpy(tmp_path, cache->path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    int result = MP3TAG_OK;
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        result = MP3TAG_ERR_IO;
+    } else {
+        if (fwrite(out.data, 1, out.size, f) != out.size ||
+            fflush(f) != 0 || fsync(fileno(f)) != 0)
+            result = MP3TAG_ERR_WRITE_FAILED;
+        if (fclose(f) != 0 && result == MP3TAG_OK)
+            result = MP3TAG_ERR_WRITE_FAILED;
+        if (result == MP3TAG_OK && rename(tmp_path, cache->path) != 0)
+            result = MP3TAG_ERR_RENAME_FAILED;
+        if (result != MP3TAG_OK)
+            unlink(tmp_path);
+    }
+
+    if (result != MP3TAG_OK) {
+        pthread_mutex_lock(&cache->lock);
+        cache->dirty = 1;
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    free(tmp_path);
+    buffer_free(&out);
+    return result;
+}
+
+void mp3tag_cache_close(mp3tag_cache_t *cache)
+{
+    if (!cache) return;
+    if (cache->dirty)
+        mp3tag_cache_save(cache);
+
+    for (size_t i = 0; i < cache->nbuckets; i++) {
+        cache_entry_t *e = cache->buckets[i];
+        while (e) {
+            cache_entry_t *next = e->next;
+            free_entry(e);
+            e = next;
+        }
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache->path);
+    free(cache);
+}
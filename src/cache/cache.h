@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include "../id3v2/id3v2_reader.h"
+#include "../container/container.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Identity of a file version: changes on replace, truncate or rewrite */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t  size;
+    int64_t  mtime_ns;
+    int64_t  ctime_ns;   /* Not persisted; see cache_identity_same() */
+} file_identity_t;
+
+/* Everything probe_file() learns about a file */
+typedef struct {
+    container_info_t container;
+    int              has_id3v2;
+    id3v2_header_t   id3v2_hdr;
+    int64_t          id3v2_offset;
+    int64_t          audio_offset;
+    int              has_id3v1;
+} cache_probe_t;
+
+typedef enum {
+    CACHE_TAGS_UNKNOWN = 0,   /* Probed, tags not read yet */
+    CACHE_TAGS_PRESENT,       /* Collection stored */
+    CACHE_TAGS_NONE           /* File has no tags */
+} cache_tag_state_t;
+
+/*
+ * Fill `id` from a stat() of `path`. Returns 0 on success.
+ */
+int cache_identity(const char *path, file_identity_t *id);
+
+/*
+ * Fill `id` from an fstat() of the open handle: the version the handle
+ * holds, whatever its path names by now. Returns 0 on success.
+ */
+int cache_identity_of(file_handle_t *fh, file_identity_t *id);
+
+/*
+ * Non-zero when `a` and `b` are the same file version, inode change time
+ * included (catches rewrites that restore size and mtime).
+ */
+int cache_identity_same(const file_identity_t *a, const file_identity_t *b);
+
+/*
+ * Look up a file version. On a hit, fills `probe` and `state`, and for
+ * CACHE_TAGS_PRESENT decodes the stored collection into `*tags`.
+ * Returns MP3TAG_OK on a hit; any other value is a miss.
+ */
+int cache_lookup(mp3tag_cache_t *cache, const file_identity_t *id,
+                 cache_probe_t *probe, cache_tag_state_t *state,
+                 mp3tag_collection_t **tags);
+
+/*
+ * Insert or replace the entry for `id`. `tags` is only used with
+ * CACHE_TAGS_PRESENT.
+ */
+void cache_store(mp3tag_cache_t *cache, const file_identity_t *id,
+                 const cache_probe_t *probe, cache_tag_state_t state,
+                 const mp3tag_collection_t *tags);
+
+/*
+ * Drop whatever entry exists for the file (dev, ino) in `id`.
+ */
+void cache_remove(mp3tag_cache_t *cache, const file_identity_t *id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CACHE_H */
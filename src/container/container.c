@@ -3,6 +3,7 @@
 
 #include "container.h"
 #include "../../include/mp3tag/mp3tag_error.h"
+#include "../stats/stats.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -57,13 +58,13 @@ static void scan_chunks(file_handle_t *fh, container_info_t *info)
 
     int64_t pos = 12;  /* After FORM/RIFF(4) + size(4) + type(4) */
     int64_t end = 8 + (int64_t)info->form_total_size;
-    int64_t fsize = file_size(fh);
+    int64_t fsize = io_size(fh);
     if (end > fsize) end = fsize;
 
     while (pos + 8 <= end) {
         uint8_t chdr[8];
-        if (file_seek(fh, pos) != 0) break;
-        if (file_read(fh, chdr, 8) != 0) break;
+        if (io_seek(fh, pos) != 0) break;
+        if (io_read(fh, chdr, 8) != 0) break;
 
         uint32_t chunk_size = is_aiff ? read_be32(chdr + 4)
                                       : read_le32(chdr + 4);
@@ -93,15 +94,15 @@ int container_detect(file_handle_t *fh, container_info_t *info)
     info->id3_chunk_offset = -1;
 
     uint8_t magic[12];
-    if (file_seek(fh, 0) != 0) return MP3TAG_ERR_SEEK_FAILED;
+    if (io_seek(fh, 0) != 0) return MP3TAG_ERR_SEEK_FAILED;
 
     /* Need at least 12 bytes for container detection */
-    if (file_size(fh) < 12) {
+    if (io_size(fh) < 12) {
         info->type = CONTAINER_NONE;
         return MP3TAG_OK;
     }
 
-    if (file_read(fh, magic, 12) != 0) {
+    if (io_read(fh, magic, 12) != 0) {
         info->type = CONTAINER_NONE;
         return MP3TAG_OK;
     }
@@ -146,13 +147,14 @@ int container_detect(file_handle_t *fh, container_info_t *info)
 /* ------------------------------------------------------------------ */
 
 int container_append_id3(file_handle_t *fh, container_info_t *info,
-                         const uint8_t *tag_data, uint32_t tag_size)
+                         const uint8_t *tag_data, uint32_t tag_size,
+                         int durable)
 {
     if (!fh || !info || !tag_data)
         return MP3TAG_ERR_INVALID_ARG;
 
     int is_aiff = (info->type == CONTAINER_AIFF);
-    int64_t fsize = file_size(fh);
+    int64_t fsize = io_size(fh);
 
     /* Build chunk header */
     uint8_t chunk_hdr[8];
@@ -163,17 +165,17 @@ int container_append_id3(file_handle_t *fh, container_info_t *info,
         write_le32(chunk_hdr + 4, tag_size);
 
     /* Seek to end and write */
-    if (file_seek(fh, fsize) != 0)
+    if (io_seek(fh, fsize) != 0)
         return MP3TAG_ERR_SEEK_FAILED;
-    if (file_write(fh, chunk_hdr, 8) != 0)
+    if (io_write(fh, chunk_hdr, 8) != 0)
         return MP3TAG_ERR_WRITE_FAILED;
-    if (file_write(fh, tag_data, tag_size) != 0)
+    if (io_write(fh, tag_data, tag_size) != 0)
         return MP3TAG_ERR_WRITE_FAILED;
 
     /* Pad byte if chunk data is odd */
     if (tag_size & 1) {
         uint8_t pad = 0;
-        if (file_write(fh, &pad, 1) != 0)
+        if (io_write(fh, &pad, 1) != 0)
             return MP3TAG_ERR_WRITE_FAILED;
     }
 
@@ -187,13 +189,13 @@ int container_append_id3(file_handle_t *fh, container_info_t *info,
     else
         write_le32(size_bytes, new_total);
 
-    if (file_seek(fh, 4) != 0)
+    if (io_seek(fh, 4) != 0)
         return MP3TAG_ERR_SEEK_FAILED;
-    if (file_write(fh, size_bytes, 4) != 0)
+    if (io_write(fh, size_bytes, 4) != 0)
         return MP3TAG_ERR_WRITE_FAILED;
 
-    if (file_sync(fh) != 0)
-        return MP3TAG_ERR_IO;
+    if (durable && io_sync(fh) != 0)
+        return MP3TAG_ERR_WRITE_FAILED;
 
     /* Update info */
     info->has_id3_chunk       = 1;
@@ -211,7 +213,8 @@ int container_append_id3(file_handle_t *fh, container_info_t *info,
 
 int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
                           int writable, container_info_t *info,
-                          const uint8_t *tag_data, uint32_t tag_size)
+                          const uint8_t *tag_data, uint32_t tag_size,
+                          int durable)
 {
     if (!fh_ptr || !*fh_ptr || !path || !info || !tag_data)
         return MP3TAG_ERR_INVALID_ARG;
@@ -221,34 +224,36 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
 
     /* Build temp path */
     size_t path_len = strlen(path);
-    char *tmp_path = malloc(path_len + 5);
+    char *tmp_path = mem_malloc(ALLOC_REWRITE, path_len + 5);
     if (!tmp_path) return MP3TAG_ERR_NO_MEMORY;
     memcpy(tmp_path, path, path_len);
     memcpy(tmp_path + path_len, ".tmp", 5);
 
     /* Create temp file */
     FILE *f = fopen(tmp_path, "wb");
-    if (!f) { free(tmp_path); return MP3TAG_ERR_IO; }
+    if (!f) { mem_free(tmp_path); return MP3TAG_ERR_IO; }
     fclose(f);
 
-    file_handle_t *tmp = file_open_rw(tmp_path);
-    if (!tmp) { free(tmp_path); return MP3TAG_ERR_IO; }
+    file_handle_t *tmp = io_open_rw(tmp_path);
+    if (!tmp) { mem_free(tmp_path); return MP3TAG_ERR_IO; }
 
     int result = MP3TAG_OK;
-    int64_t fsize = file_size(fh);
+    int64_t fsize = io_size(fh);
 
     /* Copy file header (12 bytes) with placeholder total size */
     uint8_t header[12];
-    if (file_seek(fh, 0) != 0 || file_read(fh, header, 12) != 0) {
+    if (io_seek(fh, 0) != 0 || io_read(fh, header, 12) != 0) {
         result = MP3TAG_ERR_IO;
         goto cleanup;
     }
-    if (file_write(tmp, header, 12) != 0) {
+    if (io_write(tmp, header, 12) != 0) {
         result = MP3TAG_ERR_WRITE_FAILED;
         goto cleanup;
     }
 
     /* Iterate chunks, copying all except the old ID3 chunk */
+    TRACE_BEGIN(MP3TAG_PHASE_REWRITE_COPY);
+    uint64_t copied = 0;
     {
         const char *skip_id = is_aiff ? "ID3 " : "id3 ";
         int64_t pos = 12;
@@ -257,8 +262,8 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
 
         while (pos + 8 <= end) {
             uint8_t chdr[8];
-            if (file_seek(fh, pos) != 0) break;
-            if (file_read(fh, chdr, 8) != 0) break;
+            if (io_seek(fh, pos) != 0) break;
+            if (io_read(fh, chdr, 8) != 0) break;
 
             uint32_t chunk_size = is_aiff ? read_be32(chdr + 4)
                                           : read_le32(chdr + 4);
@@ -270,9 +275,9 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
             }
 
             /* Copy this chunk */
-            if (file_seek(fh, pos) != 0) {
+            if (io_seek(fh, pos) != 0) {
                 result = MP3TAG_ERR_IO;
-                goto cleanup;
+                break;
             }
 
             uint8_t copy_buf[65536];
@@ -280,18 +285,24 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
             while (remaining > 0) {
                 size_t to_read = remaining < sizeof(copy_buf)
                                  ? remaining : sizeof(copy_buf);
-                int64_t n = file_read_partial(fh, copy_buf, to_read);
+                int64_t n = io_read_partial(fh, copy_buf, to_read);
                 if (n <= 0) break;
-                if (file_write(tmp, copy_buf, (size_t)n) != 0) {
+                if (io_write(tmp, copy_buf, (size_t)n) != 0) {
                     result = MP3TAG_ERR_WRITE_FAILED;
-                    goto cleanup;
+                    break;
                 }
+                copied += (uint64_t)n;
                 remaining -= (uint32_t)n;
+                MP3TAG_PROBE3(rewrite__copy, path, copied, (uint64_t)fsize);
             }
+            if (result != MP3TAG_OK) break;
 
             pos += chunk_total;
         }
     }
+    STATS_ADD(bytes_copied, copied);
+    TRACE_END(MP3TAG_PHASE_REWRITE_COPY, copied);
+    if (result != MP3TAG_OK) goto cleanup;
 
     /* Append new ID3 chunk */
     {
@@ -304,15 +315,15 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
 
         int64_t new_chunk_off = file_tell(tmp);
 
-        if (file_write(tmp, new_chunk_hdr, 8) != 0 ||
-            file_write(tmp, tag_data, tag_size) != 0) {
+        if (io_write(tmp, new_chunk_hdr, 8) != 0 ||
+            io_write(tmp, tag_data, tag_size) != 0) {
             result = MP3TAG_ERR_WRITE_FAILED;
             goto cleanup;
         }
 
         if (tag_size & 1) {
             uint8_t pad = 0;
-            if (file_write(tmp, &pad, 1) != 0) {
+            if (io_write(tmp, &pad, 1) != 0) {
                 result = MP3TAG_ERR_WRITE_FAILED;
                 goto cleanup;
             }
@@ -328,30 +339,30 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
         else
             write_le32(size_bytes, new_total);
 
-        if (file_seek(tmp, 4) != 0 ||
-            file_write(tmp, size_bytes, 4) != 0) {
+        if (io_seek(tmp, 4) != 0 ||
+            io_write(tmp, size_bytes, 4) != 0) {
             result = MP3TAG_ERR_WRITE_FAILED;
             goto cleanup;
         }
 
-        if (file_sync(tmp) != 0) {
-            result = MP3TAG_ERR_IO;
+        if (durable && io_sync(tmp) != 0) {
+            result = MP3TAG_ERR_WRITE_FAILED;
             goto cleanup;
         }
 
         /* Close both files before rename */
-        file_close(tmp);
+        io_close(tmp);
         tmp = NULL;
-        file_close(fh);
+        io_close(fh);
         *fh_ptr = NULL;
 
-        if (rename(tmp_path, path) != 0) {
+        if (io_rename(tmp_path, path) != 0) {
             result = MP3TAG_ERR_RENAME_FAILED;
-            *fh_ptr = writable ? file_open_rw(path) : file_open_read(path);
+            *fh_ptr = writable ? io_open_rw(path) : io_open_read(path);
             goto cleanup_path;
         }
 
-        *fh_ptr = writable ? file_open_rw(path) : file_open_read(path);
+        *fh_ptr = writable ? io_open_rw(path) : io_open_read(path);
         if (!*fh_ptr) {
             result = MP3TAG_ERR_IO;
             goto cleanup_path;
@@ -367,10 +378,10 @@ int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
 
 cleanup:
     if (tmp) {
-        file_close(tmp);
+        io_close(tmp);
         unlink(tmp_path);
     }
 cleanup_path:
-    free(tmp_path);
+    mem_free(tmp_path);
     return result;
 }
@@ -40,19 +40,23 @@ int container_detect(file_handle_t *fh, container_info_t *info);
 /*
  * Append a new ID3 chunk at the end of a container file.
  * Updates the FORM/RIFF total size. Updates `info` in place.
+ * `durable` syncs the file before returning.
  */
 int container_append_id3(file_handle_t *fh, container_info_t *info,
-                         const uint8_t *tag_data, uint32_t tag_size);
+                         const uint8_t *tag_data, uint32_t tag_size,
+                         int durable);
 
 /*
  * Rewrite the container file, replacing the old ID3 chunk with new data.
  * Uses a temp file + rename. Reopens the file handle.
  * `fh_ptr` is updated to point to the new file handle.
  * `info` is updated with the new chunk location.
+ * `durable` syncs the temp file before the rename.
  */
 int container_rewrite_id3(file_handle_t **fh_ptr, const char *path,
                           int writable, container_info_t *info,
-                          const uint8_t *tag_data, uint32_t tag_size);
+                          const uint8_t *tag_data, uint32_t tag_size,
+                          int durable);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,424 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#include "flat.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/string_util.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Deepest simple-tag nesting accepted when validating untrusted blobs */
+#define FLAT_MAX_DEPTH 32
+
+/* ------------------------------------------------------------------ */
+/*  Little-endian helpers                                              */
+/* ------------------------------------------------------------------ */
+
+static void put_u16(uint8_t *b, uint16_t v)
+{
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *b, uint32_t v)
+{
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+    b[2] = (uint8_t)(v >> 16);
+    b[3] = (uint8_t)(v >> 24);
+}
+
+static void put_u64(uint8_t *b, uint64_t v)
+{
+    put_u32(b, (uint32_t)v);
+    put_u32(b + 4, (uint32_t)(v >> 32));
+}
+
+/* ------------------------------------------------------------------ */
+/*  Encoding                                                           */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint8_t     *simples;      /* simple_count x FLAT_SIMPLE_SIZE */
+    uint32_t     next_simple;
+    dyn_buffer_t data;
+    uint64_t     data_base;    /* Blob offset of data.data[0] */
+    int          error;        /* First MP3TAG_ERR_* hit, or MP3TAG_OK */
+} flat_enc_t;
+
+static size_t count_simples(const mp3tag_simple_tag_t *st)
+{
+    size_t n = 0;
+    for (; st; st = st->next)
+        n += 1 + count_simples(st->nested);
+    return n;
+}
+
+/* Append raw bytes to the data region; returns their blob offset */
+static uint32_t enc_bytes(flat_enc_t *e, const void *p, size_t n, int nul)
+{
+    uint64_t off = e->data_base + e->data.size;
+    if (e->error != MP3TAG_OK) return 0;
+    if (off + n + 1 > 0xFFFFFFFFull) {
+        e->error = MP3TAG_ERR_TAG_TOO_LARGE;
+        return 0;
+    }
+    if ((n > 0 && buffer_append(&e->data, p, n) != 0) ||
+        (nul && buffer_append_byte(&e->data, 0) != 0)) {
+        e->error = MP3TAG_ERR_NO_MEMORY;
+        return 0;
+    }
+    return (uint32_t)off;
+}
+
+static uint32_t enc_string(flat_enc_t *e, const char *s)
+{
+    return s ? enc_bytes(e, s, strlen(s), 1) : 0;
+}
+
+static uint32_t enc_uids(flat_enc_t *e, const uint64_t *uids, size_t count)
+{
+    if (!uids || count == 0) return 0;
+
+    /* data_base is 8-aligned, so align the region-relative size */
+    while (e->data.size & 7) {
+        if (buffer_append_byte(&e->data, 0) != 0) {
+            e->error = MP3TAG_ERR_NO_MEMORY;
+            return 0;
+        }
+    }
+
+    uint32_t off = (uint32_t)(e->data_base + e->data.size);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t b[8];
+        put_u64(b, uids[i]);
+        enc_bytes(e, b, 8, 0);
+    }
+    return off;
+}
+
+static uint32_t enc_simples(flat_enc_t *e, const mp3tag_simple_tag_t *st)
+{
+    uint32_t first = FLAT_NONE;
+    uint32_t prev  = FLAT_NONE;
+
+    for (; st; st = st->next) {
+        uint32_t idx = e->next_simple++;
+        uint8_t *rec = e->simples + (size_t)idx * FLAT_SIMPLE_SIZE;
+
+        if (prev == FLAT_NONE)
+            first = idx;
+        else
+            put_u32(e->simples + (size_t)prev * FLAT_SIMPLE_SIZE + FLAT_S_NEXT,
+                    idx);
+
+        put_u32(rec + FLAT_S_NAME,     enc_string(e, st->name));
+        put_u32(rec + FLAT_S_VALUE,    enc_string(e, st->value));
+        put_u32(rec + FLAT_S_LANGUAGE, enc_string(e, st->language));
+        if (st->binary && st->binary_size > 0) {
+            put_u32(rec + FLAT_S_BINARY_OFF,
+                    enc_bytes(e, st->binary, st->binary_size, 0));
+            put_u32(rec + FLAT_S_BINARY_SIZE, (uint32_t)st->binary_size);
+        }
+        put_u32(rec + FLAT_S_FLAGS, st->is_default ? 1u : 0u);
+        put_u32(rec + FLAT_S_NEXT,  FLAT_NONE);
+        put_u32(rec + FLAT_S_NESTED, enc_simples(e, st->nested));
+
+        prev = idx;
+    }
+    return first;
+}
+
+int flat_encode(const mp3tag_collection_t *coll, dyn_buffer_t *buf)
+{
+    if (!coll || !buf) return MP3TAG_ERR_INVALID_ARG;
+
+    size_t tag_count = 0, simple_count = 0;
+    for (const mp3tag_tag_t *t = coll->tags; t; t = t->next) {
+        tag_count++;
+        simple_count += count_simples(t->simple_tags);
+    }
+
+    uint64_t tags_off    = FLAT_HEADER_SIZE;
+    uint64_t simples_off = tags_off + (uint64_t)tag_count * FLAT_TAG_SIZE;
+    uint64_t data_base   = simples_off + (uint64_t)simple_count * FLAT_SIMPLE_SIZE;
+    data_base = (data_base + 7) & ~(uint64_t)7;
+    if (data_base > 0xFFFFFFFFull)
+        return MP3TAG_ERR_TAG_TOO_LARGE;
+
+    size_t records_size = (size_t)data_base;
+    uint8_t *records = calloc(1, records_size);
+    if (!records) return MP3TAG_ERR_NO_MEMORY;
+
+    flat_enc_t e;
+    e.simples     = records + simples_off;
+    e.next_simple = 0;
+    e.data_base   = data_base;
+    e.error       = MP3TAG_OK;
+    buffer_init(&e.data);
+
+    uint8_t *trec = records + tags_off;
+    for (const mp3tag_tag_t *t = coll->tags; t; t = t->next) {
+        const uint64_t *uids[4] = {
+            t->track_uids, t->edition_uids, t->chapter_uids, t->attachment_uids
+        };
+        const size_t counts[4] = {
+            t->track_uid_count, t->edition_uid_count,
+            t->chapter_uid_count, t->attachment_uid_count
+        };
+
+        put_u32(trec + FLAT_T_TARGET_TYPE, (uint32_t)t->target_type);
+        put_u32(trec + FLAT_T_TARGET_STR,  enc_string(&e, t->target_type_str));
+        put_u32(trec + FLAT_T_FIRST_SIMPLE, enc_simples(&e, t->simple_tags));
+        for (int k = 0; k < 4; k++) {
+            put_u32(trec + FLAT_T_UID_OFF + 4 * k, enc_uids(&e, uids[k], counts[k]));
+            put_u32(trec + FLAT_T_UID_COUNT + 4 * k,
+                    uids[k] ? (uint32_t)counts[k] : 0);
+        }
+        trec += FLAT_TAG_SIZE;
+    }
+
+    uint64_t total = data_base + e.data.size;
+    int rc = e.error;
+    if (rc != MP3TAG_OK)
+        goto done;
+
+    memcpy(records + FLAT_H_MAGIC, FLAT_MAGIC, 4);
+    put_u16(records + FLAT_H_VERSION, FLAT_VERSION);
+    put_u16(records + FLAT_H_FLAGS, 0);
+    put_u32(records + FLAT_H_TOTAL_SIZE,   (uint32_t)total);
+    put_u32(records + FLAT_H_TAG_COUNT,    (uint32_t)tag_count);
+    put_u32(records + FLAT_H_TAGS_OFF,     (uint32_t)tags_off);
+    put_u32(records + FLAT_H_SIMPLE_COUNT, (uint32_t)simple_count);
+    put_u32(records + FLAT_H_SIMPLES_OFF,  (uint32_t)simples_off);
+
+    if (buffer_append(buf, records, records_size) != 0 ||
+        (e.data.size > 0 && buffer_append(buf, e.data.data, e.data.size) != 0))
+        rc = MP3TAG_ERR_NO_MEMORY;
+
+done:
+    buffer_free(&e.data);
+    free(records);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Validation                                                         */
+/* ------------------------------------------------------------------ */
+
+static int valid_string(const uint8_t *d, uint32_t total, uint32_t off)
+{
+    if (off == 0) return 1;
+    if (off >= total) return 0;
+    return memchr(d + off, 0, total - off) != NULL;
+}
+
+static int valid_range(uint32_t total, uint32_t off, uint64_t len)
+{
+    if (len == 0) return 1;
+    return off >= FLAT_HEADER_SIZE && (uint64_t)off + len <= total;
+}
+
+/* Record a reference to simple `idx` at nesting `depth` (1-based) */
+static int claim_simple(uint8_t *depths, uint32_t count, uint32_t idx,
+                        uint32_t depth)
+{
+    if (idx == FLAT_NONE) return 1;
+    if (idx >= count || depths[idx] != 0 || depth > FLAT_MAX_DEPTH) return 0;
+    depths[idx] = (uint8_t)depth;
+    return 1;
+}
+
+int flat_validate(const uint8_t *d, size_t size)
+{
+    if (!d || size < FLAT_HEADER_SIZE)           return MP3TAG_ERR_CORRUPT;
+    if (memcmp(d + FLAT_H_MAGIC, FLAT_MAGIC, 4) != 0)
+        return MP3TAG_ERR_CORRUPT;
+    if ((d[FLAT_H_VERSION] | (d[FLAT_H_VERSION + 1] << 8)) != FLAT_VERSION)
+        return MP3TAG_ERR_UNSUPPORTED;
+
+    uint32_t total        = flat_u32(d + FLAT_H_TOTAL_SIZE);
+    uint32_t tag_count    = flat_u32(d + FLAT_H_TAG_COUNT);
+    uint32_t tags_off     = flat_u32(d + FLAT_H_TAGS_OFF);
+    uint32_t simple_count = flat_u32(d + FLAT_H_SIMPLE_COUNT);
+    uint32_t simples_off  = flat_u32(d + FLAT_H_SIMPLES_OFF);
+
+    if (total < FLAT_HEADER_SIZE || total > size)  return MP3TAG_ERR_TRUNCATED;
+    if (!valid_range(total, tags_off, (uint64_t)tag_count * FLAT_TAG_SIZE) ||
+        !valid_range(total, simples_off,
+                     (uint64_t)simple_count * FLAT_SIMPLE_SIZE))
+        return MP3TAG_ERR_CORRUPT;
+
+    uint8_t *depths = calloc(simple_count ? simple_count : 1, 1);
+    if (!depths) return MP3TAG_ERR_NO_MEMORY;
+
+    int rc = MP3TAG_ERR_CORRUPT;
+
+    for (uint32_t i = 0; i < tag_count; i++) {
+        const uint8_t *t = d + tags_off + (size_t)i * FLAT_TAG_SIZE;
+        if (!valid_string(d, total, flat_u32(t + FLAT_T_TARGET_STR)))
+            goto out;
+        if (!claim_simple(depths, simple_count,
+                          flat_u32(t + FLAT_T_FIRST_SIMPLE), 1))
+            goto out;
+        for (int k = 0; k < 4; k++) {
+            if (!valid_range(total, flat_u32(t + FLAT_T_UID_OFF + 4 * k),
+                             (uint64_t)flat_u32(t + FLAT_T_UID_COUNT + 4 * k) * 8))
+                goto out;
+        }
+    }
+
+    /* Links only point forward, so one ascending pass sees every parent
+       before its children and catches shared or cyclic references. */
+    for (uint32_t i = 0; i < simple_count; i++) {
+        const uint8_t *s = d + simples_off + (size_t)i * FLAT_SIMPLE_SIZE;
+        uint32_t name   = flat_u32(s + FLAT_S_NAME);
+        uint32_t nested = flat_u32(s + FLAT_S_NESTED);
+        uint32_t next   = flat_u32(s + FLAT_S_NEXT);
+
+        if (!valid_string(d, total, name) ||
+            !valid_string(d, total, flat_u32(s + FLAT_S_VALUE)) ||
+            !valid_string(d, total, flat_u32(s + FLAT_S_LANGUAGE)) ||
+            !valid_range(total, flat_u32(s + FLAT_S_BINARY_OFF),
+                         flat_u32(s + FLAT_S_BINARY_SIZE)))
+            goto out;
+        if ((nested != FLAT_NONE && nested <= i) ||
+            (next   != FLAT_NONE && next   <= i))
+            goto out;
+
+        uint32_t depth = depths[i] ? depths[i] : 1;
+        if (!claim_simple(depths, simple_count, nested, depth + 1) ||
+            !claim_simple(depths, simple_count, next, depth))
+            goto out;
+    }
+
+    rc = MP3TAG_OK;
+
+out:
+    free(depths);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Decoding                                                           */
+/* ------------------------------------------------------------------ */
+
+static int dup_opt(const uint8_t *d, uint32_t off, char **out)
+{
+    *out = NULL;
+    if (off == 0) return 0;
+    *out = str_dup((const char *)d + off);
+    return *out ? 0 : -1;
+}
+
+static int decode_simples(const uint8_t *d, uint32_t simples_off,
+                          uint32_t idx, mp3tag_simple_tag_t **out)
+{
+    mp3tag_simple_tag_t *tail = NULL;
+    *out = NULL;
+
+    while (idx != FLAT_NONE) {
+        const uint8_t *s = d + simples_off + (size_t)idx * FLAT_SIMPLE_SIZE;
+
+        mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
+        if (!st) return -1;
+        if (tail) tail->next = st; else *out = st;
+        tail = st;
+
+        uint32_t bin_size = flat_u32(s + FLAT_S_BINARY_SIZE);
+        st->is_default = (int)(flat_u32(s + FLAT_S_FLAGS) & 1u);
+
+        if (dup_opt(d, flat_u32(s + FLAT_S_NAME),     &st->name)     != 0 ||
+            dup_opt(d, flat_u32(s + FLAT_S_VALUE),    &st->value)    != 0 ||
+            dup_opt(d, flat_u32(s + FLAT_S_LANGUAGE), &st->language) != 0)
+            return -1;
+
+        if (bin_size > 0) {
+            st->binary = malloc(bin_size);
+            if (!st->binary) return -1;
+            memcpy(st->binary, d + flat_u32(s + FLAT_S_BINARY_OFF), bin_size);
+            st->binary_size = bin_size;
+        }
+
+        if (decode_simples(d, simples_off, flat_u32(s + FLAT_S_NESTED),
+                           &st->nested) != 0)
+            return -1;
+
+        idx = flat_u32(s + FLAT_S_NEXT);
+    }
+    return 0;
+}
+
+static int decode_uids(const uint8_t *d, uint32_t off, uint32_t count,
+                       uint64_t **uids, size_t *out_count)
+{
+    *uids = NULL;
+    *out_count = 0;
+    if (count == 0) return 0;
+
+    *uids = malloc((size_t)count * sizeof(uint64_t));
+    if (!*uids) return -1;
+    for (uint32_t i = 0; i < count; i++)
+        (*uids)[i] = flat_u64(d + off + (size_t)i * 8);
+    *out_count = count;
+    return 0;
+}
+
+int flat_decode(const uint8_t *d, size_t size, mp3tag_collection_t **coll)
+{
+    if (!coll) return MP3TAG_ERR_INVALID_ARG;
+    *coll = NULL;
+
+    int rc = flat_validate(d, size);
+    if (rc != MP3TAG_OK) return rc;
+
+    uint32_t tag_count   = flat_u32(d + FLAT_H_TAG_COUNT);
+    uint32_t tags_off    = flat_u32(d + FLAT_H_TAGS_OFF);
+    uint32_t simples_off = flat_u32(d + FLAT_H_SIMPLES_OFF);
+
+    mp3tag_collection_t *c = calloc(1, sizeof(*c));
+    if (!c) return MP3TAG_ERR_NO_MEMORY;
+
+    mp3tag_tag_t *tail = NULL;
+    for (uint32_t i = 0; i < tag_count; i++) {
+        const uint8_t *t = d + tags_off + (size_t)i * FLAT_TAG_SIZE;
+
+        mp3tag_tag_t *tag = calloc(1, sizeof(*tag));
+        if (!tag) goto fail;
+        if (tail) tail->next = tag; else c->tags = tag;
+        tail = tag;
+        c->count++;
+
+        tag->target_type = (mp3tag_target_type_t)flat_u32(t + FLAT_T_TARGET_TYPE);
+
+        uint64_t **uids[4] = {
+            &tag->track_uids, &tag->edition_uids,
+            &tag->chapter_uids, &tag->attachment_uids
+        };
+        size_t *counts[4] = {
+            &tag->track_uid_count, &tag->edition_uid_count,
+            &tag->chapter_uid_count, &tag->attachment_uid_count
+        };
+
+        if (dup_opt(d, flat_u32(t + FLAT_T_TARGET_STR),
+                    &tag->target_type_str) != 0)
+            goto fail;
+        for (int k = 0; k < 4; k++) {
+            if (decode_uids(d, flat_u32(t + FLAT_T_UID_OFF + 4 * k),
+                            flat_u32(t + FLAT_T_UID_COUNT + 4 * k),
+                            uids[k], counts[k]) != 0)
+                goto fail;
+        }
+        if (decode_simples(d, simples_off, flat_u32(t + FLAT_T_FIRST_SIMPLE),
+                           &tag->simple_tags) != 0)
+            goto fail;
+    }
+
+    *coll = c;
+    return MP3TAG_OK;
+
+fail:
+    mp3tag_collection_free(NULL, c);
+    return MP3TAG_ERR_NO_MEMORY;
+}
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef FLAT_H
+#define FLAT_H
+
+#include <tag_common/buffer.h>
+#include "../../include/mp3tag/mp3tag_types.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Flat collection encoding: one contiguous, position-independent blob.
+ * All integers are little-endian; all references are byte offsets from
+ * the start of the blob (0 = none) or record indices (FLAT_NONE = none).
+ *
+ *   header   FLAT_HEADER_SIZE bytes
+ *   tags     tag_count    x FLAT_TAG_SIZE
+ *   simples  simple_count x FLAT_SIMPLE_SIZE (pre-order; children and
+ *            next siblings always have a higher index than their parent)
+ *   data     NUL-terminated strings, binary values, 8-byte aligned UIDs
+ */
+
+#define FLAT_MAGIC          "M3TF"
+#define FLAT_VERSION        1
+#define FLAT_NONE           0xFFFFFFFFu
+
+#define FLAT_HEADER_SIZE    32
+#define FLAT_TAG_SIZE       48
+#define FLAT_SIMPLE_SIZE    32
+
+/* Header field offsets */
+#define FLAT_H_MAGIC         0
+#define FLAT_H_VERSION       4   /* u16 */
+#define FLAT_H_FLAGS         6   /* u16 */
+#define FLAT_H_TOTAL_SIZE    8
+#define FLAT_H_TAG_COUNT    12
+#define FLAT_H_TAGS_OFF     16
+#define FLAT_H_SIMPLE_COUNT 20
+#define FLAT_H_SIMPLES_OFF  24
+
+/* Tag record field offsets */
+#define FLAT_T_TARGET_TYPE   0
+#define FLAT_T_TARGET_STR    4
+#define FLAT_T_FIRST_SIMPLE  8
+#define FLAT_T_UID_OFF      16   /* 4 x u32: track, edition, chapter, attachment */
+#define FLAT_T_UID_COUNT    32   /* 4 x u32 */
+
+/* Simple tag record field offsets */
+#define FLAT_S_NAME          0
+#define FLAT_S_VALUE         4
+#define FLAT_S_LANGUAGE      8
+#define FLAT_S_BINARY_OFF   12
+#define FLAT_S_BINARY_SIZE  16
+#define FLAT_S_FLAGS        20   /* bit 0: is_default */
+#define FLAT_S_NESTED       24
+#define FLAT_S_NEXT         28
+
+static inline uint32_t flat_u32(const uint8_t *b)
+{
+    return (uint32_t)b[0]         | ((uint32_t)b[1] << 8) |
+           ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static inline uint64_t flat_u64(const uint8_t *b)
+{
+    return (uint64_t)flat_u32(b) | ((uint64_t)flat_u32(b + 4) << 32);
+}
+
+/*
+ * Append the flat encoding of `coll` to `buf`.
+ */
+int flat_encode(const mp3tag_collection_t *coll, dyn_buffer_t *buf);
+
+/*
+ * Check that `data` is a well-formed flat blob: header, bounds of every
+ * offset, string termination and forward-only record links.
+ */
+int flat_validate(const uint8_t *data, size_t size);
+
+/*
+ * Rebuild a heap collection from a validated flat blob.
+ */
+int flat_decode(const uint8_t *data, size_t size, mp3tag_collection_t **coll);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLAT_H */
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Public flat-collection API: serialize/deserialize wrappers around the
+ * internal codec, and zero-copy accessors over a validated blob.
+ */
+
+#include "flat.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/buffer.h>
+#include <tag_common/string_util.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------------------------------------ */
+/*  Serialization                                                      */
+/* ------------------------------------------------------------------ */
+
+int mp3tag_flat_serialize(const mp3tag_collection_t *coll,
+                          uint8_t **data, size_t *size)
+{
+    if (!coll || !data || !size) return MP3TAG_ERR_INVALID_ARG;
+    *data = NULL;
+    *size = 0;
+
+    dyn_buffer_t buf;
+    buffer_init(&buf);
+    int rc = flat_encode(coll, &buf);
+    if (rc != MP3TAG_OK) {
+        buffer_free(&buf);
+        return rc;
+    }
+
+    *data = buf.data;  /* Hand over the buffer's storage */
+    *size = buf.size;
+    return MP3TAG_OK;
+}
+
+void mp3tag_flat_free(uint8_t *data)
+{
+    free(data);
+}
+
+int mp3tag_flat_deserialize(const uint8_t *data, size_t size,
+                            mp3tag_collection_t **coll)
+{
+    if (!data || !coll) return MP3TAG_ERR_INVALID_ARG;
+    return flat_decode(data, size, coll);
+}
+
+size_t mp3tag_flat_blob_size(const uint8_t *data, size_t avail)
+{
+    if (!data || avail < FLAT_HEADER_SIZE) return 0;
+    if (memcmp(data + FLAT_H_MAGIC, FLAT_MAGIC, 4) != 0) return 0;
+    return flat_u32(data + FLAT_H_TOTAL_SIZE);
+}
+
+int mp3tag_flat_open(mp3tag_flat_t *view, const uint8_t *data, size_t size)
+{
+    if (!view) return MP3TAG_ERR_INVALID_ARG;
+    view->data = NULL;
+    view->size = 0;
+
+    int rc = flat_validate(data, size);
+    if (rc != MP3TAG_OK) return rc;
+
+    view->data = data;
+    view->size = flat_u32(data + FLAT_H_TOTAL_SIZE);
+    return MP3TAG_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Record lookup                                                      */
+/* ------------------------------------------------------------------ */
+
+/*
+ * The view was validated by mp3tag_flat_open(), so only the caller's
+ * indices need checking here.
+ */
+
+static const uint8_t *tag_rec(const mp3tag_flat_t *v, size_t tag)
+{
+    if (!v || !v->data) return NULL;
+    if (tag >= flat_u32(v->data + FLAT_H_TAG_COUNT)) return NULL;
+    return v->data + flat_u32(v->data + FLAT_H_TAGS_OFF) + tag * FLAT_TAG_SIZE;
+}
+
+static const uint8_t *simple_rec(const mp3tag_flat_t *v, mp3tag_flat_ref_t st)
+{
+    if (!v || !v->data) return NULL;
+    if (st >= flat_u32(v->data + FLAT_H_SIMPLE_COUNT)) return NULL;
+    return v->data + flat_u32(v->data + FLAT_H_SIMPLES_OFF) +
+           (size_t)st * FLAT_SIMPLE_SIZE;
+}
+
+static const char *str_at(const mp3tag_flat_t *v, uint32_t off)
+{
+    return off ? (const char *)(v->data + off) : NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Tag accessors                                                      */
+/* ------------------------------------------------------------------ */
+
+size_t mp3tag_flat_tag_count(const mp3tag_flat_t *view)
+{
+    if (!view || !view->data) return 0;
+    return flat_u32(view->data + FLAT_H_TAG_COUNT);
+}
+
+mp3tag_target_type_t mp3tag_flat_tag_target_type(const mp3tag_flat_t *view,
+                                                 size_t tag)
+{
+    const uint8_t *t = tag_rec(view, tag);
+    return t ? (mp3tag_target_type_t)flat_u32(t + FLAT_T_TARGET_TYPE)
+             : MP3TAG_TARGET_ALBUM;
+}
+
+const char *mp3tag_flat_tag_target_string(const mp3tag_flat_t *view,
+                                          size_t tag)
+{
+    const uint8_t *t = tag_rec(view, tag);
+    return t ? str_at(view, flat_u32(t + FLAT_T_TARGET_STR)) : NULL;
+}
+
+size_t mp3tag_flat_tag_uid_count(const mp3tag_flat_t *view, size_t tag,
+                                 mp3tag_uid_kind_t kind)
+{
+    const uint8_t *t = tag_rec(view, tag);
+    if (!t || (unsigned)kind > MP3TAG_UID_ATTACHMENT) return 0;
+    return flat_u32(t + FLAT_T_UID_COUNT + 4 * kind);
+}
+
+uint64_t mp3tag_flat_tag_uid(const mp3tag_flat_t *view, size_t tag,
+                             mp3tag_uid_kind_t kind, size_t index)
+{
+    if (index >= mp3tag_flat_tag_uid_count(view, tag, kind)) return 0;
+    const uint8_t *t = tag_rec(view, tag);
+    uint32_t off = flat_u32(t + FLAT_T_UID_OFF + 4 * kind);
+    return flat_u64(view->data + off + index * 8);
+}
+
+mp3tag_flat_ref_t mp3tag_flat_tag_first_simple(const mp3tag_flat_t *view,
+                                               size_t tag)
+{
+    const uint8_t *t = tag_rec(view, tag);
+    return t ? flat_u32(t + FLAT_T_FIRST_SIMPLE) : MP3TAG_FLAT_NONE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Simple tag accessors                                               */
+/* ------------------------------------------------------------------ */
+
+const char *mp3tag_flat_simple_name(const mp3tag_flat_t *view,
+                                    mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? str_at(view, flat_u32(s + FLAT_S_NAME)) : NULL;
+}
+
+const char *mp3tag_flat_simple_value(const mp3tag_flat_t *view,
+                                     mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? str_at(view, flat_u32(s + FLAT_S_VALUE)) : NULL;
+}
+
+const char *mp3tag_flat_simple_language(const mp3tag_flat_t *view,
+                                        mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? str_at(view, flat_u32(s + FLAT_S_LANGUAGE)) : NULL;
+}
+
+const uint8_t *mp3tag_flat_simple_binary(const mp3tag_flat_t *view,
+                                         mp3tag_flat_ref_t st, size_t *size)
+{
+    const uint8_t *s = simple_rec(view, st);
+    uint32_t n = s ? flat_u32(s + FLAT_S_BINARY_SIZE) : 0;
+    if (size) *size = n;
+    return n ? view->data + flat_u32(s + FLAT_S_BINARY_OFF) : NULL;
+}
+
+int mp3tag_flat_simple_is_default(const mp3tag_flat_t *view,
+                                  mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? (int)(flat_u32(s + FLAT_S_FLAGS) & 1) : 0;
+}
+
+mp3tag_flat_ref_t mp3tag_flat_simple_nested(const mp3tag_flat_t *view,
+                                            mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? flat_u32(s + FLAT_S_NESTED) : MP3TAG_FLAT_NONE;
+}
+
+mp3tag_flat_ref_t mp3tag_flat_simple_next(const mp3tag_flat_t *view,
+                                          mp3tag_flat_ref_t st)
+{
+    const uint8_t *s = simple_rec(view, st);
+    return s ? flat_u32(s + FLAT_S_NEXT) : MP3TAG_FLAT_NONE;
+}
+
+const char *mp3tag_flat_find(const mp3tag_flat_t *view, const char *name)
+{
+    if (!name) return NULL;
+
+    size_t ntags = mp3tag_flat_tag_count(view);
+    for (size_t t = 0; t < ntags; t++) {
+        for (mp3tag_flat_ref_t st = mp3tag_flat_tag_first_simple(view, t);
+             st != MP3TAG_FLAT_NONE;
+             st = mp3tag_flat_simple_next(view, st)) {
+            const char *value = mp3tag_flat_simple_value(view, st);
+            const char *sname = mp3tag_flat_simple_name(view, st);
+            if (value && sname && str_casecmp(sname, name) == 0)
+                return value;
+        }
+    }
+    return NULL;
+}
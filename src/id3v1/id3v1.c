@@ -3,6 +3,7 @@
 
 #include "id3v1.h"
 #include "../../include/mp3tag/mp3tag_error.h"
+#include "../stats/stats.h"
 #include <tag_common/string_util.h>
 
 #include <stdlib.h>
@@ -10,14 +11,14 @@
 
 int id3v1_detect(file_handle_t *fh)
 {
-    int64_t fsize = file_size(fh);
+    int64_t fsize = io_size(fh);
     if (fsize < ID3V1_TAG_SIZE)
         return 0;
 
     uint8_t header[3];
-    if (file_seek(fh, fsize - ID3V1_TAG_SIZE) != 0)
+    if (io_seek(fh, fsize - ID3V1_TAG_SIZE) != 0)
         return MP3TAG_ERR_SEEK_FAILED;
-    if (file_read(fh, header, 3) != 0)
+    if (io_read(fh, header, 3) != 0)
         return MP3TAG_ERR_IO;
 
     return (header[0] == 'T' && header[1] == 'A' && header[2] == 'G') ? 1 : 0;
@@ -41,15 +42,15 @@ static mp3tag_simple_tag_t *add_simple(mp3tag_tag_t *tag,
     if (!value || value[0] == '\0')
         return NULL;
 
-    mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
+    mp3tag_simple_tag_t *st = mem_calloc(ALLOC_SIMPLE_TAG, 1, sizeof(*st));
     if (!st) return NULL;
 
-    st->name  = str_dup(name);
-    st->value = str_dup(value);
+    st->name  = mem_strdup(ALLOC_TAG_TEXT, name);
+    st->value = mem_strdup(ALLOC_TAG_TEXT, value);
     if (!st->name || !st->value) {
-        free(st->name);
-        free(st->value);
-        free(st);
+        mem_free(st->name);
+        mem_free(st->value);
+        mem_free(st);
         return NULL;
     }
 
@@ -73,12 +74,12 @@ int id3v1_read(file_handle_t *fh, mp3tag_collection_t **coll)
         return detected == 0 ? MP3TAG_ERR_NO_TAGS : detected;
 
     /* Read the full 128-byte tag */
-    int64_t fsize = file_size(fh);
+    int64_t fsize = io_size(fh);
     uint8_t raw[ID3V1_TAG_SIZE];
 
-    if (file_seek(fh, fsize - ID3V1_TAG_SIZE) != 0)
+    if (io_seek(fh, fsize - ID3V1_TAG_SIZE) != 0)
         return MP3TAG_ERR_SEEK_FAILED;
-    if (file_read(fh, raw, ID3V1_TAG_SIZE) != 0)
+    if (io_read(fh, raw, ID3V1_TAG_SIZE) != 0)
         return MP3TAG_ERR_IO;
 
     /* Parse fixed-width fields */
@@ -114,11 +115,11 @@ int id3v1_read(file_handle_t *fh, mp3tag_collection_t **coll)
     }
 
     /* Build collection */
-    mp3tag_collection_t *c = calloc(1, sizeof(*c));
+    mp3tag_collection_t *c = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*c));
     if (!c) return MP3TAG_ERR_NO_MEMORY;
 
-    mp3tag_tag_t *tag = calloc(1, sizeof(*tag));
-    if (!tag) { free(c); return MP3TAG_ERR_NO_MEMORY; }
+    mp3tag_tag_t *tag = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*tag));
+    if (!tag) { mem_free(c); return MP3TAG_ERR_NO_MEMORY; }
 
     tag->target_type = MP3TAG_TARGET_ALBUM;
     c->tags  = tag;
@@ -4,6 +4,7 @@
 #include "id3v2_reader.h"
 #include "id3v2_defs.h"
 #include "../../include/mp3tag/mp3tag_error.h"
+#include "../stats/stats.h"
 #include <tag_common/string_util.h>
 
 #include <stdlib.h>
@@ -19,9 +20,9 @@ int id3v2_read_header(file_handle_t *fh, int64_t offset, id3v2_header_t *hdr)
         return MP3TAG_ERR_INVALID_ARG;
 
     uint8_t buf[ID3V2_HEADER_SIZE];
-    if (file_seek(fh, offset) != 0)
+    if (io_seek(fh, offset) != 0)
         return MP3TAG_ERR_SEEK_FAILED;
-    if (file_read(fh, buf, ID3V2_HEADER_SIZE) != 0)
+    if (io_read(fh, buf, ID3V2_HEADER_SIZE) != 0)
         return MP3TAG_ERR_NOT_MP3;
 
     /* Check "ID3" magic */
@@ -62,7 +63,7 @@ int id3v2_read_header(file_handle_t *fh, int64_t offset, id3v2_header_t *hdr)
 static char *decode_iso8859_1(const uint8_t *data, size_t len)
 {
     /* Worst case: each byte becomes 2 UTF-8 bytes */
-    char *out = malloc(len * 2 + 1);
+    char *out = mem_malloc(ALLOC_DECODED_TEXT, len * 2 + 1);
     if (!out) return NULL;
 
     size_t j = 0;
@@ -87,7 +88,7 @@ static char *decode_utf8(const uint8_t *data, size_t len)
     while (actual < len && data[actual] != 0)
         actual++;
 
-    char *out = malloc(actual + 1);
+    char *out = mem_malloc(ALLOC_DECODED_TEXT, actual + 1);
     if (!out) return NULL;
     memcpy(out, data, actual);
     out[actual] = '\0';
@@ -102,7 +103,7 @@ static char *decode_utf8(const uint8_t *data, size_t len)
 static char *decode_utf16(const uint8_t *data, size_t len,
                           int has_bom, int default_be)
 {
-    if (len < 2) return str_dup("");
+    if (len < 2) return mem_strdup(ALLOC_DECODED_TEXT, "");
 
     int big_endian = default_be;
     size_t start = 0;
@@ -118,7 +119,7 @@ static char *decode_utf16(const uint8_t *data, size_t len,
     /* Allocate worst case: each UTF-16 unit -> 3 UTF-8 bytes,
        surrogate pair -> 4 UTF-8 bytes */
     size_t max_chars = (len - start) / 2;
-    char *out = malloc(max_chars * 4 + 1);
+    char *out = mem_malloc(ALLOC_DECODED_TEXT, max_chars * 4 + 1);
     if (!out) return NULL;
 
     size_t j = 0;
@@ -168,8 +169,12 @@ static char *decode_utf16(const uint8_t *data, size_t len,
     return out;
 }
 
-static char *decode_text(uint8_t encoding, const uint8_t *data, size_t len)
+char *id3v2_decode_text(uint8_t encoding, const uint8_t *data, size_t len)
 {
+    STATS_ADD(transcoded_bytes[encoding < MP3TAG_ENC_COUNT ? encoding
+                                                           : MP3TAG_ENC_LATIN1],
+              len);
+
     switch (encoding) {
     case ID3V2_ENC_ISO8859_1:
         return decode_iso8859_1(data, len);
@@ -190,8 +195,8 @@ static char *decode_text(uint8_t encoding, const uint8_t *data, size_t len)
  * UTF-16 variants use 0x00 0x00.
  * Returns the offset of the terminator, or `len` if not found.
  */
-static size_t find_text_terminator(uint8_t encoding,
-                                   const uint8_t *data, size_t len)
+size_t id3v2_find_text_terminator(uint8_t encoding,
+                                  const uint8_t *data, size_t len)
 {
     if (encoding == ID3V2_ENC_UTF16_BOM || encoding == ID3V2_ENC_UTF16BE) {
         for (size_t i = 0; i + 1 < len; i += 2) {
@@ -216,6 +221,63 @@ static size_t terminator_size(uint8_t encoding)
 /*  Frame parsing                                                      */
 /* ------------------------------------------------------------------ */
 
+/*
+ * Decode the frame header `fhdr` with `avail` bytes of the tag left after
+ * it. Returns 0 with the body size and flags, or -1 at padding, an
+ * invalid frame ID or a size running past the tag (the end of frames).
+ */
+static int decode_frame_header(const uint8_t *fhdr, uint8_t version_major,
+                               int64_t avail, uint32_t *size,
+                               uint16_t *flags)
+{
+    /* Check for padding (all zeros = end of frames) */
+    if (fhdr[0] == 0)
+        return -1;
+
+    /* Validate frame ID: must be uppercase A-Z or 0-9 */
+    for (int i = 0; i < 4; i++) {
+        if (!((fhdr[i] >= 'A' && fhdr[i] <= 'Z') ||
+              (fhdr[i] >= '0' && fhdr[i] <= '9')))
+            return -1;
+    }
+
+    /* Decode frame size */
+    if (version_major == 4)
+        *size = id3v2_syncsafe_decode(fhdr + 4);
+    else
+        *size = id3v2_be32_decode(fhdr + 4);
+    *flags = ((uint16_t)fhdr[8] << 8) | fhdr[9];
+
+    /* Sanity check */
+    return (int64_t)*size > avail ? -1 : 0;
+}
+
+/* Append a frame taking ownership of `data`; frees it on failure */
+static int append_frame(id3v2_frame_t **frames, id3v2_frame_t **tail,
+                        const uint8_t *id, uint8_t *data, uint32_t size,
+                        uint16_t flags)
+{
+    id3v2_frame_t *frame = mem_calloc(ALLOC_FRAME, 1, sizeof(*frame));
+    if (!frame) {
+        mem_free(data);
+        return MP3TAG_ERR_NO_MEMORY;
+    }
+
+    memcpy(frame->id, id, 4);
+    frame->id[4]     = '\0';
+    frame->data      = data;
+    frame->data_size = size;
+    frame->flags     = flags;
+
+    if (!*frames) {
+        *frames = frame;
+    } else {
+        (*tail)->next = frame;
+    }
+    *tail = frame;
+    return MP3TAG_OK;
+}
+
 int id3v2_read_frames(file_handle_t *fh, int64_t base_offset,
                       const id3v2_header_t *hdr, id3v2_frame_t **frames)
 {
@@ -231,9 +293,9 @@ int id3v2_read_frames(file_handle_t *fh, int64_t base_offset,
     /* Skip extended header if present */
     if (hdr->flags & ID3V2_FLAG_EXTENDED) {
         uint8_t ext_buf[4];
-        if (file_seek(fh, tag_start) != 0)
+        if (io_seek(fh, tag_start) != 0)
             return MP3TAG_ERR_SEEK_FAILED;
-        if (file_read(fh, ext_buf, 4) != 0)
+        if (io_read(fh, ext_buf, 4) != 0)
             return MP3TAG_ERR_TRUNCATED;
 
         uint32_t ext_size;
@@ -253,81 +315,77 @@ int id3v2_read_frames(file_handle_t *fh, int64_t base_offset,
 
     while (pos + ID3V2_FRAME_HEADER_SIZE <= tag_end) {
         uint8_t fhdr[ID3V2_FRAME_HEADER_SIZE];
-        if (file_seek(fh, pos) != 0)
+        if (io_seek(fh, pos) != 0)
             break;
-        if (file_read(fh, fhdr, ID3V2_FRAME_HEADER_SIZE) != 0)
-            break;
-
-        /* Check for padding (all zeros = end of frames) */
-        if (fhdr[0] == 0)
-            break;
-
-        /* Validate frame ID: must be uppercase A-Z or 0-9 */
-        int valid_id = 1;
-        for (int i = 0; i < 4; i++) {
-            if (!((fhdr[i] >= 'A' && fhdr[i] <= 'Z') ||
-                  (fhdr[i] >= '0' && fhdr[i] <= '9'))) {
-                valid_id = 0;
-                break;
-            }
-        }
-        if (!valid_id)
+        if (io_read(fh, fhdr, ID3V2_FRAME_HEADER_SIZE) != 0)
             break;
 
-        /* Decode frame size */
         uint32_t frame_size;
-        if (hdr->version_major == 4)
-            frame_size = id3v2_syncsafe_decode(fhdr + 4);
-        else
-            frame_size = id3v2_be32_decode(fhdr + 4);
-
-        uint16_t frame_flags = ((uint16_t)fhdr[8] << 8) | fhdr[9];
-
-        /* Sanity check */
-        if (pos + ID3V2_FRAME_HEADER_SIZE + frame_size > tag_end)
+        uint16_t frame_flags;
+        if (decode_frame_header(fhdr, hdr->version_major,
+                                tag_end - pos - ID3V2_FRAME_HEADER_SIZE,
+                                &frame_size, &frame_flags) != 0)
             break;
 
         /* Read frame data */
-        uint8_t *data = malloc(frame_size);
+        uint8_t *data = mem_malloc(ALLOC_FRAME_DATA, frame_size);
         if (!data) {
             id3v2_free_frames(*frames);
             *frames = NULL;
             return MP3TAG_ERR_NO_MEMORY;
         }
 
-        if (file_read(fh, data, frame_size) != 0) {
-            free(data);
+        if (io_read(fh, data, frame_size) != 0) {
+            mem_free(data);
             id3v2_free_frames(*frames);
             *frames = NULL;
             return MP3TAG_ERR_TRUNCATED;
         }
 
-        /* Create frame node */
-        id3v2_frame_t *frame = calloc(1, sizeof(*frame));
-        if (!frame) {
-            free(data);
+        if (append_frame(frames, &tail, fhdr, data, frame_size,
+                         frame_flags) != MP3TAG_OK) {
             id3v2_free_frames(*frames);
             *frames = NULL;
             return MP3TAG_ERR_NO_MEMORY;
         }
 
-        memcpy(frame->id, fhdr, 4);
-        frame->id[4]    = '\0';
-        frame->data      = data;
-        frame->data_size = frame_size;
-        frame->flags     = frame_flags;
+        pos += ID3V2_FRAME_HEADER_SIZE + frame_size;
+    }
+
+    return MP3TAG_OK;
+}
 
-        /* Append to list */
-        if (!*frames) {
-            *frames = frame;
-        } else {
-            tail->next = frame;
+int id3v2_parse_frames(const uint8_t *data, size_t size,
+                       id3v2_frame_t **frames)
+{
+    if (!frames || (!data && size))
+        return MP3TAG_ERR_INVALID_ARG;
+
+    *frames = NULL;
+    id3v2_frame_t *tail = NULL;
+
+    size_t pos = 0;
+    while (pos + ID3V2_FRAME_HEADER_SIZE <= size) {
+        const uint8_t *fhdr = data + pos;
+        uint32_t frame_size;
+        uint16_t frame_flags;
+        if (decode_frame_header(fhdr, 4,
+                                (int64_t)(size - pos - ID3V2_FRAME_HEADER_SIZE),
+                                &frame_size, &frame_flags) != 0)
+            break;
+
+        uint8_t *copy = mem_malloc(ALLOC_FRAME_DATA, frame_size);
+        if (copy)
+            memcpy(copy, fhdr + ID3V2_FRAME_HEADER_SIZE, frame_size);
+        if (!copy || append_frame(frames, &tail, fhdr, copy, frame_size,
+                                  frame_flags) != MP3TAG_OK) {
+            id3v2_free_frames(*frames);
+            *frames = NULL;
+            return MP3TAG_ERR_NO_MEMORY;
         }
-        tail = frame;
 
         pos += ID3V2_FRAME_HEADER_SIZE + frame_size;
     }
-
     return MP3TAG_OK;
 }
 
@@ -337,14 +395,14 @@ int id3v2_read_frames(file_handle_t *fh, int64_t base_offset,
 
 static mp3tag_simple_tag_t *make_simple_tag(const char *name, const char *value)
 {
-    mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
+    mp3tag_simple_tag_t *st = mem_calloc(ALLOC_SIMPLE_TAG, 1, sizeof(*st));
     if (!st) return NULL;
-    st->name  = str_dup(name);
-    st->value = str_dup(value);
+    st->name  = mem_strdup(ALLOC_TAG_TEXT, name);
+    st->value = mem_strdup(ALLOC_TAG_TEXT, value);
     if (!st->name || !st->value) {
-        free(st->name);
-        free(st->value);
-        free(st);
+        mem_free(st->name);
+        mem_free(st->value);
+        mem_free(st);
         return NULL;
     }
     return st;
@@ -353,12 +411,12 @@ static mp3tag_simple_tag_t *make_simple_tag(const char *name, const char *value)
 static mp3tag_simple_tag_t *make_binary_tag(const char *name,
                                             const uint8_t *data, size_t size)
 {
-    mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
+    mp3tag_simple_tag_t *st = mem_calloc(ALLOC_SIMPLE_TAG, 1, sizeof(*st));
     if (!st) return NULL;
-    st->name = str_dup(name);
-    if (!st->name) { free(st); return NULL; }
-    st->binary = malloc(size);
-    if (!st->binary) { free(st->name); free(st); return NULL; }
+    st->name = mem_strdup(ALLOC_TAG_TEXT, name);
+    if (!st->name) { mem_free(st); return NULL; }
+    st->binary = mem_malloc(ALLOC_BINARY, size);
+    if (!st->binary) { mem_free(st->name); mem_free(st); return NULL; }
     memcpy(st->binary, data, size);
     st->binary_size = size;
     return st;
@@ -381,7 +439,8 @@ static void parse_text_frame(const id3v2_frame_t *frame, mp3tag_tag_t *tag)
     if (frame->data_size < 1) return;
 
     uint8_t encoding = frame->data[0];
-    char *text = decode_text(encoding, frame->data + 1, frame->data_size - 1);
+    char *text = id3v2_decode_text(encoding, frame->data + 1,
+                                   frame->data_size - 1);
     if (!text) return;
 
     /* Map frame ID to human-readable name */
@@ -394,7 +453,7 @@ static void parse_text_frame(const id3v2_frame_t *frame, mp3tag_tag_t *tag)
         /* Unknown text frame: use frame ID as name */
         st = make_simple_tag(frame->id, text);
     }
-    free(text);
+    mem_free(text);
     append_simple_tag(tag, st);
 }
 
@@ -407,8 +466,8 @@ static void parse_txxx_frame(const id3v2_frame_t *frame, mp3tag_tag_t *tag)
     size_t rest_len = frame->data_size - 1;
 
     /* Find NUL separator between description and value */
-    size_t desc_end = find_text_terminator(encoding, rest, rest_len);
-    char *desc = decode_text(encoding, rest, desc_end);
+    size_t desc_end = id3v2_find_text_terminator(encoding, rest, rest_len);
+    char *desc = id3v2_decode_text(encoding, rest, desc_end);
     if (!desc) return;
 
     size_t tsz = terminator_size(encoding);
@@ -416,17 +475,18 @@ static void parse_txxx_frame(const id3v2_frame_t *frame, mp3tag_tag_t *tag)
     char *value = NULL;
 
     if (val_start < rest_len) {
-        value = decode_text(encoding, rest + val_start, rest_len - val_start);
+        value = id3v2_decode_text(encoding, rest + val_start,
+                                  rest_len - val_start);
     } else {
-        value = str_dup("");
+        value = mem_strdup(ALLOC_DECODED_TEXT, "");
     }
 
-    if (!value) { free(desc); return; }
+    if (!value) { mem_free(desc); return; }
 
     /* Use description as the tag name */
     mp3tag_simple_tag_t *st = make_simple_tag(desc, value);
-    free(desc);
-    free(value);
+    mem_free(desc);
+    mem_free(value);
     append_simple_tag(tag, st);
 }
 
@@ -447,22 +507,23 @@ static void parse_comm_frame(const id3v2_frame_t *frame, mp3tag_tag_t *tag)
     size_t rest_len = frame->data_size - 4;
 
     /* Skip short description */
-    size_t desc_end = find_text_terminator(encoding, rest, rest_len);
+    size_t desc_end = id3v2_find_text_terminator(encoding, rest, rest_len);
     size_t tsz = terminator_size(encoding);
     size_t val_start = desc_end + tsz;
 
     char *text = NULL;
     if (val_start < rest_len) {
-        text = decode_text(encoding, rest + val_start, rest_len - val_start);
+        text = id3v2_decode_text(encoding, rest + val_start,
+                                 rest_len - val_start);
     } else {
-        text = str_dup("");
+        text = mem_strdup(ALLOC_DECODED_TEXT, "");
     }
     if (!text) return;
 
     mp3tag_simple_tag_t *st = make_simple_tag("COMMENT", text);
-    free(text);
+    mem_free(text);
     if (st && lang[0] != '\0') {
-        st->language = str_dup(lang);
+        st->language = mem_strdup(ALLOC_TAG_TEXT, lang);
     }
     append_simple_tag(tag, st);
 }
@@ -485,11 +546,11 @@ int id3v2_frames_to_collection(const id3v2_frame_t *frames,
 {
     if (!coll) return MP3TAG_ERR_INVALID_ARG;
 
-    mp3tag_collection_t *c = calloc(1, sizeof(*c));
+    mp3tag_collection_t *c = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*c));
     if (!c) return MP3TAG_ERR_NO_MEMORY;
 
-    mp3tag_tag_t *tag = calloc(1, sizeof(*tag));
-    if (!tag) { free(c); return MP3TAG_ERR_NO_MEMORY; }
+    mp3tag_tag_t *tag = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*tag));
+    if (!tag) { mem_free(c); return MP3TAG_ERR_NO_MEMORY; }
 
     tag->target_type = MP3TAG_TARGET_ALBUM;
     c->tags  = tag;
@@ -497,8 +558,13 @@ int id3v2_frames_to_collection(const id3v2_frame_t *frames,
 
     for (const id3v2_frame_t *f = frames; f; f = f->next) {
         /* Skip frames with compression/encryption (unsupported) */
-        if (f->flags & (ID3V2_FRAME_FLAG_COMPRESS | ID3V2_FRAME_FLAG_ENCRYPT))
+        if (f->flags & (ID3V2_FRAME_FLAG_COMPRESS | ID3V2_FRAME_FLAG_ENCRYPT)) {
+            STATS_INC(frames_skipped);
+            MP3TAG_PROBE3(frame__parse, (const char *)f->id, f->data_size, 1);
             continue;
+        }
+        STATS_INC(frames_parsed);
+        MP3TAG_PROBE3(frame__parse, (const char *)f->id, f->data_size, 0);
 
         if (f->id[0] == 'T' && f->id[1] == 'X' &&
             f->id[2] == 'X' && f->id[3] == 'X') {
@@ -526,8 +592,8 @@ void id3v2_free_frames(id3v2_frame_t *frames)
 {
     while (frames) {
         id3v2_frame_t *next = frames->next;
-        free(frames->data);
-        free(frames);
+        mem_free(frames->data);
+        mem_free(frames);
         frames = next;
     }
 }
@@ -45,12 +45,33 @@ int id3v2_read_header(file_handle_t *fh, int64_t offset, id3v2_header_t *hdr);
 int id3v2_read_frames(file_handle_t *fh, int64_t base_offset,
                       const id3v2_header_t *hdr, id3v2_frame_t **frames);
 
+/*
+ * Split an in-memory ID3v2.4 frame area (as id3v2_serialize_frames()
+ * produces it) into frames, stopping where id3v2_read_frames() would.
+ */
+int id3v2_parse_frames(const uint8_t *data, size_t size,
+                       id3v2_frame_t **frames);
+
 /*
  * Convert parsed ID3v2 frames into an mp3tag_collection_t.
  */
 int id3v2_frames_to_collection(const id3v2_frame_t *frames,
                                mp3tag_collection_t **coll);
 
+/*
+ * Decode text in ID3v2 encoding `encoding` to a newly allocated UTF-8
+ * string, stopping at the first NUL. Unknown encodings are treated as
+ * ISO-8859-1. Returns NULL when out of memory.
+ */
+char *id3v2_decode_text(uint8_t encoding, const uint8_t *data, size_t len);
+
+/*
+ * Offset of the NUL terminator (two bytes for UTF-16) in `data`, or `len`
+ * if there is none.
+ */
+size_t id3v2_find_text_terminator(uint8_t encoding,
+                                  const uint8_t *data, size_t len);
+
 /*
  * Free a linked list of frames.
  */
@@ -4,6 +4,7 @@
 #include "id3v2_writer.h"
 #include "id3v2_defs.h"
 #include "../../include/mp3tag/mp3tag_error.h"
+#include "../stats/stats.h"
 #include <tag_common/string_util.h>
 
 #include <stdlib.h>
@@ -25,7 +26,7 @@ static int write_frame_header(dyn_buffer_t *buf, const char *frame_id,
     id3v2_syncsafe_encode(body_size, hdr + 4);
     hdr[8] = 0;  /* flags */
     hdr[9] = 0;
-    return buffer_append(buf, hdr, ID3V2_FRAME_HEADER_SIZE);
+    return buf_append(buf, hdr, ID3V2_FRAME_HEADER_SIZE);
 }
 
 /*
@@ -41,10 +42,10 @@ static int serialize_text_frame(dyn_buffer_t *buf, const char *frame_id,
         return -1;
 
     /* Encoding: UTF-8 */
-    if (buffer_append_byte(buf, ID3V2_ENC_UTF8) != 0)
+    if (buf_append_byte(buf, ID3V2_ENC_UTF8) != 0)
         return -1;
 
-    return buffer_append(buf, text, text_len);
+    return buf_append(buf, text, text_len);
 }
 
 /*
@@ -60,13 +61,13 @@ static int serialize_txxx_frame(dyn_buffer_t *buf, const char *desc,
     if (write_frame_header(buf, "TXXX", body_size) != 0)
         return -1;
 
-    if (buffer_append_byte(buf, ID3V2_ENC_UTF8) != 0)
+    if (buf_append_byte(buf, ID3V2_ENC_UTF8) != 0)
         return -1;
-    if (buffer_append(buf, desc, desc_len) != 0)
+    if (buf_append(buf, desc, desc_len) != 0)
         return -1;
-    if (buffer_append_byte(buf, 0) != 0)  /* NUL separator */
+    if (buf_append_byte(buf, 0) != 0)  /* NUL separator */
         return -1;
-    if (text_len > 0 && buffer_append(buf, text, text_len) != 0)
+    if (text_len > 0 && buf_append(buf, text, text_len) != 0)
         return -1;
 
     return 0;
@@ -86,17 +87,17 @@ static int serialize_comm_frame(dyn_buffer_t *buf, const char *text,
     if (write_frame_header(buf, "COMM", body_size) != 0)
         return -1;
 
-    if (buffer_append_byte(buf, ID3V2_ENC_UTF8) != 0)
+    if (buf_append_byte(buf, ID3V2_ENC_UTF8) != 0)
         return -1;
     /* Language code (exactly 3 bytes) */
     char lang3[3] = {lang[0], lang[1] ? lang[1] : ' ', lang[2] ? lang[2] : ' '};
-    if (buffer_append(buf, lang3, 3) != 0)
+    if (buf_append(buf, lang3, 3) != 0)
         return -1;
     /* Empty short description + NUL */
-    if (buffer_append_byte(buf, 0) != 0)
+    if (buf_append_byte(buf, 0) != 0)
         return -1;
     /* Text */
-    if (text_len > 0 && buffer_append(buf, text, text_len) != 0)
+    if (text_len > 0 && buf_append(buf, text, text_len) != 0)
         return -1;
 
     return 0;
@@ -110,7 +111,7 @@ static int serialize_binary_frame(dyn_buffer_t *buf, const char *frame_id,
 {
     if (write_frame_header(buf, frame_id, (uint32_t)size) != 0)
         return -1;
-    return buffer_append(buf, data, size);
+    return buf_append(buf, data, size);
 }
 
 /*
@@ -0,0 +1,722 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * In-process catalog index.
+ *
+ * Every added file becomes a document with a dense id. Documents are
+ * grouped into fixed-size segments; each segment keeps a bloom filter of
+ * the frame (simple tag) names present in its documents, so frame
+ * queries skip whole segments that cannot match. Selected text fields
+ * get inverted postings (sorted document-id lists) keyed by field and
+ * case-folded value. Re-adding or removing a file only tombstones its
+ * old document; queries skip dead ids. Once dead documents outnumber
+ * live ones, the index is rebuilt with dense ids (see compact()).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/mp3tag/mp3tag.h"
+#include "../id3v2/id3v2_defs.h"
+#include <tag_common/string_util.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_SEGMENT_SHIFT  12                  /* 4096 documents */
+#define INDEX_BLOOM_BITS     4096
+#define INDEX_BLOOM_WORDS    (INDEX_BLOOM_BITS / 64)
+#define INDEX_BLOOM_HASHES   4
+
+#define INDEX_NO_DOC         0xFFFFFFFFu
+
+/* Compact once dead documents outnumber live ones, and at least this many */
+#define INDEX_COMPACT_MIN    64
+
+/* Well-known fields that always get postings; see is_indexed_field() */
+static const char *const index_fields[] = {
+    "ARTIST", "ALBUM_ARTIST", "ALBUM", "GENRE", NULL
+};
+
+/* ------------------------------------------------------------------ */
+/*  String map (open addressing, owned keys)                           */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    char     *key;
+    uint64_t  hash;
+    uint32_t  value;
+} strmap_slot_t;
+
+typedef struct {
+    strmap_slot_t *slots;
+    size_t         cap;     /* Power of two */
+    size_t         count;
+} strmap_t;
+
+static uint64_t hash_str(const char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *s; s++) {
+        h ^= (uint8_t)*s;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static strmap_slot_t *strmap_slot(const strmap_t *m, const char *key,
+                                  uint64_t hash)
+{
+    size_t i = (size_t)hash & (m->cap - 1);
+    for (;;) {
+        strmap_slot_t *s = &m->slots[i];
+        if (!s->key || (s->hash == hash && strcmp(s->key, key) == 0))
+            return s;
+        i = (i + 1) & (m->cap - 1);
+    }
+}
+
+static int strmap_grow(strmap_t *m)
+{
+    size_t cap = m->cap ? m->cap * 2 : 64;
+    strmap_slot_t *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+
+    strmap_t grown = { slots, cap, m->count };
+    for (size_t i = 0; i < m->cap; i++) {
+        if (m->slots[i].key)
+            *strmap_slot(&grown, m->slots[i].key, m->slots[i].hash) =
+                m->slots[i];
+    }
+    free(m->slots);
+    *m = grown;
+    return 0;
+}
+
+/* Returns the value for `key`, or INDEX_NO_DOC */
+static uint32_t strmap_get(const strmap_t *m, const char *key)
+{
+    if (!m->cap) return INDEX_NO_DOC;
+    const strmap_slot_t *s = strmap_slot(m, key, hash_str(key));
+    return s->key ? s->value : INDEX_NO_DOC;
+}
+
+/*
+ * Find or insert `key`. New keys get `value`; returns the slot, or NULL
+ * if out of memory.
+ */
+static strmap_slot_t *strmap_put(strmap_t *m, const char *key, uint32_t value,
+                                 int *inserted)
+{
+    if ((m->count + 1) * 10 > m->cap * 7 && strmap_grow(m) != 0)
+        return NULL;
+
+    uint64_t hash = hash_str(key);
+    strmap_slot_t *s = strmap_slot(m, key, hash);
+    *inserted = 0;
+    if (!s->key) {
+        s->key = str_dup(key);
+        if (!s->key) return NULL;
+        s->hash  = hash;
+        s->value = value;
+        m->count++;
+        *inserted = 1;
+    }
+    return s;
+}
+
+static void strmap_free(strmap_t *m)
+{
+    for (size_t i = 0; i < m->cap; i++)
+        free(m->slots[i].key);
+    free(m->slots);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Index structures                                                   */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint32_t atom;      /* Interned frame name */
+    uint64_t size;      /* Value length or binary size */
+} doc_frame_t;
+
+typedef struct {
+    char        *path;
+    doc_frame_t *frames;
+    uint32_t     frame_count;
+    int          live;
+} index_doc_t;
+
+typedef struct {
+    uint32_t *ids;      /* Ascending document ids */
+    uint32_t  count;
+    uint32_t  cap;
+} posting_t;
+
+typedef struct {
+    uint64_t bits[INDEX_BLOOM_WORDS];
+} bloom_t;
+
+struct mp3tag_index {
+    pthread_rwlock_t      lock;
+
+    index_doc_t          *docs;
+    uint32_t              doc_count;
+    uint32_t              doc_cap;
+    uint32_t              live_count;
+    strmap_t              paths;      /* path -> current doc id */
+
+    bloom_t              *blooms;     /* One per segment */
+    size_t                bloom_count;
+
+    strmap_t              terms;      /* "FIELD\x1Fvalue" -> posting index */
+    posting_t            *postings;
+    uint32_t              posting_count;
+    uint32_t              posting_cap;
+
+    strmap_t              atoms;      /* Frame name -> atom id */
+    mp3tag_frame_stats_t *stats;      /* Per atom */
+    uint32_t              atom_cap;
+};
+
+/* ------------------------------------------------------------------ */
+/*  Helpers                                                            */
+/* ------------------------------------------------------------------ */
+
+static int grow_array(void **arr, uint32_t *cap, uint32_t need, size_t elem)
+{
+    if (need <= *cap) return 0;
+    uint64_t n = *cap ? (uint64_t)*cap * 2 : 16;
+    while (n < need) n *= 2;
+    if (n > UINT32_MAX) n = UINT32_MAX;
+    void *p = realloc(*arr, (size_t)n * elem);
+    if (!p) return -1;
+    memset((uint8_t *)p + (size_t)*cap * elem, 0, (size_t)(n - *cap) * elem);
+    *arr = p;
+    *cap = (uint32_t)n;
+    return 0;
+}
+
+/* Upper-case ASCII copy of a frame name */
+static char *fold_name(const char *name)
+{
+    char *s = str_dup(name);
+    if (!s) return NULL;
+    for (char *p = s; *p; p++)
+        if (*p >= 'a' && *p <= 'z') *p = (char)(*p - 32);
+    return s;
+}
+
+/* "FIELD\x1Fvalue" with upper-cased field and lower-cased value */
+static char *term_key(const char *field, const char *value)
+{
+    size_t fl = strlen(field), vl = strlen(value);
+    char *k = malloc(fl + vl + 2);
+    if (!k) return NULL;
+    for (size_t i = 0; i < fl; i++) {
+        char c = field[i];
+        k[i] = (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+    }
+    k[fl] = '\x1f';
+    for (size_t i = 0; i < vl; i++) {
+        char c = value[i];
+        k[fl + 1 + i] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    k[fl + 1 + vl] = '\0';
+    return k;
+}
+
+/*
+ * The well-known fields, plus every name without a mapped frame: TXXX
+ * descriptions and the text frames a tagger made up or this library
+ * does not name (MOOD, TKEY). Those are the site-specific fields a
+ * catalog is searched by, and no fixed list can name them. The mapped
+ * frames left out (TITLE, COMMENT, dates, sort orders) are unique per
+ * file or free text, so their postings would only cost memory; binary
+ * frames have no value and never get here.
+ */
+static int is_indexed_field(const char *name)
+{
+    for (size_t i = 0; index_fields[i]; i++)
+        if (str_casecmp(name, index_fields[i]) == 0) return 1;
+    return id3v2_name_to_frame_id(name) == NULL;
+}
+
+static unsigned size_bucket(uint64_t size)
+{
+    unsigned b = 0;
+    while (size > 1 && b < MP3TAG_INDEX_SIZE_BUCKETS - 1) {
+        size >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void bloom_add(bloom_t *b, uint64_t hash)
+{
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    for (uint32_t i = 0; i < INDEX_BLOOM_HASHES; i++) {
+        uint32_t bit = (h1 + i * h2) % INDEX_BLOOM_BITS;
+        b->bits[bit / 64] |= 1ull << (bit % 64);
+    }
+}
+
+static int bloom_test(const bloom_t *b, uint64_t hash)
+{
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    for (uint32_t i = 0; i < INDEX_BLOOM_HASHES; i++) {
+        uint32_t bit = (h1 + i * h2) % INDEX_BLOOM_BITS;
+        if (!(b->bits[bit / 64] & (1ull << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+/* Account a document's frames in (sign > 0) or out of the statistics */
+static void apply_stats(mp3tag_index_t *idx, const index_doc_t *doc, int sign)
+{
+    for (uint32_t i = 0; i < doc->frame_count; i++) {
+        const doc_frame_t *f = &doc->frames[i];
+        mp3tag_frame_stats_t *st = &idx->stats[f->atom];
+        unsigned b = size_bucket(f->size);
+        if (sign > 0) {
+            st->count++;
+            st->total_bytes += f->size;
+            st->size_histogram[b]++;
+            if (f->size > st->max_bytes) st->max_bytes = f->size;
+        } else {
+            st->count--;
+            st->total_bytes -= f->size;
+            st->size_histogram[b]--;
+        }
+    }
+}
+
+static void kill_doc(mp3tag_index_t *idx, uint32_t id)
+{
+    index_doc_t *doc = &idx->docs[id];
+    if (!doc->live) return;
+    apply_stats(idx, doc, -1);
+    free(doc->frames);
+    doc->frames      = NULL;
+    doc->frame_count = 0;
+    doc->live        = 0;
+    idx->live_count--;
+}
+
+/*
+ * Drop dead documents: renumber the live ones densely (in order, so
+ * postings stay sorted), filter the postings and forget terms and paths
+ * left without a document, and rebuild the segment blooms. Everything
+ * that can fail is allocated first; on failure the index is unchanged.
+ */
+static int compact(mp3tag_index_t *idx)
+{
+    uint32_t live     = idx->live_count;
+    uint32_t pcap     = idx->posting_count ? idx->posting_count : 1;
+    size_t   segments = ((size_t)live + (1u << INDEX_SEGMENT_SHIFT) - 1)
+                        >> INDEX_SEGMENT_SHIFT;
+
+    uint32_t    *remap = malloc((idx->doc_count ? idx->doc_count : 1) *
+                                sizeof(*remap));
+    const char **atom_names = calloc(idx->atoms.count ? idx->atoms.count : 1,
+                                     sizeof(*atom_names));
+    bloom_t     *blooms = calloc(segments ? segments : 1, sizeof(*blooms));
+    posting_t   *postings = calloc(pcap, sizeof(*postings));
+    uint32_t    *old_posting = malloc(pcap * sizeof(*old_posting));
+    strmap_t     paths = { NULL, 0, 0 }, terms = { NULL, 0, 0 };
+    if (!remap || !atom_names || !blooms || !postings || !old_posting)
+        goto fail;
+
+    uint32_t next = 0;
+    for (uint32_t d = 0; d < idx->doc_count; d++)
+        remap[d] = idx->docs[d].live ? next++ : INDEX_NO_DOC;
+
+    for (uint32_t d = 0; d < idx->doc_count; d++) {
+        int inserted;
+        if (idx->docs[d].live &&
+            !strmap_put(&paths, idx->docs[d].path, remap[d], &inserted))
+            goto fail;
+    }
+
+    uint32_t kept = 0;
+    for (size_t i = 0; i < idx->terms.cap; i++) {
+        const strmap_slot_t *t = &idx->terms.slots[i];
+        if (!t->key) continue;
+        const posting_t *p = &idx->postings[t->value];
+        uint32_t k = 0;
+        while (k < p->count && !idx->docs[p->ids[k]].live) k++;
+        if (k == p->count) continue;
+
+        int inserted;
+        if (!strmap_put(&terms, t->key, kept, &inserted))
+            goto fail;
+        old_posting[kept++] = t->value;
+    }
+
+    /* Commit: nothing below can fail */
+    for (size_t i = 0; i < idx->atoms.cap; i++)
+        if (idx->atoms.slots[i].key)
+            atom_names[idx->atoms.slots[i].value] = idx->atoms.slots[i].key;
+
+    for (uint32_t k = 0; k < kept; k++) {
+        posting_t *p = &idx->postings[old_posting[k]];
+        uint32_t n = 0;
+        for (uint32_t j = 0; j < p->count; j++)
+            if (remap[p->ids[j]] != INDEX_NO_DOC)
+                p->ids[n++] = remap[p->ids[j]];
+        p->count    = n;
+        postings[k] = *p;
+        p->ids      = NULL;
+    }
+    for (uint32_t k = 0; k < idx->posting_count; k++)
+        free(idx->postings[k].ids);
+
+    for (uint32_t d = 0; d < idx->doc_count; d++) {
+        index_doc_t *doc = &idx->docs[d];
+        if (remap[d] == INDEX_NO_DOC) {
+            free(doc->path);
+            continue;
+        }
+        bloom_t *b = &blooms[remap[d] >> INDEX_SEGMENT_SHIFT];
+        for (uint32_t f = 0; f < doc->frame_count; f++)
+            bloom_add(b, hash_str(atom_names[doc->frames[f].atom]));
+        idx->docs[remap[d]] = *doc;
+    }
+    memset(&idx->docs[live], 0,
+           (size_t)(idx->doc_count - live) * sizeof(*idx->docs));
+    idx->doc_count = live;
+
+    free(idx->blooms);
+    idx->blooms      = blooms;
+    idx->bloom_count = segments;
+
+    free(idx->postings);
+    idx->postings      = postings;
+    idx->posting_count = kept;
+    idx->posting_cap   = pcap;
+
+    strmap_free(&idx->terms);
+    idx->terms = terms;
+    strmap_free(&idx->paths);
+    idx->paths = paths;
+
+    free(remap);
+    free(atom_names);
+    free(old_posting);
+    return 0;
+
+fail:
+    strmap_free(&paths);
+    strmap_free(&terms);
+    free(remap);
+    free(atom_names);
+    free(blooms);
+    free(postings);
+    free(old_posting);
+    return -1;
+}
+
+/* Compact when tombstones dominate; a failure just leaves them in place */
+static void maybe_compact(mp3tag_index_t *idx)
+{
+    uint32_t dead = idx->doc_count - idx->live_count;
+    if (dead >= INDEX_COMPACT_MIN && dead > idx->live_count)
+        compact(idx);
+}
+
+static int add_posting(mp3tag_index_t *idx, const char *field,
+                       const char *value, uint32_t doc)
+{
+    char *key = term_key(field, value);
+    if (!key) return -1;
+
+    int inserted;
+    strmap_slot_t *s = strmap_put(&idx->terms, key, idx->posting_count,
+                                  &inserted);
+    free(key);
+    if (!s) return -1;
+    if (inserted) {
+        if (grow_array((void **)&idx->postings, &idx->posting_cap,
+                       idx->posting_count + 1, sizeof(posting_t)) != 0)
+            return -1;
+        idx->posting_count++;
+    }
+
+    posting_t *p = &idx->postings[s->value];
+    if (p->count > 0 && p->ids[p->count - 1] == doc)
+        return 0;  /* Same value twice in one file */
+    if (grow_array((void **)&p->ids, &p->cap, p->count + 1,
+                   sizeof(uint32_t)) != 0)
+        return -1;
+    p->ids[p->count++] = doc;
+    return 0;
+}
+
+static int intern_atom(mp3tag_index_t *idx, const char *name, uint32_t *atom)
+{
+    int inserted;
+    strmap_slot_t *s = strmap_put(&idx->atoms, name,
+                                  (uint32_t)idx->atoms.count, &inserted);
+    if (!s) return -1;
+    if (inserted &&
+        grow_array((void **)&idx->stats, &idx->atom_cap, s->value + 1,
+                   sizeof(mp3tag_frame_stats_t)) != 0)
+        return -1;
+    *atom = s->value;
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_index_t *mp3tag_index_create(void)
+{
+    mp3tag_index_t *idx = calloc(1, sizeof(*idx));
+    if (!idx) return NULL;
+    if (pthread_rwlock_init(&idx->lock, NULL) != 0) {
+        free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+void mp3tag_index_destroy(mp3tag_index_t *idx)
+{
+    if (!idx) return;
+    for (uint32_t i = 0; i < idx->doc_count; i++) {
+        free(idx->docs[i].path);
+        free(idx->docs[i].frames);
+    }
+    for (uint32_t i = 0; i < idx->posting_count; i++)
+        free(idx->postings[i].ids);
+    free(idx->docs);
+    free(idx->blooms);
+    free(idx->postings);
+    free(idx->stats);
+    strmap_free(&idx->paths);
+    strmap_free(&idx->terms);
+    strmap_free(&idx->atoms);
+    pthread_rwlock_destroy(&idx->lock);
+    free(idx);
+}
+
+int mp3tag_index_add(mp3tag_index_t *idx, const char *path,
+                     const mp3tag_collection_t *tags)
+{
+    if (!idx || !path || !tags) return MP3TAG_ERR_INVALID_ARG;
+
+    /* Gather frames outside the lock */
+    size_t nframes = 0;
+    for (const mp3tag_tag_t *t = tags->tags; t; t = t->next)
+        for (const mp3tag_simple_tag_t *st = t->simple_tags; st; st = st->next)
+            if (st->name) nframes++;
+
+    char **names = calloc(nframes ? nframes : 1, sizeof(*names));
+    doc_frame_t *frames = calloc(nframes ? nframes : 1, sizeof(*frames));
+    char *path_copy = str_dup(path);
+    int rc = MP3TAG_ERR_NO_MEMORY;
+    if (!names || !frames || !path_copy) goto out;
+
+    size_t n = 0;
+    for (const mp3tag_tag_t *t = tags->tags; t; t = t->next) {
+        for (const mp3tag_simple_tag_t *st = t->simple_tags; st; st = st->next) {
+            if (!st->name) continue;
+            names[n] = fold_name(st->name);
+            if (!names[n]) goto out;
+            frames[n].size = st->binary ? st->binary_size
+                           : st->value  ? strlen(st->value) : 0;
+            n++;
+        }
+    }
+
+    pthread_rwlock_wrlock(&idx->lock);
+
+    /* Ids run out at INDEX_NO_DOC, the "no document" marker */
+    maybe_compact(idx);
+    if (idx->doc_count == INDEX_NO_DOC &&
+        (idx->live_count == INDEX_NO_DOC || compact(idx) != 0))
+        goto unlock;
+
+    uint32_t id = idx->doc_count;
+    if (grow_array((void **)&idx->docs, &idx->doc_cap, id + 1,
+                   sizeof(index_doc_t)) != 0)
+        goto unlock;
+
+    size_t seg = id >> INDEX_SEGMENT_SHIFT;
+    if (seg >= idx->bloom_count) {
+        bloom_t *b = realloc(idx->blooms, (seg + 1) * sizeof(*b));
+        if (!b) goto unlock;
+        memset(&b[idx->bloom_count], 0,
+               (seg + 1 - idx->bloom_count) * sizeof(*b));
+        idx->blooms      = b;
+        idx->bloom_count = seg + 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (intern_atom(idx, names[i], &frames[i].atom) != 0)
+            goto unlock;
+    }
+
+    /* Replace any previous version of the file */
+    int inserted;
+    strmap_slot_t *ps = strmap_put(&idx->paths, path, id, &inserted);
+    if (!ps) goto unlock;
+    if (!inserted) {
+        if (ps->value != INDEX_NO_DOC)
+            kill_doc(idx, ps->value);
+        ps->value = id;
+    }
+
+    /* From here on the document is committed; posting failures only
+       make it unfindable through that one value. */
+    index_doc_t *doc = &idx->docs[id];
+    doc->path        = path_copy;
+    doc->frames      = frames;
+    doc->frame_count = (uint32_t)n;
+    doc->live        = 1;
+    idx->doc_count++;
+    idx->live_count++;
+    path_copy = NULL;
+    frames    = NULL;
+
+    size_t i = 0;
+    for (const mp3tag_tag_t *t = tags->tags; t; t = t->next) {
+        for (const mp3tag_simple_tag_t *st = t->simple_tags; st; st = st->next) {
+            if (!st->name) continue;
+            bloom_add(&idx->blooms[seg], hash_str(names[i]));
+            if (st->value && is_indexed_field(names[i]))
+                add_posting(idx, names[i], st->value, id);
+            i++;
+        }
+    }
+    apply_stats(idx, doc, 1);
+    rc = MP3TAG_OK;
+
+unlock:
+    pthread_rwlock_unlock(&idx->lock);
+out:
+    if (names) {
+        for (size_t k = 0; k < nframes; k++) free(names[k]);
+        free(names);
+    }
+    free(frames);
+    free(path_copy);
+    return rc;
+}
+
+int mp3tag_index_remove(mp3tag_index_t *idx, const char *path)
+{
+    if (!idx || !path) return MP3TAG_ERR_INVALID_ARG;
+
+    int rc = MP3TAG_ERR_TAG_NOT_FOUND;
+    pthread_rwlock_wrlock(&idx->lock);
+    if (idx->paths.cap) {
+        strmap_slot_t *s = strmap_slot(&idx->paths, path, hash_str(path));
+        if (s->key && s->value != INDEX_NO_DOC) {
+            kill_doc(idx, s->value);
+            s->value = INDEX_NO_DOC;
+            maybe_compact(idx);
+            rc = MP3TAG_OK;
+        }
+    }
+    pthread_rwlock_unlock(&idx->lock);
+    return rc;
+}
+
+size_t mp3tag_index_count(mp3tag_index_t *idx)
+{
+    if (!idx) return 0;
+    pthread_rwlock_rdlock(&idx->lock);
+    size_t n = idx->live_count;
+    pthread_rwlock_unlock(&idx->lock);
+    return n;
+}
+
+int mp3tag_index_find(mp3tag_index_t *idx, const char *field,
+                      const char *value, mp3tag_index_callback_t callback,
+                      void *user_data)
+{
+    if (!idx || !field || !value || !callback) return MP3TAG_ERR_INVALID_ARG;
+
+    char *key = term_key(field, value);
+    if (!key) return MP3TAG_ERR_NO_MEMORY;
+
+    pthread_rwlock_rdlock(&idx->lock);
+    uint32_t p = strmap_get(&idx->terms, key);
+    if (p != INDEX_NO_DOC) {
+        const posting_t *post = &idx->postings[p];
+        for (uint32_t i = 0; i < post->count; i++) {
+            const index_doc_t *doc = &idx->docs[post->ids[i]];
+            if (doc->live && callback(doc->path, user_data) != 0)
+                break;
+        }
+    }
+    pthread_rwlock_unlock(&idx->lock);
+
+    free(key);
+    return MP3TAG_OK;
+}
+
+int mp3tag_index_find_frame(mp3tag_index_t *idx, const char *name,
+                            uint64_t min_size, mp3tag_index_callback_t callback,
+                            void *user_data)
+{
+    if (!idx || !name || !callback) return MP3TAG_ERR_INVALID_ARG;
+
+    char *folded = fold_name(name);
+    if (!folded) return MP3TAG_ERR_NO_MEMORY;
+    uint64_t hash = hash_str(folded);
+
+    pthread_rwlock_rdlock(&idx->lock);
+    uint32_t atom = strmap_get(&idx->atoms, folded);
+    if (atom != INDEX_NO_DOC && idx->stats[atom].count > 0) {
+        int stop = 0;
+        for (size_t seg = 0; seg < idx->bloom_count && !stop; seg++) {
+            if (!bloom_test(&idx->blooms[seg], hash))
+                continue;
+
+            uint32_t first = (uint32_t)(seg << INDEX_SEGMENT_SHIFT);
+            uint32_t last  = first + (1u << INDEX_SEGMENT_SHIFT);
+            if (last > idx->doc_count) last = idx->doc_count;
+
+            for (uint32_t d = first; d < last && !stop; d++) {
+                const index_doc_t *doc = &idx->docs[d];
+                for (uint32_t f = 0; f < doc->frame_count; f++) {
+                    if (doc->frames[f].atom == atom &&
+                        doc->frames[f].size >= min_size) {
+                        stop = callback(doc->path, user_data) != 0;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    pthread_rwlock_unlock(&idx->lock);
+
+    free(folded);
+    return MP3TAG_OK;
+}
+
+int mp3tag_index_frame_stats(mp3tag_index_t *idx, const char *name,
+                             mp3tag_frame_stats_t *stats)
+{
+    if (!idx || !name || !stats) return MP3TAG_ERR_INVALID_ARG;
+
+    char *folded = fold_name(name);
+    if (!folded) return MP3TAG_ERR_NO_MEMORY;
+
+    int rc = MP3TAG_ERR_TAG_NOT_FOUND;
+    pthread_rwlock_rdlock(&idx->lock);
+    uint32_t atom = strmap_get(&idx->atoms, folded);
+    if (atom != INDEX_NO_DOC) {
+        *stats = idx->stats[atom];
+        rc = MP3TAG_OK;
+    }
+    pthread_rwlock_unlock(&idx->lock);
+
+    free(folded);
+    return rc;
+}
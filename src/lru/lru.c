@@ -0,0 +1,389 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Shared in-memory cache of immutable snapshots, bounded by bytes.
+ *
+ * Readers never lock: they announce the current epoch in a reader slot,
+ * walk an atomic bucket chain, take a reference on the snapshot they
+ * find and leave. Writers serialise on a mutex, publish new entries with
+ * release stores and retire the entries they unlink; a retired entry is
+ * freed only once every announced reader epoch is newer than the epoch
+ * it was retired in. Replacement is approximate LRU (CLOCK): readers set
+ * a reference bit, the eviction hand clears it once before evicting.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lru.h"
+#include "../snapshot/snapshot.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include "../mp3tag_internal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LRU_READER_SLOTS  128
+#define LRU_MIN_BUCKETS   256
+#define LRU_MAX_BUCKETS   (1u << 20)
+
+/* Typical bytes per cached collection, used to size the bucket array */
+#define LRU_BYTES_PER_ENTRY 4096
+
+typedef struct lru_entry {
+    file_identity_t              id;
+    mp3tag_snapshot_t           *snap;       /* One reference held */
+    atomic_int                   referenced; /* CLOCK bit */
+    _Atomic(struct lru_entry *)  next;       /* Bucket chain */
+
+    /* Writer-side only (under lock) */
+    struct lru_entry            *ring_prev;
+    struct lru_entry            *ring_next;
+    uint64_t                     retired_at;
+    struct lru_entry            *retired_next;
+} lru_entry_t;
+
+struct mp3tag_lru {
+    _Atomic(lru_entry_t *)  *buckets;
+    size_t                   nbuckets;        /* Power of two */
+
+    pthread_mutex_t          lock;            /* Writers */
+    size_t                   max_bytes;
+    size_t                   bytes;
+    size_t                   count;
+    lru_entry_t             *hand;            /* CLOCK ring position */
+    lru_entry_t             *retired;
+
+    atomic_uint_fast64_t     epoch;
+    atomic_uint_fast64_t     readers[LRU_READER_SLOTS];  /* 0 = free */
+
+    atomic_uint_fast64_t     hits;
+    atomic_uint_fast64_t     misses;
+    atomic_uint_fast64_t     evictions;
+};
+
+/* ------------------------------------------------------------------ */
+/*  Reader epochs                                                      */
+/* ------------------------------------------------------------------ */
+
+static size_t slot_hint(void)
+{
+    static _Thread_local size_t hint;
+    static atomic_size_t next_hint;
+    if (hint == 0)
+        hint = atomic_fetch_add(&next_hint, 1) + 1;
+    return hint;
+}
+
+/* Returns the claimed slot, or -1 if every slot is busy */
+static int reader_enter(mp3tag_lru_t *lru)
+{
+    uint_fast64_t e = atomic_load(&lru->epoch);
+    size_t start = slot_hint();
+    for (size_t i = 0; i < LRU_READER_SLOTS; i++) {
+        size_t s = (start + i) % LRU_READER_SLOTS;
+        uint_fast64_t expected = 0;
+        if (atomic_compare_exchange_strong(&lru->readers[s], &expected, e))
+            return (int)s;
+    }
+    return -1;
+}
+
+static void reader_exit(mp3tag_lru_t *lru, int slot)
+{
+    atomic_store(&lru->readers[slot], 0);
+}
+
+/* Free retired entries no reader can still reach. Caller holds lock. */
+static void reclaim(mp3tag_lru_t *lru)
+{
+    uint_fast64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < LRU_READER_SLOTS; i++) {
+        uint_fast64_t e = atomic_load(&lru->readers[i]);
+        if (e != 0 && e < oldest) oldest = e;
+    }
+
+    lru_entry_t **pp = &lru->retired;
+    while (*pp) {
+        lru_entry_t *e = *pp;
+        if (e->retired_at < oldest) {
+            *pp = e->retired_next;
+            mp3tag_snapshot_release(e->snap);
+            free(e);
+        } else {
+            pp = &e->retired_next;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Writer helpers (lock held)                                         */
+/* ------------------------------------------------------------------ */
+
+static _Atomic(lru_entry_t *) *bucket_for(mp3tag_lru_t *lru, uint64_t dev,
+                                          uint64_t ino)
+{
+    uint64_t h = (ino * 0x9e3779b97f4a7c15ull) ^ dev;
+    h ^= h >> 29;
+    return &lru->buckets[h & (lru->nbuckets - 1)];
+}
+
+static void ring_insert(mp3tag_lru_t *lru, lru_entry_t *e)
+{
+    if (!lru->hand) {
+        e->ring_prev = e->ring_next = e;
+        lru->hand = e;
+        return;
+    }
+    /* Just behind the hand: the last place it will look */
+    e->ring_next = lru->hand;
+    e->ring_prev = lru->hand->ring_prev;
+    e->ring_prev->ring_next = e;
+    lru->hand->ring_prev = e;
+}
+
+static void ring_remove(mp3tag_lru_t *lru, lru_entry_t *e)
+{
+    if (e->ring_next == e) {
+        lru->hand = NULL;
+    } else {
+        e->ring_prev->ring_next = e->ring_next;
+        e->ring_next->ring_prev = e->ring_prev;
+        if (lru->hand == e) lru->hand = e->ring_next;
+    }
+}
+
+/* Unlink `e` from its bucket and the ring and queue it for reclamation */
+static void retire(mp3tag_lru_t *lru, lru_entry_t *e)
+{
+    _Atomic(lru_entry_t *) *pp = bucket_for(lru, e->id.dev, e->id.ino);
+    lru_entry_t *cur;
+    while ((cur = atomic_load(pp)) != e)
+        pp = &cur->next;
+    atomic_store_explicit(pp, atomic_load(&e->next), memory_order_release);
+
+    ring_remove(lru, e);
+    lru->bytes -= e->snap->bytes;
+    lru->count--;
+
+    e->retired_at   = atomic_fetch_add(&lru->epoch, 1);
+    e->retired_next = lru->retired;
+    lru->retired    = e;
+}
+
+static lru_entry_t *find_locked(mp3tag_lru_t *lru, uint64_t dev, uint64_t ino)
+{
+    for (lru_entry_t *e = atomic_load(bucket_for(lru, dev, ino)); e;
+         e = atomic_load(&e->next)) {
+        if (e->id.dev == dev && e->id.ino == ino)
+            return e;
+    }
+    return NULL;
+}
+
+static void evict(mp3tag_lru_t *lru)
+{
+    while (lru->bytes > lru->max_bytes && lru->hand) {
+        lru_entry_t *e = lru->hand;
+        if (atomic_exchange(&e->referenced, 0)) {
+            lru->hand = e->ring_next;
+            continue;
+        }
+        retire(lru, e);
+        atomic_fetch_add(&lru->evictions, 1);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Internal API                                                       */
+/* ------------------------------------------------------------------ */
+
+mp3tag_snapshot_t *lru_find(mp3tag_lru_t *lru, const file_identity_t *id)
+{
+    int slot = reader_enter(lru);
+    if (slot < 0)
+        pthread_mutex_lock(&lru->lock);  /* Out of slots: exclude writers */
+
+    mp3tag_snapshot_t *snap = NULL;
+    for (lru_entry_t *e = atomic_load_explicit(bucket_for(lru, id->dev, id->ino),
+                                               memory_order_acquire);
+         e; e = atomic_load_explicit(&e->next, memory_order_acquire)) {
+        if (e->id.dev != id->dev || e->id.ino != id->ino)
+            continue;
+        if (e->id.size == id->size && e->id.mtime_ns == id->mtime_ns) {
+            snap = snapshot_retain(e->snap);
+            atomic_store_explicit(&e->referenced, 1, memory_order_relaxed);
+        }
+        break;
+    }
+
+    if (slot < 0)
+        pthread_mutex_unlock(&lru->lock);
+    else
+        reader_exit(lru, slot);
+
+    atomic_fetch_add_explicit(snap ? &lru->hits : &lru->misses, 1,
+                              memory_order_relaxed);
+    return snap;
+}
+
+void lru_publish(mp3tag_lru_t *lru, const file_identity_t *id,
+                 mp3tag_snapshot_t *snap)
+{
+    pthread_mutex_lock(&lru->lock);
+
+    lru_entry_t *prev = find_locked(lru, id->dev, id->ino);
+    if (prev) retire(lru, prev);
+
+    lru_entry_t *e = NULL;
+    if (snap->bytes <= lru->max_bytes)
+        e = calloc(1, sizeof(*e));
+    if (e) {
+        e->id   = *id;
+        e->snap = snap;
+        atomic_init(&e->referenced, 1);
+        _Atomic(lru_entry_t *) *head = bucket_for(lru, id->dev, id->ino);
+        atomic_init(&e->next, atomic_load(head));
+        ring_insert(lru, e);
+        lru->bytes += snap->bytes;
+        lru->count++;
+        atomic_store_explicit(head, e, memory_order_release);
+        evict(lru);
+    } else {
+        mp3tag_snapshot_release(snap);  /* Too large to keep */
+    }
+
+    reclaim(lru);
+    pthread_mutex_unlock(&lru->lock);
+}
+
+void lru_forget(mp3tag_lru_t *lru, const file_identity_t *id)
+{
+    pthread_mutex_lock(&lru->lock);
+    lru_entry_t *e = find_locked(lru, id->dev, id->ino);
+    if (e) retire(lru, e);
+    reclaim(lru);
+    pthread_mutex_unlock(&lru->lock);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_lru_t *mp3tag_lru_create(size_t max_bytes)
+{
+    mp3tag_lru_t *lru = calloc(1, sizeof(*lru));
+    if (!lru) return NULL;
+
+    size_t want = max_bytes / LRU_BYTES_PER_ENTRY;
+    size_t n = LRU_MIN_BUCKETS;
+    while (n < want && n < LRU_MAX_BUCKETS) n *= 2;
+
+    lru->buckets = calloc(n, sizeof(*lru->buckets));
+    if (!lru->buckets) {
+        free(lru);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++)
+        atomic_init(&lru->buckets[i], NULL);
+    for (size_t i = 0; i < LRU_READER_SLOTS; i++)
+        atomic_init(&lru->readers[i], 0);
+
+    lru->nbuckets  = n;
+    lru->max_bytes = max_bytes;
+    atomic_init(&lru->epoch, 1);
+    atomic_init(&lru->hits, 0);
+    atomic_init(&lru->misses, 0);
+    atomic_init(&lru->evictions, 0);
+    pthread_mutex_init(&lru->lock, NULL);
+    return lru;
+}
+
+void mp3tag_lru_destroy(mp3tag_lru_t *lru)
+{
+    if (!lru) return;
+
+    while (lru->hand)
+        retire(lru, lru->hand);
+    reclaim(lru);  /* No readers may remain */
+
+    pthread_mutex_destroy(&lru->lock);
+    free(lru->buckets);
+    free(lru);
+}
+
+mp3tag_snapshot_t *mp3tag_lru_get(mp3tag_lru_t *lru, const char *path)
+{
+    if (!lru || !path) return NULL;
+
+    file_identity_t id;
+    if (cache_identity(path, &id) != 0) return NULL;
+    return lru_find(lru, &id);
+}
+
+int mp3tag_lru_load(mp3tag_lru_t *lru, mp3tag_context_t *ctx,
+                    const char *path, mp3tag_snapshot_t **snap)
+{
+    if (!lru || !ctx || !path || !snap) return MP3TAG_ERR_INVALID_ARG;
+    *snap = NULL;
+
+    file_identity_t id;
+    if (cache_identity(path, &id) != 0) return MP3TAG_ERR_IO;
+
+    *snap = lru_find(lru, &id);
+    if (*snap) return MP3TAG_OK;
+
+    /* The snapshot outlives the context's hold on the file */
+    mp3tag_snapshot_t *s = NULL;
+    int rc = mp3tag_open(ctx, path);
+    if (rc == MP3TAG_OK)
+        rc = mp3tag_snapshot_acquire(ctx, &s);
+    mp3tag_close(ctx);
+    if (rc != MP3TAG_OK) return rc;
+
+    /* A context attached to this cache has published it already */
+    if (ctx->lru != lru)
+        lru_publish(lru, &id, snapshot_retain(s));
+    *snap = s;
+    return MP3TAG_OK;
+}
+
+int mp3tag_lru_publish(mp3tag_lru_t *lru, const char *path,
+                       const mp3tag_collection_t *tags)
+{
+    if (!lru || !path || !tags) return MP3TAG_ERR_INVALID_ARG;
+
+    file_identity_t id;
+    if (cache_identity(path, &id) != 0) return MP3TAG_ERR_IO;
+
+    mp3tag_snapshot_t *s = snapshot_copy(tags);
+    if (!s) return MP3TAG_ERR_NO_MEMORY;
+
+    lru_publish(lru, &id, s);
+    return MP3TAG_OK;
+}
+
+void mp3tag_lru_invalidate(mp3tag_lru_t *lru, const char *path)
+{
+    if (!lru || !path) return;
+
+    file_identity_t id;
+    if (cache_identity(path, &id) == 0)
+        lru_forget(lru, &id);
+}
+
+void mp3tag_lru_get_stats(mp3tag_lru_t *lru, mp3tag_lru_stats_t *stats)
+{
+    if (!lru || !stats) return;
+
+    pthread_mutex_lock(&lru->lock);
+    stats->entries = lru->count;
+    stats->bytes   = lru->bytes;
+    pthread_mutex_unlock(&lru->lock);
+
+    stats->hits      = atomic_load(&lru->hits);
+    stats->misses    = atomic_load(&lru->misses);
+    stats->evictions = atomic_load(&lru->evictions);
+}
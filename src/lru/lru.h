@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef LRU_H
+#define LRU_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include "../cache/cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Look up a file version. Returns a new reference to its snapshot, or
+ * NULL. Lock-free.
+ */
+mp3tag_snapshot_t *lru_find(mp3tag_lru_t *lru, const file_identity_t *id);
+
+/*
+ * Publish `snap` as the current version of file `id`, taking over the
+ * caller's reference. Any entry for the same file is retired.
+ */
+void lru_publish(mp3tag_lru_t *lru, const file_identity_t *id,
+                 mp3tag_snapshot_t *snap);
+
+/*
+ * Retire the entry for file `id`, if any.
+ */
+void lru_forget(mp3tag_lru_t *lru, const file_identity_t *id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LRU_H */
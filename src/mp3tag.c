@@ -2,11 +2,15 @@
 /* Copyright (c) 2025 Morgan Prior */
 
 #include "../include/mp3tag/mp3tag.h"
+#include "mp3tag_internal.h"
 #include "id3v2/id3v2_reader.h"
 #include "id3v2/id3v2_writer.h"
 #include "id3v2/id3v2_defs.h"
 #include "id3v1/id3v1.h"
 #include "container/container.h"
+#include "lru/lru.h"
+#include "snapshot/snapshot.h"
+#include "stats/stats.h"
 #include <tag_common/file_io.h>
 #include <tag_common/buffer.h>
 #include <tag_common/string_util.h>
@@ -16,33 +20,6 @@
 #include <stdio.h>
 #include <unistd.h>
 
-/* ------------------------------------------------------------------ */
-/*  Internal context definition                                        */
-/* ------------------------------------------------------------------ */
-
-struct mp3tag_context {
-    mp3tag_allocator_t  allocator;
-    int                 has_allocator;
-
-    file_handle_t      *fh;
-    char               *path;
-    int                 writable;
-
-    /* Container format info */
-    container_info_t    container;
-
-    /* Parsed file structure */
-    int                 has_id3v2;
-    id3v2_header_t      id3v2_hdr;
-    int64_t             id3v2_offset;  /* File offset of ID3v2 header */
-    int64_t             audio_offset;  /* First byte of audio (raw streams only) */
-
-    int                 has_id3v1;
-
-    /* Cached tag collection (owned by context) */
-    mp3tag_collection_t *cached_tags;
-};
-
 /* ------------------------------------------------------------------ */
 /*  Collection / tag freeing                                           */
 /* ------------------------------------------------------------------ */
@@ -51,12 +28,12 @@ static void free_simple_tags(mp3tag_simple_tag_t *st)
 {
     while (st) {
         mp3tag_simple_tag_t *next = st->next;
-        free(st->name);
-        free(st->value);
-        free(st->binary);
-        free(st->language);
+        mem_free(st->name);
+        mem_free(st->value);
+        mem_free(st->binary);
+        mem_free(st->language);
         free_simple_tags(st->nested);
-        free(st);
+        mem_free(st);
         st = next;
     }
 }
@@ -65,13 +42,13 @@ static void free_tag(mp3tag_tag_t *tag)
 {
     while (tag) {
         mp3tag_tag_t *next = tag->next;
-        free(tag->target_type_str);
-        free(tag->track_uids);
-        free(tag->edition_uids);
-        free(tag->chapter_uids);
-        free(tag->attachment_uids);
+        mem_free(tag->target_type_str);
+        mem_free(tag->track_uids);
+        mem_free(tag->edition_uids);
+        mem_free(tag->chapter_uids);
+        mem_free(tag->attachment_uids);
         free_simple_tags(tag->simple_tags);
-        free(tag);
+        mem_free(tag);
         tag = next;
     }
 }
@@ -80,17 +57,39 @@ static void free_collection(mp3tag_collection_t *coll)
 {
     if (!coll) return;
     free_tag(coll->tags);
-    free(coll);
+    mem_free(coll);
 }
 
 static void invalidate_cache(mp3tag_context_t *ctx)
 {
-    if (ctx->cached_tags) {
+    if (ctx->snapshot) {
+        /* Other holders keep the collection alive */
+        mp3tag_snapshot_release(ctx->snapshot);
+        ctx->snapshot    = NULL;
+        ctx->cached_tags = NULL;
+    } else if (ctx->cached_tags) {
         free_collection(ctx->cached_tags);
         ctx->cached_tags = NULL;
     }
 }
 
+/* Share the cached collection as a snapshot (the context keeps one ref) */
+static mp3tag_snapshot_t *ctx_snapshot(mp3tag_context_t *ctx)
+{
+    if (!ctx->snapshot && ctx->cached_tags)
+        ctx->snapshot = snapshot_wrap(ctx->cached_tags);
+    return ctx->snapshot;
+}
+
+mp3tag_collection_t *ctx_detach_tags(mp3tag_context_t *ctx)
+{
+    mp3tag_collection_t *coll = ctx->cached_tags;
+    mp3tag_snapshot_t *snap = ctx->snapshot;
+    ctx->cached_tags = NULL;
+    ctx->snapshot    = NULL;
+    return snap ? snapshot_unwrap(snap) : coll;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Version / Error                                                    */
 /* ------------------------------------------------------------------ */
@@ -122,6 +121,7 @@ const char *mp3tag_strerror(int error)
     case MP3TAG_ERR_WRITE_FAILED:  return "Write operation failed";
     case MP3TAG_ERR_SEEK_FAILED:   return "Seek operation failed";
     case MP3TAG_ERR_RENAME_FAILED: return "File rename failed";
+    case MP3TAG_ERR_WORKER_CRASHED: return "Worker process crashed";
     default:                       return "Unknown error";
     }
 }
@@ -142,8 +142,11 @@ mp3tag_context_t *mp3tag_create(const mp3tag_allocator_t *allocator)
         ctx->has_allocator = 1;
     } else {
         ctx = calloc(1, sizeof(*ctx));
+        if (!ctx) return NULL;
     }
 
+    ctx->padding = ID3V2_DEFAULT_PADDING;
+    ctx->fsync   = 1;
     return ctx;
 }
 
@@ -155,19 +158,24 @@ void mp3tag_destroy(mp3tag_context_t *ctx)
     if (ctx->has_allocator && ctx->allocator.free)
         ctx->allocator.free(ctx, ctx->allocator.user_data);
     else
-        free(ctx);
+        mem_free(ctx);
 }
 
-static int probe_file(mp3tag_context_t *ctx)
+static int probe_layout(mp3tag_context_t *ctx)
 {
     /* Detect container format (AIFF, WAV, or raw stream) */
+    uint64_t io_before = trace_io_bytes();
+    TRACE_BEGIN(MP3TAG_PHASE_CONTAINER_DETECT);
     int rc = container_detect(ctx->fh, &ctx->container);
+    TRACE_END(MP3TAG_PHASE_CONTAINER_DETECT, trace_io_bytes() - io_before);
     if (rc != MP3TAG_OK)
         return rc;
 
     if (ctx->container.type == CONTAINER_NONE) {
         /* Raw stream (MP3, AAC, etc.) — ID3v2 is prepended at offset 0 */
+        TRACE_BEGIN(MP3TAG_PHASE_ID3V2_HEADER);
         rc = id3v2_read_header(ctx->fh, 0, &ctx->id3v2_hdr);
+        TRACE_END(MP3TAG_PHASE_ID3V2_HEADER, ID3V2_HEADER_SIZE);
         if (rc == MP3TAG_OK) {
             ctx->has_id3v2    = 1;
             ctx->id3v2_offset = 0;
@@ -188,9 +196,11 @@ static int probe_file(mp3tag_context_t *ctx)
         ctx->has_id3v1 = 0;
 
         if (ctx->container.has_id3_chunk) {
+            TRACE_BEGIN(MP3TAG_PHASE_ID3V2_HEADER);
             rc = id3v2_read_header(ctx->fh,
                                    ctx->container.id3_chunk_data_offset,
                                    &ctx->id3v2_hdr);
+            TRACE_END(MP3TAG_PHASE_ID3V2_HEADER, ID3V2_HEADER_SIZE);
             if (rc == MP3TAG_OK) {
                 ctx->has_id3v2    = 1;
                 ctx->id3v2_offset = ctx->container.id3_chunk_data_offset;
@@ -205,48 +215,215 @@ static int probe_file(mp3tag_context_t *ctx)
     return MP3TAG_OK;
 }
 
-int mp3tag_open(mp3tag_context_t *ctx, const char *path)
+static int probe_file(mp3tag_context_t *ctx)
 {
-    if (!ctx || !path)           return MP3TAG_ERR_INVALID_ARG;
-    if (ctx->fh)                 return MP3TAG_ERR_ALREADY_OPEN;
+    MP3TAG_PROBE1(probe__start, ctx);
+    int rc = probe_layout(ctx);
+    MP3TAG_PROBE4(probe__done, ctx, rc, (int)ctx->container.type,
+                  ctx->has_id3v2 ? ctx->id3v2_hdr.tag_size : 0);
+    return rc;
+}
 
-    ctx->fh = file_open_read(path);
-    if (!ctx->fh)                return MP3TAG_ERR_IO;
+/* ------------------------------------------------------------------ */
+/*  Persistent cache glue                                              */
+/* ------------------------------------------------------------------ */
 
-    ctx->path     = str_dup(path);
-    ctx->writable = 0;
+static void save_probe(const mp3tag_context_t *ctx, cache_probe_t *probe)
+{
+    probe->container    = ctx->container;
+    probe->has_id3v2    = ctx->has_id3v2;
+    probe->id3v2_hdr    = ctx->id3v2_hdr;
+    probe->id3v2_offset = ctx->id3v2_offset;
+    probe->audio_offset = ctx->audio_offset;
+    probe->has_id3v1    = ctx->has_id3v1;
+}
 
-    return probe_file(ctx);
+static void restore_probe(mp3tag_context_t *ctx, const cache_probe_t *probe)
+{
+    ctx->container    = probe->container;
+    ctx->has_id3v2    = probe->has_id3v2;
+    ctx->id3v2_hdr    = probe->id3v2_hdr;
+    ctx->id3v2_offset = probe->id3v2_offset;
+    ctx->audio_offset = probe->audio_offset;
+    ctx->has_id3v1    = probe->has_id3v1;
 }
 
-int mp3tag_open_rw(mp3tag_context_t *ctx, const char *path)
+static void cache_update(mp3tag_context_t *ctx, cache_tag_state_t state)
+{
+    if (!ctx->cache || !ctx->has_identity) return;
+
+    cache_probe_t probe;
+    save_probe(ctx, &probe);
+    cache_store(ctx->cache, &ctx->identity, &probe, state, ctx->cached_tags);
+}
+
+/*
+ * Record the version the handle holds, from an fstat() of it. With a
+ * cache attached the path is stat()ed too: if it names another file by
+ * now, the handle may hold a replaced one, so no identity is recorded
+ * and nothing is cached under it (mp3tag_revalidate() reopens).
+ */
+static void record_identity(mp3tag_context_t *ctx)
+{
+    file_identity_t named;
+    ctx->has_identity = ctx->fh &&
+                        cache_identity_of(ctx->fh, &ctx->identity) == 0;
+    if (ctx->has_identity && ctx->cache)
+        ctx->has_identity = cache_identity(ctx->path, &named) == 0 &&
+                            named.dev == ctx->identity.dev &&
+                            named.ino == ctx->identity.ino;
+}
+
+/*
+ * Probe the freshly opened file, or restore the probe (and tags) from
+ * the attached cache when the file's identity is unchanged. The identity
+ * is recorded either way for mp3tag_revalidate().
+ */
+static int probe_or_restore(mp3tag_context_t *ctx)
+{
+    record_identity(ctx);
+    if (ctx->cache && ctx->has_identity) {
+        cache_probe_t probe;
+        cache_tag_state_t state;
+        mp3tag_collection_t *tags = NULL;
+        if (cache_lookup(ctx->cache, &ctx->identity,
+                         &probe, &state, &tags) == MP3TAG_OK) {
+            restore_probe(ctx, &probe);
+            ctx->cached_tags = tags;
+            ctx->tags_absent = (state == CACHE_TAGS_NONE);
+            return MP3TAG_OK;
+        }
+    }
+
+    int rc = probe_file(ctx);
+    if (rc == MP3TAG_OK)
+        cache_update(ctx, CACHE_TAGS_UNKNOWN);
+    return rc;
+}
+
+/*
+ * After a write the cached version of the file is stale: forget it and
+ * record the new identity with the re-probed structure.
+ */
+static void cache_after_write(mp3tag_context_t *ctx)
+{
+    if (ctx->cache && ctx->has_identity)
+        cache_remove(ctx->cache, &ctx->identity);
+    ctx->tags_absent = 0;
+    record_identity(ctx);
+    cache_update(ctx, CACHE_TAGS_UNKNOWN);
+}
+
+int mp3tag_set_cache(mp3tag_context_t *ctx, mp3tag_cache_t *cache)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->cache = cache;
+    return MP3TAG_OK;
+}
+
+int mp3tag_set_lru(mp3tag_context_t *ctx, mp3tag_lru_t *lru)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->lru = lru;
+    return MP3TAG_OK;
+}
+
+/* Offer the freshly parsed collection to the shared snapshot cache */
+static void lru_share(mp3tag_context_t *ctx)
+{
+    if (!ctx->lru || !ctx->has_identity) return;
+
+    mp3tag_snapshot_t *snap = ctx_snapshot(ctx);
+    if (snap)
+        lru_publish(ctx->lru, &ctx->identity, snapshot_retain(snap));
+}
+
+/*
+ * Share the new file version without reading it back: the collection a
+ * parse of the written `frames` yields (serializing drops what ID3v2
+ * cannot hold). Retires the entry for `before` (the identity prior to
+ * the write) if the write replaced the file.
+ */
+static void lru_after_write(mp3tag_context_t *ctx, const dyn_buffer_t *frames,
+                            const file_identity_t *before)
+{
+    if (ctx->has_identity) {
+        id3v2_frame_t *list = NULL;
+        mp3tag_collection_t *coll = NULL;
+        if (id3v2_parse_frames(frames->data, frames->size,
+                               &list) == MP3TAG_OK &&
+            id3v2_frames_to_collection(list, &coll) == MP3TAG_OK) {
+            ctx->cached_tags = coll;
+            cache_update(ctx, CACHE_TAGS_PRESENT);
+            lru_share(ctx);
+        }
+        id3v2_free_frames(list);
+    }
+
+    if (before && (!ctx->has_identity ||
+                   before->dev != ctx->identity.dev ||
+                   before->ino != ctx->identity.ino))
+        lru_forget(ctx->lru, before);
+}
+
+static int open_file(mp3tag_context_t *ctx, const char *path, int writable)
 {
     if (!ctx || !path)           return MP3TAG_ERR_INVALID_ARG;
     if (ctx->fh)                 return MP3TAG_ERR_ALREADY_OPEN;
 
-    ctx->fh = file_open_rw(path);
-    if (!ctx->fh)                return MP3TAG_ERR_IO;
+    perf_sample_t ps;
+    if (ctx->perf) perf_begin(ctx->perf, &ps);
+    uint64_t t0 = ctx->stats.metrics ? stats_now_ns() : 0;
+    stats_scope_t *prev = stats_enter(&ctx->stats);
+    int rc = MP3TAG_ERR_IO;
+    MP3TAG_PROBE3(open__start, ctx, path, writable);
+
+    ctx->fh = writable ? io_open_rw(path) : io_open_read(path);
+    if (ctx->fh) {
+        ctx->path     = mem_strdup(ALLOC_PATH, path);
+        ctx->writable = writable;
+        rc = probe_or_restore(ctx);
+    }
+
+    MP3TAG_PROBE4(open__done, ctx, rc, ctx->stats.counters.bytes_read,
+                  ctx->stats.counters.bytes_written);
+    stats_leave(prev);
+    if (ctx->perf) perf_end(ctx->perf, MP3TAG_PERF_OP_OPEN, &ps);
+    if (ctx->stats.metrics)
+        metrics_op(ctx->stats.metrics, METRICS_OP_OPEN, rc, t0);
+    return rc;
+}
 
-    ctx->path     = str_dup(path);
-    ctx->writable = 1;
+int mp3tag_open(mp3tag_context_t *ctx, const char *path)
+{
+    return open_file(ctx, path, 0);
+}
 
-    return probe_file(ctx);
+int mp3tag_open_rw(mp3tag_context_t *ctx, const char *path)
+{
+    return open_file(ctx, path, 1);
 }
 
 void mp3tag_close(mp3tag_context_t *ctx)
 {
     if (!ctx) return;
+    stats_scope_t *prev = stats_enter(&ctx->stats);
     invalidate_cache(ctx);
     if (ctx->fh) {
-        file_close(ctx->fh);
+        io_close(ctx->fh);
         ctx->fh = NULL;
+        MP3TAG_PROBE4(close, ctx, ctx->path, ctx->stats.counters.bytes_read,
+                      ctx->stats.counters.bytes_written);
     }
-    free(ctx->path);
+    mem_free(ctx->path);
     ctx->path       = NULL;
     ctx->writable   = 0;
     ctx->has_id3v2  = 0;
     ctx->has_id3v1  = 0;
+    ctx->has_identity = 0;
+    ctx->tags_absent  = 0;
     memset(&ctx->container, 0, sizeof(ctx->container));
+    stats_leave(prev);
 }
 
 int mp3tag_is_open(const mp3tag_context_t *ctx)
@@ -254,11 +431,48 @@ int mp3tag_is_open(const mp3tag_context_t *ctx)
     return (ctx && ctx->fh) ? 1 : 0;
 }
 
+static int revalidate(mp3tag_context_t *ctx)
+{
+    if (!ctx)     return MP3TAG_ERR_INVALID_ARG;
+    if (!ctx->fh) return MP3TAG_ERR_NOT_OPEN;
+
+    file_identity_t now;
+    if (cache_identity(ctx->path, &now) != 0)
+        return MP3TAG_ERR_IO;
+    if (ctx->has_identity && cache_identity_same(&ctx->identity, &now))
+        return 0;
+
+    /* Replaced under us: the handle still refers to the old inode */
+    if (!ctx->has_identity ||
+        now.dev != ctx->identity.dev || now.ino != ctx->identity.ino) {
+        file_handle_t *fh = ctx->writable ? io_open_rw(ctx->path)
+                                          : io_open_read(ctx->path);
+        if (!fh) return MP3TAG_ERR_IO;
+        io_close(ctx->fh);
+        ctx->fh = fh;
+    }
+
+    invalidate_cache(ctx);
+    ctx->tags_absent = 0;
+    int rc = probe_or_restore(ctx);
+    return rc == MP3TAG_OK ? 1 : rc;
+}
+
+int mp3tag_revalidate(mp3tag_context_t *ctx)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+
+    stats_scope_t *prev = stats_enter(&ctx->stats);
+    int rc = revalidate(ctx);
+    stats_leave(prev);
+    return rc;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Tag reading                                                        */
 /* ------------------------------------------------------------------ */
 
-int mp3tag_read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags)
+static int read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags)
 {
     if (!ctx || !tags)     return MP3TAG_ERR_INVALID_ARG;
     if (!ctx->fh)          return MP3TAG_ERR_NOT_OPEN;
@@ -268,22 +482,45 @@ int mp3tag_read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags)
         *tags = ctx->cached_tags;
         return MP3TAG_OK;
     }
+    if (ctx->tags_absent)
+        return MP3TAG_ERR_NO_TAGS;
+
+    /* Another context may already have parsed this file version */
+    if (ctx->lru && ctx->has_identity) {
+        mp3tag_snapshot_t *snap = lru_find(ctx->lru, &ctx->identity);
+        if (snap) {
+            ctx->snapshot    = snap;
+            ctx->cached_tags = snap->coll;
+            *tags = ctx->cached_tags;
+            return MP3TAG_OK;
+        }
+    }
 
     /* Try ID3v2 first */
     if (ctx->has_id3v2) {
         id3v2_frame_t *frames = NULL;
+        TRACE_BEGIN(MP3TAG_PHASE_ID3V2_FRAMES);
         int rc = id3v2_read_frames(ctx->fh, ctx->id3v2_offset,
                                    &ctx->id3v2_hdr, &frames);
+        TRACE_END(MP3TAG_PHASE_ID3V2_FRAMES, ctx->id3v2_hdr.tag_size);
         if (rc != MP3TAG_OK)
             return rc;
 
+        uint64_t frame_bytes = 0;
+        for (const id3v2_frame_t *f = frames; f; f = f->next)
+            frame_bytes += f->data_size;
+
         mp3tag_collection_t *coll = NULL;
+        TRACE_BEGIN(MP3TAG_PHASE_FRAMES_TO_COLLECTION);
         rc = id3v2_frames_to_collection(frames, &coll);
+        TRACE_END(MP3TAG_PHASE_FRAMES_TO_COLLECTION, frame_bytes);
         id3v2_free_frames(frames);
         if (rc != MP3TAG_OK)
             return rc;
 
         ctx->cached_tags = coll;
+        cache_update(ctx, CACHE_TAGS_PRESENT);
+        lru_share(ctx);
         *tags = coll;
         return MP3TAG_OK;
     }
@@ -296,13 +533,50 @@ int mp3tag_read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags)
             return rc;
 
         ctx->cached_tags = coll;
+        cache_update(ctx, CACHE_TAGS_PRESENT);
+        lru_share(ctx);
         *tags = coll;
         return MP3TAG_OK;
     }
 
+    cache_update(ctx, CACHE_TAGS_NONE);
     return MP3TAG_ERR_NO_TAGS;
 }
 
+int mp3tag_read_tags(mp3tag_context_t *ctx, mp3tag_collection_t **tags)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+
+    perf_sample_t ps;
+    if (ctx->perf) perf_begin(ctx->perf, &ps);
+    uint64_t t0 = ctx->stats.metrics ? stats_now_ns() : 0;
+    stats_scope_t *prev = stats_enter(&ctx->stats);
+    MP3TAG_PROBE1(read__start, ctx);
+    int rc = read_tags(ctx, tags);
+    MP3TAG_PROBE2(read__done, ctx, rc);
+    stats_leave(prev);
+    if (ctx->perf) perf_end(ctx->perf, MP3TAG_PERF_OP_READ, &ps);
+    if (ctx->stats.metrics)
+        metrics_op(ctx->stats.metrics, METRICS_OP_READ, rc, t0);
+    return rc;
+}
+
+int mp3tag_snapshot_acquire(mp3tag_context_t *ctx, mp3tag_snapshot_t **snap)
+{
+    if (!ctx || !snap) return MP3TAG_ERR_INVALID_ARG;
+    *snap = NULL;
+
+    mp3tag_collection_t *tags = NULL;
+    int rc = mp3tag_read_tags(ctx, &tags);
+    if (rc != MP3TAG_OK) return rc;
+
+    mp3tag_snapshot_t *s = ctx_snapshot(ctx);
+    if (!s) return MP3TAG_ERR_NO_MEMORY;
+
+    *snap = snapshot_retain(s);
+    return MP3TAG_OK;
+}
+
 int mp3tag_read_tag_string(mp3tag_context_t *ctx, const char *name,
                            char *value, size_t size)
 {
@@ -336,7 +610,7 @@ static int write_zeros(file_handle_t *fh, uint32_t count)
     memset(zeros, 0, sizeof(zeros));
     while (count > 0) {
         uint32_t chunk = count < sizeof(zeros) ? count : (uint32_t)sizeof(zeros);
-        if (file_write(fh, zeros, chunk) != 0)
+        if (io_write(fh, zeros, chunk) != 0)
             return MP3TAG_ERR_WRITE_FAILED;
         count -= chunk;
     }
@@ -361,17 +635,21 @@ static int raw_try_inplace(mp3tag_context_t *ctx, dyn_buffer_t *frame_buf)
     uint8_t hdr[ID3V2_HEADER_SIZE];
     id3v2_build_header(available, hdr);
 
-    if (file_seek(ctx->fh, 0) != 0)
-        return MP3TAG_ERR_SEEK_FAILED;
-    if (file_write(ctx->fh, hdr, ID3V2_HEADER_SIZE) != 0)
-        return MP3TAG_ERR_WRITE_FAILED;
-    if (file_write(ctx->fh, frame_buf->data, frame_buf->size) != 0)
-        return MP3TAG_ERR_WRITE_FAILED;
-
-    int rc = write_zeros(ctx->fh, available - needed);
+    TRACE_BEGIN(MP3TAG_PHASE_INPLACE_WRITE);
+    int rc = MP3TAG_OK;
+    if (io_seek(ctx->fh, 0) != 0)
+        rc = MP3TAG_ERR_SEEK_FAILED;
+    else if (io_write(ctx->fh, hdr, ID3V2_HEADER_SIZE) != 0 ||
+             io_write(ctx->fh, frame_buf->data, frame_buf->size) != 0)
+        rc = MP3TAG_ERR_WRITE_FAILED;
+    else
+        rc = write_zeros(ctx->fh, available - needed);
+    TRACE_END(MP3TAG_PHASE_INPLACE_WRITE,
+              rc == MP3TAG_OK ? ID3V2_HEADER_SIZE + (uint64_t)available : 0);
     if (rc != MP3TAG_OK) return rc;
 
-    file_sync(ctx->fh);
+    if (ctx->fsync && io_sync(ctx->fh) != 0)
+        return MP3TAG_ERR_WRITE_FAILED;
     return MP3TAG_OK;
 }
 
@@ -381,85 +659,96 @@ static int raw_rewrite(mp3tag_context_t *ctx, dyn_buffer_t *frame_buf)
         return MP3TAG_ERR_INVALID_ARG;
 
     size_t path_len = strlen(ctx->path);
-    char *tmp_path = malloc(path_len + 5);
+    char *tmp_path = mem_malloc(ALLOC_REWRITE, path_len + 5);
     if (!tmp_path) return MP3TAG_ERR_NO_MEMORY;
     memcpy(tmp_path, ctx->path, path_len);
     memcpy(tmp_path + path_len, ".tmp", 5);
 
-    uint32_t body_size = (uint32_t)frame_buf->size + ID3V2_DEFAULT_PADDING;
+    uint32_t body_size = (uint32_t)frame_buf->size + ctx->padding;
     uint8_t hdr[ID3V2_HEADER_SIZE];
     id3v2_build_header(body_size, hdr);
 
     /* Create temp file */
-    file_handle_t *tmp = file_open_rw(tmp_path);
+    file_handle_t *tmp = io_open_rw(tmp_path);
     if (!tmp) {
         FILE *f = fopen(tmp_path, "wb");
-        if (!f) { free(tmp_path); return MP3TAG_ERR_IO; }
+        if (!f) { mem_free(tmp_path); return MP3TAG_ERR_IO; }
         fclose(f);
-        tmp = file_open_rw(tmp_path);
-        if (!tmp) { free(tmp_path); return MP3TAG_ERR_IO; }
+        tmp = io_open_rw(tmp_path);
+        if (!tmp) { mem_free(tmp_path); return MP3TAG_ERR_IO; }
     }
 
     int result = MP3TAG_OK;
 
     /* Write new ID3v2 tag */
-    if (file_seek(tmp, 0) != 0 ||
-        file_write(tmp, hdr, ID3V2_HEADER_SIZE) != 0 ||
-        file_write(tmp, frame_buf->data, frame_buf->size) != 0) {
+    if (io_seek(tmp, 0) != 0 ||
+        io_write(tmp, hdr, ID3V2_HEADER_SIZE) != 0 ||
+        io_write(tmp, frame_buf->data, frame_buf->size) != 0) {
         result = MP3TAG_ERR_WRITE_FAILED;
         goto cleanup;
     }
 
-    result = write_zeros(tmp, ID3V2_DEFAULT_PADDING);
+    result = write_zeros(tmp, ctx->padding);
     if (result != MP3TAG_OK) goto cleanup;
 
     /* Copy audio data from original */
+    TRACE_BEGIN(MP3TAG_PHASE_REWRITE_COPY);
+    uint64_t copied = 0;
     {
         int64_t src_offset = ctx->audio_offset;
-        int64_t src_end    = file_size(ctx->fh);
+        int64_t src_end    = io_size(ctx->fh);
 
-        if (file_seek(ctx->fh, src_offset) != 0) {
+        uint8_t copy_buf[65536];
+        int64_t bytes_left = src_end - src_offset;
+        if (io_seek(ctx->fh, src_offset) != 0) {
             result = MP3TAG_ERR_SEEK_FAILED;
-            goto cleanup;
+            bytes_left = 0;
         }
 
-        uint8_t copy_buf[65536];
-        int64_t bytes_left = src_end - src_offset;
         while (bytes_left > 0) {
             size_t to_read = (size_t)(bytes_left < (int64_t)sizeof(copy_buf)
                                       ? bytes_left : (int64_t)sizeof(copy_buf));
-            int64_t n = file_read_partial(ctx->fh, copy_buf, to_read);
+            int64_t n = io_read_partial(ctx->fh, copy_buf, to_read);
             if (n <= 0) break;
-            if (file_write(tmp, copy_buf, (size_t)n) != 0) {
+            if (io_write(tmp, copy_buf, (size_t)n) != 0) {
                 result = MP3TAG_ERR_WRITE_FAILED;
-                goto cleanup;
+                break;
             }
+            copied += (uint64_t)n;
             bytes_left -= n;
+            MP3TAG_PROBE3(rewrite__copy, ctx->path, copied,
+                          (uint64_t)(src_end - src_offset));
         }
     }
+    STATS_ADD(bytes_copied, copied);
+    TRACE_END(MP3TAG_PHASE_REWRITE_COPY, copied);
+    if (result != MP3TAG_OK) goto cleanup;
 
-    if (file_sync(tmp) != 0) { result = MP3TAG_ERR_IO; goto cleanup; }
+    if (ctx->fsync && io_sync(tmp) != 0) {
+        result = MP3TAG_ERR_WRITE_FAILED;
+        goto cleanup;
+    }
 
-    file_close(tmp); tmp = NULL;
-    file_close(ctx->fh); ctx->fh = NULL;
+    io_close(tmp); tmp = NULL;
+    io_close(ctx->fh); ctx->fh = NULL;
 
-    if (rename(tmp_path, ctx->path) != 0) {
+    if (io_rename(tmp_path, ctx->path) != 0) {
         result = MP3TAG_ERR_RENAME_FAILED;
-        ctx->fh = ctx->writable ? file_open_rw(ctx->path)
-                                : file_open_read(ctx->path);
+        ctx->fh = ctx->writable ? io_open_rw(ctx->path)
+                                : io_open_read(ctx->path);
         goto cleanup_path;
     }
 
-    ctx->fh = ctx->writable ? file_open_rw(ctx->path)
-                            : file_open_read(ctx->path);
+    ctx->fh = ctx->writable ? io_open_rw(ctx->path)
+                            : io_open_read(ctx->path);
     if (!ctx->fh) { result = MP3TAG_ERR_IO; goto cleanup_path; }
 
     probe_file(ctx);
 
 cleanup:
-    if (tmp) { file_close(tmp); unlink(tmp_path); }
+    if (tmp) { io_close(tmp); unlink(tmp_path); }
 cleanup_path:
-    free(tmp_path);
+    mem_free(tmp_path);
     return result;
 }
 
@@ -467,6 +756,13 @@ cleanup_path:
 /*  Tag writing: container (AIFF/WAV)                                  */
 /* ------------------------------------------------------------------ */
 
+static void note_strategy(mp3tag_context_t *ctx,
+                          mp3tag_write_strategy_t strategy)
+{
+    STATS_INC(write_strategy[strategy]);
+    MP3TAG_PROBE2(write__strategy, ctx, (int)strategy);
+}
+
 static int container_try_inplace(mp3tag_context_t *ctx,
                                  dyn_buffer_t *frame_buf)
 {
@@ -484,27 +780,31 @@ static int container_try_inplace(mp3tag_context_t *ctx,
     id3v2_build_header(available - ID3V2_HEADER_SIZE, hdr);
 
     int64_t data_off = ctx->container.id3_chunk_data_offset;
-    if (file_seek(ctx->fh, data_off) != 0)
-        return MP3TAG_ERR_SEEK_FAILED;
-    if (file_write(ctx->fh, hdr, ID3V2_HEADER_SIZE) != 0)
-        return MP3TAG_ERR_WRITE_FAILED;
-    if (file_write(ctx->fh, frame_buf->data, frame_buf->size) != 0)
-        return MP3TAG_ERR_WRITE_FAILED;
-
-    int rc = write_zeros(ctx->fh, available - needed);
+    TRACE_BEGIN(MP3TAG_PHASE_INPLACE_WRITE);
+    int rc = MP3TAG_OK;
+    if (io_seek(ctx->fh, data_off) != 0)
+        rc = MP3TAG_ERR_SEEK_FAILED;
+    else if (io_write(ctx->fh, hdr, ID3V2_HEADER_SIZE) != 0 ||
+             io_write(ctx->fh, frame_buf->data, frame_buf->size) != 0)
+        rc = MP3TAG_ERR_WRITE_FAILED;
+    else
+        rc = write_zeros(ctx->fh, available - needed);
+    TRACE_END(MP3TAG_PHASE_INPLACE_WRITE,
+              rc == MP3TAG_OK ? (uint64_t)available : 0);
     if (rc != MP3TAG_OK) return rc;
 
-    file_sync(ctx->fh);
+    if (ctx->fsync && io_sync(ctx->fh) != 0)
+        return MP3TAG_ERR_WRITE_FAILED;
     return MP3TAG_OK;
 }
 
 static int container_write_new(mp3tag_context_t *ctx, dyn_buffer_t *frame_buf)
 {
     /* Build full ID3v2 tag (header + frames + padding) */
-    uint32_t body_size = (uint32_t)frame_buf->size + ID3V2_DEFAULT_PADDING;
+    uint32_t body_size = (uint32_t)frame_buf->size + ctx->padding;
     uint32_t tag_total = ID3V2_HEADER_SIZE + body_size;
 
-    uint8_t *tag_data = calloc(1, tag_total);
+    uint8_t *tag_data = mem_calloc(ALLOC_REWRITE, 1, tag_total);
     if (!tag_data) return MP3TAG_ERR_NO_MEMORY;
 
     id3v2_build_header(body_size, tag_data);
@@ -513,15 +813,18 @@ static int container_write_new(mp3tag_context_t *ctx, dyn_buffer_t *frame_buf)
     int rc;
     if (!ctx->container.has_id3_chunk) {
         /* No existing chunk — append */
+        note_strategy(ctx, MP3TAG_WRITE_APPEND);
         rc = container_append_id3(ctx->fh, &ctx->container,
-                                  tag_data, tag_total);
+                                  tag_data, tag_total, ctx->fsync);
     } else {
         /* Existing chunk too small — rewrite container */
+        note_strategy(ctx, MP3TAG_WRITE_CONTAINER_REWRITE);
         rc = container_rewrite_id3(&ctx->fh, ctx->path, ctx->writable,
-                                   &ctx->container, tag_data, tag_total);
+                                   &ctx->container, tag_data, tag_total,
+                                   ctx->fsync);
     }
 
-    free(tag_data);
+    mem_free(tag_data);
 
     if (rc == MP3TAG_OK)
         probe_file(ctx);
@@ -533,7 +836,7 @@ static int container_write_new(mp3tag_context_t *ctx, dyn_buffer_t *frame_buf)
 /*  Tag writing: main entry point                                      */
 /* ------------------------------------------------------------------ */
 
-int mp3tag_write_tags(mp3tag_context_t *ctx, const mp3tag_collection_t *tags)
+static int write_tags(mp3tag_context_t *ctx, const mp3tag_collection_t *tags)
 {
     if (!ctx || !tags)   return MP3TAG_ERR_INVALID_ARG;
     if (!ctx->fh)        return MP3TAG_ERR_NOT_OPEN;
@@ -542,37 +845,66 @@ int mp3tag_write_tags(mp3tag_context_t *ctx, const mp3tag_collection_t *tags)
     dyn_buffer_t frame_buf;
     buffer_init(&frame_buf);
 
+    MP3TAG_PROBE1(serialize__start, ctx);
+    TRACE_BEGIN(MP3TAG_PHASE_SERIALIZE);
     int rc = id3v2_serialize_frames(tags, &frame_buf);
+    TRACE_END(MP3TAG_PHASE_SERIALIZE, frame_buf.size);
+    MP3TAG_PROBE3(serialize__done, ctx, rc, frame_buf.size);
     if (rc != MP3TAG_OK) {
-        buffer_free(&frame_buf);
+        buf_free(&frame_buf);
         return rc;
     }
+    MP3TAG_PROBE3(write__start, ctx, ctx->path, frame_buf.size);
 
     invalidate_cache(ctx);
 
+    file_identity_t before = ctx->identity;
+    int have_before = ctx->has_identity;
+
     if (ctx->container.type == CONTAINER_NONE) {
-        /* Raw stream: try in-place, then rewrite */
+        /* Raw stream: in place, or rewrite when the tag does not fit */
         rc = raw_try_inplace(ctx, &frame_buf);
         if (rc == MP3TAG_OK) {
-            buffer_free(&frame_buf);
+            note_strategy(ctx, MP3TAG_WRITE_IN_PLACE);
             probe_file(ctx);
-            return MP3TAG_OK;
+        } else if (rc == MP3TAG_ERR_NO_SPACE) {
+            note_strategy(ctx, MP3TAG_WRITE_RAW_REWRITE);
+            rc = raw_rewrite(ctx, &frame_buf);
         }
-        rc = raw_rewrite(ctx, &frame_buf);
-        buffer_free(&frame_buf);
-        return rc;
     } else {
-        /* Container: try in-place within chunk, then append/rewrite */
+        /* Container: in place within the chunk, else append/rewrite */
         rc = container_try_inplace(ctx, &frame_buf);
         if (rc == MP3TAG_OK) {
-            buffer_free(&frame_buf);
+            note_strategy(ctx, MP3TAG_WRITE_IN_PLACE);
             probe_file(ctx);
-            return MP3TAG_OK;
+        } else if (rc == MP3TAG_ERR_NO_SPACE) {
+            rc = container_write_new(ctx, &frame_buf);
         }
-        rc = container_write_new(ctx, &frame_buf);
-        buffer_free(&frame_buf);
-        return rc;
     }
+
+    /* Even a failed write may have touched the file */
+    cache_after_write(ctx);
+    if (rc == MP3TAG_OK && ctx->lru)
+        lru_after_write(ctx, &frame_buf, have_before ? &before : NULL);
+    buf_free(&frame_buf);
+    MP3TAG_PROBE2(write__done, ctx, rc);
+    return rc;
+}
+
+int mp3tag_write_tags(mp3tag_context_t *ctx, const mp3tag_collection_t *tags)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+
+    perf_sample_t ps;
+    if (ctx->perf) perf_begin(ctx->perf, &ps);
+    uint64_t t0 = ctx->stats.metrics ? stats_now_ns() : 0;
+    stats_scope_t *prev = stats_enter(&ctx->stats);
+    int rc = write_tags(ctx, tags);
+    stats_leave(prev);
+    if (ctx->perf) perf_end(ctx->perf, MP3TAG_PERF_OP_WRITE, &ps);
+    if (ctx->stats.metrics)
+        metrics_op(ctx->stats.metrics, METRICS_OP_WRITE, rc, t0);
+    return rc;
 }
 
 /* ------------------------------------------------------------------ */
@@ -581,16 +913,16 @@ int mp3tag_write_tags(mp3tag_context_t *ctx, const mp3tag_collection_t *tags)
 
 static mp3tag_simple_tag_t *clone_simple_tag(const mp3tag_simple_tag_t *src)
 {
-    mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
+    mp3tag_simple_tag_t *st = mem_calloc(ALLOC_SIMPLE_TAG, 1, sizeof(*st));
     if (!st) return NULL;
 
-    st->name       = str_dup(src->name);
-    st->value      = str_dup(src->value);
-    st->language   = str_dup(src->language);
+    st->name       = mem_strdup(ALLOC_TAG_TEXT, src->name);
+    st->value      = mem_strdup(ALLOC_TAG_TEXT, src->value);
+    st->language   = mem_strdup(ALLOC_TAG_TEXT, src->language);
     st->is_default = src->is_default;
 
     if (src->binary && src->binary_size > 0) {
-        st->binary = malloc(src->binary_size);
+        st->binary = mem_malloc(ALLOC_BINARY, src->binary_size);
         if (st->binary) {
             memcpy(st->binary, src->binary, src->binary_size);
             st->binary_size = src->binary_size;
@@ -600,21 +932,34 @@ static mp3tag_simple_tag_t *clone_simple_tag(const mp3tag_simple_tag_t *src)
     return st;
 }
 
-int mp3tag_set_tag_string(mp3tag_context_t *ctx, const char *name,
-                          const char *value)
+static void append_simple(mp3tag_tag_t *tag, mp3tag_simple_tag_t *st)
 {
-    if (!ctx || !name)   return MP3TAG_ERR_INVALID_ARG;
-    if (!ctx->fh)        return MP3TAG_ERR_NOT_OPEN;
-    if (!ctx->writable)  return MP3TAG_ERR_READ_ONLY;
+    if (!tag->simple_tags) {
+        tag->simple_tags = st;
+    } else {
+        mp3tag_simple_tag_t *tail = tag->simple_tags;
+        while (tail->next) tail = tail->next;
+        tail->next = st;
+    }
+}
 
-    mp3tag_collection_t *existing = NULL;
-    mp3tag_read_tags(ctx, &existing);
+static int edited(const tag_edit_t *edits, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++)
+        if (str_casecmp(edits[i].name, name) == 0)
+            return 1;
+    return 0;
+}
 
-    mp3tag_collection_t *work = calloc(1, sizeof(*work));
-    if (!work) return MP3TAG_ERR_NO_MEMORY;
+mp3tag_collection_t *collection_with_edits(const mp3tag_collection_t *existing,
+                                           const tag_edit_t *edits,
+                                           size_t count)
+{
+    mp3tag_collection_t *work = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*work));
+    if (!work) return NULL;
 
-    mp3tag_tag_t *wtag = calloc(1, sizeof(*wtag));
-    if (!wtag) { free(work); return MP3TAG_ERR_NO_MEMORY; }
+    mp3tag_tag_t *wtag = mem_calloc(ALLOC_COLLECTION, 1, sizeof(*wtag));
+    if (!wtag) { mem_free(work); return NULL; }
     wtag->target_type = MP3TAG_TARGET_ALBUM;
     work->tags  = wtag;
     work->count = 1;
@@ -622,48 +967,81 @@ int mp3tag_set_tag_string(mp3tag_context_t *ctx, const char *name,
     if (existing) {
         for (const mp3tag_tag_t *tag = existing->tags; tag; tag = tag->next) {
             for (const mp3tag_simple_tag_t *st = tag->simple_tags; st; st = st->next) {
-                if (st->name && str_casecmp(st->name, name) == 0)
+                if (st->name && edited(edits, count, st->name))
                     continue;
 
                 mp3tag_simple_tag_t *copy = clone_simple_tag(st);
-                if (copy) {
-                    if (!wtag->simple_tags) {
-                        wtag->simple_tags = copy;
-                    } else {
-                        mp3tag_simple_tag_t *tail = wtag->simple_tags;
-                        while (tail->next) tail = tail->next;
-                        tail->next = copy;
-                    }
-                }
+                if (copy)
+                    append_simple(wtag, copy);
             }
         }
     }
 
-    if (value) {
-        mp3tag_simple_tag_t *st = calloc(1, sizeof(*st));
-        if (!st) { free_collection(work); return MP3TAG_ERR_NO_MEMORY; }
-        st->name  = str_dup(name);
-        st->value = str_dup(value);
+    for (size_t i = 0; i < count; i++) {
+        if (!edits[i].value) continue;
 
-        if (!wtag->simple_tags) {
-            wtag->simple_tags = st;
-        } else {
-            mp3tag_simple_tag_t *tail = wtag->simple_tags;
-            while (tail->next) tail = tail->next;
-            tail->next = st;
-        }
+        mp3tag_simple_tag_t *st = mem_calloc(ALLOC_SIMPLE_TAG, 1, sizeof(*st));
+        if (!st) { free_collection(work); return NULL; }
+        st->name  = mem_strdup(ALLOC_TAG_TEXT, edits[i].name);
+        st->value = mem_strdup(ALLOC_TAG_TEXT, edits[i].value);
+        append_simple(wtag, st);
     }
 
+    return work;
+}
+
+static int set_tag_string(mp3tag_context_t *ctx, const char *name,
+                          const char *value)
+{
+    if (!ctx || !name)   return MP3TAG_ERR_INVALID_ARG;
+    if (!ctx->fh)        return MP3TAG_ERR_NOT_OPEN;
+    if (!ctx->writable)  return MP3TAG_ERR_READ_ONLY;
+
+    mp3tag_collection_t *existing = NULL;
+    mp3tag_read_tags(ctx, &existing);
+
+    tag_edit_t edit = { name, value };
+    mp3tag_collection_t *work = collection_with_edits(existing, &edit, 1);
+    if (!work) return MP3TAG_ERR_NO_MEMORY;
+
     int rc = mp3tag_write_tags(ctx, work);
     free_collection(work);
     return rc;
 }
 
+int mp3tag_set_tag_string(mp3tag_context_t *ctx, const char *name,
+                          const char *value)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+
+    stats_scope_t *prev = stats_enter(&ctx->stats);
+    int rc = set_tag_string(ctx, name, value);
+    stats_leave(prev);
+    return rc;
+}
+
 int mp3tag_remove_tag(mp3tag_context_t *ctx, const char *name)
 {
     return mp3tag_set_tag_string(ctx, name, NULL);
 }
 
+/* Far beyond any useful reserve, and well inside 28-bit tag sizes */
+#define MAX_PADDING (16u << 20)
+
+int mp3tag_set_padding(mp3tag_context_t *ctx, uint32_t padding)
+{
+    if (!ctx || padding > MAX_PADDING) return MP3TAG_ERR_INVALID_ARG;
+    ctx->padding = padding;
+    return MP3TAG_OK;
+}
+
+int mp3tag_set_fsync(mp3tag_context_t *ctx, int enabled)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->fsync = enabled ? 1 : 0;
+    return MP3TAG_OK;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Collection building API                                            */
 /* ------------------------------------------------------------------ */
@@ -714,7 +1092,7 @@ mp3tag_simple_tag_t *mp3tag_tag_add_simple(mp3tag_context_t *ctx,
     if (!st) return NULL;
     st->name  = str_dup(name);
     st->value = value ? str_dup(value) : NULL;
-    if (!st->name) { free(st); return NULL; }
+    if (!st->name) { mem_free(st); return NULL; }
 
     if (!tag->simple_tags) {
         tag->simple_tags = st;
@@ -738,7 +1116,7 @@ mp3tag_simple_tag_t *mp3tag_simple_tag_add_nested(mp3tag_context_t *ctx,
     if (!st) return NULL;
     st->name  = str_dup(name);
     st->value = value ? str_dup(value) : NULL;
-    if (!st->name) { free(st); return NULL; }
+    if (!st->name) { mem_free(st); return NULL; }
 
     if (!parent->nested) {
         parent->nested = st;
@@ -756,7 +1134,7 @@ int mp3tag_simple_tag_set_language(mp3tag_context_t *ctx,
 {
     (void)ctx;
     if (!simple_tag) return MP3TAG_ERR_INVALID_ARG;
-    free(simple_tag->language);
+    mem_free(simple_tag->language);
     simple_tag->language = language ? str_dup(language) : NULL;
     return MP3TAG_OK;
 }
@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef MP3TAG_INTERNAL_H
+#define MP3TAG_INTERNAL_H
+
+#include "../include/mp3tag/mp3tag_types.h"
+#include "id3v2/id3v2_reader.h"
+#include "container/container.h"
+#include "cache/cache.h"
+#include "stats/stats.h"
+#include "perf/perf.h"
+#include <tag_common/file_io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------ */
+/*  Internal context definition                                        */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Shared between mp3tag.c and the other public API units (batch, ...)
+ * so they can drive a context without going through the public API.
+ */
+struct mp3tag_context {
+    mp3tag_allocator_t  allocator;
+    int                 has_allocator;
+
+    file_handle_t      *fh;
+    char               *path;
+    int                 writable;
+
+    /* Container format info */
+    container_info_t    container;
+
+    /* Parsed file structure */
+    int                 has_id3v2;
+    id3v2_header_t      id3v2_hdr;
+    int64_t             id3v2_offset;  /* File offset of ID3v2 header */
+    int64_t             audio_offset;  /* First byte of audio (raw streams only) */
+
+    int                 has_id3v1;
+
+    /* Write settings (mp3tag_set_padding(), mp3tag_set_fsync()) */
+    uint32_t            padding;
+    int                 fsync;
+
+    /* Cached tag collection (owned by context, or by `snapshot` once
+     * it has been shared) */
+    mp3tag_collection_t *cached_tags;
+    mp3tag_snapshot_t  *snapshot;
+
+    /* Persistent probe/tag cache (not owned) */
+    mp3tag_cache_t     *cache;
+    file_identity_t     identity;      /* Version of the open file */
+    int                 has_identity;
+    int                 tags_absent;   /* Cache says: no tags in file */
+
+    /* Shared snapshot cache (not owned) */
+    mp3tag_lru_t       *lru;
+
+    /* Counters and trace hooks, active on the calling thread during
+     * public calls */
+    stats_scope_t       stats;
+    mp3tag_trace_hooks_t trace_hooks;
+
+    /* CPU counter aggregate (not owned) */
+    mp3tag_perf_t      *perf;
+};
+
+/*
+ * Transfer ownership of the cached collection to the caller.
+ * The context forgets it, so a later close/invalidate will not free it.
+ * A collection that is still shared through a snapshot is copied.
+ */
+mp3tag_collection_t *ctx_detach_tags(mp3tag_context_t *ctx);
+
+/* A single-field change: `value` NULL removes the field */
+typedef struct {
+    const char *name;
+    const char *value;
+} tag_edit_t;
+
+/*
+ * New collection, laid out the way mp3tag_set_tag_string() writes it:
+ * every simple tag of `existing` (may be NULL) that no edit names,
+ * followed by the edited values in order. NULL when out of memory.
+ */
+mp3tag_collection_t *collection_with_edits(const mp3tag_collection_t *existing,
+                                           const tag_edit_t *edits,
+                                           size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3TAG_INTERNAL_H */
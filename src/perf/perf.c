@@ -0,0 +1,299 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * CPU counters around public operations.
+ *
+ * Each thread lazily opens one perf_event group (cycles as leader, then
+ * instructions, cache misses and branch misses) counting its own user
+ * space, and keeps it for the rest of its life. An operation reads the
+ * group before and after, which costs two read() calls; when the kernel
+ * multiplexes the PMU the deltas are scaled by enabled/running time.
+ * Where perf events are restricted, unsupported (VMs without a PMU) or
+ * not a Linux thing at all, only clocks and getrusage() are sampled.
+ */
+
+#define _GNU_SOURCE         /* RUSAGE_THREAD, syscall() */
+#define _DARWIN_C_SOURCE
+
+#include "perf.h"
+#include "../mp3tag_internal.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#define PERF_HAVE_EVENTS 1
+#endif
+
+typedef struct {
+    atomic_uint_least64_t calls;
+    atomic_uint_least64_t wall_ns;
+    atomic_uint_least64_t cpu_ns;
+    atomic_uint_least64_t faults;
+    atomic_uint_least64_t switches;
+    atomic_uint_least64_t hw_calls;
+    atomic_uint_least64_t hw[PERF_HW_EVENTS];
+} perf_op_t;
+
+struct mp3tag_perf {
+    mp3tag_perf_source_t best;
+    perf_op_t            ops[MP3TAG_PERF_OP_COUNT];
+};
+
+/* ------------------------------------------------------------------ */
+/*  Per-thread hardware counter group                                  */
+/* ------------------------------------------------------------------ */
+
+#ifdef PERF_HAVE_EVENTS
+
+enum { GROUP_UNTRIED = -2, GROUP_UNAVAILABLE = -1 };
+
+static _Thread_local int perf_fds[PERF_HW_EVENTS] = {
+    GROUP_UNTRIED, GROUP_UNTRIED, GROUP_UNTRIED, GROUP_UNTRIED
+};
+
+static pthread_key_t  perf_key;
+static pthread_once_t perf_once = PTHREAD_ONCE_INIT;
+
+static void close_group(void *arg)
+{
+    int *fds = arg;
+    for (int i = PERF_HW_EVENTS - 1; i >= 0; i--) {
+        if (fds[i] >= 0) close(fds[i]);
+        fds[i] = GROUP_UNAVAILABLE;
+    }
+}
+
+static void perf_key_init(void)
+{
+    pthread_key_create(&perf_key, close_group);
+}
+
+static int open_event(uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP |
+                          PERF_FORMAT_TOTAL_TIME_ENABLED |
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group,
+                        PERF_FLAG_FD_CLOEXEC);
+}
+
+/* The calling thread's group leader, or -1 */
+static int thread_group(void)
+{
+    if (perf_fds[0] != GROUP_UNTRIED) return perf_fds[0];
+
+    static const uint64_t events[PERF_HW_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (int i = 0; i < PERF_HW_EVENTS; i++) {
+        perf_fds[i] = open_event(events[i], i ? perf_fds[0] : -1);
+        if (perf_fds[i] < 0) {
+            /* All or nothing: partial groups are not comparable */
+            close_group(perf_fds);
+            return GROUP_UNAVAILABLE;
+        }
+    }
+
+    pthread_once(&perf_once, perf_key_init);
+    pthread_setspecific(perf_key, perf_fds);
+    return perf_fds[0];
+}
+
+static int read_hw(perf_sample_t *s)
+{
+    int leader = thread_group();
+    if (leader < 0) return 0;
+
+    /* nr, time enabled, time running, then one value per member */
+    uint64_t buf[3 + PERF_HW_EVENTS];
+    if (read(leader, buf, sizeof(buf)) != (ssize_t)sizeof(buf) ||
+        buf[0] != PERF_HW_EVENTS)
+        return 0;
+
+    s->hw_enabled = buf[1];
+    s->hw_running = buf[2];
+    memcpy(s->hw, buf + 3, sizeof(s->hw));
+    return 1;
+}
+
+#else
+
+static int read_hw(perf_sample_t *s)
+{
+    (void)s;
+    return 0;
+}
+
+#endif /* PERF_HAVE_EVENTS */
+
+/* ------------------------------------------------------------------ */
+/*  Software counters                                                  */
+/* ------------------------------------------------------------------ */
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void read_rusage(perf_sample_t *s)
+{
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    int who = RUSAGE_THREAD;
+#else
+    int who = RUSAGE_SELF;          /* Whole process: noisier, still useful */
+#endif
+    if (getrusage(who, &ru) != 0) return;
+    s->faults   = (uint64_t)ru.ru_minflt + (uint64_t)ru.ru_majflt;
+    s->switches = (uint64_t)ru.ru_nvcsw + (uint64_t)ru.ru_nivcsw;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Sampling                                                           */
+/* ------------------------------------------------------------------ */
+
+void perf_begin(const mp3tag_perf_t *perf, perf_sample_t *start)
+{
+    memset(start, 0, sizeof(*start));
+    start->wall_ns = stats_now_ns();
+    start->cpu_ns  = thread_cpu_ns();
+    read_rusage(start);
+    /* Last, so the software reads above stay out of the hardware counts */
+    if (perf->best == MP3TAG_PERF_HARDWARE)
+        start->hardware = read_hw(start);
+}
+
+static void add(atomic_uint_least64_t *sum, uint64_t v)
+{
+    atomic_fetch_add_explicit(sum, v, memory_order_relaxed);
+}
+
+void perf_end(mp3tag_perf_t *perf, mp3tag_perf_op_t op,
+              const perf_sample_t *start)
+{
+    perf_sample_t end;
+    memset(&end, 0, sizeof(end));
+    if (start->hardware)
+        end.hardware = read_hw(&end);
+    read_rusage(&end);
+    end.cpu_ns  = thread_cpu_ns();
+    end.wall_ns = stats_now_ns();
+
+    perf_op_t *o = &perf->ops[op];
+    add(&o->calls, 1);
+    add(&o->wall_ns, end.wall_ns - start->wall_ns);
+    add(&o->cpu_ns, end.cpu_ns - start->cpu_ns);
+    add(&o->faults, end.faults - start->faults);
+    add(&o->switches, end.switches - start->switches);
+
+    uint64_t enabled = end.hw_enabled - start->hw_enabled;
+    uint64_t running = end.hw_running - start->hw_running;
+    if (!end.hardware || running == 0) return;
+
+    /* Scale up for the time the group was multiplexed out */
+    double scale = (double)enabled / (double)running;
+    for (int i = 0; i < PERF_HW_EVENTS; i++)
+        add(&o->hw[i], (uint64_t)((double)(end.hw[i] - start->hw[i]) * scale));
+    add(&o->hw_calls, 1);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_perf_t *mp3tag_perf_create(mp3tag_perf_source_t best)
+{
+    mp3tag_perf_t *perf = malloc(sizeof(*perf));
+    if (!perf) return NULL;
+    perf->best = best;
+    mp3tag_perf_reset(perf);
+    return perf;
+}
+
+void mp3tag_perf_destroy(mp3tag_perf_t *perf)
+{
+    free(perf);
+}
+
+void mp3tag_perf_reset(mp3tag_perf_t *perf)
+{
+    if (!perf) return;
+    for (int op = 0; op < MP3TAG_PERF_OP_COUNT; op++) {
+        perf_op_t *o = &perf->ops[op];
+        atomic_init(&o->calls, 0);
+        atomic_init(&o->wall_ns, 0);
+        atomic_init(&o->cpu_ns, 0);
+        atomic_init(&o->faults, 0);
+        atomic_init(&o->switches, 0);
+        atomic_init(&o->hw_calls, 0);
+        for (int i = 0; i < PERF_HW_EVENTS; i++)
+            atomic_init(&o->hw[i], 0);
+    }
+}
+
+int mp3tag_set_perf(mp3tag_context_t *ctx, mp3tag_perf_t *perf)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->perf = perf;
+    return MP3TAG_OK;
+}
+
+static double avg(const atomic_uint_least64_t *sum, uint64_t n)
+{
+    if (n == 0) return 0.0;
+    return (double)atomic_load_explicit(sum, memory_order_relaxed) /
+           (double)n;
+}
+
+int mp3tag_perf_report(const mp3tag_perf_t *perf, mp3tag_perf_op_t op,
+                       mp3tag_perf_report_t *report)
+{
+    if (!perf || !report || (unsigned)op >= MP3TAG_PERF_OP_COUNT)
+        return MP3TAG_ERR_INVALID_ARG;
+
+    const perf_op_t *o = &perf->ops[op];
+    uint64_t calls = atomic_load_explicit(&o->calls, memory_order_relaxed);
+    uint64_t hw_calls = atomic_load_explicit(&o->hw_calls,
+                                             memory_order_relaxed);
+
+    memset(report, 0, sizeof(*report));
+    report->calls            = calls;
+    report->source           = (calls > 0 && hw_calls == calls)
+                                   ? MP3TAG_PERF_HARDWARE
+                                   : MP3TAG_PERF_SOFTWARE;
+    report->wall_ns          = avg(&o->wall_ns, calls);
+    report->cpu_ns           = avg(&o->cpu_ns, calls);
+    report->page_faults      = avg(&o->faults, calls);
+    report->context_switches = avg(&o->switches, calls);
+
+    if (report->source == MP3TAG_PERF_HARDWARE) {
+        report->cycles        = avg(&o->hw[0], hw_calls);
+        report->instructions  = avg(&o->hw[1], hw_calls);
+        report->cache_misses  = avg(&o->hw[2], hw_calls);
+        report->branch_misses = avg(&o->hw[3], hw_calls);
+    }
+    return MP3TAG_OK;
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_HW_EVENTS 4           /* cycles, instructions, cache, branch */
+
+/* Counter readings at the start of an operation */
+typedef struct {
+    int      hardware;             /* hw[] and hw_* are valid */
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t faults;
+    uint64_t switches;
+    uint64_t hw[PERF_HW_EVENTS];
+    uint64_t hw_enabled;           /* For multiplexing correction */
+    uint64_t hw_running;
+} perf_sample_t;
+
+/*
+ * Bracket one operation. Nesting is fine: each caller keeps its own
+ * start sample.
+ */
+void perf_begin(const mp3tag_perf_t *perf, perf_sample_t *start);
+void perf_end(mp3tag_perf_t *perf, mp3tag_perf_op_t op,
+              const perf_sample_t *start);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_H */
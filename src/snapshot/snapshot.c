@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#include "snapshot.h"
+#include "../flat/flat.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/buffer.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t str_bytes(const char *s)
+{
+    return s ? strlen(s) + 1 : 0;
+}
+
+static size_t simple_bytes(const mp3tag_simple_tag_t *st)
+{
+    size_t n = 0;
+    for (; st; st = st->next) {
+        n += sizeof(*st) + str_bytes(st->name) + str_bytes(st->value) +
+             str_bytes(st->language) + st->binary_size +
+             simple_bytes(st->nested);
+    }
+    return n;
+}
+
+static size_t collection_bytes(const mp3tag_collection_t *coll)
+{
+    size_t n = sizeof(*coll);
+    for (const mp3tag_tag_t *t = coll->tags; t; t = t->next) {
+        n += sizeof(*t) + str_bytes(t->target_type_str) +
+             (t->track_uid_count + t->edition_uid_count +
+              t->chapter_uid_count + t->attachment_uid_count) *
+                 sizeof(uint64_t) +
+             simple_bytes(t->simple_tags);
+    }
+    return n;
+}
+
+mp3tag_snapshot_t *snapshot_wrap(mp3tag_collection_t *coll)
+{
+    if (!coll) return NULL;
+
+    mp3tag_snapshot_t *snap = malloc(sizeof(*snap));
+    if (!snap) return NULL;
+    atomic_init(&snap->refs, 1);
+    snap->coll  = coll;
+    snap->bytes = sizeof(*snap) + collection_bytes(coll);
+    return snap;
+}
+
+mp3tag_snapshot_t *snapshot_copy(const mp3tag_collection_t *coll)
+{
+    if (!coll) return NULL;
+
+    /* The flat codec already performs a complete deep copy */
+    dyn_buffer_t buf;
+    buffer_init(&buf);
+    mp3tag_collection_t *copy = NULL;
+    int rc = flat_encode(coll, &buf);
+    if (rc == MP3TAG_OK)
+        rc = flat_decode(buf.data, buf.size, &copy);
+    buffer_free(&buf);
+
+    if (rc != MP3TAG_OK) return NULL;
+
+    mp3tag_snapshot_t *snap = snapshot_wrap(copy);
+    if (!snap)
+        mp3tag_collection_free(NULL, copy);
+    return snap;
+}
+
+mp3tag_collection_t *snapshot_unwrap(mp3tag_snapshot_t *snap)
+{
+    if (!snap) return NULL;
+
+    /* Sole owner: nobody else can observe the collection any more */
+    if (atomic_load_explicit(&snap->refs, memory_order_acquire) == 1) {
+        mp3tag_collection_t *coll = snap->coll;
+        free(snap);
+        return coll;
+    }
+
+    mp3tag_collection_t *copy = NULL;
+    mp3tag_snapshot_t *dup = snapshot_copy(snap->coll);
+    if (dup) {
+        copy = dup->coll;
+        free(dup);
+    }
+    mp3tag_snapshot_release(snap);
+    return copy;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+const mp3tag_collection_t *mp3tag_snapshot_tags(const mp3tag_snapshot_t *snap)
+{
+    return snap ? snap->coll : NULL;
+}
+
+size_t mp3tag_snapshot_size(const mp3tag_snapshot_t *snap)
+{
+    return snap ? snap->bytes : 0;
+}
+
+mp3tag_snapshot_t *mp3tag_snapshot_retain(mp3tag_snapshot_t *snap)
+{
+    return snap ? snapshot_retain(snap) : NULL;
+}
+
+void mp3tag_snapshot_release(mp3tag_snapshot_t *snap)
+{
+    if (!snap) return;
+    if (atomic_fetch_sub_explicit(&snap->refs, 1, memory_order_acq_rel) != 1)
+        return;
+    mp3tag_collection_free(NULL, snap->coll);
+    free(snap);
+}
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Immutable, reference-counted collection. Nothing may modify `coll`
+ * once the snapshot exists; the last release frees it.
+ */
+struct mp3tag_snapshot {
+    atomic_size_t        refs;
+    mp3tag_collection_t *coll;
+    size_t               bytes;    /* Heap footprint, binary data included */
+};
+
+/*
+ * Wrap a heap collection, taking ownership of it. Starts with one
+ * reference. On failure NULL is returned and `coll` stays with the
+ * caller.
+ */
+mp3tag_snapshot_t *snapshot_wrap(mp3tag_collection_t *coll);
+
+/*
+ * Deep-copy `coll` into a new snapshot with one reference.
+ */
+mp3tag_snapshot_t *snapshot_copy(const mp3tag_collection_t *coll);
+
+/*
+ * Give up a reference in exchange for a private, mutable collection:
+ * the wrapped one when this was the last reference, a copy otherwise.
+ * Returns NULL only when the copy cannot be allocated.
+ */
+mp3tag_collection_t *snapshot_unwrap(mp3tag_snapshot_t *snap);
+
+static inline mp3tag_snapshot_t *snapshot_retain(mp3tag_snapshot_t *snap)
+{
+    atomic_fetch_add_explicit(&snap->refs, 1, memory_order_relaxed);
+    return snap;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Allocation profile for MP3TAG_ALLOC_PROFILE builds.
+ *
+ * Every tagged block is remembered in an open-addressing table keyed by
+ * address, so mem_free() can credit its bytes back to the right tag
+ * without a header in front of the block. Blocks freed with plain free()
+ * elsewhere stay in the table until their address is handed out again,
+ * which only makes live and peak figures err on the high side.
+ */
+
+#include "stats.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MP3TAG_ALLOC_PROFILE
+
+#include <pthread.h>
+
+static const char *const alloc_tag_names[ALLOC_TAG_COUNT] = {
+    "path",
+    "collection",
+    "simple_tag",
+    "tag_text",
+    "binary",
+    "frame",
+    "frame_data",
+    "decoded_text",
+    "buffer_growth",
+    "rewrite",
+};
+
+typedef struct {
+    uintptr_t addr;                /* 0 = empty slot */
+    size_t    size;
+    unsigned  tag;
+} alloc_entry_t;
+
+static pthread_mutex_t     prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static mp3tag_alloc_site_t prof_sites[ALLOC_TAG_COUNT];
+static alloc_entry_t      *prof_table;
+static size_t              prof_capacity;  /* Power of two */
+static size_t              prof_used;
+
+static size_t slot_of(uintptr_t addr)
+{
+    uint64_t h = (uint64_t)addr * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & (prof_capacity - 1);
+}
+
+static void site_grow(unsigned tag, size_t bytes)
+{
+    mp3tag_alloc_site_t *s = &prof_sites[tag];
+    s->live_bytes += bytes;
+    if (s->live_bytes > s->peak_bytes)
+        s->peak_bytes = s->live_bytes;
+}
+
+static void site_shrink(unsigned tag, size_t bytes)
+{
+    mp3tag_alloc_site_t *s = &prof_sites[tag];
+    s->live_bytes = s->live_bytes > bytes ? s->live_bytes - bytes : 0;
+}
+
+static int table_grow(void)
+{
+    size_t cap = prof_capacity ? prof_capacity * 2 : 1024;
+    alloc_entry_t *table = calloc(cap, sizeof(*table));
+    if (!table) return -1;
+
+    alloc_entry_t *old = prof_table;
+    size_t old_cap = prof_capacity;
+    prof_table    = table;
+    prof_capacity = cap;
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].addr) continue;
+        size_t j = slot_of(old[i].addr);
+        while (prof_table[j].addr)
+            j = (j + 1) & (cap - 1);
+        prof_table[j] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/* Remove slot `i`, shifting later members of its probe run back */
+static void table_erase(size_t i)
+{
+    size_t mask = prof_capacity - 1;
+    size_t j = i;
+    for (;;) {
+        prof_table[i].addr = 0;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!prof_table[j].addr) return;
+            size_t home = slot_of(prof_table[j].addr);
+            /* Entry j may move to i only if home is not in (i, j] */
+            if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+                break;
+        }
+        prof_table[i] = prof_table[j];
+        i = j;
+    }
+}
+
+static alloc_entry_t *table_find(uintptr_t addr, size_t *slot)
+{
+    if (!prof_capacity) return NULL;
+    size_t i = slot_of(addr);
+    while (prof_table[i].addr) {
+        if (prof_table[i].addr == addr) {
+            *slot = i;
+            return &prof_table[i];
+        }
+        i = (i + 1) & (prof_capacity - 1);
+    }
+    *slot = i;
+    return NULL;
+}
+
+void alloc_profile_add(alloc_tag_t tag, const void *p, size_t size)
+{
+    uintptr_t addr = (uintptr_t)p;
+
+    pthread_mutex_lock(&prof_lock);
+    prof_sites[tag].allocations++;
+    prof_sites[tag].bytes += size;
+    site_grow(tag, size);
+
+    size_t slot = 0;
+    alloc_entry_t *e = table_find(addr, &slot);
+    if (e) {
+        /* Previous block at this address was freed behind our back */
+        site_shrink(e->tag, e->size);
+    } else {
+        if ((prof_used + 1) * 2 > prof_capacity) {
+            if (table_grow() != 0) goto out;
+            table_find(addr, &slot);
+        }
+        e = &prof_table[slot];
+        prof_used++;
+    }
+    e->addr = addr;
+    e->size = size;
+    e->tag  = tag;
+out:
+    pthread_mutex_unlock(&prof_lock);
+}
+
+void alloc_profile_remove(const void *p)
+{
+    pthread_mutex_lock(&prof_lock);
+    size_t slot = 0;
+    alloc_entry_t *e = table_find((uintptr_t)p, &slot);
+    if (e) {
+        site_shrink(e->tag, e->size);
+        table_erase(slot);
+        prof_used--;
+    }
+    pthread_mutex_unlock(&prof_lock);
+}
+
+void alloc_profile_resize(alloc_tag_t tag, size_t old_size, size_t new_size)
+{
+    if (old_size == new_size) return;
+
+    pthread_mutex_lock(&prof_lock);
+    if (new_size > old_size) {
+        prof_sites[tag].allocations++;
+        prof_sites[tag].bytes += new_size;
+        site_grow(tag, new_size - old_size);
+    } else {
+        site_shrink(tag, old_size - new_size);
+    }
+    pthread_mutex_unlock(&prof_lock);
+}
+
+#endif /* MP3TAG_ALLOC_PROFILE */
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+int mp3tag_alloc_profile_enabled(void)
+{
+#ifdef MP3TAG_ALLOC_PROFILE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t mp3tag_alloc_profile(mp3tag_alloc_site_t *sites, size_t max)
+{
+#ifdef MP3TAG_ALLOC_PROFILE
+    pthread_mutex_lock(&prof_lock);
+    for (size_t i = 0; i < max && i < ALLOC_TAG_COUNT; i++) {
+        sites[i]     = prof_sites[i];
+        sites[i].tag = alloc_tag_names[i];
+    }
+    pthread_mutex_unlock(&prof_lock);
+    return ALLOC_TAG_COUNT;
+#else
+    (void)sites;
+    (void)max;
+    return 0;
+#endif
+}
+
+size_t mp3tag_alloc_profile_dump(char *buf, size_t size)
+{
+    mp3tag_alloc_site_t sites[ALLOC_TAG_COUNT];
+    size_t n = mp3tag_alloc_profile(sites, ALLOC_TAG_COUNT);
+
+    size_t len = 0;
+    char line[160];
+    int w = snprintf(line, sizeof(line), "%-14s %12s %14s %14s %14s\n",
+                     "tag", "allocs", "bytes", "live", "peak");
+    for (size_t i = 0; i <= n; i++) {
+        if (i > 0) {
+            const mp3tag_alloc_site_t *s = &sites[i - 1];
+            w = snprintf(line, sizeof(line),
+                         "%-14s %12llu %14llu %14llu %14llu\n", s->tag,
+                         (unsigned long long)s->allocations,
+                         (unsigned long long)s->bytes,
+                         (unsigned long long)s->live_bytes,
+                         (unsigned long long)s->peak_bytes);
+        }
+        if (w < 0) continue;
+        if (buf && len < size) {
+            size_t room = size - len;
+            memcpy(buf + len, line,
+                   (size_t)w < room ? (size_t)w : room - 1);
+        }
+        len += (size_t)w;
+    }
+    if (buf && size > 0)
+        buf[len < size ? len : size - 1] = '\0';
+    return len;
+}
+
+void mp3tag_alloc_profile_reset(void)
+{
+#ifdef MP3TAG_ALLOC_PROFILE
+    pthread_mutex_lock(&prof_lock);
+    for (size_t i = 0; i < ALLOC_TAG_COUNT; i++) {
+        prof_sites[i].allocations = 0;
+        prof_sites[i].bytes       = 0;
+        prof_sites[i].peak_bytes  = prof_sites[i].live_bytes;
+    }
+    pthread_mutex_unlock(&prof_lock);
+#endif
+}
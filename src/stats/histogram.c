@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Per-phase latency histograms in the HDR style: log-linear buckets
+ * with 64 linear sub-buckets per power of two, so any recorded value is
+ * reported within 1/64 (about 1.6%) of its true size, from 1 ns up to
+ * about 9.7 hours. Recording is a handful of relaxed atomic adds, so one
+ * histogram can sit behind any number of contexts and threads.
+ */
+
+#include "stats.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define HIST_SUB_BITS   6
+#define HIST_SUB_COUNT  (1u << HIST_SUB_BITS)          /* per octave */
+#define HIST_MAX_MSB    44                             /* ~2^45 ns */
+#define HIST_BUCKETS    ((HIST_MAX_MSB - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+typedef struct {
+    atomic_uint_least64_t buckets[HIST_BUCKETS];
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t sum;                 /* ns */
+    atomic_uint_least64_t max;
+} hist_phase_t;
+
+struct mp3tag_histogram {
+    hist_phase_t phases[MP3TAG_PHASE_COUNT];
+};
+
+/* Phase start times of the calling thread; phases of one kind never nest */
+static _Thread_local uint64_t hist_start[MP3TAG_PHASE_COUNT];
+
+static unsigned msb64(uint64_t v)
+{
+    unsigned m = 0;
+    while (v >>= 1) m++;
+    return m;
+}
+
+/*
+ * Values below 2 * HIST_SUB_COUNT map to themselves; above that, the
+ * index is the octave times HIST_SUB_COUNT plus the top HIST_SUB_BITS+1
+ * bits of the value, which keeps the index space contiguous.
+ */
+static unsigned bucket_index(uint64_t v)
+{
+    if (v < 2 * HIST_SUB_COUNT) return (unsigned)v;
+
+    unsigned m = msb64(v);
+    if (m > HIST_MAX_MSB) {
+        m = HIST_MAX_MSB;
+        v = ((uint64_t)1 << (HIST_MAX_MSB + 1)) - 1;
+    }
+    unsigned shift = m - HIST_SUB_BITS;
+    return shift * HIST_SUB_COUNT + (unsigned)(v >> shift);
+}
+
+/* Largest value that lands in bucket `idx` */
+static uint64_t bucket_upper(unsigned idx)
+{
+    if (idx < 2 * HIST_SUB_COUNT) return idx;
+
+    unsigned shift = idx / HIST_SUB_COUNT - 1;
+    uint64_t sub   = idx % HIST_SUB_COUNT + HIST_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void hist_begin(mp3tag_phase_t phase, void *user_data)
+{
+    (void)user_data;
+    hist_start[phase] = stats_now_ns();
+}
+
+static void hist_end(mp3tag_phase_t phase, uint64_t bytes, void *user_data)
+{
+    mp3tag_histogram_t *h = user_data;
+    hist_phase_t *p = &h->phases[phase];
+    uint64_t ns = stats_now_ns() - hist_start[phase];
+
+    atomic_fetch_add_explicit(&p->buckets[bucket_index(ns)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->sum, ns, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&p->max, memory_order_relaxed);
+    while (ns > max &&
+           !atomic_compare_exchange_weak_explicit(&p->max, &max, ns,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+}
+
+static int phase_valid(mp3tag_phase_t phase)
+{
+    return (unsigned)phase < MP3TAG_PHASE_COUNT;
+}
+
+void histogram_cumulative(const mp3tag_histogram_t *h, mp3tag_phase_t phase,
+                          const uint64_t *bounds, size_t n, uint64_t *counts,
+                          uint64_t *total, uint64_t *sum_ns)
+{
+    const hist_phase_t *p = &h->phases[phase];
+    uint64_t seen = 0;
+    size_t i = 0;
+    for (unsigned b = 0; b < HIST_BUCKETS; b++) {
+        uint64_t upper = bucket_upper(b);
+        while (i < n && upper > bounds[i]) counts[i++] = seen;
+        seen += atomic_load_explicit(&p->buckets[b], memory_order_relaxed);
+    }
+    while (i < n) counts[i++] = seen;
+    *total  = seen;
+    *sum_ns = atomic_load_explicit(&p->sum, memory_order_relaxed);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_histogram_t *mp3tag_histogram_create(void)
+{
+    mp3tag_histogram_t *h = malloc(sizeof(*h));
+    if (h) mp3tag_histogram_reset(h);
+    return h;
+}
+
+void mp3tag_histogram_destroy(mp3tag_histogram_t *h)
+{
+    free(h);
+}
+
+void mp3tag_histogram_hooks(mp3tag_histogram_t *h,
+                            mp3tag_trace_hooks_t *hooks)
+{
+    if (!hooks) return;
+    hooks->begin     = h ? hist_begin : NULL;
+    hooks->end       = h ? hist_end : NULL;
+    hooks->user_data = h;
+}
+
+void mp3tag_histogram_reset(mp3tag_histogram_t *h)
+{
+    if (!h) return;
+    for (unsigned i = 0; i < MP3TAG_PHASE_COUNT; i++) {
+        hist_phase_t *p = &h->phases[i];
+        for (unsigned b = 0; b < HIST_BUCKETS; b++)
+            atomic_init(&p->buckets[b], 0);
+        atomic_init(&p->count, 0);
+        atomic_init(&p->bytes, 0);
+        atomic_init(&p->sum, 0);
+        atomic_init(&p->max, 0);
+    }
+}
+
+uint64_t mp3tag_histogram_count(const mp3tag_histogram_t *h,
+                                mp3tag_phase_t phase)
+{
+    if (!h || !phase_valid(phase)) return 0;
+    return atomic_load_explicit(&h->phases[phase].count,
+                                memory_order_relaxed);
+}
+
+uint64_t mp3tag_histogram_bytes(const mp3tag_histogram_t *h,
+                                mp3tag_phase_t phase)
+{
+    if (!h || !phase_valid(phase)) return 0;
+    return atomic_load_explicit(&h->phases[phase].bytes,
+                                memory_order_relaxed);
+}
+
+uint64_t mp3tag_histogram_max(const mp3tag_histogram_t *h,
+                              mp3tag_phase_t phase)
+{
+    if (!h || !phase_valid(phase)) return 0;
+    return atomic_load_explicit(&h->phases[phase].max, memory_order_relaxed);
+}
+
+uint64_t mp3tag_histogram_percentile(const mp3tag_histogram_t *h,
+                                     mp3tag_phase_t phase, double percentile)
+{
+    if (!h || !phase_valid(phase)) return 0;
+
+    const hist_phase_t *p = &h->phases[phase];
+    uint64_t total = 0;
+    for (unsigned b = 0; b < HIST_BUCKETS; b++)
+        total += atomic_load_explicit(&p->buckets[b], memory_order_relaxed);
+    if (total == 0) return 0;
+
+    if (percentile < 0.0)   percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t max = atomic_load_explicit(&p->max, memory_order_relaxed);
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < HIST_BUCKETS; b++) {
+        seen += atomic_load_explicit(&p->buckets[b], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t v = bucket_upper(b);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
@@ -0,0 +1,441 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * I/O trace recorder and reader. Records are encoded under one mutex
+ * into a stdio buffer, so a recorder can sit behind several contexts on
+ * several threads; the cost when no recorder is attached is the branch
+ * in each io_* wrapper.
+ */
+
+#include "iotrace.h"
+#include "stats.h"
+#include "../mp3tag_internal.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest encoded call record: op and six 64-bit varints */
+#define RECORD_MAX (1 + 6 * 10)
+
+typedef struct {
+    const file_handle_t *fh;
+    uint32_t             handle;
+    uint64_t             pos;        /* Current offset as far as we know */
+} open_file_t;
+
+struct mp3tag_iotrace {
+    pthread_mutex_t lock;
+    FILE           *out;
+    int             error;           /* Sticky: a write failed */
+    uint64_t        last_start;
+
+    open_file_t    *open;
+    size_t          n_open, cap_open;
+    uint32_t        next_handle;
+
+    char          **paths;           /* Index = path id - 1 */
+    size_t          n_paths, cap_paths;
+    size_t         *path_slots;      /* Open addressing: id, 0 = empty */
+    size_t          cap_slots;       /* Power of two */
+};
+
+/* ------------------------------------------------------------------ */
+/*  Encoding                                                           */
+/* ------------------------------------------------------------------ */
+
+static size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static void emit(mp3tag_iotrace_t *t, const void *p, size_t n)
+{
+    if (!t->error && fwrite(p, 1, n, t->out) != n)
+        t->error = 1;
+}
+
+static uint64_t hash_path(const char *path)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *path; path++) {
+        h ^= (uint8_t)*path;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/* Slot holding `path`'s id, or the empty slot where it belongs */
+static size_t *path_slot(const mp3tag_iotrace_t *t, const char *path)
+{
+    size_t i = (size_t)hash_path(path) & (t->cap_slots - 1);
+    for (;;) {
+        size_t *slot = &t->path_slots[i];
+        if (!*slot || strcmp(t->paths[*slot - 1], path) == 0)
+            return slot;
+        i = (i + 1) & (t->cap_slots - 1);
+    }
+}
+
+/* Keep the id table at most half full */
+static int path_slots_grow(mp3tag_iotrace_t *t)
+{
+    size_t cap = t->cap_slots ? t->cap_slots * 2 : 64;
+    size_t *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+
+    free(t->path_slots);
+    t->path_slots = slots;
+    t->cap_slots  = cap;
+    for (size_t id = 1; id <= t->n_paths; id++)
+        *path_slot(t, t->paths[id - 1]) = id;
+    return 0;
+}
+
+/* Path id of `path`, naming it in the trace the first time; 0 if OOM */
+static uint64_t path_id(mp3tag_iotrace_t *t, const char *path)
+{
+    if (!path) return 0;
+    if ((t->n_paths + 1) * 2 > t->cap_slots && path_slots_grow(t) != 0)
+        return 0;
+
+    size_t *slot = path_slot(t, path);
+    if (*slot)
+        return *slot;
+
+    if (t->n_paths == t->cap_paths) {
+        size_t cap = t->cap_paths ? t->cap_paths * 2 : 16;
+        char **grown = realloc(t->paths, cap * sizeof(*grown));
+        if (!grown) return 0;
+        t->paths     = grown;
+        t->cap_paths = cap;
+    }
+    char *copy = str_dup(path);
+    if (!copy) return 0;
+    t->paths[t->n_paths++] = copy;
+    *slot = t->n_paths;
+
+    uint8_t rec[1 + 2 * 10];
+    size_t len = strlen(path), n = 0;
+    rec[n++] = IOTRACE_PATH;
+    n += put_varint(rec + n, t->n_paths);
+    n += put_varint(rec + n, len);
+    emit(t, rec, n);
+    emit(t, path, len);
+    return t->n_paths;
+}
+
+static void put_record(mp3tag_iotrace_t *t, iotrace_op_t op, uint64_t start,
+                       uint32_t handle, uint64_t a, uint64_t b,
+                       int64_t result)
+{
+    uint64_t end = stats_now_ns();
+    int64_t  gap = t->last_start ? (int64_t)(start - t->last_start) : 0;
+    t->last_start = start;
+
+    uint8_t rec[RECORD_MAX];
+    size_t n = 0;
+    rec[n++] = (uint8_t)op;
+    n += put_varint(rec + n, zigzag(gap));
+    n += put_varint(rec + n, end - start);
+    n += put_varint(rec + n, handle);
+    n += put_varint(rec + n, a);
+    n += put_varint(rec + n, b);
+    n += put_varint(rec + n, zigzag(result));
+    emit(t, rec, n);
+}
+
+static open_file_t *find_open(mp3tag_iotrace_t *t, const file_handle_t *fh)
+{
+    for (size_t i = 0; i < t->n_open; i++)
+        if (t->open[i].fh == fh)
+            return &t->open[i];
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Recording                                                          */
+/* ------------------------------------------------------------------ */
+
+void iotrace_open(mp3tag_iotrace_t *t, const file_handle_t *fh,
+                  const char *path, int writable, uint64_t start)
+{
+    pthread_mutex_lock(&t->lock);
+    uint32_t handle = ++t->next_handle;
+    uint64_t id = path_id(t, path);
+
+    if (fh) {
+        if (t->n_open == t->cap_open) {
+            size_t cap = t->cap_open ? t->cap_open * 2 : 8;
+            open_file_t *grown = realloc(t->open, cap * sizeof(*grown));
+            if (grown) {
+                t->open     = grown;
+                t->cap_open = cap;
+            }
+        }
+        /* Untracked when out of memory: its records carry handle 0 */
+        if (t->n_open < t->cap_open)
+            t->open[t->n_open++] = (open_file_t){ fh, handle, 0 };
+    }
+    put_record(t, IOTRACE_OPEN, start, handle, id, writable ? 1 : 0,
+               fh ? 0 : -1);
+    pthread_mutex_unlock(&t->lock);
+}
+
+uint32_t iotrace_closing(mp3tag_iotrace_t *t, const file_handle_t *fh)
+{
+    pthread_mutex_lock(&t->lock);
+    uint32_t handle = 0;
+    open_file_t *f = find_open(t, fh);
+    if (f) {
+        handle = f->handle;
+        *f = t->open[--t->n_open];
+    }
+    pthread_mutex_unlock(&t->lock);
+    return handle;
+}
+
+void iotrace_closed(mp3tag_iotrace_t *t, uint32_t handle, uint64_t start)
+{
+    pthread_mutex_lock(&t->lock);
+    put_record(t, IOTRACE_CLOSE, start, handle, 0, 0, 0);
+    pthread_mutex_unlock(&t->lock);
+}
+
+void iotrace_op(mp3tag_iotrace_t *t, iotrace_op_t op,
+                const file_handle_t *fh, uint64_t arg, int64_t result,
+                uint64_t start)
+{
+    pthread_mutex_lock(&t->lock);
+    open_file_t *f = find_open(t, fh);
+    uint32_t handle = f ? f->handle : 0;
+    uint64_t pos = f ? f->pos : 0;
+
+    switch (op) {
+    case IOTRACE_SEEK:
+        put_record(t, op, start, handle, arg, 0, result);
+        if (f && result == 0) f->pos = arg;
+        break;
+    case IOTRACE_READ:
+        put_record(t, op, start, handle, pos, arg, result);
+        if (f && result > 0) f->pos += (uint64_t)result;
+        break;
+    case IOTRACE_WRITE:
+        put_record(t, op, start, handle, pos, arg, result);
+        if (f && result == 0) f->pos += arg;
+        break;
+    default:
+        put_record(t, op, start, handle, 0, 0, result);
+        break;
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+void iotrace_rename(mp3tag_iotrace_t *t, const char *from, const char *to,
+                    int result, uint64_t start)
+{
+    pthread_mutex_lock(&t->lock);
+    uint64_t a = path_id(t, from), b = path_id(t, to);
+    put_record(t, IOTRACE_RENAME, start, 0, a, b, result);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_iotrace_t *mp3tag_iotrace_create(const char *path)
+{
+    if (!path) return NULL;
+    mp3tag_iotrace_t *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->out = fopen(path, "wb");
+    if (!t->out) {
+        free(t);
+        return NULL;
+    }
+    setvbuf(t->out, NULL, _IOFBF, 1 << 16);
+    pthread_mutex_init(&t->lock, NULL);
+
+    uint8_t header[sizeof(IOTRACE_MAGIC)];
+    memcpy(header, IOTRACE_MAGIC, sizeof(IOTRACE_MAGIC) - 1);
+    header[sizeof(IOTRACE_MAGIC) - 1] = IOTRACE_VERSION;
+    emit(t, header, sizeof(header));
+    return t;
+}
+
+int mp3tag_iotrace_destroy(mp3tag_iotrace_t *t)
+{
+    if (!t) return MP3TAG_OK;
+    int error = t->error;
+    if (fclose(t->out) != 0) error = 1;
+    for (size_t i = 0; i < t->n_paths; i++)
+        free(t->paths[i]);
+    free(t->paths);
+    free(t->path_slots);
+    free(t->open);
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+    return error ? MP3TAG_ERR_WRITE_FAILED : MP3TAG_OK;
+}
+
+int mp3tag_set_iotrace(mp3tag_context_t *ctx, mp3tag_iotrace_t *t)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->stats.iotrace = t;
+    return MP3TAG_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Decoding                                                           */
+/* ------------------------------------------------------------------ */
+
+struct iotrace_reader {
+    FILE     *in;
+    uint64_t  start;                /* Of the previous record */
+    char    **paths;
+    size_t    n_paths, cap_paths;
+};
+
+static int get_varint(FILE *in, uint64_t *v)
+{
+    uint64_t x = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int c = getc(in);
+        if (c == EOF) return -1;
+        x |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *v = x;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+iotrace_reader_t *iotrace_reader_open(const char *path)
+{
+    iotrace_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->in = fopen(path, "rb");
+    if (!r->in) {
+        free(r);
+        return NULL;
+    }
+
+    uint8_t header[sizeof(IOTRACE_MAGIC)];
+    if (fread(header, 1, sizeof(header), r->in) != sizeof(header) ||
+        memcmp(header, IOTRACE_MAGIC, sizeof(IOTRACE_MAGIC) - 1) != 0 ||
+        header[sizeof(IOTRACE_MAGIC) - 1] != IOTRACE_VERSION) {
+        iotrace_reader_close(r);
+        errno = EINVAL;
+        return NULL;
+    }
+    return r;
+}
+
+void iotrace_reader_close(iotrace_reader_t *r)
+{
+    if (!r) return;
+    fclose(r->in);
+    for (size_t i = 0; i < r->n_paths; i++)
+        free(r->paths[i]);
+    free(r->paths);
+    free(r);
+}
+
+static int read_path(iotrace_reader_t *r)
+{
+    uint64_t id, len;
+    if (get_varint(r->in, &id) != 0 || get_varint(r->in, &len) != 0 ||
+        id != r->n_paths + 1 || len > 65536)
+        return -1;
+
+    if (r->n_paths == r->cap_paths) {
+        size_t cap = r->cap_paths ? r->cap_paths * 2 : 16;
+        char **grown = realloc(r->paths, cap * sizeof(*grown));
+        if (!grown) return -1;
+        r->paths     = grown;
+        r->cap_paths = cap;
+    }
+    char *path = malloc((size_t)len + 1);
+    if (!path) return -1;
+    if (fread(path, 1, (size_t)len, r->in) != len) {
+        free(path);
+        return -1;
+    }
+    path[len] = '\0';
+    r->paths[r->n_paths++] = path;
+    return 0;
+}
+
+int iotrace_reader_next(iotrace_reader_t *r, iotrace_record_t *rec)
+{
+    for (;;) {
+        int op = getc(r->in);
+        if (op == EOF) return 0;
+        if (op == IOTRACE_PATH) {
+            if (read_path(r) != 0) return -1;
+            continue;
+        }
+        if (op <= IOTRACE_PATH || op >= IOTRACE_OP_END) return -1;
+
+        uint64_t gap, dur, handle, a, b, result;
+        if (get_varint(r->in, &gap) != 0 || get_varint(r->in, &dur) != 0 ||
+            get_varint(r->in, &handle) != 0 || get_varint(r->in, &a) != 0 ||
+            get_varint(r->in, &b) != 0 || get_varint(r->in, &result) != 0 ||
+            handle > UINT32_MAX)
+            return -1;
+
+        r->start += (uint64_t)unzigzag(gap);
+        rec->op          = (iotrace_op_t)op;
+        rec->start_ns    = r->start;
+        rec->duration_ns = dur;
+        rec->handle      = (uint32_t)handle;
+        rec->a           = a;
+        rec->b           = b;
+        rec->result      = unzigzag(result);
+        return 1;
+    }
+}
+
+const char *iotrace_reader_path(const iotrace_reader_t *r, uint64_t id)
+{
+    return id >= 1 && id <= r->n_paths ? r->paths[id - 1] : NULL;
+}
+
+const char *iotrace_op_name(iotrace_op_t op)
+{
+    static const char *const names[IOTRACE_OP_END] = {
+        [IOTRACE_PATH]   = "path",
+        [IOTRACE_OPEN]   = "open",
+        [IOTRACE_CLOSE]  = "close",
+        [IOTRACE_SEEK]   = "seek",
+        [IOTRACE_SIZE]   = "size",
+        [IOTRACE_READ]   = "read",
+        [IOTRACE_WRITE]  = "write",
+        [IOTRACE_SYNC]   = "sync",
+        [IOTRACE_RENAME] = "rename",
+    };
+    if ((unsigned)op >= IOTRACE_OP_END || !names[op]) return "unknown";
+    return names[op];
+}
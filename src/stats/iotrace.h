@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef IOTRACE_H
+#define IOTRACE_H
+
+/*
+ * I/O trace recording (see mp3tag_iotrace_create()) and decoding.
+ *
+ * A trace is the magic "MP3TIOT" and a version byte, then one record
+ * per file-layer call in completion order. All integers are unsigned
+ * LEB128 varints; signed ones are zigzag-encoded first. A record is
+ *
+ *   op, start (ns after the previous record's start, signed),
+ *   duration (ns), handle, a, b, result (signed)
+ *
+ * except IOTRACE_PATH, which is op, id, length, bytes and names a path
+ * before the first record that refers to it. Handles number the opens
+ * of a trace from 1 and are never reused. Per op:
+ *
+ *   OPEN    a = path id, b = 1 for read-write;  result 0 or -1
+ *   CLOSE                                       result 0
+ *   SEEK    a = offset;                         result 0 or -1
+ *   SIZE                                        result size or -1
+ *   READ    a = offset, b = bytes asked;        result bytes read or -1
+ *   WRITE   a = offset, b = bytes;              result 0 or -1
+ *   SYNC                                        result 0 or -1
+ *   RENAME  a = from path id, b = to path id;   result 0 or -1 (handle 0)
+ *
+ * Offsets are tracked by the recorder from seeks and transfer sizes, as
+ * the file layer reads and writes at its current position.
+ */
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include <tag_common/file_io.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    IOTRACE_PATH = 1,
+    IOTRACE_OPEN,
+    IOTRACE_CLOSE,
+    IOTRACE_SEEK,
+    IOTRACE_SIZE,
+    IOTRACE_READ,
+    IOTRACE_WRITE,
+    IOTRACE_SYNC,
+    IOTRACE_RENAME,
+    IOTRACE_OP_END
+} iotrace_op_t;
+
+#define IOTRACE_MAGIC   "MP3TIOT"
+#define IOTRACE_VERSION 1
+
+/* ---------- Recording (called by the io_* wrappers in stats.h) ---------- */
+
+void iotrace_open(mp3tag_iotrace_t *t, const file_handle_t *fh,
+                  const char *path, int writable, uint64_t start);
+
+/*
+ * Forget `fh` before file_close() frees it, so a concurrent open that
+ * gets the same pointer is not mistaken for it; pass the returned
+ * handle to iotrace_closed() afterwards.
+ */
+uint32_t iotrace_closing(mp3tag_iotrace_t *t, const file_handle_t *fh);
+void     iotrace_closed(mp3tag_iotrace_t *t, uint32_t handle,
+                        uint64_t start);
+
+/*
+ * SEEK: `arg` is the offset; READ and WRITE: the byte count. `result`
+ * as in the table above.
+ */
+void iotrace_op(mp3tag_iotrace_t *t, iotrace_op_t op,
+                const file_handle_t *fh, uint64_t arg, int64_t result,
+                uint64_t start);
+
+void iotrace_rename(mp3tag_iotrace_t *t, const char *from, const char *to,
+                    int result, uint64_t start);
+
+/* ---------- Decoding ---------- */
+
+typedef struct {
+    iotrace_op_t op;
+    uint64_t     start_ns;          /* Since the first record */
+    uint64_t     duration_ns;
+    uint32_t     handle;
+    uint64_t     a, b;
+    int64_t      result;
+} iotrace_record_t;
+
+typedef struct iotrace_reader iotrace_reader_t;
+
+/* NULL with errno set; EINVAL if the file is not a trace */
+iotrace_reader_t *iotrace_reader_open(const char *path);
+void              iotrace_reader_close(iotrace_reader_t *r);
+
+/*
+ * Next call record (path records are absorbed). Returns 1, 0 at the
+ * end of the trace, or -1 if it is truncated or corrupt.
+ */
+int iotrace_reader_next(iotrace_reader_t *r, iotrace_record_t *rec);
+
+/* Path named by `id` so far, or NULL */
+const char *iotrace_reader_path(const iotrace_reader_t *r, uint64_t id);
+
+/* "open", "read", ... */
+const char *iotrace_op_name(iotrace_op_t op);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTRACE_H */
@@ -0,0 +1,496 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Metrics registry in the Prometheus text exposition format.
+ *
+ * Contexts publish their counter deltas when their outermost public call
+ * returns (relaxed atomic adds of the words that changed), phases land
+ * in a shared latency histogram, and opens, reads and writes are counted
+ * with their errors. Rendering reads the atomics without stopping the
+ * writers, so one scrape may see a call's counters before its phases.
+ * The optional endpoint is a thread answering one client at a time on a
+ * unix socket, with an HTTP response to a GET and a bare body otherwise.
+ */
+
+#define _DEFAULT_SOURCE     /* lstat, S_ISSOCK */
+#define _DARWIN_C_SOURCE
+
+#include "metrics.h"
+#include "stats.h"
+#include "../mp3tag_internal.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define STATS_WORDS  (sizeof(mp3tag_stats_t) / sizeof(uint64_t))
+#define ERROR_SLOTS  64             /* Index = -code; 0 = unknown code */
+
+_Static_assert(sizeof(mp3tag_stats_t) % sizeof(uint64_t) == 0,
+               "mp3tag_stats_t must be made of uint64_t counters");
+
+struct mp3tag_metrics {
+    atomic_uint_least64_t counters[STATS_WORDS];   /* Of mp3tag_stats_t */
+    atomic_uint_least64_t calls[METRICS_OP_COUNT];
+    atomic_uint_least64_t call_ns[METRICS_OP_COUNT];
+    atomic_uint_least64_t errors[METRICS_OP_COUNT][ERROR_SLOTS];
+    atomic_uint_least64_t files;                   /* Successful opens */
+
+    mp3tag_histogram_t   *phases;
+    mp3tag_trace_hooks_t  hooks;
+
+    /* Endpoint (mp3tag_metrics_serve()) */
+    int                   serving;
+    int                   listen_fd;
+    int                   wake[2];  /* Written by destroy to stop */
+    pthread_t             thread;
+    char                 *socket_path;
+};
+
+/* Phase histogram bounds: 1 us to 10 s */
+static const uint64_t phase_bounds[] = {
+    1000, 10000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000u,
+    5000000000u, 10000000000u,
+};
+
+#define PHASE_BOUNDS (sizeof(phase_bounds) / sizeof(phase_bounds[0]))
+
+/* ------------------------------------------------------------------ */
+/*  Recording                                                          */
+/* ------------------------------------------------------------------ */
+
+void metrics_flush(mp3tag_metrics_t *m, const mp3tag_stats_t *counters,
+                   mp3tag_stats_t *flushed)
+{
+    const uint64_t *now  = (const uint64_t *)counters;
+    uint64_t       *done = (uint64_t *)flushed;
+    for (size_t i = 0; i < STATS_WORDS; i++) {
+        if (now[i] == done[i]) continue;
+        atomic_fetch_add_explicit(&m->counters[i], now[i] - done[i],
+                                  memory_order_relaxed);
+        done[i] = now[i];
+    }
+}
+
+void metrics_phase_begin(mp3tag_metrics_t *m, mp3tag_phase_t phase)
+{
+    m->hooks.begin(phase, m->hooks.user_data);
+}
+
+void metrics_phase_end(mp3tag_metrics_t *m, mp3tag_phase_t phase,
+                       uint64_t bytes)
+{
+    m->hooks.end(phase, bytes, m->hooks.user_data);
+}
+
+void metrics_op(mp3tag_metrics_t *m, metrics_op_t op, int rc,
+                uint64_t start_ns)
+{
+    atomic_fetch_add_explicit(&m->calls[op], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->call_ns[op], stats_now_ns() - start_ns,
+                              memory_order_relaxed);
+    if (op == METRICS_OP_OPEN && rc == MP3TAG_OK)
+        atomic_fetch_add_explicit(&m->files, 1, memory_order_relaxed);
+    if (rc < 0) {
+        unsigned slot = -rc < ERROR_SLOTS ? (unsigned)-rc : 0;
+        atomic_fetch_add_explicit(&m->errors[op][slot], 1,
+                                  memory_order_relaxed);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Rendering                                                          */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    char   *buf;
+    size_t  size;
+    size_t  len;                    /* Needed so far, may exceed size */
+} out_t;
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+static void put(out_t *o, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int room = o->buf && o->len < o->size ? (int)(o->size - o->len) : 0;
+    int w = vsnprintf(room ? o->buf + o->len : NULL, (size_t)room, fmt, ap);
+    va_end(ap);
+    if (w > 0) o->len += (size_t)w;
+}
+
+static void header(out_t *o, const char *name, const char *type,
+                   const char *help)
+{
+    put(o, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static const char *error_name(unsigned slot)
+{
+    switch (-(int)slot) {
+    case MP3TAG_ERR_INVALID_ARG:    return "MP3TAG_ERR_INVALID_ARG";
+    case MP3TAG_ERR_NO_MEMORY:      return "MP3TAG_ERR_NO_MEMORY";
+    case MP3TAG_ERR_IO:             return "MP3TAG_ERR_IO";
+    case MP3TAG_ERR_NOT_OPEN:       return "MP3TAG_ERR_NOT_OPEN";
+    case MP3TAG_ERR_ALREADY_OPEN:   return "MP3TAG_ERR_ALREADY_OPEN";
+    case MP3TAG_ERR_READ_ONLY:      return "MP3TAG_ERR_READ_ONLY";
+    case MP3TAG_ERR_NOT_MP3:        return "MP3TAG_ERR_NOT_MP3";
+    case MP3TAG_ERR_BAD_ID3V2:      return "MP3TAG_ERR_BAD_ID3V2";
+    case MP3TAG_ERR_CORRUPT:        return "MP3TAG_ERR_CORRUPT";
+    case MP3TAG_ERR_TRUNCATED:      return "MP3TAG_ERR_TRUNCATED";
+    case MP3TAG_ERR_UNSUPPORTED:    return "MP3TAG_ERR_UNSUPPORTED";
+    case MP3TAG_ERR_NO_TAGS:        return "MP3TAG_ERR_NO_TAGS";
+    case MP3TAG_ERR_TAG_NOT_FOUND:  return "MP3TAG_ERR_TAG_NOT_FOUND";
+    case MP3TAG_ERR_TAG_TOO_LARGE:  return "MP3TAG_ERR_TAG_TOO_LARGE";
+    case MP3TAG_ERR_NO_SPACE:       return "MP3TAG_ERR_NO_SPACE";
+    case MP3TAG_ERR_WRITE_FAILED:   return "MP3TAG_ERR_WRITE_FAILED";
+    case MP3TAG_ERR_SEEK_FAILED:    return "MP3TAG_ERR_SEEK_FAILED";
+    case MP3TAG_ERR_RENAME_FAILED:  return "MP3TAG_ERR_RENAME_FAILED";
+    case MP3TAG_ERR_WORKER_CRASHED: return "MP3TAG_ERR_WORKER_CRASHED";
+    default:                        return "unknown";
+    }
+}
+
+static uint64_t load(const atomic_uint_least64_t *v)
+{
+    return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+static void render(const mp3tag_metrics_t *m, out_t *o)
+{
+    static const char *const ops[METRICS_OP_COUNT] = {
+        "open", "read", "write",
+    };
+    static const char *const syscalls[] = {
+        "open", "close", "read", "write", "seek", "stat", "fsync", "rename",
+    };
+    static const char *const strategies[MP3TAG_WRITE_STRATEGY_COUNT] = {
+        "in_place", "append", "container_rewrite", "raw_rewrite",
+    };
+    static const char *const encodings[MP3TAG_ENC_COUNT] = {
+        "latin1", "utf16", "utf16be", "utf8",
+    };
+
+    mp3tag_stats_t st;
+    uint64_t *words = (uint64_t *)&st;
+    for (size_t i = 0; i < STATS_WORDS; i++)
+        words[i] = load(&m->counters[i]);
+
+    header(o, "mp3tag_build_info", "gauge", "Library version.");
+    put(o, "mp3tag_build_info{version=\"%s\"} 1\n", mp3tag_version());
+
+    header(o, "mp3tag_files_opened_total", "counter",
+           "Files opened successfully; rate() gives files per second.");
+    put(o, "mp3tag_files_opened_total %llu\n",
+        (unsigned long long)load(&m->files));
+
+    header(o, "mp3tag_calls_total", "counter",
+           "Opens, tag reads and tag writes.");
+    for (unsigned op = 0; op < METRICS_OP_COUNT; op++)
+        put(o, "mp3tag_calls_total{op=\"%s\"} %llu\n", ops[op],
+            (unsigned long long)load(&m->calls[op]));
+
+    header(o, "mp3tag_call_seconds_total", "counter",
+           "Time spent in opens, tag reads and tag writes.");
+    for (unsigned op = 0; op < METRICS_OP_COUNT; op++)
+        put(o, "mp3tag_call_seconds_total{op=\"%s\"} %.9f\n", ops[op],
+            (double)load(&m->call_ns[op]) / 1e9);
+
+    header(o, "mp3tag_call_errors_total", "counter",
+           "Failed calls by MP3TAG_ERR_* code.");
+    for (unsigned op = 0; op < METRICS_OP_COUNT; op++)
+        for (unsigned e = 0; e < ERROR_SLOTS; e++) {
+            uint64_t n = load(&m->errors[op][e]);
+            if (n)
+                put(o, "mp3tag_call_errors_total{op=\"%s\",code=\"%s\"} "
+                       "%llu\n", ops[op], error_name(e),
+                    (unsigned long long)n);
+        }
+
+    header(o, "mp3tag_read_bytes_total", "counter",
+           "Bytes read through the file layer.");
+    put(o, "mp3tag_read_bytes_total %llu\n",
+        (unsigned long long)st.bytes_read);
+    header(o, "mp3tag_written_bytes_total", "counter",
+           "Bytes written through the file layer.");
+    put(o, "mp3tag_written_bytes_total %llu\n",
+        (unsigned long long)st.bytes_written);
+
+    const uint64_t calls[] = {
+        st.syscalls.open, st.syscalls.close, st.syscalls.read,
+        st.syscalls.write, st.syscalls.seek, st.syscalls.stat,
+        st.syscalls.fsync, st.syscalls.rename,
+    };
+    header(o, "mp3tag_syscalls_total", "counter",
+           "File-layer calls, one system call each.");
+    for (size_t i = 0; i < sizeof(calls) / sizeof(calls[0]); i++)
+        put(o, "mp3tag_syscalls_total{call=\"%s\"} %llu\n", syscalls[i],
+            (unsigned long long)calls[i]);
+
+    header(o, "mp3tag_writes_total", "counter",
+           "Tag writes by the strategy that reached the file.");
+    for (unsigned i = 0; i < MP3TAG_WRITE_STRATEGY_COUNT; i++)
+        put(o, "mp3tag_writes_total{strategy=\"%s\"} %llu\n", strategies[i],
+            (unsigned long long)st.write_strategy[i]);
+
+    header(o, "mp3tag_copied_bytes_total", "counter",
+           "Bytes moved by rewrites.");
+    put(o, "mp3tag_copied_bytes_total %llu\n",
+        (unsigned long long)st.bytes_copied);
+    header(o, "mp3tag_fsync_seconds_total", "counter", "Time spent in fsync.");
+    put(o, "mp3tag_fsync_seconds_total %.9f\n", (double)st.fsync_ns / 1e9);
+
+    header(o, "mp3tag_frames_parsed_total", "counter",
+           "ID3v2 frames parsed.");
+    put(o, "mp3tag_frames_parsed_total %llu\n",
+        (unsigned long long)st.frames_parsed);
+    header(o, "mp3tag_frames_skipped_total", "counter",
+           "Compressed or encrypted ID3v2 frames skipped.");
+    put(o, "mp3tag_frames_skipped_total %llu\n",
+        (unsigned long long)st.frames_skipped);
+    header(o, "mp3tag_transcoded_bytes_total", "counter",
+           "Source text bytes transcoded, by ID3v2 encoding.");
+    for (unsigned i = 0; i < MP3TAG_ENC_COUNT; i++)
+        put(o, "mp3tag_transcoded_bytes_total{encoding=\"%s\"} %llu\n",
+            encodings[i], (unsigned long long)st.transcoded_bytes[i]);
+
+    header(o, "mp3tag_allocations_total", "counter", "Heap allocations.");
+    put(o, "mp3tag_allocations_total %llu\n",
+        (unsigned long long)st.allocations);
+    header(o, "mp3tag_allocated_bytes_total", "counter",
+           "Bytes requested from the heap.");
+    put(o, "mp3tag_allocated_bytes_total %llu\n",
+        (unsigned long long)st.bytes_allocated);
+
+    header(o, "mp3tag_phase_seconds", "histogram",
+           "Latency of read and write phases.");
+    for (unsigned ph = 0; ph < MP3TAG_PHASE_COUNT; ph++) {
+        uint64_t counts[PHASE_BOUNDS], total, sum_ns;
+        const char *name = mp3tag_phase_name((mp3tag_phase_t)ph);
+        histogram_cumulative(m->phases, (mp3tag_phase_t)ph, phase_bounds,
+                             PHASE_BOUNDS, counts, &total, &sum_ns);
+        for (size_t b = 0; b < PHASE_BOUNDS; b++)
+            put(o, "mp3tag_phase_seconds_bucket{phase=\"%s\",le=\"%g\"} "
+                   "%llu\n", name, (double)phase_bounds[b] / 1e9,
+                (unsigned long long)counts[b]);
+        put(o, "mp3tag_phase_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+               "mp3tag_phase_seconds_sum{phase=\"%s\"} %.9f\n"
+               "mp3tag_phase_seconds_count{phase=\"%s\"} %llu\n",
+            name, (unsigned long long)total, name, (double)sum_ns / 1e9,
+            name, (unsigned long long)total);
+    }
+
+    header(o, "mp3tag_phase_bytes_total", "counter",
+           "Bytes handled per phase.");
+    for (unsigned ph = 0; ph < MP3TAG_PHASE_COUNT; ph++)
+        put(o, "mp3tag_phase_bytes_total{phase=\"%s\"} %llu\n",
+            mp3tag_phase_name((mp3tag_phase_t)ph),
+            (unsigned long long)mp3tag_histogram_bytes(m->phases,
+                                                       (mp3tag_phase_t)ph));
+}
+
+/* ------------------------------------------------------------------ */
+/*  Unix-socket endpoint                                               */
+/* ------------------------------------------------------------------ */
+
+#define CLIENT_WAIT_MS 100          /* For a request line, if any */
+
+static void send_all(int fd, const char *p, size_t n)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;            /* SO_NOSIGPIPE is set on the socket */
+#endif
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, flags);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return;
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+static void serve_client(mp3tag_metrics_t *m, int fd)
+{
+    struct timeval tv = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    /* Clients that send nothing (e.g. socat) get the bare body */
+    char req[512];
+    ssize_t got = 0;
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    if (poll(&p, 1, CLIENT_WAIT_MS) > 0)
+        got = recv(fd, req, sizeof(req), 0);
+    int http = got >= 4 && memcmp(req, "GET ", 4) == 0;
+
+    out_t o = { 0 };
+    render(m, &o);
+    o.size = o.len + 1;
+    o.buf  = malloc(o.size);
+    if (!o.buf) return;
+    o.len = 0;
+    render(m, &o);
+    if (o.len >= o.size) o.len = o.size - 1;   /* Grew in between */
+
+    if (http) {
+        char head[160];
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\n"
+                         "Connection: close\r\n\r\n", o.len);
+        send_all(fd, head, (size_t)n);
+    }
+    send_all(fd, o.buf, o.len);
+    free(o.buf);
+}
+
+static void *serve_thread(void *arg)
+{
+    mp3tag_metrics_t *m = arg;
+    struct pollfd fds[2] = {
+        { .fd = m->listen_fd, .events = POLLIN },
+        { .fd = m->wake[0],   .events = POLLIN },
+    };
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+        int fd = accept(m->listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        serve_client(m, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_metrics_t *mp3tag_metrics_create(void)
+{
+    mp3tag_metrics_t *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    m->phases = mp3tag_histogram_create();
+    if (!m->phases) {
+        free(m);
+        return NULL;
+    }
+    mp3tag_histogram_hooks(m->phases, &m->hooks);
+    for (size_t i = 0; i < STATS_WORDS; i++)
+        atomic_init(&m->counters[i], 0);
+    atomic_init(&m->files, 0);
+    for (unsigned op = 0; op < METRICS_OP_COUNT; op++) {
+        atomic_init(&m->calls[op], 0);
+        atomic_init(&m->call_ns[op], 0);
+        for (unsigned e = 0; e < ERROR_SLOTS; e++)
+            atomic_init(&m->errors[op][e], 0);
+    }
+    return m;
+}
+
+void mp3tag_metrics_destroy(mp3tag_metrics_t *m)
+{
+    if (!m) return;
+    if (m->serving) {
+        ssize_t w;
+        do {
+            w = write(m->wake[1], "x", 1);
+        } while (w < 0 && errno == EINTR);
+        pthread_join(m->thread, NULL);
+        close(m->listen_fd);
+        close(m->wake[0]);
+        close(m->wake[1]);
+        unlink(m->socket_path);
+        free(m->socket_path);
+    }
+    mp3tag_histogram_destroy(m->phases);
+    free(m);
+}
+
+int mp3tag_set_metrics(mp3tag_context_t *ctx, mp3tag_metrics_t *m)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    ctx->stats.metrics = m;
+    ctx->stats.flushed = ctx->stats.counters;   /* Count from here on */
+    return MP3TAG_OK;
+}
+
+size_t mp3tag_metrics_render(const mp3tag_metrics_t *m, char *buf,
+                             size_t size)
+{
+    if (!m) {
+        if (buf && size > 0) buf[0] = '\0';
+        return 0;
+    }
+    out_t o = { buf, size, 0 };
+    render(m, &o);
+    if (buf && size > 0 && o.len >= size)
+        buf[size - 1] = '\0';
+    return o.len;
+}
+
+int mp3tag_metrics_serve(mp3tag_metrics_t *m, const char *socket_path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (!m || !socket_path ||
+        strlen(socket_path) >= sizeof(addr.sun_path))
+        return MP3TAG_ERR_INVALID_ARG;
+    if (m->serving) return MP3TAG_ERR_ALREADY_OPEN;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+
+    /* A socket left behind by a previous process; never other files */
+    struct stat st;
+    if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(socket_path);
+
+    m->socket_path = str_dup(socket_path);
+    if (!m->socket_path) return MP3TAG_ERR_NO_MEMORY;
+
+    m->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int bound = m->listen_fd >= 0 &&
+                bind(m->listen_fd, (struct sockaddr *)&addr,
+                     sizeof(addr)) == 0;
+    if (!bound || listen(m->listen_fd, 16) != 0 || pipe(m->wake) != 0) {
+        if (m->listen_fd >= 0) close(m->listen_fd);
+        if (bound) unlink(socket_path);
+        free(m->socket_path);
+        m->socket_path = NULL;
+        return MP3TAG_ERR_IO;
+    }
+    if (pthread_create(&m->thread, NULL, serve_thread, m) != 0) {
+        close(m->listen_fd);
+        close(m->wake[0]);
+        close(m->wake[1]);
+        unlink(socket_path);
+        free(m->socket_path);
+        m->socket_path = NULL;
+        return MP3TAG_ERR_NO_MEMORY;
+    }
+    m->serving = 1;
+    return MP3TAG_OK;
+}
@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Public calls counted and timed by the registry */
+typedef enum {
+    METRICS_OP_OPEN = 0,           /* mp3tag_open(), mp3tag_open_rw() */
+    METRICS_OP_READ,               /* mp3tag_read_tags() */
+    METRICS_OP_WRITE,              /* mp3tag_write_tags() */
+    METRICS_OP_COUNT
+} metrics_op_t;
+
+/*
+ * Add what `counters` gained since `flushed` to the registry, then
+ * catch `flushed` up. Called by stats_leave() on the context's thread.
+ */
+void metrics_flush(mp3tag_metrics_t *m, const mp3tag_stats_t *counters,
+                   mp3tag_stats_t *flushed);
+
+/* Phase latencies, fed by TRACE_BEGIN / TRACE_END */
+void metrics_phase_begin(mp3tag_metrics_t *m, mp3tag_phase_t phase);
+void metrics_phase_end(mp3tag_metrics_t *m, mp3tag_phase_t phase,
+                       uint64_t bytes);
+
+/* One finished call that started at `start_ns` (stats_now_ns()) */
+void metrics_op(mp3tag_metrics_t *m, metrics_op_t op, int rc,
+                uint64_t start_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H */
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/*
+ * Static tracepoints (USDT) under the "mp3tag" provider. Built with
+ * MP3TAG_USDT (the MP3TAG_ENABLE_USDT CMake option) each probe is a
+ * single nop plus an ELF note that bpftrace, perf and SystemTap can
+ * attach to in any binary the library is linked into; otherwise the
+ * macros expand to nothing and their arguments are not evaluated.
+ *
+ * Probe                 Arguments
+ * open__start           ctx, path, writable
+ * open__done            ctx, rc, bytes_read, bytes_written (cumulative)
+ * probe__start          ctx
+ * probe__done           ctx, rc, container type, ID3v2 tag size
+ * read__start           ctx
+ * read__done            ctx, rc
+ * frame__parse          frame ID, payload size, skipped
+ * serialize__start      ctx
+ * serialize__done       ctx, rc, bytes
+ * write__start          ctx, path, serialized bytes
+ * write__strategy       ctx, mp3tag_write_strategy_t
+ * write__done           ctx, rc
+ * rewrite__copy         path, bytes copied so far, bytes to copy
+ * close                 ctx, path, bytes_read, bytes_written (cumulative)
+ *
+ * Names use double underscores, which the tools show as dashes.
+ */
+
+#ifdef MP3TAG_USDT
+
+#include <sys/sdt.h>
+
+#define MP3TAG_PROBE1(name, a) \
+    DTRACE_PROBE1(mp3tag, name, a)
+#define MP3TAG_PROBE2(name, a, b) \
+    DTRACE_PROBE2(mp3tag, name, a, b)
+#define MP3TAG_PROBE3(name, a, b, c) \
+    DTRACE_PROBE3(mp3tag, name, a, b, c)
+#define MP3TAG_PROBE4(name, a, b, c, d) \
+    DTRACE_PROBE4(mp3tag, name, a, b, c, d)
+
+#else
+
+#define MP3TAG_PROBE1(name, a)              ((void)0)
+#define MP3TAG_PROBE2(name, a, b)           ((void)0)
+#define MP3TAG_PROBE3(name, a, b, c)        ((void)0)
+#define MP3TAG_PROBE4(name, a, b, c, d)     ((void)0)
+
+#endif
+
+#endif /* PROBES_H */
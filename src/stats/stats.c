@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+#include "../mp3tag_internal.h"
+#include "../../include/mp3tag/mp3tag.h"
+
+#include <string.h>
+#include <time.h>
+
+_Thread_local stats_scope_t *stats_current;
+
+uint64_t stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+int mp3tag_get_stats(const mp3tag_context_t *ctx, mp3tag_stats_t *stats)
+{
+    if (!ctx || !stats) return MP3TAG_ERR_INVALID_ARG;
+    *stats = ctx->stats.counters;
+    return MP3TAG_OK;
+}
+
+void mp3tag_reset_stats(mp3tag_context_t *ctx)
+{
+    if (!ctx) return;
+    memset(&ctx->stats.counters, 0, sizeof(ctx->stats.counters));
+    memset(&ctx->stats.flushed, 0, sizeof(ctx->stats.flushed));
+}
+
+int mp3tag_set_trace(mp3tag_context_t *ctx, const mp3tag_trace_hooks_t *hooks)
+{
+    if (!ctx) return MP3TAG_ERR_INVALID_ARG;
+    if (hooks) {
+        ctx->trace_hooks = *hooks;
+        ctx->stats.trace = &ctx->trace_hooks;
+    } else {
+        ctx->stats.trace = NULL;
+    }
+    return MP3TAG_OK;
+}
+
+const char *mp3tag_phase_name(mp3tag_phase_t phase)
+{
+    static const char *const names[MP3TAG_PHASE_COUNT] = {
+        "container_detect",
+        "id3v2_header",
+        "id3v2_frames",
+        "frames_to_collection",
+        "serialize",
+        "inplace_write",
+        "rewrite_copy",
+        "fsync",
+        "rename",
+    };
+    if ((unsigned)phase >= MP3TAG_PHASE_COUNT) return "unknown";
+    return names[phase];
+}
@@ -0,0 +1,354 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "../../include/mp3tag/mp3tag_types.h"
+#include "iotrace.h"
+#include "metrics.h"
+#include "probes.h"
+#include <tag_common/buffer.h>
+#include <tag_common/file_io.h>
+#include <tag_common/string_util.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-context instrumentation state */
+typedef struct {
+    mp3tag_stats_t              counters;
+    const mp3tag_trace_hooks_t *trace;      /* NULL = tracing off */
+    mp3tag_iotrace_t           *iotrace;    /* NULL = not recording */
+    mp3tag_metrics_t           *metrics;    /* NULL = not exported */
+    mp3tag_stats_t              flushed;    /* Counters added to metrics */
+} stats_scope_t;
+
+/*
+ * Instrumentation of the context whose public call is running on this
+ * thread, or NULL. Public entry points bracket their work with
+ * stats_enter() / stats_leave(), so the format layers can count without
+ * a context argument. Counting costs a thread-local load and an add.
+ */
+extern _Thread_local stats_scope_t *stats_current;
+
+#define STATS_ADD(field, n) do { \
+    stats_scope_t *s_ = stats_current; \
+    if (s_) s_->counters.field += (uint64_t)(n); \
+} while (0)
+
+#define STATS_INC(field) STATS_ADD(field, 1)
+
+static inline stats_scope_t *stats_enter(stats_scope_t *scope)
+{
+    stats_scope_t *prev = stats_current;
+    stats_current = scope;
+    return prev;
+}
+
+/* Leaving the outermost call on a context publishes its counts */
+static inline void stats_leave(stats_scope_t *prev)
+{
+    stats_scope_t *s = stats_current;
+    if (s && s != prev && s->metrics)
+        metrics_flush(s->metrics, &s->counters, &s->flushed);
+    stats_current = prev;
+}
+
+/*
+ * Phase markers for the hooks and metrics registry of the context whose
+ * call is running on this thread. Without either they cost a
+ * thread-local load and two branches.
+ */
+#define TRACE_BEGIN(phase) do { \
+    stats_scope_t *s_ = stats_current; \
+    if (s_ && s_->trace && s_->trace->begin) \
+        s_->trace->begin((phase), s_->trace->user_data); \
+    if (s_ && s_->metrics) \
+        metrics_phase_begin(s_->metrics, (phase)); \
+} while (0)
+
+#define TRACE_END(phase, bytes) do { \
+    stats_scope_t *s_ = stats_current; \
+    if (s_ && s_->trace && s_->trace->end) \
+        s_->trace->end((phase), (uint64_t)(bytes), s_->trace->user_data); \
+    if (s_ && s_->metrics) \
+        metrics_phase_end(s_->metrics, (phase), (uint64_t)(bytes)); \
+} while (0)
+
+/* Bytes moved through the file layer so far, for per-phase deltas */
+static inline uint64_t trace_io_bytes(void)
+{
+    stats_scope_t *s = stats_current;
+    return s ? s->counters.bytes_read + s->counters.bytes_written : 0;
+}
+
+/* Monotonic clock in nanoseconds */
+uint64_t stats_now_ns(void);
+
+/*
+ * Cumulative counts of `phase` at or below each of the `n` ascending
+ * `bounds` (ns), plus the total count and summed ns, read in one pass
+ * so they agree with each other. Within the histogram's 1/64
+ * precision: a value just above a bound may be counted under it.
+ */
+void histogram_cumulative(const mp3tag_histogram_t *h, mp3tag_phase_t phase,
+                          const uint64_t *bounds, size_t n, uint64_t *counts,
+                          uint64_t *total, uint64_t *sum_ns);
+
+/* ------------------------------------------------------------------ */
+/*  Counted file I/O                                                   */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Recorder of the calling context, and the start time of the call it
+ * is about to record. Without a recorder: a thread-local load and a
+ * branch per call.
+ */
+static inline mp3tag_iotrace_t *io_recorder(uint64_t *start)
+{
+    stats_scope_t *s = stats_current;
+    mp3tag_iotrace_t *t = s ? s->iotrace : NULL;
+    *start = t ? stats_now_ns() : 0;
+    return t;
+}
+
+static inline file_handle_t *io_open_read(const char *path)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.open);
+    file_handle_t *fh = file_open_read(path);
+    if (t) iotrace_open(t, fh, path, 0, start);
+    return fh;
+}
+
+static inline file_handle_t *io_open_rw(const char *path)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.open);
+    file_handle_t *fh = file_open_rw(path);
+    if (t) iotrace_open(t, fh, path, 1, start);
+    return fh;
+}
+
+static inline void io_close(file_handle_t *fh)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    uint32_t handle = t ? iotrace_closing(t, fh) : 0;
+    STATS_INC(syscalls.close);
+    file_close(fh);
+    if (t) iotrace_closed(t, handle, start);
+}
+
+static inline int io_seek(file_handle_t *fh, int64_t off)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.seek);
+    int rc = file_seek(fh, off);
+    if (t) iotrace_op(t, IOTRACE_SEEK, fh, (uint64_t)off, rc ? -1 : 0, start);
+    return rc;
+}
+
+static inline int64_t io_size(file_handle_t *fh)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.stat);
+    int64_t size = file_size(fh);
+    if (t) iotrace_op(t, IOTRACE_SIZE, fh, 0, size < 0 ? -1 : size, start);
+    return size;
+}
+
+static inline int io_stat(file_handle_t *fh, struct stat *st)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.stat);
+    int rc = file_stat(fh, st);
+    if (t) iotrace_op(t, IOTRACE_SIZE, fh, 0, rc ? -1 : st->st_size, start);
+    return rc;
+}
+
+static inline int io_read(file_handle_t *fh, void *buf, size_t n)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.read);
+    int rc = file_read(fh, buf, n);
+    if (rc == 0) STATS_ADD(bytes_read, n);
+    if (t) iotrace_op(t, IOTRACE_READ, fh, n, rc ? -1 : (int64_t)n, start);
+    return rc;
+}
+
+static inline int64_t io_read_partial(file_handle_t *fh, void *buf, size_t n)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.read);
+    int64_t got = file_read_partial(fh, buf, n);
+    if (got > 0) STATS_ADD(bytes_read, got);
+    if (t) iotrace_op(t, IOTRACE_READ, fh, n, got < 0 ? -1 : got, start);
+    return got;
+}
+
+static inline int io_write(file_handle_t *fh, const void *buf, size_t n)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.write);
+    int rc = file_write(fh, buf, n);
+    if (rc == 0) STATS_ADD(bytes_written, n);
+    if (t) iotrace_op(t, IOTRACE_WRITE, fh, n, rc ? -1 : 0, start);
+    return rc;
+}
+
+static inline int io_sync(file_handle_t *fh)
+{
+    if (!stats_current)
+        return file_sync(fh);
+
+    TRACE_BEGIN(MP3TAG_PHASE_FSYNC);
+    uint64_t start = stats_now_ns();
+    int rc = file_sync(fh);
+    uint64_t end = stats_now_ns();
+    stats_current->counters.syscalls.fsync++;
+    stats_current->counters.fsync_ns += end - start;
+    if (stats_current->iotrace)
+        iotrace_op(stats_current->iotrace, IOTRACE_SYNC, fh, 0,
+                   rc ? -1 : 0, start);
+    TRACE_END(MP3TAG_PHASE_FSYNC, 0);
+    return rc;
+}
+
+/* rename() of a rewrite's temp file over the original, as a phase */
+static inline int io_rename(const char *from, const char *to)
+{
+    uint64_t start;
+    mp3tag_iotrace_t *t = io_recorder(&start);
+    STATS_INC(syscalls.rename);
+    TRACE_BEGIN(MP3TAG_PHASE_RENAME);
+    int rc = rename(from, to);
+    TRACE_END(MP3TAG_PHASE_RENAME, 0);
+    if (t) iotrace_rename(t, from, to, rc ? -1 : 0, start);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Counted allocation                                                 */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Call-site tags for internal allocations. Only profiling builds
+ * (MP3TAG_ALLOC_PROFILE) record them; see mp3tag_alloc_profile().
+ * Keep in step with the names in alloc_profile.c.
+ */
+typedef enum {
+    ALLOC_PATH = 0,          /* Context's copy of the file path */
+    ALLOC_COLLECTION,        /* Collection and tag nodes */
+    ALLOC_SIMPLE_TAG,        /* Simple-tag nodes */
+    ALLOC_TAG_TEXT,          /* Simple-tag names, values, languages */
+    ALLOC_BINARY,            /* Simple-tag binary payloads */
+    ALLOC_FRAME,             /* Parsed ID3v2 frame nodes */
+    ALLOC_FRAME_DATA,        /* Raw ID3v2 frame payloads */
+    ALLOC_DECODED_TEXT,      /* Text decoded to UTF-8 */
+    ALLOC_BUFFER_GROWTH,     /* dyn_buffer reallocations */
+    ALLOC_REWRITE,           /* Temp paths and tag blocks for rewrites */
+    ALLOC_TAG_COUNT
+} alloc_tag_t;
+
+#ifdef MP3TAG_ALLOC_PROFILE
+void alloc_profile_add(alloc_tag_t tag, const void *p, size_t size);
+void alloc_profile_remove(const void *p);
+void alloc_profile_resize(alloc_tag_t tag, size_t old_size, size_t new_size);
+#else
+#define alloc_profile_add(tag, p, size)              ((void)0)
+#define alloc_profile_remove(p)                      ((void)0)
+#define alloc_profile_resize(tag, old_size, new_size) ((void)0)
+#endif
+
+static inline void *mem_malloc(alloc_tag_t tag, size_t size)
+{
+    (void)tag;
+    STATS_INC(allocations);
+    STATS_ADD(bytes_allocated, size);
+    void *p = malloc(size);
+    if (p) alloc_profile_add(tag, p, size);
+    return p;
+}
+
+static inline void *mem_calloc(alloc_tag_t tag, size_t count, size_t size)
+{
+    (void)tag;
+    STATS_INC(allocations);
+    STATS_ADD(bytes_allocated, count * size);
+    void *p = calloc(count, size);
+    if (p) alloc_profile_add(tag, p, count * size);
+    return p;
+}
+
+static inline char *mem_strdup(alloc_tag_t tag, const char *s)
+{
+    (void)tag;
+    if (!s) return NULL;
+    STATS_INC(allocations);
+    STATS_ADD(bytes_allocated, strlen(s) + 1);
+    char *p = str_dup(s);
+    if (p) alloc_profile_add(tag, p, strlen(s) + 1);
+    return p;
+}
+
+/* Free anything; tagged blocks are also dropped from the profile */
+static inline void mem_free(void *p)
+{
+    if (p) alloc_profile_remove(p);
+    free(p);
+}
+
+/*
+ * dyn_buffer appends that account for the reallocations they cause.
+ * Pair with buf_free() so profiling builds see the memory go away.
+ */
+static inline void buf_grew(size_t old_capacity, size_t new_capacity)
+{
+    if (new_capacity == old_capacity) return;
+    STATS_INC(allocations);
+    STATS_ADD(bytes_allocated, new_capacity);
+    alloc_profile_resize(ALLOC_BUFFER_GROWTH, old_capacity, new_capacity);
+}
+
+static inline int buf_append(dyn_buffer_t *buf, const void *data, size_t n)
+{
+    size_t cap = buf->capacity;
+    int rc = buffer_append(buf, data, n);
+    buf_grew(cap, buf->capacity);
+    return rc;
+}
+
+static inline int buf_append_byte(dyn_buffer_t *buf, uint8_t byte)
+{
+    size_t cap = buf->capacity;
+    int rc = buffer_append_byte(buf, byte);
+    buf_grew(cap, buf->capacity);
+    return rc;
+}
+
+static inline void buf_free(dyn_buffer_t *buf)
+{
+    alloc_profile_resize(ALLOC_BUFFER_GROWTH, buf->capacity, 0);
+    buffer_free(buf);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H */
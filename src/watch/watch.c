@@ -0,0 +1,739 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Incremental re-reading of changed files.
+ *
+ * On Linux, inotify watches every directory under the configured roots
+ * for close-write, move and delete events. Affected paths wait in a
+ * pending set until they have been quiet for the debounce interval, then
+ * go through the normal read path (with the attached cache) and into the
+ * index. When the kernel queue overflows, or on platforms without
+ * inotify, the roots are swept for files whose mtime/ctime is newer than
+ * the cursor: the last wall-clock time at which nothing was pending.
+ * Every audio file seen under the roots is remembered, so a sweep also
+ * notices files that vanished, and cache entries for a file that was
+ * deleted or replaced are dropped. The cursor is persisted so a
+ * restarted watcher only sweeps what changed while it was down.
+ */
+
+#define _DEFAULT_SOURCE     /* d_type / DT_* on glibc */
+#define _DARWIN_C_SOURCE
+
+#include "../batch/batch.h"
+#include "../cache/cache.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/string_util.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#define WATCH_HAVE_INOTIFY 1
+#endif
+
+#define WATCH_DEFAULT_DEBOUNCE_MS 500
+#define WATCH_PENDING_BUCKETS     1024
+
+/* Allowance for coarse timestamps and clock adjustments in sweeps */
+#define WATCH_SWEEP_SLACK_NS      2000000000LL
+
+/* Cursor is written at most this often while running */
+#define WATCH_CURSOR_SAVE_NS      1000000000LL
+
+#define WATCH_CURSOR_MAGIC        "M3TW"
+
+#if defined(__APPLE__)
+#define ST_MTIME_NS(st) ((int64_t)(st).st_mtimespec.tv_sec * 1000000000 + \
+                         (st).st_mtimespec.tv_nsec)
+#define ST_CTIME_NS(st) ((int64_t)(st).st_ctimespec.tv_sec * 1000000000 + \
+                         (st).st_ctimespec.tv_nsec)
+#else
+#define ST_MTIME_NS(st) ((int64_t)(st).st_mtim.tv_sec * 1000000000 + \
+                         (st).st_mtim.tv_nsec)
+#define ST_CTIME_NS(st) ((int64_t)(st).st_ctim.tv_sec * 1000000000 + \
+                         (st).st_ctim.tv_nsec)
+#endif
+
+typedef struct pending {
+    char           *path;
+    int64_t         due_ms;       /* Monotonic deadline */
+    struct pending *next;
+} pending_t;
+
+typedef struct known {
+    char           *path;
+    uint32_t        gen;          /* Last sweep that saw the file */
+    int             has_id;
+    file_identity_t id;           /* Version last seen, for the cache */
+    struct known   *next;
+} known_t;
+
+struct mp3tag_watcher {
+    mp3tag_cache_t         *cache;
+    mp3tag_index_t         *index;
+    mp3tag_scan_callback_t  callback;
+    void                   *user_data;
+    unsigned                debounce_ms;
+    char                   *cursor_path;
+
+    mp3tag_context_t       *ctx;
+
+    char                  **roots;
+    size_t                  root_count;
+
+    int                     fd;           /* inotify, or -1 */
+    char                  **wd_paths;     /* Directory per watch descriptor */
+    size_t                  wd_cap;
+
+    pending_t              *pending[WATCH_PENDING_BUCKETS];
+    size_t                  pending_count;
+
+    known_t               **known;        /* Audio files under the roots */
+    size_t                  known_cap;    /* Power of two */
+    size_t                  known_count;
+    uint32_t                gen;
+
+    int64_t                 cursor_ns;    /* Wall clock; in sync up to here */
+    int64_t                 saved_ns;     /* When the cursor was last saved */
+    int                     need_sweep;
+};
+
+/* ------------------------------------------------------------------ */
+/*  Clocks and cursor                                                  */
+/* ------------------------------------------------------------------ */
+
+static int64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int64_t real_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Returns 1 and sets *ns if a cursor was stored */
+static int load_cursor(const char *path, int64_t *ns)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    char magic[5] = {0};
+    int version = 0;
+    long long value = 0;
+    int ok = fscanf(f, "%4s %d %lld", magic, &version, &value) == 3 &&
+             strcmp(magic, WATCH_CURSOR_MAGIC) == 0 && version == 1;
+    fclose(f);
+
+    if (ok) *ns = (int64_t)value;
+    return ok;
+}
+
+static int save_cursor(mp3tag_watcher_t *w)
+{
+    if (!w->cursor_path) return MP3TAG_OK;
+
+    size_t len = strlen(w->cursor_path);
+    char *tmp = malloc(len + 5);
+    if (!tmp) return MP3TAG_ERR_NO_MEMORY;
+    memcpy(tmp, w->cursor_path, len);
+    memcpy(tmp + len, ".tmp", 5);
+
+    int rc = MP3TAG_OK;
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        rc = MP3TAG_ERR_IO;
+    } else {
+        if (fprintf(f, "%s 1 %lld\n", WATCH_CURSOR_MAGIC,
+                    (long long)w->cursor_ns) < 0)
+            rc = MP3TAG_ERR_WRITE_FAILED;
+        if (fclose(f) != 0 && rc == MP3TAG_OK)
+            rc = MP3TAG_ERR_WRITE_FAILED;
+        if (rc == MP3TAG_OK && rename(tmp, w->cursor_path) != 0)
+            rc = MP3TAG_ERR_RENAME_FAILED;
+        if (rc != MP3TAG_OK)
+            unlink(tmp);
+    }
+    free(tmp);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Pending set                                                        */
+/* ------------------------------------------------------------------ */
+
+static uint64_t hash_path(const char *path)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *path; path++) {
+        h ^= (uint8_t)*path;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static size_t pending_bucket(const char *path)
+{
+    return (size_t)(hash_path(path) % WATCH_PENDING_BUCKETS);
+}
+
+/* Takes ownership of `path`; a repeat event restarts the quiet period */
+static void pending_add(mp3tag_watcher_t *w, char *path, int64_t due_ms)
+{
+    pending_t **head = &w->pending[pending_bucket(path)];
+    for (pending_t *p = *head; p; p = p->next) {
+        if (strcmp(p->path, path) == 0) {
+            if (due_ms > p->due_ms) p->due_ms = due_ms;
+            free(path);
+            return;
+        }
+    }
+
+    pending_t *p = malloc(sizeof(*p));
+    if (!p) {
+        free(path);
+        w->need_sweep = 1;  /* Catch it on the next sweep instead */
+        return;
+    }
+    p->path   = path;
+    p->due_ms = due_ms;
+    p->next   = *head;
+    *head     = p;
+    w->pending_count++;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Known files                                                        */
+/* ------------------------------------------------------------------ */
+
+static int known_grow(mp3tag_watcher_t *w)
+{
+    size_t cap = w->known_cap ? w->known_cap * 2 : 1024;
+    known_t **b = calloc(cap, sizeof(*b));
+    if (!b) return -1;
+
+    for (size_t i = 0; i < w->known_cap; i++) {
+        known_t *k = w->known[i];
+        while (k) {
+            known_t *next = k->next;
+            size_t j = (size_t)hash_path(k->path) & (cap - 1);
+            k->next = b[j];
+            b[j] = k;
+            k = next;
+        }
+    }
+    free(w->known);
+    w->known     = b;
+    w->known_cap = cap;
+    return 0;
+}
+
+/* Remember `path` as present in the current generation */
+static known_t *known_mark(mp3tag_watcher_t *w, const char *path)
+{
+    if (w->known_count >= w->known_cap && known_grow(w) != 0)
+        return NULL;
+
+    known_t **head = &w->known[hash_path(path) & (w->known_cap - 1)];
+    for (known_t *k = *head; k; k = k->next) {
+        if (strcmp(k->path, path) == 0) {
+            k->gen = w->gen;
+            return k;
+        }
+    }
+
+    known_t *k = calloc(1, sizeof(*k));
+    if (!k) return NULL;
+    k->path = str_dup(path);
+    if (!k->path) { free(k); return NULL; }
+    k->gen  = w->gen;
+    k->next = *head;
+    *head   = k;
+    w->known_count++;
+    return k;
+}
+
+/*
+ * Record the version of `path` now on disk. The cache entry for the
+ * version seen before is dropped when the file was replaced by another
+ * inode; an in-place change overwrites it anyway.
+ */
+static void known_identify(mp3tag_watcher_t *w, const char *path)
+{
+    known_t *k = known_mark(w, path);
+    if (!k) return;
+
+    file_identity_t id;
+    if (cache_identity(path, &id) != 0)
+        return;
+    if (k->has_id && w->cache &&
+        (k->id.dev != id.dev || k->id.ino != id.ino))
+        cache_remove(w->cache, &k->id);
+    k->id     = id;
+    k->has_id = 1;
+}
+
+/* Forget `path`, and its cache entry along with it */
+static void known_forget(mp3tag_watcher_t *w, const char *path)
+{
+    if (!w->known_cap) return;
+
+    known_t **pp = &w->known[hash_path(path) & (w->known_cap - 1)];
+    for (; *pp; pp = &(*pp)->next) {
+        if (strcmp((*pp)->path, path) == 0) {
+            known_t *k = *pp;
+            *pp = k->next;
+            if (k->has_id && w->cache)
+                cache_remove(w->cache, &k->id);
+            free(k->path);
+            free(k);
+            w->known_count--;
+            return;
+        }
+    }
+}
+
+
+/* ------------------------------------------------------------------ */
+/*  Re-reading                                                         */
+/* ------------------------------------------------------------------ */
+
+static void process_path(mp3tag_watcher_t *w, const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        /* Deleted or moved away */
+        known_forget(w, path);
+        if (w->index)
+            mp3tag_index_remove(w->index, path);
+        if (w->callback)
+            w->callback(path, MP3TAG_ERR_IO, NULL, w->user_data);
+        return;
+    }
+
+    mp3tag_collection_t *tags = NULL;
+    int rc = batch_read_one(w->ctx, path, &tags);
+    known_identify(w, path);
+
+    if (w->index) {
+        if (rc == MP3TAG_OK)
+            mp3tag_index_add(w->index, path, tags);
+        else
+            mp3tag_index_remove(w->index, path);
+    }
+    if (w->callback)
+        w->callback(path, rc, tags, w->user_data);
+    mp3tag_collection_free(NULL, tags);
+}
+
+/* Process every pending path whose quiet period has elapsed */
+static int flush_due(mp3tag_watcher_t *w, int64_t now_ms)
+{
+    int processed = 0;
+    for (size_t b = 0; b < WATCH_PENDING_BUCKETS; b++) {
+        pending_t **pp = &w->pending[b];
+        while (*pp) {
+            pending_t *p = *pp;
+            if (p->due_ms > now_ms) {
+                pp = &p->next;
+                continue;
+            }
+            *pp = p->next;
+            w->pending_count--;
+            process_path(w, p->path);
+            free(p->path);
+            free(p);
+            processed++;
+        }
+    }
+    return processed;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Directory walking                                                  */
+/* ------------------------------------------------------------------ */
+
+#ifdef WATCH_HAVE_INOTIFY
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+                    IN_DELETE | IN_CREATE | IN_ONLYDIR | IN_DONT_FOLLOW)
+
+static void add_watch(mp3tag_watcher_t *w, const char *dir)
+{
+    int wd = inotify_add_watch(w->fd, dir, WATCH_MASK);
+    if (wd < 0) return;
+
+    if ((size_t)wd >= w->wd_cap) {
+        size_t cap = w->wd_cap ? w->wd_cap : 64;
+        while (cap <= (size_t)wd) cap *= 2;
+        char **p = realloc(w->wd_paths, cap * sizeof(*p));
+        if (!p) return;
+        memset(p + w->wd_cap, 0, (cap - w->wd_cap) * sizeof(*p));
+        w->wd_paths = p;
+        w->wd_cap   = cap;
+    }
+    /* A renamed directory keeps its descriptor: take the new name */
+    free(w->wd_paths[wd]);
+    w->wd_paths[wd] = str_dup(dir);
+}
+
+/* True if `path` lies below the directory `dir` (of length `len`) */
+static int under_dir(const char *path, const char *dir, size_t len)
+{
+    return strncmp(path, dir, len) == 0 && path[len] == '/';
+}
+
+/*
+ * The directory `dir` left the tree (moved away or deleted). Every known
+ * file below it is queued, and the re-read drops the ones that are gone;
+ * its watches are removed, and a move within the roots re-adds them on
+ * the IN_MOVED_TO that follows.
+ */
+static void forget_dir(mp3tag_watcher_t *w, const char *dir, int64_t due)
+{
+    size_t len = strlen(dir);
+
+    for (size_t i = 0; i < w->known_cap; i++) {
+        for (known_t *k = w->known[i]; k; k = k->next) {
+            if (under_dir(k->path, dir, len)) {
+                char *path = str_dup(k->path);
+                if (path) pending_add(w, path, due);
+            }
+        }
+    }
+
+    for (size_t wd = 0; wd < w->wd_cap; wd++) {
+        char *p = w->wd_paths[wd];
+        if (p && (strcmp(p, dir) == 0 || under_dir(p, dir, len))) {
+            inotify_rm_watch(w->fd, (int)wd);
+            free(p);
+            w->wd_paths[wd] = NULL;
+        }
+    }
+}
+#endif
+
+/*
+ * Watch `dir` and everything below it, remembering every audio file.
+ * Files changed at or after `since_ns` are queued for an immediate
+ * re-read (since_ns < 0: none).
+ */
+static void walk_dir(mp3tag_watcher_t *w, const char *dir, int64_t since_ns)
+{
+#ifdef WATCH_HAVE_INOTIFY
+    if (w->fd >= 0)
+        add_watch(w, dir);
+#endif
+
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    int64_t now = mono_ms();
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        if (name[0] == '.' &&
+            (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+
+        int is_dir = 0, is_reg = 0;
+#ifdef DT_DIR
+        if (de->d_type == DT_DIR)      is_dir = 1;
+        else if (de->d_type == DT_REG) is_reg = 1;
+        else if (de->d_type != DT_UNKNOWN) continue;  /* links, devices, ... */
+#endif
+        int audio = batch_has_audio_extension(name);
+        if (is_reg && !audio)
+            continue;
+
+        char *child = batch_join_path(dir, name);
+        if (!child) continue;
+
+        /* Only stat when the type is unknown or times are needed */
+        struct stat st;
+        int need_stat = (!is_dir && !is_reg) || (is_reg && since_ns >= 0);
+        if (need_stat) {
+            if (lstat(child, &st) != 0) {
+                free(child);
+                continue;
+            }
+            is_dir = S_ISDIR(st.st_mode);
+            is_reg = S_ISREG(st.st_mode);
+        }
+
+        if (is_dir) {
+            walk_dir(w, child, since_ns);
+            free(child);
+        } else if (is_reg && audio) {
+            if (w->cache)
+                known_identify(w, child);
+            else
+                known_mark(w, child);
+            if (since_ns >= 0 &&
+                (ST_MTIME_NS(st) >= since_ns || ST_CTIME_NS(st) >= since_ns))
+                pending_add(w, child, now);
+            else
+                free(child);
+        } else {
+            free(child);
+        }
+    }
+    closedir(d);
+}
+
+static void sweep(mp3tag_watcher_t *w)
+{
+    int64_t since = w->cursor_ns - WATCH_SWEEP_SLACK_NS;
+
+    w->gen++;
+    for (size_t i = 0; i < w->root_count; i++)
+        walk_dir(w, w->roots[i], since);
+    w->need_sweep = 0;
+
+    /* Known files the walk did not see again may be gone; the re-read
+       stats them and drops the ones that really are */
+    int64_t now = mono_ms();
+    for (size_t i = 0; i < w->known_cap; i++) {
+        for (known_t *k = w->known[i]; k; k = k->next) {
+            if (k->gen != w->gen) {
+                char *path = str_dup(k->path);
+                if (path) pending_add(w, path, now);
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Events                                                             */
+/* ------------------------------------------------------------------ */
+
+#ifdef WATCH_HAVE_INOTIFY
+static void drain_events(mp3tag_watcher_t *w)
+{
+    /* Aligned for struct inotify_event */
+    uint64_t buf[4096 / sizeof(uint64_t)];
+
+    for (;;) {
+        ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+
+        int64_t due = mono_ms() + w->debounce_ms;
+        for (char *p = (char *)buf; p < (char *)buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                w->need_sweep = 1;
+                continue;
+            }
+            if (ev->wd < 0 || (size_t)ev->wd >= w->wd_cap ||
+                !w->wd_paths[ev->wd])
+                continue;
+            if (ev->mask & IN_IGNORED) {
+                free(w->wd_paths[ev->wd]);
+                w->wd_paths[ev->wd] = NULL;
+                continue;
+            }
+            if (ev->len == 0)
+                continue;
+
+            const char *dir = w->wd_paths[ev->wd];
+            if (ev->mask & IN_ISDIR) {
+                char *sub = batch_join_path(dir, ev->name);
+                if (!sub) continue;
+                /* New or moved-in subtree: watch it and read its files */
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                    walk_dir(w, sub, 0);
+                else if (ev->mask & (IN_MOVED_FROM | IN_DELETE))
+                    forget_dir(w, sub, due);
+                free(sub);
+                continue;
+            }
+            if (!batch_has_audio_extension(ev->name) ||
+                !(ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO |
+                              IN_MOVED_FROM | IN_DELETE)))
+                continue;
+
+            char *path = batch_join_path(dir, ev->name);
+            if (!path) continue;
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                known_mark(w, path);
+            pending_add(w, path, due);
+        }
+    }
+}
+#endif
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_watcher_t *mp3tag_watcher_create(const mp3tag_watch_options_t *opts)
+{
+    mp3tag_watcher_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+
+    w->fd          = -1;
+    w->debounce_ms = WATCH_DEFAULT_DEBOUNCE_MS;
+    if (opts) {
+        w->cache     = opts->cache;
+        w->index     = opts->index;
+        w->callback  = opts->callback;
+        w->user_data = opts->user_data;
+        if (opts->debounce_ms)
+            w->debounce_ms = opts->debounce_ms;
+        if (opts->cursor_path) {
+            w->cursor_path = str_dup(opts->cursor_path);
+            if (!w->cursor_path) goto fail;
+        }
+    }
+
+    w->ctx = mp3tag_create(opts ? opts->allocator : NULL);
+    if (!w->ctx) goto fail;
+    mp3tag_set_cache(w->ctx, w->cache);
+
+#ifdef WATCH_HAVE_INOTIFY
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+    /* Without a stored cursor the caller is assumed to be in sync now */
+    w->cursor_ns = real_ns();
+    if (w->cursor_path && load_cursor(w->cursor_path, &w->cursor_ns))
+        w->need_sweep = 1;
+    w->saved_ns = real_ns();
+
+    return w;
+
+fail:
+    mp3tag_watcher_destroy(w);
+    return NULL;
+}
+
+int mp3tag_watcher_add_root(mp3tag_watcher_t *w, const char *root)
+{
+    if (!w || !root) return MP3TAG_ERR_INVALID_ARG;
+
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode))
+        return MP3TAG_ERR_IO;
+
+    char **roots = realloc(w->roots, (w->root_count + 1) * sizeof(*roots));
+    if (!roots) return MP3TAG_ERR_NO_MEMORY;
+    w->roots = roots;
+    w->roots[w->root_count] = str_dup(root);
+    if (!w->roots[w->root_count]) return MP3TAG_ERR_NO_MEMORY;
+    w->root_count++;
+
+    /* Install watches; files are only queued by the resume sweep */
+    walk_dir(w, root, -1);
+    return MP3TAG_OK;
+}
+
+int mp3tag_watcher_fd(const mp3tag_watcher_t *w)
+{
+    return w ? w->fd : -1;
+}
+
+int mp3tag_watcher_poll(mp3tag_watcher_t *w, int timeout_ms)
+{
+    if (!w) return MP3TAG_ERR_INVALID_ARG;
+
+    int64_t start_ns = real_ns();
+
+    /* Wake up in time for the earliest possible debounce deadline */
+    int wait_ms = timeout_ms;
+    if (w->pending_count > 0 &&
+        (wait_ms < 0 || (unsigned)wait_ms > w->debounce_ms))
+        wait_ms = (int)w->debounce_ms;
+    if (w->need_sweep)
+        wait_ms = 0;
+
+#ifdef WATCH_HAVE_INOTIFY
+    if (w->fd >= 0) {
+        struct pollfd pfd = { w->fd, POLLIN, 0 };
+        if (poll(&pfd, 1, wait_ms) > 0)
+            drain_events(w);
+    } else
+#endif
+    {
+        /* No event source: every poll is a sweep */
+        if (wait_ms > 0) {
+            struct timespec ts = { wait_ms / 1000,
+                                   (long)(wait_ms % 1000) * 1000000 };
+            nanosleep(&ts, NULL);
+        }
+        w->need_sweep = 1;
+    }
+
+    if (w->need_sweep)
+        sweep(w);
+
+    int processed = flush_due(w, mono_ms());
+
+    /* Nothing outstanding: everything changed before `start_ns` is seen */
+    if (w->pending_count == 0 && !w->need_sweep) {
+        w->cursor_ns = start_ns;
+        if (start_ns - w->saved_ns >= WATCH_CURSOR_SAVE_NS &&
+            save_cursor(w) == MP3TAG_OK)
+            w->saved_ns = start_ns;
+    }
+    return processed;
+}
+
+void mp3tag_watcher_destroy(mp3tag_watcher_t *w)
+{
+    if (!w) return;
+
+    if (w->ctx) {
+        if (w->cache)
+            mp3tag_cache_save(w->cache);
+        save_cursor(w);
+    }
+
+    for (size_t b = 0; b < WATCH_PENDING_BUCKETS; b++) {
+        pending_t *p = w->pending[b];
+        while (p) {
+            pending_t *next = p->next;
+            free(p->path);
+            free(p);
+            p = next;
+        }
+    }
+    for (size_t i = 0; i < w->known_cap; i++) {
+        known_t *k = w->known[i];
+        while (k) {
+            known_t *next = k->next;
+            free(k->path);
+            free(k);
+            k = next;
+        }
+    }
+    for (size_t i = 0; i < w->wd_cap; i++)
+        free(w->wd_paths[i]);
+    for (size_t i = 0; i < w->root_count; i++)
+        free(w->roots[i]);
+    if (w->fd >= 0)
+        close(w->fd);
+
+    free(w->known);
+    free(w->wd_paths);
+    free(w->roots);
+    free(w->cursor_path);
+    mp3tag_destroy(w->ctx);
+    free(w);
+}
@@ -0,0 +1,724 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Write-behind layer for bursts of single-field edits.
+ *
+ * Edits are kept per file, a later edit of a field replacing the earlier
+ * one, until the file's delay has passed since its first pending edit or
+ * until an explicit flush. A flush then costs one tag write per file no
+ * matter how many edits it absorbed.
+ *
+ * With a journal configured, a flush first makes the complete new tags
+ * of every file it is about to touch durable in the journal, then writes
+ * the files and removes the journal. A crash at any point leaves either
+ * untouched files and a torn journal (discarded by its checksum) or a
+ * complete journal, which the next mp3tag_writeback_create() replays.
+ * Replaying writes whole collections, so applying it twice is harmless.
+ * A file whose write fails stays pending, and the journal is kept; so
+ * does one that could not be read for want of descriptors or memory.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../mp3tag_internal.h"
+#include "../flat/flat.h"
+#include "../../include/mp3tag/mp3tag.h"
+#include <tag_common/buffer.h>
+#include <tag_common/string_util.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Journal layout (little-endian):
+ *   "M3WJ" | u32 version | u32 record count | u64 FNV-1a of the records
+ *   per record: u32 path length | path | u32 blob length | flat blob
+ */
+#define WB_JOURNAL_MAGIC    "M3WJ"
+#define WB_JOURNAL_VERSION  1
+#define WB_JOURNAL_HEADER   20
+
+/* Retries of a file whose flush failed back off from the delay (or the
+   minimum) up to the maximum */
+#define WB_RETRY_MIN_MS     100
+#define WB_RETRY_MAX_MS     60000
+
+typedef struct wb_file {
+    char           *path;
+    tag_edit_t     *edits;        /* Owned strings; value NULL = remove */
+    size_t          edit_count;
+    size_t          edit_cap;
+    int64_t         due_ms;       /* Monotonic deadline */
+    unsigned        failures;     /* Consecutive failed flushes */
+    struct wb_file *next;
+} wb_file_t;
+
+/* A file being flushed. No descriptor is held between its merge and
+   its write, so a flush opens one file at a time however many it takes */
+typedef struct {
+    wb_file_t           *file;
+    mp3tag_collection_t *tags;
+    int                  error;
+    int                  failed_write;  /* Reopening or writing failed */
+} wb_job_t;
+
+/*
+ * Lock order: flush_lock, then lock. `lock` guards the pending list and
+ * is never held across file I/O; `flush_lock` runs one flush or read of
+ * the files at a time, so a flush never races another over one file.
+ */
+struct mp3tag_writeback {
+    pthread_mutex_t     lock;
+    pthread_mutex_t     flush_lock;
+    pthread_cond_t      wake;
+    pthread_t           thread;
+    int                 has_thread;
+    int                 stop;
+
+    unsigned            delay_ms;
+    char               *journal_path;
+    mp3tag_allocator_t  allocator;
+    int                 has_allocator;
+
+    mp3tag_context_t   *ctx;          /* All file access; under flush_lock */
+    wb_file_t          *files;
+    size_t              file_count;   /* Including files being flushed */
+    int                 error;        /* First failure of a background flush */
+};
+
+static int64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static mp3tag_context_t *wb_context(mp3tag_writeback_t *wb)
+{
+    return mp3tag_create(wb->has_allocator ? &wb->allocator : NULL);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Pending edits                                                      */
+/* ------------------------------------------------------------------ */
+
+static void free_file(wb_file_t *f)
+{
+    for (size_t i = 0; i < f->edit_count; i++) {
+        free((void *)f->edits[i].name);
+        free((void *)f->edits[i].value);
+    }
+    free(f->edits);
+    free(f->path);
+    free(f);
+}
+
+static wb_file_t *find_file(mp3tag_writeback_t *wb, const char *path)
+{
+    for (wb_file_t *f = wb->files; f; f = f->next)
+        if (strcmp(f->path, path) == 0)
+            return f;
+    return NULL;
+}
+
+static int add_edit(wb_file_t *f, const char *name, const char *value)
+{
+    char *v = NULL;
+    if (value && !(v = str_dup(value)))
+        return MP3TAG_ERR_NO_MEMORY;
+
+    for (size_t i = 0; i < f->edit_count; i++) {
+        if (str_casecmp(f->edits[i].name, name) == 0) {
+            free((void *)f->edits[i].value);
+            f->edits[i].value = v;
+            return MP3TAG_OK;
+        }
+    }
+
+    if (f->edit_count == f->edit_cap) {
+        size_t cap = f->edit_cap ? f->edit_cap * 2 : 4;
+        tag_edit_t *e = realloc(f->edits, cap * sizeof(*e));
+        if (!e) { free(v); return MP3TAG_ERR_NO_MEMORY; }
+        f->edits    = e;
+        f->edit_cap = cap;
+    }
+
+    char *n = str_dup(name);
+    if (!n) { free(v); return MP3TAG_ERR_NO_MEMORY; }
+    f->edits[f->edit_count].name  = n;
+    f->edits[f->edit_count].value = v;
+    f->edit_count++;
+    return MP3TAG_OK;
+}
+
+/*
+ * Current tags of `path` with its pending edits applied (caller owns).
+ * Called with flush_lock held; the lock is only taken for the edits.
+ */
+static int merged_tags(mp3tag_writeback_t *wb, const char *path,
+                       mp3tag_collection_t **tags)
+{
+    mp3tag_context_t *ctx = wb->ctx;
+    *tags = NULL;
+
+    int rc = mp3tag_open(ctx, path);
+    mp3tag_collection_t *existing = NULL;
+    if (rc == MP3TAG_OK)
+        rc = mp3tag_read_tags(ctx, &existing);
+
+    pthread_mutex_lock(&wb->lock);
+    const wb_file_t *f = find_file(wb, path);
+    if (rc == MP3TAG_OK && !f) {
+        *tags = ctx_detach_tags(ctx);
+        if (!*tags) rc = MP3TAG_ERR_NO_MEMORY;
+    } else if ((rc == MP3TAG_OK || rc == MP3TAG_ERR_NO_TAGS) && f) {
+        *tags = collection_with_edits(existing, f->edits, f->edit_count);
+        rc = *tags ? MP3TAG_OK : MP3TAG_ERR_NO_MEMORY;
+    }
+    pthread_mutex_unlock(&wb->lock);
+
+    mp3tag_close(ctx);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Journal                                                            */
+/* ------------------------------------------------------------------ */
+
+static uint64_t fnv1a(const uint8_t *p, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static int put_le(dyn_buffer_t *b, uint64_t v, int bytes)
+{
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; i++)
+        tmp[i] = (uint8_t)(v >> (8 * i));
+    return buffer_append(b, tmp, (size_t)bytes);
+}
+
+/* fsync() the directory holding `path`, making its entry durable */
+static int sync_parent(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    size_t len = !slash ? 0 : slash == path ? 1 : (size_t)(slash - path);
+    char *dir = len ? strndup(path, len) : strdup(".");
+    if (!dir) return MP3TAG_ERR_NO_MEMORY;
+
+    int rc = MP3TAG_OK;
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        rc = MP3TAG_ERR_IO;
+    } else {
+        if (fsync(fd) != 0)
+            rc = MP3TAG_ERR_WRITE_FAILED;
+        close(fd);
+    }
+    free(dir);
+    return rc;
+}
+
+static int journal_write(const char *path, wb_job_t *jobs, size_t count)
+{
+    dyn_buffer_t out, blob;
+    buffer_init(&out);
+    buffer_init(&blob);
+
+    int rc = buffer_append(&out, WB_JOURNAL_MAGIC, 4);
+    rc |= put_le(&out, WB_JOURNAL_VERSION, 4);
+    rc |= put_le(&out, 0, 4);     /* Count and checksum patched below */
+    rc |= put_le(&out, 0, 8);
+
+    uint32_t records = 0;
+    for (size_t i = 0; i < count && rc == 0; i++) {
+        if (jobs[i].error != MP3TAG_OK) continue;
+        blob.size = 0;
+        if (flat_encode(jobs[i].tags, &blob) != MP3TAG_OK) {
+            rc = -1;
+            break;
+        }
+        size_t len = strlen(jobs[i].file->path);
+        rc |= put_le(&out, len, 4);
+        rc |= buffer_append(&out, jobs[i].file->path, len);
+        rc |= put_le(&out, blob.size, 4);
+        rc |= buffer_append(&out, blob.data, blob.size);
+        records++;
+    }
+    buffer_free(&blob);
+
+    if (rc != 0) {
+        buffer_free(&out);
+        return MP3TAG_ERR_NO_MEMORY;
+    }
+
+    uint64_t sum = fnv1a(out.data + WB_JOURNAL_HEADER,
+                         out.size - WB_JOURNAL_HEADER);
+    for (int i = 0; i < 4; i++)
+        out.data[8 + i] = (uint8_t)(records >> (8 * i));
+    for (int i = 0; i < 8; i++)
+        out.data[12 + i] = (uint8_t)(sum >> (8 * i));
+
+    int result = MP3TAG_OK;
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        result = MP3TAG_ERR_IO;
+    } else {
+        if (fwrite(out.data, 1, out.size, f) != out.size ||
+            fflush(f) != 0 || fsync(fileno(f)) != 0)
+            result = MP3TAG_ERR_WRITE_FAILED;
+        if (fclose(f) != 0 && result == MP3TAG_OK)
+            result = MP3TAG_ERR_WRITE_FAILED;
+        /* A journal only protects the files once its name survives too */
+        if (result == MP3TAG_OK)
+            result = sync_parent(path);
+        if (result != MP3TAG_OK)
+            unlink(path);
+    }
+
+    buffer_free(&out);
+    return result;
+}
+
+/* Re-apply a complete journal left behind by an interrupted flush */
+static void journal_replay(mp3tag_writeback_t *wb)
+{
+    FILE *f = fopen(wb->journal_path, "rb");
+    if (!f) return;
+
+    dyn_buffer_t data;
+    buffer_init(&data);
+    uint8_t chunk[65536];
+    size_t n;
+    int ok = 1;
+    while (ok && (n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        ok = buffer_append(&data, chunk, n) == 0;
+    fclose(f);
+
+    const uint8_t *p = data.data;
+    size_t left = data.size;
+    if (!ok || left < WB_JOURNAL_HEADER ||
+        memcmp(p, WB_JOURNAL_MAGIC, 4) != 0 ||
+        flat_u32(p + 4) != WB_JOURNAL_VERSION ||
+        flat_u64(p + 12) != fnv1a(p + WB_JOURNAL_HEADER,
+                                  left - WB_JOURNAL_HEADER))
+        goto done;  /* Torn: the flush never touched a file */
+
+    uint32_t records = flat_u32(p + 8);
+    p    += WB_JOURNAL_HEADER;
+    left -= WB_JOURNAL_HEADER;
+
+    for (uint32_t i = 0; i < records; i++) {
+        if (left < 4) break;
+        uint32_t plen = flat_u32(p);
+        if (left - 4 < (size_t)plen + 4) break;
+        uint32_t blen = flat_u32(p + 4 + plen);
+        if (left - 8 - plen < blen) break;
+
+        char *path = malloc((size_t)plen + 1);
+        mp3tag_collection_t *tags = NULL;
+        const uint8_t *blob = p + 8 + plen;
+        if (path && flat_validate(blob, blen) == MP3TAG_OK &&
+            flat_decode(blob, blen, &tags) == MP3TAG_OK) {
+            memcpy(path, p + 4, plen);
+            path[plen] = '\0';
+            if (mp3tag_open_rw(wb->ctx, path) == MP3TAG_OK)
+                mp3tag_write_tags(wb->ctx, tags);
+            mp3tag_close(wb->ctx);
+        }
+        mp3tag_collection_free(NULL, tags);
+        free(path);
+
+        p    += 8 + (size_t)plen + blen;
+        left -= 8 + (size_t)plen + blen;
+    }
+
+done:
+    buffer_free(&data);
+    unlink(wb->journal_path);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Flushing                                                           */
+/* ------------------------------------------------------------------ */
+
+/* Errors that may clear by themselves, e.g. out of descriptors or memory;
+   the file's edits stay pending rather than being dropped */
+static int transient_error(int rc)
+{
+    return rc == MP3TAG_ERR_IO || rc == MP3TAG_ERR_NO_MEMORY;
+}
+
+/* Put back a file whose flush failed, due again after a backoff */
+static void requeue(mp3tag_writeback_t *wb, wb_file_t *f)
+{
+    int64_t backoff = wb->delay_ms > WB_RETRY_MIN_MS ? wb->delay_ms
+                                                     : WB_RETRY_MIN_MS;
+    for (unsigned i = 0; i < f->failures && backoff < WB_RETRY_MAX_MS; i++)
+        backoff *= 2;
+    if (backoff > WB_RETRY_MAX_MS)
+        backoff = WB_RETRY_MAX_MS;
+    f->failures++;
+    f->due_ms = mono_ms() + backoff;
+
+    /* Edits made while the flush ran are newer: fold the old ones under
+       them rather than queueing the file twice */
+    wb_file_t *newer = find_file(wb, f->path);
+    if (newer) {
+        for (size_t i = 0; i < f->edit_count; i++) {
+            int shadowed = 0;
+            for (size_t j = 0; j < newer->edit_count && !shadowed; j++)
+                shadowed = str_casecmp(newer->edits[j].name,
+                                       f->edits[i].name) == 0;
+            if (!shadowed && add_edit(newer, f->edits[i].name,
+                                      f->edits[i].value) != MP3TAG_OK)
+                break;
+        }
+        newer->failures = f->failures;
+        newer->due_ms   = f->due_ms;
+        free_file(f);
+        wb->file_count--;
+        return;
+    }
+
+    f->next = wb->files;
+    wb->files = f;
+}
+
+/*
+ * Write out pending files: the one named `path`, every file when `path`
+ * is NULL, or only those past their deadline when `due_only` is set.
+ * Called with flush_lock held; the lock is only taken to move files off
+ * and back onto the pending list, never across the I/O. Returns the
+ * first error.
+ */
+static int flush(mp3tag_writeback_t *wb, const char *path, int due_only)
+{
+    pthread_mutex_lock(&wb->lock);
+    int64_t now = mono_ms();
+
+    /* Take the selected files off the pending list */
+    wb_file_t *taken = NULL;
+    size_t count = 0;
+    for (wb_file_t **pp = &wb->files; *pp; ) {
+        wb_file_t *f = *pp;
+        int pick = path ? strcmp(f->path, path) == 0
+                        : !due_only || f->due_ms <= now;
+        if (pick) {
+            *pp = f->next;
+            f->next = taken;
+            taken = f;
+            count++;
+        } else {
+            pp = &f->next;
+        }
+    }
+    wb_job_t *jobs = count ? calloc(count, sizeof(*jobs)) : NULL;
+    if (count && !jobs) {
+        /* Put everything back for a later attempt */
+        while (taken) {
+            wb_file_t *f = taken;
+            taken = f->next;
+            requeue(wb, f);
+        }
+    }
+    pthread_mutex_unlock(&wb->lock);
+    if (!count) return MP3TAG_OK;
+    if (!jobs)  return MP3TAG_ERR_NO_MEMORY;
+
+    size_t i = 0;
+    for (wb_file_t *f = taken; f; f = f->next, i++) {
+        jobs[i].file = f;
+
+        mp3tag_collection_t *existing = NULL;
+        int rc = mp3tag_open(wb->ctx, f->path);
+        if (rc == MP3TAG_OK) {
+            rc = mp3tag_read_tags(wb->ctx, &existing);
+            if (rc == MP3TAG_ERR_NO_TAGS) rc = MP3TAG_OK;
+        }
+        if (rc == MP3TAG_OK) {
+            jobs[i].tags = collection_with_edits(existing, f->edits,
+                                                 f->edit_count);
+            if (!jobs[i].tags) rc = MP3TAG_ERR_NO_MEMORY;
+        }
+        mp3tag_close(wb->ctx);
+        jobs[i].error = rc;
+    }
+
+    int result = MP3TAG_OK;
+    int journaled = 0;
+    if (wb->journal_path) {
+        result = journal_write(wb->journal_path, jobs, count);
+        journaled = (result == MP3TAG_OK);
+    }
+    /* A failed journal write means no file may be touched */
+    int writable = !wb->journal_path || journaled;
+
+    int write_failed = 0;
+    for (i = 0; i < count; i++) {
+        if (writable && jobs[i].error == MP3TAG_OK) {
+            int rc = mp3tag_open_rw(wb->ctx, jobs[i].file->path);
+            if (rc == MP3TAG_OK)
+                rc = mp3tag_write_tags(wb->ctx, jobs[i].tags);
+            mp3tag_close(wb->ctx);
+            jobs[i].error = rc;
+            jobs[i].failed_write = (rc != MP3TAG_OK);
+            write_failed |= jobs[i].failed_write;
+        }
+        if (result == MP3TAG_OK && jobs[i].error != MP3TAG_OK)
+            result = jobs[i].error;
+    }
+
+    /* Every file is durable (write_tags syncs): the journal is spent.
+       After a failed write it stays, for the next create to replay. */
+    if (journaled && !write_failed)
+        unlink(wb->journal_path);
+
+    pthread_mutex_lock(&wb->lock);
+    for (i = 0; i < count; i++) {
+        mp3tag_collection_free(NULL, jobs[i].tags);
+        if (!writable || jobs[i].failed_write ||
+            transient_error(jobs[i].error)) {
+            requeue(wb, jobs[i].file);
+        } else {
+            free_file(jobs[i].file);
+            wb->file_count--;
+        }
+    }
+    pthread_mutex_unlock(&wb->lock);
+    free(jobs);
+    return result;
+}
+
+static void *flusher(void *arg)
+{
+    mp3tag_writeback_t *wb = arg;
+
+    pthread_mutex_lock(&wb->lock);
+    while (!wb->stop) {
+        int64_t next = -1;
+        for (wb_file_t *f = wb->files; f; f = f->next)
+            if (next < 0 || f->due_ms < next)
+                next = f->due_ms;
+
+        if (next < 0) {
+            pthread_cond_wait(&wb->wake, &wb->lock);
+            continue;
+        }
+
+        int64_t wait = next - mono_ms();
+        if (wait > 0) {
+            /* Condition variables time out on the realtime clock */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec  += wait / 1000;
+            ts.tv_nsec += (long)(wait % 1000) * 1000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&wb->wake, &wb->lock, &ts);
+            continue;
+        }
+
+        pthread_mutex_unlock(&wb->lock);
+        pthread_mutex_lock(&wb->flush_lock);
+        int rc = flush(wb, NULL, 1);
+        pthread_mutex_unlock(&wb->flush_lock);
+        pthread_mutex_lock(&wb->lock);
+        if (rc != MP3TAG_OK && wb->error == MP3TAG_OK)
+            wb->error = rc;
+    }
+    pthread_mutex_unlock(&wb->lock);
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+mp3tag_writeback_t *mp3tag_writeback_create(const mp3tag_writeback_options_t *opts)
+{
+    mp3tag_writeback_t *wb = calloc(1, sizeof(*wb));
+    if (!wb) return NULL;
+
+    if (opts) {
+        wb->delay_ms = opts->delay_ms;
+        if (opts->allocator) {
+            wb->allocator     = *opts->allocator;
+            wb->has_allocator = 1;
+        }
+        if (opts->journal_path &&
+            !(wb->journal_path = str_dup(opts->journal_path))) {
+            free(wb);
+            return NULL;
+        }
+    }
+
+    wb->ctx = wb_context(wb);
+    if (!wb->ctx) {
+        free(wb->journal_path);
+        free(wb);
+        return NULL;
+    }
+    pthread_mutex_init(&wb->lock, NULL);
+    pthread_mutex_init(&wb->flush_lock, NULL);
+    pthread_cond_init(&wb->wake, NULL);
+
+    if (wb->journal_path)
+        journal_replay(wb);
+
+    if (wb->delay_ms &&
+        pthread_create(&wb->thread, NULL, flusher, wb) == 0)
+        wb->has_thread = 1;
+    else
+        wb->delay_ms = 0;  /* Explicit flushes only */
+
+    return wb;
+}
+
+int mp3tag_writeback_set(mp3tag_writeback_t *wb, const char *path,
+                         const char *name, const char *value)
+{
+    if (!wb || !path || !name) return MP3TAG_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&wb->lock);
+
+    int rc = MP3TAG_OK;
+    wb_file_t *f = find_file(wb, path);
+    if (!f) {
+        f = calloc(1, sizeof(*f));
+        if (f && !(f->path = str_dup(path))) {
+            free(f);
+            f = NULL;
+        }
+        if (!f) {
+            rc = MP3TAG_ERR_NO_MEMORY;
+        } else {
+            f->due_ms = mono_ms() + wb->delay_ms;
+            f->next   = wb->files;
+            wb->files = f;
+            wb->file_count++;
+            if (wb->has_thread)
+                pthread_cond_signal(&wb->wake);
+        }
+    }
+    if (rc == MP3TAG_OK)
+        rc = add_edit(f, name, value);
+
+    pthread_mutex_unlock(&wb->lock);
+    return rc;
+}
+
+int mp3tag_writeback_read_tags(mp3tag_writeback_t *wb, const char *path,
+                               mp3tag_collection_t **tags)
+{
+    if (!wb || !path || !tags) return MP3TAG_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&wb->flush_lock);
+    int rc = merged_tags(wb, path, tags);
+    pthread_mutex_unlock(&wb->flush_lock);
+    return rc;
+}
+
+int mp3tag_writeback_read_string(mp3tag_writeback_t *wb, const char *path,
+                                 const char *name, char *value, size_t size)
+{
+    if (!wb || !path || !name || !value || size == 0)
+        return MP3TAG_ERR_INVALID_ARG;
+
+    /* Held first so edits a flush has in flight are on disk or back */
+    pthread_mutex_lock(&wb->flush_lock);
+    pthread_mutex_lock(&wb->lock);
+
+    /* A pending edit answers without touching the file */
+    wb_file_t *f = find_file(wb, path);
+    for (size_t i = 0; f && i < f->edit_count; i++) {
+        if (str_casecmp(f->edits[i].name, name) != 0) continue;
+        const char *v = f->edits[i].value;
+        int rc = !v ? MP3TAG_ERR_TAG_NOT_FOUND
+               : str_copy(value, size, v) == 0 ? MP3TAG_OK
+                                               : MP3TAG_ERR_TAG_TOO_LARGE;
+        pthread_mutex_unlock(&wb->lock);
+        pthread_mutex_unlock(&wb->flush_lock);
+        return rc;
+    }
+    pthread_mutex_unlock(&wb->lock);
+
+    int rc = mp3tag_open(wb->ctx, path);
+    if (rc == MP3TAG_OK)
+        rc = mp3tag_read_tag_string(wb->ctx, name, value, size);
+    mp3tag_close(wb->ctx);
+
+    pthread_mutex_unlock(&wb->flush_lock);
+    return rc;
+}
+
+int mp3tag_writeback_flush(mp3tag_writeback_t *wb, const char *path)
+{
+    if (!wb) return MP3TAG_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&wb->flush_lock);
+    int rc = flush(wb, path, 0);
+    pthread_mutex_unlock(&wb->flush_lock);
+
+    if (rc == MP3TAG_OK && !path) {
+        pthread_mutex_lock(&wb->lock);
+        rc = wb->error;
+        wb->error = MP3TAG_OK;
+        pthread_mutex_unlock(&wb->lock);
+    }
+    return rc;
+}
+
+size_t mp3tag_writeback_pending(mp3tag_writeback_t *wb)
+{
+    if (!wb) return 0;
+
+    pthread_mutex_lock(&wb->lock);
+    size_t n = wb->file_count;
+    pthread_mutex_unlock(&wb->lock);
+    return n;
+}
+
+void mp3tag_writeback_destroy(mp3tag_writeback_t *wb)
+{
+    if (!wb) return;
+
+    if (wb->has_thread) {
+        pthread_mutex_lock(&wb->lock);
+        wb->stop = 1;
+        pthread_cond_signal(&wb->wake);
+        pthread_mutex_unlock(&wb->lock);
+        pthread_join(wb->thread, NULL);
+    }
+
+    pthread_mutex_lock(&wb->flush_lock);
+    flush(wb, NULL, 0);
+    pthread_mutex_unlock(&wb->flush_lock);
+
+    /* Whatever still could not be written is lost */
+    while (wb->files) {
+        wb_file_t *f = wb->files;
+        wb->files = f->next;
+        free_file(f);
+    }
+
+    pthread_cond_destroy(&wb->wake);
+    pthread_mutex_destroy(&wb->flush_lock);
+    pthread_mutex_destroy(&wb->lock);
+    mp3tag_destroy(wb->ctx);
+    free(wb->journal_path);
+    free(wb);
+}
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Synthetic audio files shared by the test programs.
+ */
+
+#include "fixtures.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ------------------------------------------------------------------ */
+/*  Minimal test-file generators                                       */
+/* ------------------------------------------------------------------ */
+
+/* Helper: write raw bytes to a file */
+static void write_bytes(FILE *f, const void *data, size_t n)
+{
+    fwrite(data, 1, n, f);
+}
+
+static void write_be16(FILE *f, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    write_bytes(f, b, 2);
+}
+
+static void write_be32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = {
+        (uint8_t)(v >> 24), (uint8_t)(v >> 16),
+        (uint8_t)(v >> 8),  (uint8_t)v
+    };
+    write_bytes(f, b, 4);
+}
+
+static void write_le16(FILE *f, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    write_bytes(f, b, 2);
+}
+
+static void write_le32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = {
+        (uint8_t)v,          (uint8_t)(v >> 8),
+        (uint8_t)(v >> 16),  (uint8_t)(v >> 24)
+    };
+    write_bytes(f, b, 4);
+}
+
+/*
+ * Minimal MP3: a single silent MPEG1-Layer3 frame (417 bytes).
+ */
+void create_mp3(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    uint8_t frame[417];
+    memset(frame, 0, sizeof(frame));
+    frame[0] = 0xFF;  /* sync */
+    frame[1] = 0xFB;  /* MPEG1, Layer3, no CRC */
+    frame[2] = 0x90;  /* 128 kbps, 44100 Hz */
+    frame[3] = 0x00;
+    write_bytes(f, frame, sizeof(frame));
+    fclose(f);
+}
+
+/*
+ * Minimal AAC: a single ADTS frame header (7 bytes) + 1 byte data.
+ */
+void create_aac(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    /*
+     * ADTS header (7 bytes, no CRC):
+     *   syncword=FFF, ID=0(MPEG4), layer=00, protection=1
+     *   profile=01(AAC-LC), sf_index=0100(44100), private=0, ch=001(mono)
+     *   ... frame_length=8 (7 header + 1 data), buffer_fullness, frames_minus_1
+     */
+    uint8_t adts[8] = {
+        0xFF, 0xF1,       /* sync + MPEG4 + no CRC */
+        0x50,             /* AAC-LC, 44100, private=0, ch_top=0 */
+        0x80,             /* ch_rest=01, orig=0, home=0, frame_len top bits */
+        0x04, 0x00,       /* frame_length=8, buffer fullness */
+        0x00,             /* frames_minus_1=0 */
+        0x00              /* 1 byte of "audio" data */
+    };
+    /* Fix frame_length field: 8 = 0b0000000001000
+       byte3 bits[1:0] = 00, byte4 = 0b00001000, byte5 bits[7:5] = 000 */
+    adts[3] = 0x80;  /* ch=01, frame_length high 2 bits = 00 */
+    adts[4] = 0x04;  /* frame_length mid 8 bits: 8>>3 = 1 -> 0x04 shifted */
+    /* Actually let's just use a minimal frame length encoding: */
+    /* frame_length = 8. In ADTS: bits spread across bytes 3-5 */
+    /* byte3[1:0]=0, byte4[7:0]=0x02, byte5[7:5]=0 gives 8 */
+    adts[3] = 0x80;
+    adts[4] = 0x02;
+    adts[5] = 0x00;
+    write_bytes(f, adts, sizeof(adts));
+    fclose(f);
+}
+
+/*
+ * Minimal WAV: RIFF/WAVE with fmt + data chunks.
+ * 1 channel, 16-bit, 44100 Hz, 1 sample of silence.
+ */
+void create_wav(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+
+    /* RIFF header */
+    write_bytes(f, "RIFF", 4);
+    write_le32(f, 36 + 2);       /* total size: 4(WAVE) + 24(fmt) + 8(data hdr) + 2(data) */
+    write_bytes(f, "WAVE", 4);
+
+    /* fmt chunk: 16 bytes of PCM format */
+    write_bytes(f, "fmt ", 4);
+    write_le32(f, 16);           /* chunk size */
+    write_le16(f, 1);            /* PCM */
+    write_le16(f, 1);            /* mono */
+    write_le32(f, 44100);        /* sample rate */
+    write_le32(f, 88200);        /* byte rate */
+    write_le16(f, 2);            /* block align */
+    write_le16(f, 16);           /* bits per sample */
+
+    /* data chunk: 1 sample = 2 bytes */
+    write_bytes(f, "data", 4);
+    write_le32(f, 2);
+    write_le16(f, 0);            /* silence */
+
+    fclose(f);
+}
+
+/*
+ * Minimal AIFF: FORM/AIFF with COMM + SSND chunks.
+ * 1 channel, 16-bit, 44100 Hz, 1 frame of silence.
+ */
+void create_aiff(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+
+    /* FORM header */
+    write_bytes(f, "FORM", 4);
+    /* total = 4(AIFF) + 26(COMM chunk) + 18(SSND chunk) = 48 */
+    write_be32(f, 48);
+    write_bytes(f, "AIFF", 4);
+
+    /* COMM chunk: 18 bytes of data */
+    write_bytes(f, "COMM", 4);
+    write_be32(f, 18);
+    write_be16(f, 1);            /* numChannels */
+    write_be32(f, 1);            /* numSampleFrames */
+    write_be16(f, 16);           /* sampleSize */
+    /* sampleRate as 80-bit IEEE 754 extended: 44100 Hz */
+    uint8_t sr[10] = { 0x40, 0x0E, 0xAC, 0x44, 0, 0, 0, 0, 0, 0 };
+    write_bytes(f, sr, 10);
+
+    /* SSND chunk: offset(4) + blockSize(4) + 2 bytes audio = 10 bytes data */
+    write_bytes(f, "SSND", 4);
+    write_be32(f, 10);
+    write_be32(f, 0);            /* offset */
+    write_be32(f, 0);            /* blockSize */
+    write_be16(f, 0);            /* silence */
+
+    fclose(f);
+}
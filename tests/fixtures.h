@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef MP3TAG_TEST_FIXTURES_H
+#define MP3TAG_TEST_FIXTURES_H
+
+/* Untagged minimal files; each call overwrites `path` */
+void create_mp3(const char *path);    /* One silent MPEG1 Layer III frame */
+void create_aac(const char *path);    /* One ADTS frame */
+void create_wav(const char *path);    /* RIFF/WAVE, fmt + data */
+void create_aiff(const char *path);   /* FORM/AIFF, COMM + SSND */
+
+#endif /* MP3TAG_TEST_FIXTURES_H */
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+#ifndef MP3TAG_TEST_SYSCOUNT_H
+#define MP3TAG_TEST_SYSCOUNT_H
+
+#include <stdint.h>
+
+/*
+ * File-related libc calls seen by the LD_PRELOAD interposer
+ * (syscount_preload.c), process-wide since it was loaded.
+ */
+typedef struct {
+    uint64_t open;      /* open, openat, creat, fopen (+64 variants) */
+    uint64_t read;      /* read, __read_chk */
+    uint64_t pread;     /* pread, pread64 and their _chk forms */
+    uint64_t lseek;     /* lseek, lseek64 */
+    uint64_t write;     /* write, pwrite, pwrite64 */
+    uint64_t fsync;     /* fsync, fdatasync */
+} syscount_t;
+
+/* Exported by the interposer; look it up with dlsym(RTLD_DEFAULT) */
+typedef void (*syscount_get_fn)(syscount_t *out);
+
+#define SYSCOUNT_GET_SYMBOL "syscount_get"
+
+#endif /* MP3TAG_TEST_SYSCOUNT_H */
@@ -0,0 +1,196 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * LD_PRELOAD interposer counting file-related libc calls, for the
+ * syscall budget tests. Each wrapper bumps a counter and forwards to
+ * the next definition (normally glibc's). The _chk entry points are
+ * covered too, so _FORTIFY_SOURCE builds of the library are counted.
+ */
+
+#define _GNU_SOURCE
+
+#include "syscount.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static atomic_uint_least64_t n_open, n_read, n_pread, n_lseek, n_write,
+                             n_fsync;
+
+void syscount_get(syscount_t *out)
+{
+    out->open  = atomic_load(&n_open);
+    out->read  = atomic_load(&n_read);
+    out->pread = atomic_load(&n_pread);
+    out->lseek = atomic_load(&n_lseek);
+    out->write = atomic_load(&n_write);
+    out->fsync = atomic_load(&n_fsync);
+}
+
+/* Resolve the next definition of `fn` on first use */
+#define NEXT(fn)                                                    \
+    static __typeof__(fn) *next_ = NULL;                            \
+    if (!next_) next_ = (__typeof__(fn) *)dlsym(RTLD_NEXT, #fn)
+
+#define COUNT(counter) atomic_fetch_add(&(counter), 1)
+
+/* Mode is only passed, and only valid, when a file may be created */
+#define TAKE_MODE(flags)                                            \
+    mode_t mode = 0;                                                \
+    if ((flags) & (O_CREAT | O_TMPFILE)) {                          \
+        va_list ap;                                                 \
+        va_start(ap, flags);                                        \
+        mode = (mode_t)va_arg(ap, int);                             \
+        va_end(ap);                                                 \
+    }
+
+int open(const char *path, int flags, ...)
+{
+    NEXT(open);
+    TAKE_MODE(flags);
+    COUNT(n_open);
+    return next_(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    NEXT(open64);
+    TAKE_MODE(flags);
+    COUNT(n_open);
+    return next_(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+    NEXT(openat);
+    TAKE_MODE(flags);
+    COUNT(n_open);
+    return next_(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+    NEXT(openat64);
+    TAKE_MODE(flags);
+    COUNT(n_open);
+    return next_(dirfd, path, flags, mode);
+}
+
+int creat(const char *path, mode_t mode)
+{
+    NEXT(creat);
+    COUNT(n_open);
+    return next_(path, mode);
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    NEXT(fopen);
+    COUNT(n_open);
+    return next_(path, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode)
+{
+    NEXT(fopen64);
+    COUNT(n_open);
+    return next_(path, mode);
+}
+
+ssize_t read(int fd, void *buf, size_t n)
+{
+    NEXT(read);
+    COUNT(n_read);
+    return next_(fd, buf, n);
+}
+
+ssize_t __read_chk(int fd, void *buf, size_t n, size_t buflen)
+{
+    NEXT(__read_chk);
+    COUNT(n_read);
+    return next_(fd, buf, n, buflen);
+}
+
+ssize_t pread(int fd, void *buf, size_t n, off_t off)
+{
+    NEXT(pread);
+    COUNT(n_pread);
+    return next_(fd, buf, n, off);
+}
+
+ssize_t pread64(int fd, void *buf, size_t n, off64_t off)
+{
+    NEXT(pread64);
+    COUNT(n_pread);
+    return next_(fd, buf, n, off);
+}
+
+ssize_t __pread_chk(int fd, void *buf, size_t n, off_t off, size_t buflen)
+{
+    NEXT(__pread_chk);
+    COUNT(n_pread);
+    return next_(fd, buf, n, off, buflen);
+}
+
+ssize_t __pread64_chk(int fd, void *buf, size_t n, off64_t off,
+                      size_t buflen)
+{
+    NEXT(__pread64_chk);
+    COUNT(n_pread);
+    return next_(fd, buf, n, off, buflen);
+}
+
+off_t lseek(int fd, off_t off, int whence)
+{
+    NEXT(lseek);
+    COUNT(n_lseek);
+    return next_(fd, off, whence);
+}
+
+off64_t lseek64(int fd, off64_t off, int whence)
+{
+    NEXT(lseek64);
+    COUNT(n_lseek);
+    return next_(fd, off, whence);
+}
+
+ssize_t write(int fd, const void *buf, size_t n)
+{
+    NEXT(write);
+    COUNT(n_write);
+    return next_(fd, buf, n);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t n, off_t off)
+{
+    NEXT(pwrite);
+    COUNT(n_write);
+    return next_(fd, buf, n, off);
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t n, off64_t off)
+{
+    NEXT(pwrite64);
+    COUNT(n_write);
+    return next_(fd, buf, n, off);
+}
+
+int fsync(int fd)
+{
+    NEXT(fsync);
+    COUNT(n_fsync);
+    return next_(fd);
+}
+
+int fdatasync(int fd)
+{
+    NEXT(fdatasync);
+    COUNT(n_fsync);
+    return next_(fd);
+}
@@ -9,10 +9,22 @@
  *   AIFF — IFF/AIFF container with "ID3 " chunk
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <mp3tag/mp3tag.h>
+#include "fixtures.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
 
 static int g_pass = 0;
 static int g_fail = 0;
@@ -24,161 +36,6 @@ static int g_fail = 0;
 
 #define CHECK_RC(rc, msg) CHECK((rc) == MP3TAG_OK, msg)
 
-/* ------------------------------------------------------------------ */
-/*  Minimal test-file generators                                       */
-/* ------------------------------------------------------------------ */
-
-/* Helper: write raw bytes to a file */
-static void write_bytes(FILE *f, const void *data, size_t n)
-{
-    fwrite(data, 1, n, f);
-}
-
-static void write_be16(FILE *f, uint16_t v)
-{
-    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
-    write_bytes(f, b, 2);
-}
-
-static void write_be32(FILE *f, uint32_t v)
-{
-    uint8_t b[4] = {
-        (uint8_t)(v >> 24), (uint8_t)(v >> 16),
-        (uint8_t)(v >> 8),  (uint8_t)v
-    };
-    write_bytes(f, b, 4);
-}
-
-static void write_le16(FILE *f, uint16_t v)
-{
-    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
-    write_bytes(f, b, 2);
-}
-
-static void write_le32(FILE *f, uint32_t v)
-{
-    uint8_t b[4] = {
-        (uint8_t)v,          (uint8_t)(v >> 8),
-        (uint8_t)(v >> 16),  (uint8_t)(v >> 24)
-    };
-    write_bytes(f, b, 4);
-}
-
-/*
- * Minimal MP3: a single silent MPEG1-Layer3 frame (417 bytes).
- */
-static void create_mp3(const char *path)
-{
-    FILE *f = fopen(path, "wb");
-    uint8_t frame[417];
-    memset(frame, 0, sizeof(frame));
-    frame[0] = 0xFF;  /* sync */
-    frame[1] = 0xFB;  /* MPEG1, Layer3, no CRC */
-    frame[2] = 0x90;  /* 128 kbps, 44100 Hz */
-    frame[3] = 0x00;
-    write_bytes(f, frame, sizeof(frame));
-    fclose(f);
-}
-
-/*
- * Minimal AAC: a single ADTS frame header (7 bytes) + 1 byte data.
- */
-static void create_aac(const char *path)
-{
-    FILE *f = fopen(path, "wb");
-    /*
-     * ADTS header (7 bytes, no CRC):
-     *   syncword=FFF, ID=0(MPEG4), layer=00, protection=1
-     *   profile=01(AAC-LC), sf_index=0100(44100), private=0, ch=001(mono)
-     *   ... frame_length=8 (7 header + 1 data), buffer_fullness, frames_minus_1
-     */
-    uint8_t adts[8] = {
-        0xFF, 0xF1,       /* sync + MPEG4 + no CRC */
-        0x50,             /* AAC-LC, 44100, private=0, ch_top=0 */
-        0x80,             /* ch_rest=01, orig=0, home=0, frame_len top bits */
-        0x04, 0x00,       /* frame_length=8, buffer fullness */
-        0x00,             /* frames_minus_1=0 */
-        0x00              /* 1 byte of "audio" data */
-    };
-    /* Fix frame_length field: 8 = 0b0000000001000
-       byte3 bits[1:0] = 00, byte4 = 0b00001000, byte5 bits[7:5] = 000 */
-    adts[3] = 0x80;  /* ch=01, frame_length high 2 bits = 00 */
-    adts[4] = 0x04;  /* frame_length mid 8 bits: 8>>3 = 1 -> 0x04 shifted */
-    /* Actually let's just use a minimal frame length encoding: */
-    /* frame_length = 8. In ADTS: bits spread across bytes 3-5 */
-    /* byte3[1:0]=0, byte4[7:0]=0x02, byte5[7:5]=0 gives 8 */
-    adts[3] = 0x80;
-    adts[4] = 0x02;
-    adts[5] = 0x00;
-    write_bytes(f, adts, sizeof(adts));
-    fclose(f);
-}
-
-/*
- * Minimal WAV: RIFF/WAVE with fmt + data chunks.
- * 1 channel, 16-bit, 44100 Hz, 1 sample of silence.
- */
-static void create_wav(const char *path)
-{
-    FILE *f = fopen(path, "wb");
-
-    /* RIFF header */
-    write_bytes(f, "RIFF", 4);
-    write_le32(f, 36 + 2);       /* total size: 4(WAVE) + 24(fmt) + 8(data hdr) + 2(data) */
-    write_bytes(f, "WAVE", 4);
-
-    /* fmt chunk: 16 bytes of PCM format */
-    write_bytes(f, "fmt ", 4);
-    write_le32(f, 16);           /* chunk size */
-    write_le16(f, 1);            /* PCM */
-    write_le16(f, 1);            /* mono */
-    write_le32(f, 44100);        /* sample rate */
-    write_le32(f, 88200);        /* byte rate */
-    write_le16(f, 2);            /* block align */
-    write_le16(f, 16);           /* bits per sample */
-
-    /* data chunk: 1 sample = 2 bytes */
-    write_bytes(f, "data", 4);
-    write_le32(f, 2);
-    write_le16(f, 0);            /* silence */
-
-    fclose(f);
-}
-
-/*
- * Minimal AIFF: FORM/AIFF with COMM + SSND chunks.
- * 1 channel, 16-bit, 44100 Hz, 1 frame of silence.
- */
-static void create_aiff(const char *path)
-{
-    FILE *f = fopen(path, "wb");
-
-    /* FORM header */
-    write_bytes(f, "FORM", 4);
-    /* total = 4(AIFF) + 26(COMM chunk) + 18(SSND chunk) = 48 */
-    write_be32(f, 48);
-    write_bytes(f, "AIFF", 4);
-
-    /* COMM chunk: 18 bytes of data */
-    write_bytes(f, "COMM", 4);
-    write_be32(f, 18);
-    write_be16(f, 1);            /* numChannels */
-    write_be32(f, 1);            /* numSampleFrames */
-    write_be16(f, 16);           /* sampleSize */
-    /* sampleRate as 80-bit IEEE 754 extended: 44100 Hz */
-    uint8_t sr[10] = { 0x40, 0x0E, 0xAC, 0x44, 0, 0, 0, 0, 0, 0 };
-    write_bytes(f, sr, 10);
-
-    /* SSND chunk: offset(4) + blockSize(4) + 2 bytes audio = 10 bytes data */
-    write_bytes(f, "SSND", 4);
-    write_be32(f, 10);
-    write_be32(f, 0);            /* offset */
-    write_be32(f, 0);            /* blockSize */
-    write_be16(f, 0);            /* silence */
-
-    fclose(f);
-}
-
 /* ------------------------------------------------------------------ */
 /*  Per-format test suite                                              */
 /* ------------------------------------------------------------------ */
@@ -299,6 +156,1569 @@ static void test_format(const char *label, const char *path,
     remove(path);
 }
 
+/* ------------------------------------------------------------------ */
+/*  Batch reading                                                      */
+/* ------------------------------------------------------------------ */
+
+static void tag_file(const char *path, void (*create_fn)(const char *),
+                     const char *title)
+{
+    create_fn(path);
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "TITLE", title);
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+}
+
+static void *failing_alloc(size_t size, void *user_data)
+{
+    (void)size;
+    (void)user_data;
+    return NULL;
+}
+
+static void test_batch(void)
+{
+    printf("\n--- Batch ---\n");
+
+    const char *paths[] = {
+        "/tmp/test_libmp3tag_batch0.mp3",
+        "/tmp/test_libmp3tag_batch1.wav",
+        "/tmp/test_libmp3tag_missing.mp3",
+        "/tmp/test_libmp3tag_batch3.aiff",
+        "/tmp/test_libmp3tag_batch4.mp3",
+    };
+    const size_t n = sizeof(paths) / sizeof(paths[0]);
+
+    tag_file(paths[0], create_mp3,  "Batch 0");
+    tag_file(paths[1], create_wav,  "Batch 1");
+    tag_file(paths[3], create_aiff, "Batch 3");
+    create_mp3(paths[4]);  /* untagged */
+
+    mp3tag_batch_options_t opts = {0};
+    opts.thread_count = 3;
+    mp3tag_batch_result_t results[5];
+
+    int rc = mp3tag_read_batch(paths, n, &opts, results);
+    CHECK_RC(rc, "read_batch");
+
+    const char *expect[] = { "Batch 0", "Batch 1", NULL, "Batch 3", NULL };
+    int in_order = 1;
+    for (size_t i = 0; i < n; i++) {
+        const mp3tag_simple_tag_t *st =
+            results[i].tags && results[i].tags->tags
+            ? results[i].tags->tags->simple_tags : NULL;
+        if (expect[i]) {
+            if (results[i].error != MP3TAG_OK || !st ||
+                strcmp(st->value, expect[i]) != 0)
+                in_order = 0;
+        } else if (results[i].tags) {
+            in_order = 0;
+        }
+    }
+    CHECK(in_order, "batch results match input order");
+    CHECK(results[2].error == MP3TAG_ERR_IO, "batch reports missing file");
+    CHECK(results[4].error == MP3TAG_ERR_NO_TAGS, "batch reports untagged file");
+
+    mp3tag_batch_results_free(results, n);
+    CHECK(results[0].tags == NULL, "batch results freed");
+
+    /* Physical ordering changes visiting order only */
+    opts.order_by_location = 1;
+    rc = mp3tag_read_batch(paths, n, &opts, results);
+    CHECK(rc == MP3TAG_OK && results[1].tags &&
+          strcmp(results[1].tags->tags->simple_tags->value, "Batch 1") == 0 &&
+          results[2].error == MP3TAG_ERR_IO,
+          "batch ordered by location keeps result order");
+    mp3tag_batch_results_free(results, n);
+
+    /* Forked workers return the same results */
+    opts.order_by_location = 0;
+    opts.thread_count = 2;
+    rc = mp3tag_read_batch_isolated(paths, n, &opts, results);
+    in_order = rc == MP3TAG_OK;
+    for (size_t i = 0; i < n; i++) {
+        const mp3tag_simple_tag_t *st =
+            results[i].tags && results[i].tags->tags
+            ? results[i].tags->tags->simple_tags : NULL;
+        if (expect[i] ? (!st || strcmp(st->value, expect[i]) != 0)
+                      : results[i].tags != NULL)
+            in_order = 0;
+    }
+    CHECK(in_order && results[2].error == MP3TAG_ERR_IO,
+          "isolated batch matches threaded batch");
+    mp3tag_batch_results_free(results, n);
+
+    /* Workers that cannot even create a context are not replaced forever */
+    mp3tag_allocator_t broke = { failing_alloc, NULL, NULL, NULL };
+    opts.allocator = &broke;
+    rc = mp3tag_read_batch_isolated(paths, n, &opts, results);
+    int all_lost = rc == MP3TAG_OK;
+    for (size_t i = 0; i < n; i++)
+        if (results[i].error != MP3TAG_ERR_WORKER_CRASHED) all_lost = 0;
+    CHECK(all_lost, "isolated batch gives up on workers that cannot start");
+    mp3tag_batch_results_free(results, n);
+
+    /* With SIGCHLD ignored no exit status can be collected: still unclean */
+    struct sigaction ign = { 0 }, saved;
+    ign.sa_handler = SIG_IGN;
+    sigaction(SIGCHLD, &ign, &saved);
+    rc = mp3tag_read_batch_isolated(paths, n, &opts, results);
+    sigaction(SIGCHLD, &saved, NULL);
+    all_lost = rc == MP3TAG_OK;
+    for (size_t i = 0; i < n; i++)
+        if (results[i].error != MP3TAG_ERR_WORKER_CRASHED) all_lost = 0;
+    CHECK(all_lost, "uncollectable worker exits count as crashes");
+    mp3tag_batch_results_free(results, n);
+    opts.allocator = NULL;
+
+    /* Sequential iterator with readahead */
+    mp3tag_batch_iter_t *it = mp3tag_batch_iter_create(paths, n, NULL);
+    CHECK(it != NULL, "batch_iter_create");
+    mp3tag_batch_result_t r;
+    int seen = 0, iter_ok = 1;
+    while (mp3tag_batch_iter_next(it, &r) == 1) {
+        if ((expect[seen] != NULL) != (r.error == MP3TAG_OK))
+            iter_ok = 0;
+        mp3tag_collection_free(NULL, r.tags);
+        seen++;
+    }
+    CHECK(iter_ok && seen == (int)n, "batch_iter visits every file in order");
+    mp3tag_batch_iter_destroy(it);
+
+    for (size_t i = 0; i < n; i++)
+        remove(paths[i]);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Directory scanning                                                 */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    int files;
+    int tagged;
+    int errors;
+} scan_counts_t;
+
+static int count_scan_result(const char *path, int error,
+                             const mp3tag_collection_t *tags, void *user_data)
+{
+    scan_counts_t *c = user_data;
+    (void)path;
+    c->files++;
+    if (error == MP3TAG_OK && tags) c->tagged++;
+    else if (error != MP3TAG_ERR_NO_TAGS) c->errors++;
+    return 0;
+}
+
+static void test_scan(void)
+{
+    printf("\n--- Scan ---\n");
+
+    mkdir("/tmp/test_libmp3tag_scan", 0755);
+    mkdir("/tmp/test_libmp3tag_scan/a", 0755);
+    mkdir("/tmp/test_libmp3tag_scan/a/b", 0755);
+
+    tag_file("/tmp/test_libmp3tag_scan/one.mp3",    create_mp3,  "One");
+    tag_file("/tmp/test_libmp3tag_scan/a/two.WAV",  create_wav,  "Two");
+    tag_file("/tmp/test_libmp3tag_scan/a/b/three.aiff", create_aiff, "Three");
+    tag_file("/tmp/test_libmp3tag_scan/a/b/noext",  create_mp3,  "Sniffed");
+    create_aac("/tmp/test_libmp3tag_scan/a/untagged.aac");
+    FILE *f = fopen("/tmp/test_libmp3tag_scan/a/notes.txt", "w");
+    if (f) { fputs("not audio", f); fclose(f); }
+
+    mp3tag_scan_options_t opts = {0};
+    opts.thread_count = 4;
+    scan_counts_t c = {0, 0, 0};
+    int rc = mp3tag_scan_dir("/tmp/test_libmp3tag_scan", &opts,
+                             count_scan_result, &c);
+    CHECK_RC(rc, "scan_dir");
+    CHECK(c.files == 4 && c.tagged == 3 && c.errors == 0,
+          "scan finds files by extension");
+
+    opts.detect_by_magic = 1;
+    memset(&c, 0, sizeof(c));
+    rc = mp3tag_scan_dir("/tmp/test_libmp3tag_scan", &opts,
+                         count_scan_result, &c);
+    CHECK(rc == MP3TAG_OK && c.files == 5 && c.tagged == 4,
+          "scan sniffs files by magic");
+
+    remove("/tmp/test_libmp3tag_scan/one.mp3");
+    remove("/tmp/test_libmp3tag_scan/a/two.WAV");
+    remove("/tmp/test_libmp3tag_scan/a/b/three.aiff");
+    remove("/tmp/test_libmp3tag_scan/a/b/noext");
+    remove("/tmp/test_libmp3tag_scan/a/untagged.aac");
+    remove("/tmp/test_libmp3tag_scan/a/notes.txt");
+    rmdir("/tmp/test_libmp3tag_scan/a/b");
+    rmdir("/tmp/test_libmp3tag_scan/a");
+    rmdir("/tmp/test_libmp3tag_scan");
+}
+
+/* ------------------------------------------------------------------ */
+/*  Persistent cache                                                   */
+/* ------------------------------------------------------------------ */
+
+/* Read TITLE through a fresh context attached to `cache` */
+static int cached_title(mp3tag_cache_t *cache, const char *path,
+                        char *title, size_t size)
+{
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_set_cache(ctx, cache);
+    int rc = mp3tag_open(ctx, path);
+    if (rc == MP3TAG_OK)
+        rc = mp3tag_read_tag_string(ctx, "TITLE", title, size);
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+    return rc;
+}
+
+/* Overwrite the first `from` in the file with `to` (same length) while
+ * preserving size and mtime, so only the content tells versions apart */
+static void patch_keep_identity(const char *path, const char *from,
+                                const char *to)
+{
+    struct stat st;
+    stat(path, &st);
+
+    FILE *f = fopen(path, "r+b");
+    if (!f) return;
+    char buf[4096];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    size_t len = strlen(from);
+    for (size_t i = 0; i + len <= n; i++) {
+        if (memcmp(buf + i, from, len) == 0) {
+            fseek(f, (long)i, SEEK_SET);
+            fwrite(to, 1, len, f);
+            break;
+        }
+    }
+    fclose(f);
+
+    struct timespec times[2];
+    times[0].tv_sec  = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+#if defined(__APPLE__)
+    times[1] = st.st_mtimespec;
+#else
+    times[1] = st.st_mtim;
+#endif
+    utimensat(AT_FDCWD, path, times, 0);
+}
+
+static void test_cache(void)
+{
+    printf("\n--- Cache ---\n");
+
+    const char *path  = "/tmp/test_libmp3tag_cache.mp3";
+    const char *store = "/tmp/test_libmp3tag_cache.bin";
+    char title[64];
+    remove(store);
+
+    tag_file(path, create_mp3, "Cached");
+
+    mp3tag_cache_t *cache = mp3tag_cache_open(store);
+    CHECK(cache != NULL, "cache_open on missing file");
+
+    int rc = cached_title(cache, path, title, sizeof(title));
+    CHECK(rc == MP3TAG_OK && strcmp(title, "Cached") == 0,
+          "first read populates cache");
+
+    patch_keep_identity(path, "Cached", "Cachex");
+    rc = cached_title(cache, path, title, sizeof(title));
+    CHECK(rc == MP3TAG_OK && strcmp(title, "Cached") == 0,
+          "unchanged identity is served from cache");
+
+    CHECK_RC(mp3tag_cache_save(cache), "cache_save");
+    mp3tag_cache_close(cache);
+
+    cache = mp3tag_cache_open(store);
+    rc = cached_title(cache, path, title, sizeof(title));
+    CHECK(rc == MP3TAG_OK && strcmp(title, "Cached") == 0,
+          "entries survive save and reload");
+
+    /* Changing the mtime invalidates the entry */
+    utimensat(AT_FDCWD, path, NULL, 0);
+    rc = cached_title(cache, path, title, sizeof(title));
+    CHECK(rc == MP3TAG_OK && strcmp(title, "Cachex") == 0,
+          "mtime change forces a re-parse");
+
+    /* Writes through the library drop the stale entry */
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_set_cache(ctx, cache);
+    mp3tag_open_rw(ctx, path);
+    rc = mp3tag_set_tag_string(ctx, "TITLE", "Rewritten");
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+    CHECK_RC(rc, "write with cache attached");
+
+    rc = cached_title(cache, path, title, sizeof(title));
+    CHECK(rc == MP3TAG_OK && strcmp(title, "Rewritten") == 0,
+          "write invalidates cache entry");
+
+    /* The identity comes from the open handle; only a cache also checks
+       that the path still names it */
+    const char *other = "/tmp/test_libmp3tag_cache2.mp3";
+    tag_file(other, create_mp3, "Uncached");
+    mp3tag_stats_t plain, with_cache;
+    ctx = mp3tag_create(NULL);
+    mp3tag_open(ctx, other);
+    mp3tag_get_stats(ctx, &plain);
+    mp3tag_close(ctx);
+    mp3tag_set_cache(ctx, cache);
+    mp3tag_reset_stats(ctx);
+    mp3tag_open(ctx, other);
+    mp3tag_get_stats(ctx, &with_cache);
+    mp3tag_destroy(ctx);
+    CHECK(with_cache.syscalls.stat == plain.syscalls.stat + 1,
+          "open stats the path only with a cache attached");
+
+    mp3tag_cache_close(cache);
+    remove(other);
+    remove(path);
+    remove(store);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Flat collections                                                   */
+/* ------------------------------------------------------------------ */
+
+static void test_flat(void)
+{
+    printf("\n--- Flat ---\n");
+
+    mp3tag_collection_t *coll = mp3tag_collection_create(NULL);
+    mp3tag_tag_t *tag = mp3tag_collection_add_tag(NULL, coll,
+                                                  MP3TAG_TARGET_TRACK);
+    mp3tag_tag_add_track_uid(NULL, tag, 0x0123456789ABCDEFull);
+    mp3tag_simple_tag_t *artist = mp3tag_tag_add_simple(NULL, tag,
+                                                        "ARTIST", "Someone");
+    mp3tag_simple_tag_set_language(NULL, artist, "eng");
+    mp3tag_simple_tag_add_nested(NULL, artist, "SORT_WITH", "One, Some");
+    mp3tag_tag_add_simple(NULL, tag, "TITLE", "Flat Title");
+
+    uint8_t *blob = NULL;
+    size_t size = 0;
+    int rc = mp3tag_flat_serialize(coll, &blob, &size);
+    CHECK(rc == MP3TAG_OK && blob && size > 0, "flat_serialize");
+    CHECK(mp3tag_flat_blob_size(blob, size) == size, "flat_blob_size");
+
+    mp3tag_flat_t view;
+    CHECK_RC(mp3tag_flat_open(&view, blob, size), "flat_open");
+    CHECK(mp3tag_flat_tag_count(&view) == 1 &&
+          mp3tag_flat_tag_target_type(&view, 0) == MP3TAG_TARGET_TRACK,
+          "flat tag accessors");
+    CHECK(mp3tag_flat_tag_uid_count(&view, 0, MP3TAG_UID_TRACK) == 1 &&
+          mp3tag_flat_tag_uid(&view, 0, MP3TAG_UID_TRACK, 0) ==
+              0x0123456789ABCDEFull,
+          "flat track UID");
+
+    mp3tag_flat_ref_t st = mp3tag_flat_tag_first_simple(&view, 0);
+    mp3tag_flat_ref_t nested = mp3tag_flat_simple_nested(&view, st);
+    const char *lang = mp3tag_flat_simple_language(&view, st);
+    const char *sort = mp3tag_flat_simple_value(&view, nested);
+    CHECK(strcmp(mp3tag_flat_simple_name(&view, st), "ARTIST") == 0 &&
+          lang && strcmp(lang, "eng") == 0 &&
+          sort && strcmp(sort, "One, Some") == 0 &&
+          mp3tag_flat_simple_nested(&view, nested) == MP3TAG_FLAT_NONE,
+          "flat simple tag accessors");
+
+    const char *title = mp3tag_flat_find(&view, "title");
+    CHECK(title && strcmp(title, "Flat Title") == 0 &&
+          title >= (const char *)blob && title < (const char *)blob + size,
+          "flat_find returns a pointer into the blob");
+    CHECK(mp3tag_flat_find(&view, "ALBUM") == NULL,
+          "flat_find misses absent tag");
+
+    mp3tag_collection_t *copy = NULL;
+    rc = mp3tag_flat_deserialize(blob, size, &copy);
+    CHECK(rc == MP3TAG_OK && copy && copy->count == 1 &&
+          strcmp(copy->tags->simple_tags->next->value, "Flat Title") == 0 &&
+          strcmp(copy->tags->simple_tags->nested->name, "SORT_WITH") == 0,
+          "flat_deserialize round trip");
+    mp3tag_collection_free(NULL, copy);
+
+    CHECK(mp3tag_flat_open(&view, blob, size - 1) != MP3TAG_OK,
+          "flat_open rejects truncated blob");
+    mp3tag_flat_free(blob);
+
+    /* An unnamed entry stays unnamed rather than becoming "" */
+    mp3tag_simple_tag_t *unnamed = mp3tag_tag_add_simple(NULL, tag, "X", "v");
+    free(unnamed->name);
+    unnamed->name = NULL;
+    rc = mp3tag_flat_serialize(coll, &blob, &size);
+    copy = NULL;
+    if (rc == MP3TAG_OK)
+        rc = mp3tag_flat_deserialize(blob, size, &copy);
+    const mp3tag_simple_tag_t *last = copy ? copy->tags->simple_tags : NULL;
+    while (last && last->next) last = last->next;
+    CHECK(rc == MP3TAG_OK && last && !last->name &&
+          strcmp(last->value, "v") == 0 &&
+          mp3tag_flat_open(&view, blob, size) == MP3TAG_OK &&
+          mp3tag_flat_find(&view, "X") == NULL,
+          "NULL name round trip");
+    mp3tag_collection_free(NULL, copy);
+
+    mp3tag_flat_free(blob);
+    mp3tag_collection_free(NULL, coll);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Catalog index                                                      */
+/* ------------------------------------------------------------------ */
+
+static int count_index_match(const char *path, void *user_data)
+{
+    (void)path;
+    (*(int *)user_data)++;
+    return 0;
+}
+
+/* Collection with ARTIST, a custom field and an optional APIC blob */
+static mp3tag_collection_t *index_coll(const char *artist, const char *mood,
+                                       size_t apic_size)
+{
+    mp3tag_collection_t *coll = mp3tag_collection_create(NULL);
+    mp3tag_tag_t *tag = mp3tag_collection_add_tag(NULL, coll,
+                                                  MP3TAG_TARGET_ALBUM);
+    mp3tag_tag_add_simple(NULL, tag, "ARTIST", artist);
+    mp3tag_tag_add_simple(NULL, tag, "MOOD", mood);
+    if (apic_size > 0) {
+        mp3tag_simple_tag_t *st = mp3tag_tag_add_simple(NULL, tag, "APIC",
+                                                        NULL);
+        st->binary      = calloc(1, apic_size);
+        st->binary_size = apic_size;
+    }
+    return coll;
+}
+
+static void test_index(void)
+{
+    printf("\n--- Index ---\n");
+
+    mp3tag_index_t *idx = mp3tag_index_create();
+    CHECK(idx != NULL, "index_create");
+
+    mp3tag_collection_t *a = index_coll("Band", "Calm", 2 << 20);
+    mp3tag_collection_t *b = index_coll("band", "Loud", 1000);
+    mp3tag_collection_t *c = index_coll("Other", "Calm", 0);
+    mp3tag_index_add(idx, "/music/a.mp3", a);
+    mp3tag_index_add(idx, "/music/b.mp3", b);
+    mp3tag_index_add(idx, "/music/c.mp3", c);
+    CHECK(mp3tag_index_count(idx) == 3, "index_count");
+
+    int n = 0;
+    mp3tag_index_find(idx, "artist", "BAND", count_index_match, &n);
+    CHECK(n == 2, "find by artist is case-insensitive");
+
+    n = 0;
+    mp3tag_index_find(idx, "MOOD", "calm", count_index_match, &n);
+    CHECK(n == 2, "find by user-defined field");
+
+    n = 0;
+    mp3tag_index_find_frame(idx, "APIC", 1 << 20, count_index_match, &n);
+    CHECK(n == 1, "find frame above size threshold");
+
+    n = 0;
+    mp3tag_index_find_frame(idx, "apic", 0, count_index_match, &n);
+    CHECK(n == 2, "find frame of any size");
+
+    /* Re-adding a path replaces its postings */
+    mp3tag_index_add(idx, "/music/a.mp3", c);
+    n = 0;
+    mp3tag_index_find(idx, "ARTIST", "band", count_index_match, &n);
+    CHECK(n == 1 && mp3tag_index_count(idx) == 3, "re-add replaces entry");
+
+    mp3tag_frame_stats_t stats;
+    int rc = mp3tag_index_frame_stats(idx, "APIC", &stats);
+    CHECK(rc == MP3TAG_OK && stats.count == 1 && stats.total_bytes == 1000 &&
+          stats.size_histogram[9] == 1,
+          "frame stats follow replacements");
+
+    CHECK_RC(mp3tag_index_remove(idx, "/music/b.mp3"), "index_remove");
+    n = 0;
+    mp3tag_index_find_frame(idx, "APIC", 0, count_index_match, &n);
+    CHECK(n == 0 && mp3tag_index_count(idx) == 2,
+          "removed file no longer matches");
+
+    /* Churn well past the compaction threshold; lookups stay exact */
+    char name[64];
+    for (int i = 0; i < 1000; i++) {
+        mp3tag_index_add(idx, "/music/a.mp3", (i & 1) ? a : c);
+        snprintf(name, sizeof(name), "/music/tmp%d.mp3", i);
+        mp3tag_index_add(idx, name, b);
+        mp3tag_index_remove(idx, name);
+    }
+    int artist = 0, mood = 0, apic = 0;
+    mp3tag_index_find(idx, "ARTIST", "band", count_index_match, &artist);
+    mp3tag_index_find(idx, "MOOD", "calm", count_index_match, &mood);
+    mp3tag_index_find_frame(idx, "APIC", 0, count_index_match, &apic);
+    rc = mp3tag_index_frame_stats(idx, "APIC", &stats);
+    CHECK(mp3tag_index_count(idx) == 2 && artist == 1 && mood == 2 &&
+          apic == 1 && rc == MP3TAG_OK && stats.count == 1 &&
+          stats.total_bytes == 2 << 20,
+          "index stays exact across compactions");
+
+    mp3tag_collection_free(NULL, a);
+    mp3tag_collection_free(NULL, b);
+    mp3tag_collection_free(NULL, c);
+    mp3tag_index_destroy(idx);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Change watcher                                                     */
+/* ------------------------------------------------------------------ */
+
+static int count_watch_event(const char *path, int error,
+                             const mp3tag_collection_t *tags, void *user_data)
+{
+    (void)path;
+    (void)tags;
+    scan_counts_t *c = user_data;
+    c->files++;
+    if (error == MP3TAG_OK) c->tagged++;
+    else                    c->errors++;
+    return 0;
+}
+
+/* Poll until `done` holds or about two seconds pass */
+#define POLL_UNTIL(w, done) do { \
+    for (int tries_ = 0; tries_ < 200 && !(done); tries_++) \
+        mp3tag_watcher_poll((w), 10); \
+} while (0)
+
+static void test_watch(void)
+{
+    printf("\n--- Watch ---\n");
+
+    const char *dir    = "/tmp/test_libmp3tag_watch";
+    const char *file   = "/tmp/test_libmp3tag_watch/song.mp3";
+    const char *cursor = "/tmp/test_libmp3tag_watch.cursor";
+    mkdir(dir, 0755);
+    remove(cursor);
+
+    mp3tag_index_t *idx = mp3tag_index_create();
+    scan_counts_t c = {0, 0, 0};
+
+    mp3tag_watch_options_t opts = {0};
+    opts.index       = idx;
+    opts.debounce_ms = 20;
+    opts.cursor_path = cursor;
+    opts.callback    = count_watch_event;
+    opts.user_data   = &c;
+
+    mp3tag_watcher_t *w = mp3tag_watcher_create(&opts);
+    CHECK(w != NULL, "watcher_create");
+    CHECK_RC(mp3tag_watcher_add_root(w, dir), "watcher_add_root");
+
+    tag_file(file, create_mp3, "Watched");
+    POLL_UNTIL(w, mp3tag_index_count(idx) == 1);
+    CHECK(mp3tag_index_count(idx) == 1 && c.tagged >= 1,
+          "new file is read into the index");
+
+    remove(file);
+    POLL_UNTIL(w, mp3tag_index_count(idx) == 0);
+    CHECK(mp3tag_index_count(idx) == 0, "deleted file leaves the index");
+
+    mp3tag_watcher_destroy(w);
+
+    /* Changes made while no watcher runs are found by the resume sweep */
+    tag_file(file, create_mp3, "While away");
+    memset(&c, 0, sizeof(c));
+    w = mp3tag_watcher_create(&opts);
+    mp3tag_watcher_add_root(w, dir);
+    POLL_UNTIL(w, c.tagged > 0);
+    CHECK(c.tagged > 0 && mp3tag_index_count(idx) == 1,
+          "restart sweeps files changed since the cursor");
+
+    mp3tag_watcher_destroy(w);
+
+    /* A directory moved out of the root takes its files along */
+    const char *sub      = "/tmp/test_libmp3tag_watch/album";
+    const char *sub_file = "/tmp/test_libmp3tag_watch/album/track.mp3";
+    const char *moved    = "/tmp/test_libmp3tag_watch_moved";
+    const char *moved_f  = "/tmp/test_libmp3tag_watch_moved/track.mp3";
+    const char *cache_f  = "/tmp/test_libmp3tag_watch.cache";
+    remove(cache_f);
+    mp3tag_cache_t *cache = mp3tag_cache_open(cache_f);
+    opts.cache = cache;
+    w = mp3tag_watcher_create(&opts);
+    mp3tag_watcher_add_root(w, dir);
+    mkdir(sub, 0755);
+    tag_file(sub_file, create_mp3, "Album track");
+    POLL_UNTIL(w, mp3tag_index_count(idx) == 2);
+    CHECK(mp3tag_index_count(idx) == 2, "file in new subdirectory is read");
+
+    rename(sub, moved);
+    POLL_UNTIL(w, mp3tag_index_count(idx) == 1);
+    CHECK(mp3tag_index_count(idx) == 1,
+          "directory moved away leaves the index");
+
+    mp3tag_watcher_destroy(w);
+    struct stat st;
+    CHECK(stat(cache_f, &st) == 0, "watcher saves the cache on destroy");
+    mp3tag_cache_close(cache);
+
+    mp3tag_index_destroy(idx);
+    remove(moved_f);
+    rmdir(moved);
+    remove(file);
+    remove(cursor);
+    remove(cache_f);
+    rmdir(dir);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Shared snapshot cache                                              */
+/* ------------------------------------------------------------------ */
+
+static const char *snapshot_title(const mp3tag_snapshot_t *snap)
+{
+    const mp3tag_collection_t *c = mp3tag_snapshot_tags(snap);
+    for (const mp3tag_tag_t *t = c ? c->tags : NULL; t; t = t->next)
+        for (const mp3tag_simple_tag_t *st = t->simple_tags; st; st = st->next)
+            if (st->name && st->value && strcmp(st->name, "TITLE") == 0)
+                return st->value;
+    return NULL;
+}
+
+static int strings_equal(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Same tags, names, values and binaries in the same order */
+static int collections_equal(const mp3tag_collection_t *a,
+                             const mp3tag_collection_t *b)
+{
+    const mp3tag_tag_t *ta = a->tags, *tb = b->tags;
+    for (; ta && tb; ta = ta->next, tb = tb->next) {
+        if (ta->target_type != tb->target_type) return 0;
+        const mp3tag_simple_tag_t *sa = ta->simple_tags, *sb = tb->simple_tags;
+        for (; sa && sb; sa = sa->next, sb = sb->next) {
+            if (!strings_equal(sa->name, sb->name) ||
+                !strings_equal(sa->value, sb->value) ||
+                sa->binary_size != sb->binary_size ||
+                (sa->binary_size &&
+                 memcmp(sa->binary, sb->binary, sa->binary_size) != 0))
+                return 0;
+        }
+        if (sa || sb) return 0;
+    }
+    return !ta && !tb;
+}
+
+typedef struct {
+    mp3tag_lru_t *lru;
+    const char   *path;
+    int           bad;
+} lru_reader_t;
+
+static void *lru_reader(void *arg)
+{
+    lru_reader_t *r = arg;
+    for (int i = 0; i < 2000; i++) {
+        mp3tag_snapshot_t *snap = mp3tag_lru_get(r->lru, r->path);
+        if (snap && !snapshot_title(snap)) r->bad++;
+        mp3tag_snapshot_release(snap);
+    }
+    return NULL;
+}
+
+static void test_lru(void)
+{
+    printf("\n--- Snapshot cache ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_lru.mp3";
+    tag_file(path, create_mp3, "First");
+
+    mp3tag_lru_t *lru = mp3tag_lru_create(1 << 20);
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+
+    mp3tag_snapshot_t *a = NULL;
+    int rc = mp3tag_lru_load(lru, ctx, path, &a);
+    CHECK(rc == MP3TAG_OK && a && strcmp(snapshot_title(a), "First") == 0,
+          "lru_load reads on miss");
+
+    mp3tag_snapshot_t *b = mp3tag_lru_get(lru, path);
+    CHECK(b == a, "lru_get shares the cached snapshot");
+    mp3tag_snapshot_release(b);
+
+    /* A write through an attached context publishes the new version as
+     * the file now holds it: ID3v2 keeps neither the target type nor
+     * valueless entries */
+    mp3tag_set_lru(ctx, lru);
+    mp3tag_open_rw(ctx, path);
+    mp3tag_collection_t *w = mp3tag_collection_create(NULL);
+    mp3tag_tag_t *wt = mp3tag_collection_add_tag(NULL, w,
+                                                 MP3TAG_TARGET_TRACK);
+    mp3tag_tag_add_simple(NULL, wt, "TITLE", "Second");
+    mp3tag_tag_add_simple(NULL, wt, "MOOD", NULL);
+    CHECK_RC(mp3tag_write_tags(ctx, w), "write through lru context");
+    mp3tag_collection_free(NULL, w);
+    mp3tag_close(ctx);
+
+    mp3tag_context_t *fresh = mp3tag_create(NULL);
+    mp3tag_collection_t *disk = NULL;
+    mp3tag_open(fresh, path);
+    mp3tag_read_tags(fresh, &disk);
+    b = mp3tag_lru_get(lru, path);
+    CHECK(b && strcmp(snapshot_title(b), "Second") == 0,
+          "write publishes replacement");
+    CHECK(b && disk && collections_equal(mp3tag_snapshot_tags(b), disk),
+          "published version matches a fresh read");
+    mp3tag_destroy(fresh);
+    CHECK(strcmp(snapshot_title(a), "First") == 0,
+          "old snapshot survives replacement");
+    mp3tag_snapshot_release(a);
+    mp3tag_snapshot_release(b);
+
+    /* Readers keep running while the entry is replaced over and over */
+    lru_reader_t readers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        readers[i].lru  = lru;
+        readers[i].path = path;
+        readers[i].bad  = 0;
+        pthread_create(&threads[i], NULL, lru_reader, &readers[i]);
+    }
+    mp3tag_collection_t *coll = mp3tag_collection_create(NULL);
+    mp3tag_tag_t *tag = mp3tag_collection_add_tag(NULL, coll,
+                                                  MP3TAG_TARGET_ALBUM);
+    mp3tag_tag_add_simple(NULL, tag, "TITLE", "Published");
+    for (int i = 0; i < 200; i++)
+        mp3tag_lru_publish(lru, path, coll);
+    int bad = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        bad += readers[i].bad;
+    }
+    CHECK(bad == 0, "concurrent readers during publishes");
+
+    /* Byte budget forces eviction */
+    mp3tag_lru_t *small = mp3tag_lru_create(1024);
+    char name[64];
+    for (int i = 0; i < 8; i++) {
+        snprintf(name, sizeof(name), "/tmp/test_libmp3tag_lru%d.mp3", i);
+        tag_file(name, create_mp3, "Evict me");
+        mp3tag_snapshot_t *s = NULL;
+        mp3tag_lru_load(small, ctx, name, &s);
+        mp3tag_snapshot_release(s);
+    }
+    mp3tag_lru_stats_t stats;
+    mp3tag_lru_get_stats(small, &stats);
+    CHECK(stats.evictions > 0 && stats.bytes <= 1024,
+          "eviction keeps cache within byte budget");
+    mp3tag_lru_destroy(small);
+    for (int i = 0; i < 8; i++) {
+        snprintf(name, sizeof(name), "/tmp/test_libmp3tag_lru%d.mp3", i);
+        remove(name);
+    }
+
+    mp3tag_collection_free(NULL, coll);
+    mp3tag_destroy(ctx);
+    mp3tag_lru_destroy(lru);
+    remove(path);
+}
+
+static void test_snapshot(void)
+{
+    printf("\n--- Snapshots ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_snap.mp3";
+    tag_file(path, create_mp3, "Before");
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open_rw(ctx, path);
+
+    mp3tag_snapshot_t *snap = NULL;
+    int rc = mp3tag_snapshot_acquire(ctx, &snap);
+    CHECK_RC(rc, "snapshot_acquire");
+
+    mp3tag_collection_t *tags = NULL;
+    mp3tag_read_tags(ctx, &tags);
+    CHECK(mp3tag_snapshot_tags(snap) == tags, "snapshot shares parsed tags");
+
+    mp3tag_snapshot_t *again = mp3tag_snapshot_retain(snap);
+    CHECK(again == snap, "snapshot_retain");
+    mp3tag_snapshot_release(again);
+
+    rc = mp3tag_set_tag_string(ctx, "TITLE", "After");
+    CHECK_RC(rc, "write while snapshot held");
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+    CHECK(strcmp(snapshot_title(snap), "Before") == 0,
+          "snapshot survives write, close and destroy");
+    mp3tag_snapshot_release(snap);
+
+    /* An attached context reads the cached version without copying */
+    mp3tag_lru_t *lru = mp3tag_lru_create(1 << 20);
+    mp3tag_context_t *a = mp3tag_create(NULL);
+    mp3tag_context_t *b = mp3tag_create(NULL);
+    mp3tag_set_lru(a, lru);
+    mp3tag_set_lru(b, lru);
+
+    mp3tag_snapshot_t *sa = NULL, *sb = NULL;
+    mp3tag_open(a, path);
+    mp3tag_snapshot_acquire(a, &sa);
+    mp3tag_open(b, path);
+    mp3tag_snapshot_acquire(b, &sb);
+    CHECK(sa && sa == sb && strcmp(snapshot_title(sb), "After") == 0,
+          "contexts share one snapshot through the cache");
+
+    mp3tag_close(a);
+    mp3tag_close(b);
+    CHECK(strcmp(snapshot_title(sa), "After") == 0,
+          "shared snapshot outlives both contexts' reads");
+
+    mp3tag_snapshot_release(sa);
+    mp3tag_snapshot_release(sb);
+    mp3tag_destroy(a);
+    mp3tag_destroy(b);
+    mp3tag_lru_destroy(lru);
+    remove(path);
+}
+
+static void test_revalidate(void)
+{
+    printf("\n--- Revalidate ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_reval.mp3";
+    tag_file(path, create_mp3, "One");
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open(ctx, path);
+    mp3tag_collection_t *before = NULL, *after = NULL;
+    mp3tag_read_tags(ctx, &before);
+
+    mp3tag_reset_stats(ctx);
+    int rc = mp3tag_revalidate(ctx);
+    mp3tag_read_tags(ctx, &after);
+    mp3tag_stats_t st;
+    mp3tag_get_stats(ctx, &st);
+    CHECK(rc == 0 && after == before, "unchanged file keeps cached tags");
+    CHECK(st.syscalls.stat == 1 && st.syscalls.open == 0,
+          "unchanged file costs one stat");
+
+    /* Another writer modifies the file */
+    mp3tag_context_t *writer = mp3tag_create(NULL);
+    mp3tag_open_rw(writer, path);
+    mp3tag_set_tag_string(writer, "TITLE", "Two");
+    mp3tag_destroy(writer);
+    rc = mp3tag_revalidate(ctx);
+    char title[64] = "";
+    mp3tag_read_tag_string(ctx, "TITLE", title, sizeof(title));
+    CHECK(rc == 1 && strcmp(title, "Two") == 0, "modified file is re-probed");
+    CHECK(mp3tag_revalidate(ctx) == 0, "revalidate settles after re-probe");
+
+    /* Replaced by rename: the old handle must not be reused */
+    const char *tmp = "/tmp/test_libmp3tag_reval.tmp.mp3";
+    tag_file(tmp, create_mp3, "Three");
+    rename(tmp, path);
+    rc = mp3tag_revalidate(ctx);
+    mp3tag_read_tag_string(ctx, "TITLE", title, sizeof(title));
+    CHECK(rc == 1 && strcmp(title, "Three") == 0, "replaced file is reopened");
+
+    remove(path);
+    CHECK(mp3tag_revalidate(ctx) == MP3TAG_ERR_IO, "deleted file reports I/O error");
+    mp3tag_close(ctx);
+    CHECK(mp3tag_revalidate(ctx) == MP3TAG_ERR_NOT_OPEN, "revalidate needs an open file");
+    mp3tag_destroy(ctx);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Write-behind                                                       */
+/* ------------------------------------------------------------------ */
+
+static void le32(uint8_t *b, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        b[i] = (uint8_t)(v >> (8 * i));
+}
+
+/* Journal as an interrupted flush leaves it: one record for `path` */
+static void write_journal(const char *journal, const char *path,
+                          const char *title, int corrupt)
+{
+    mp3tag_collection_t *coll = mp3tag_collection_create(NULL);
+    mp3tag_tag_t *tag = mp3tag_collection_add_tag(NULL, coll,
+                                                  MP3TAG_TARGET_ALBUM);
+    mp3tag_tag_add_simple(NULL, tag, "TITLE", title);
+    uint8_t *blob = NULL;
+    size_t blob_size = 0;
+    mp3tag_flat_serialize(coll, &blob, &blob_size);
+    mp3tag_collection_free(NULL, coll);
+
+    size_t path_len = strlen(path);
+    size_t body_len = 8 + path_len + blob_size;
+    uint8_t *body = malloc(body_len);
+    le32(body, (uint32_t)path_len);
+    memcpy(body + 4, path, path_len);
+    le32(body + 4 + path_len, (uint32_t)blob_size);
+    memcpy(body + 8 + path_len, blob, blob_size);
+
+    uint64_t sum = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < body_len; i++) {
+        sum ^= body[i];
+        sum *= 0x100000001b3ull;
+    }
+    if (corrupt) body[body_len - 1] ^= 0xFF;
+
+    uint8_t hdr[20];
+    memcpy(hdr, "M3WJ", 4);
+    le32(hdr + 4, 1);                    /* Version */
+    le32(hdr + 8, 1);                    /* Records */
+    le32(hdr + 12, (uint32_t)sum);
+    le32(hdr + 16, (uint32_t)(sum >> 32));
+
+    FILE *f = fopen(journal, "wb");
+    fwrite(hdr, 1, sizeof(hdr), f);
+    fwrite(body, 1, body_len, f);
+    fclose(f);
+
+    free(body);
+    mp3tag_flat_free(blob);
+}
+
+static void read_title(const char *path, char *title, size_t size)
+{
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    title[0] = '\0';
+    mp3tag_open(ctx, path);
+    mp3tag_read_tag_string(ctx, "TITLE", title, size);
+    mp3tag_destroy(ctx);
+}
+
+static void test_writeback(void)
+{
+    printf("\n--- Write-behind ---\n");
+
+    const char *path    = "/tmp/test_libmp3tag_wb.mp3";
+    const char *journal = "/tmp/test_libmp3tag_wb.journal";
+    char value[64];
+    tag_file(path, create_mp3, "Original");
+    remove(journal);
+
+    mp3tag_writeback_options_t opts = { 0 };
+    opts.journal_path = journal;
+    mp3tag_writeback_t *wb = mp3tag_writeback_create(&opts);
+    CHECK(wb != NULL, "writeback_create");
+
+    mp3tag_writeback_set(wb, path, "TITLE", "First");
+    mp3tag_writeback_set(wb, path, "ARTIST", "Someone");
+    mp3tag_writeback_set(wb, path, "TITLE", "Second");
+    CHECK(mp3tag_writeback_pending(wb) == 1, "edits coalesce per file");
+
+    read_title(path, value, sizeof(value));
+    CHECK(strcmp(value, "Original") == 0, "file untouched before flush");
+    int rc = mp3tag_writeback_read_string(wb, path, "TITLE", value, sizeof(value));
+    CHECK(rc == MP3TAG_OK && strcmp(value, "Second") == 0,
+          "reads see pending edits");
+
+    mp3tag_collection_t *tags = NULL;
+    rc = mp3tag_writeback_read_tags(wb, path, &tags);
+    int simple = 0;
+    for (const mp3tag_simple_tag_t *st = tags ? tags->tags->simple_tags : NULL;
+         st; st = st->next)
+        simple++;
+    CHECK(rc == MP3TAG_OK && simple == 2, "read_tags merges pending edits");
+    mp3tag_collection_free(NULL, tags);
+
+    rc = mp3tag_writeback_flush(wb, path);
+    read_title(path, value, sizeof(value));
+    CHECK(rc == MP3TAG_OK && strcmp(value, "Second") == 0 &&
+          mp3tag_writeback_pending(wb) == 0, "flush writes merged edits");
+    CHECK(access(journal, F_OK) != 0, "journal removed after flush");
+
+    mp3tag_writeback_set(wb, path, "ARTIST", NULL);
+    rc = mp3tag_writeback_read_string(wb, path, "ARTIST", value, sizeof(value));
+    CHECK(rc == MP3TAG_ERR_TAG_NOT_FOUND, "pending removal hides field");
+    mp3tag_writeback_destroy(wb);
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open(ctx, path);
+    rc = mp3tag_read_tag_string(ctx, "ARTIST", value, sizeof(value));
+    CHECK(rc == MP3TAG_ERR_TAG_NOT_FOUND, "destroy flushes pending edits");
+    mp3tag_destroy(ctx);
+
+    /* Background flush after the delay */
+    opts.delay_ms = 20;
+    wb = mp3tag_writeback_create(&opts);
+    mp3tag_writeback_set(wb, path, "TITLE", "Delayed");
+    for (int i = 0; i < 200 && mp3tag_writeback_pending(wb) > 0; i++)
+        nanosleep(&(struct timespec){ 0, 5000000 }, NULL);
+    read_title(path, value, sizeof(value));
+    CHECK(strcmp(value, "Delayed") == 0, "delayed flush in background");
+    CHECK(mp3tag_writeback_flush(wb, NULL) == MP3TAG_OK,
+          "no background errors");
+    mp3tag_writeback_destroy(wb);
+    opts.delay_ms = 0;
+
+    /* Recovery from a crash after the journal was synced */
+    write_journal(journal, path, "Recovered", 0);
+    wb = mp3tag_writeback_create(&opts);
+    read_title(path, value, sizeof(value));
+    CHECK(strcmp(value, "Recovered") == 0 && access(journal, F_OK) != 0,
+          "complete journal replayed on create");
+    mp3tag_writeback_destroy(wb);
+
+    write_journal(journal, path, "Torn", 1);
+    wb = mp3tag_writeback_create(&opts);
+    read_title(path, value, sizeof(value));
+    CHECK(strcmp(value, "Recovered") == 0 && access(journal, F_OK) != 0,
+          "torn journal discarded");
+    mp3tag_writeback_destroy(wb);
+
+    /* A journal that cannot be written backs off instead of spinning */
+    opts.delay_ms     = 10;
+    opts.journal_path = "/nonexistent_dir/wb.journal";
+    wb = mp3tag_writeback_create(&opts);
+    mp3tag_writeback_set(wb, path, "TITLE", "Unjournaled");
+    nanosleep(&(struct timespec){ 0, 50000000 }, NULL);
+    CHECK(mp3tag_writeback_pending(wb) == 1,
+          "failed flush keeps the edits pending");
+    CHECK(mp3tag_writeback_flush(wb, NULL) != MP3TAG_OK,
+          "failed journal write is reported");
+    read_title(path, value, sizeof(value));
+    CHECK(strcmp(value, "Recovered") == 0, "file untouched without journal");
+    mp3tag_writeback_destroy(wb);
+    opts.delay_ms     = 0;
+    opts.journal_path = journal;
+
+    /* A flush of more files than descriptors may be open */
+    char name[64];
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "/tmp/test_libmp3tag_wb%d.mp3", i);
+        tag_file(name, create_mp3, "Original");
+    }
+    wb = mp3tag_writeback_create(&opts);
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "/tmp/test_libmp3tag_wb%d.mp3", i);
+        mp3tag_writeback_set(wb, name, "TITLE", "Many");
+    }
+    struct rlimit saved, low;
+    getrlimit(RLIMIT_NOFILE, &saved);
+    low = saved;
+    low.rlim_cur = 64;
+    setrlimit(RLIMIT_NOFILE, &low);
+    rc = mp3tag_writeback_flush(wb, NULL);
+    setrlimit(RLIMIT_NOFILE, &saved);
+    int written = 0;
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "/tmp/test_libmp3tag_wb%d.mp3", i);
+        read_title(name, value, sizeof(value));
+        written += strcmp(value, "Many") == 0;
+        remove(name);
+    }
+    CHECK(rc == MP3TAG_OK && written == 100 &&
+          mp3tag_writeback_pending(wb) == 0,
+          "flush beyond the descriptor limit");
+    mp3tag_writeback_destroy(wb);
+
+    remove(path);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Statistics                                                         */
+/* ------------------------------------------------------------------ */
+
+static void test_stats(void)
+{
+    printf("\n--- Statistics ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_stats.mp3";
+    create_mp3(path);
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_stats_t st;
+
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "TITLE", "Counted");
+    mp3tag_close(ctx);
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.write_strategy[MP3TAG_WRITE_RAW_REWRITE] == 1 &&
+          st.bytes_copied > 0 && st.syscalls.rename == 1,
+          "first write rewrites the stream");
+    CHECK(st.syscalls.fsync >= 1 && st.syscalls.open >= 1 &&
+          st.syscalls.close >= 1, "syscalls counted");
+
+    mp3tag_reset_stats(ctx);
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "ARTIST", "Counter");
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.write_strategy[MP3TAG_WRITE_IN_PLACE] == 1 &&
+          st.write_strategy[MP3TAG_WRITE_RAW_REWRITE] == 0 &&
+          st.bytes_copied == 0, "padding allows in-place write");
+    mp3tag_close(ctx);
+
+    mp3tag_reset_stats(ctx);
+    mp3tag_collection_t *tags = NULL;
+    mp3tag_open(ctx, path);
+    mp3tag_read_tags(ctx, &tags);
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.frames_parsed == 2 && st.frames_skipped == 0,
+          "frames parsed");
+    CHECK(st.transcoded_bytes[MP3TAG_ENC_UTF8] +
+          st.transcoded_bytes[MP3TAG_ENC_LATIN1] +
+          st.transcoded_bytes[MP3TAG_ENC_UTF16] > 0, "text transcoded");
+    CHECK(st.bytes_read > 0 && st.syscalls.read > 0 &&
+          st.bytes_written == 0, "read accounted");
+    CHECK(st.allocations > 0 && st.bytes_allocated > 0,
+          "allocations counted");
+    mp3tag_close(ctx);
+
+    mp3tag_reset_stats(ctx);
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.syscalls.open == 0 && st.allocations == 0, "reset_stats");
+
+    mp3tag_destroy(ctx);
+    remove(path);
+}
+
+static void test_write_settings(void)
+{
+    printf("\n--- Write settings ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_settings.wav";
+    create_wav(path);
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_stats_t st;
+
+    CHECK_RC(mp3tag_set_padding(ctx, 0), "set_padding(0)");
+    CHECK(mp3tag_set_padding(ctx, 1u << 30) == MP3TAG_ERR_INVALID_ARG,
+          "oversized padding rejected");
+    CHECK_RC(mp3tag_set_fsync(ctx, 0), "set_fsync(0)");
+
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "TITLE", "Tight");
+    mp3tag_set_tag_string(ctx, "ARTIST", "Unpadded");
+    mp3tag_close(ctx);
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.write_strategy[MP3TAG_WRITE_APPEND] == 1 &&
+          st.write_strategy[MP3TAG_WRITE_CONTAINER_REWRITE] == 1,
+          "without padding the next edit rewrites");
+    CHECK(st.syscalls.fsync == 0 && st.syscalls.rename == 1,
+          "fsync off skips every sync");
+
+    mp3tag_reset_stats(ctx);
+    mp3tag_set_padding(ctx, 4096);
+    mp3tag_set_fsync(ctx, 1);
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "GENRE", "Padded");
+    mp3tag_set_tag_string(ctx, "COMMENT", "Fits");
+    mp3tag_get_stats(ctx, &st);
+    CHECK(st.write_strategy[MP3TAG_WRITE_CONTAINER_REWRITE] == 1 &&
+          st.write_strategy[MP3TAG_WRITE_IN_PLACE] == 1,
+          "padding lets the next edit go in place");
+    CHECK(st.syscalls.fsync == 2, "fsync on syncs every write");
+
+    char buf[64] = "";
+    mp3tag_read_tag_string(ctx, "ARTIST", buf, sizeof(buf));
+    CHECK(strcmp(buf, "Unpadded") == 0, "tags survive unsynced rewrite");
+    mp3tag_close(ctx);
+
+    mp3tag_destroy(ctx);
+    remove(path);
+}
+
+typedef struct {
+    int      open[MP3TAG_PHASE_COUNT];
+    int      ended[MP3TAG_PHASE_COUNT];
+    uint64_t bytes[MP3TAG_PHASE_COUNT];
+    int      unpaired;
+} trace_log_t;
+
+static void trace_begin(mp3tag_phase_t phase, void *user_data)
+{
+    trace_log_t *log = user_data;
+    if (log->open[phase]) log->unpaired++;
+    log->open[phase] = 1;
+}
+
+static void trace_end(mp3tag_phase_t phase, uint64_t bytes, void *user_data)
+{
+    trace_log_t *log = user_data;
+    if (!log->open[phase]) log->unpaired++;
+    log->open[phase] = 0;
+    log->ended[phase]++;
+    log->bytes[phase] += bytes;
+}
+
+static void test_trace(void)
+{
+    printf("\n--- Tracing ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_trace.mp3";
+    create_mp3(path);
+
+    trace_log_t log;
+    memset(&log, 0, sizeof(log));
+    mp3tag_trace_hooks_t hooks = { trace_begin, trace_end, &log };
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    CHECK_RC(mp3tag_set_trace(ctx, &hooks), "set_trace");
+
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "TITLE", "Traced");
+    mp3tag_close(ctx);
+    CHECK(log.ended[MP3TAG_PHASE_CONTAINER_DETECT] >= 1 &&
+          log.ended[MP3TAG_PHASE_SERIALIZE] == 1, "detect and serialize");
+    CHECK(log.ended[MP3TAG_PHASE_REWRITE_COPY] == 1 &&
+          log.bytes[MP3TAG_PHASE_REWRITE_COPY] > 0 &&
+          log.ended[MP3TAG_PHASE_RENAME] == 1, "rewrite traced");
+
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "ARTIST", "Tracer");
+    mp3tag_close(ctx);
+    CHECK(log.ended[MP3TAG_PHASE_INPLACE_WRITE] == 1 &&
+          log.ended[MP3TAG_PHASE_FSYNC] >= 1, "in-place write traced");
+
+    mp3tag_collection_t *tags = NULL;
+    mp3tag_open(ctx, path);
+    mp3tag_read_tags(ctx, &tags);
+    mp3tag_close(ctx);
+    CHECK(log.ended[MP3TAG_PHASE_ID3V2_HEADER] >= 1 &&
+          log.ended[MP3TAG_PHASE_ID3V2_FRAMES] >= 1 &&
+          log.bytes[MP3TAG_PHASE_FRAMES_TO_COLLECTION] > 0,
+          "read phases traced");
+
+    int open_left = 0;
+    for (int i = 0; i < MP3TAG_PHASE_COUNT; i++) open_left += log.open[i];
+    CHECK(log.unpaired == 0 && open_left == 0, "begin/end paired");
+
+    mp3tag_set_trace(ctx, NULL);
+    int before = log.ended[MP3TAG_PHASE_CONTAINER_DETECT];
+    mp3tag_open(ctx, path);
+    mp3tag_close(ctx);
+    CHECK(log.ended[MP3TAG_PHASE_CONTAINER_DETECT] == before,
+          "set_trace(NULL) removes hooks");
+    CHECK(strcmp(mp3tag_phase_name(MP3TAG_PHASE_REWRITE_COPY),
+                 "rewrite_copy") == 0, "phase_name");
+
+    /* Histogram sink */
+    mp3tag_histogram_t *h = mp3tag_histogram_create();
+    CHECK(h != NULL, "histogram_create");
+    mp3tag_histogram_hooks(h, &hooks);
+    mp3tag_set_trace(ctx, &hooks);
+    for (int i = 0; i < 20; i++) {
+        mp3tag_open(ctx, path);
+        mp3tag_read_tags(ctx, &tags);
+        mp3tag_close(ctx);
+    }
+    uint64_t n   = mp3tag_histogram_count(h, MP3TAG_PHASE_ID3V2_FRAMES);
+    uint64_t p50 = mp3tag_histogram_percentile(h, MP3TAG_PHASE_ID3V2_FRAMES,
+                                               50.0);
+    uint64_t p99 = mp3tag_histogram_percentile(h, MP3TAG_PHASE_ID3V2_FRAMES,
+                                               99.0);
+    uint64_t max = mp3tag_histogram_max(h, MP3TAG_PHASE_ID3V2_FRAMES);
+    CHECK(n == 20, "histogram counts phases");
+    CHECK(p50 > 0 && p50 <= p99 && p99 <= max, "percentiles ordered");
+    CHECK(mp3tag_histogram_bytes(h, MP3TAG_PHASE_ID3V2_FRAMES) > 0,
+          "histogram bytes");
+    CHECK(mp3tag_histogram_count(h, MP3TAG_PHASE_RENAME) == 0,
+          "untouched phase empty");
+    mp3tag_histogram_reset(h);
+    CHECK(mp3tag_histogram_count(h, MP3TAG_PHASE_ID3V2_FRAMES) == 0 &&
+          mp3tag_histogram_percentile(h, MP3TAG_PHASE_ID3V2_FRAMES,
+                                      50.0) == 0, "histogram_reset");
+
+    mp3tag_destroy(ctx);
+    mp3tag_histogram_destroy(h);
+    remove(path);
+}
+
+static const mp3tag_alloc_site_t *find_site(const mp3tag_alloc_site_t *sites,
+                                            size_t n, const char *tag)
+{
+    for (size_t i = 0; i < n; i++)
+        if (strcmp(sites[i].tag, tag) == 0) return &sites[i];
+    return NULL;
+}
+
+static void test_alloc_profile(void)
+{
+    printf("\n--- Allocation profile ---\n");
+
+    char dump[2048];
+    mp3tag_alloc_site_t sites[32];
+
+    if (!mp3tag_alloc_profile_enabled()) {
+        CHECK(mp3tag_alloc_profile(sites, 32) == 0, "disabled: no sites");
+        size_t len = mp3tag_alloc_profile_dump(dump, sizeof(dump));
+        CHECK(len == strlen(dump) && strstr(dump, "peak") != NULL,
+              "disabled: dump has header only");
+        return;
+    }
+
+    const char *path = "/tmp/test_libmp3tag_alloc.mp3";
+    create_mp3(path);
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "TITLE", "Profiled");
+    mp3tag_set_tag_string(ctx, "ARTIST", "Profiler");
+    mp3tag_close(ctx);
+
+    mp3tag_alloc_profile_reset();
+    mp3tag_collection_t *tags = NULL;
+    mp3tag_open(ctx, path);
+    mp3tag_read_tags(ctx, &tags);
+
+    size_t n = mp3tag_alloc_profile(sites, 32);
+    const mp3tag_alloc_site_t *data = find_site(sites, n, "frame_data");
+    const mp3tag_alloc_site_t *text = find_site(sites, n, "decoded_text");
+    const mp3tag_alloc_site_t *node = find_site(sites, n, "simple_tag");
+    CHECK(data && data->allocations == 2 && data->bytes > 0,
+          "frame payloads tagged");
+    CHECK(data && data->live_bytes == 0 && data->peak_bytes > 0,
+          "frame payloads freed after parsing");
+    CHECK(text && text->allocations >= 2, "decoded text tagged");
+    CHECK(node && node->allocations == 2 && node->live_bytes > 0,
+          "simple-tag nodes live while cached");
+
+    mp3tag_close(ctx);
+    n = mp3tag_alloc_profile(sites, 32);
+    node = find_site(sites, n, "simple_tag");
+    CHECK(node && node->live_bytes == 0, "nodes freed on close");
+
+    mp3tag_open_rw(ctx, path);
+    mp3tag_set_tag_string(ctx, "ALBUM", "Allocations");
+    mp3tag_close(ctx);
+    n = mp3tag_alloc_profile(sites, 32);
+    const mp3tag_alloc_site_t *grow = find_site(sites, n, "buffer_growth");
+    CHECK(grow && grow->allocations > 0 && grow->live_bytes == 0,
+          "serialize buffer growth tagged");
+
+    size_t len = mp3tag_alloc_profile_dump(dump, sizeof(dump));
+    CHECK(len == strlen(dump) && strstr(dump, "frame_data") != NULL,
+          "dump lists tags");
+    CHECK(mp3tag_alloc_profile_dump(dump, 8) == len && strlen(dump) == 7,
+          "dump truncates like snprintf");
+
+    mp3tag_destroy(ctx);
+    remove(path);
+}
+
+static void test_perf(void)
+{
+    printf("\n--- CPU counters ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_perf.mp3";
+    create_mp3(path);
+
+    mp3tag_perf_t *sw = mp3tag_perf_create(MP3TAG_PERF_SOFTWARE);
+    mp3tag_perf_t *hw = mp3tag_perf_create(MP3TAG_PERF_HARDWARE);
+    CHECK(sw && hw, "perf_create");
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    CHECK_RC(mp3tag_set_perf(ctx, sw), "set_perf");
+
+    mp3tag_collection_t *coll = mp3tag_collection_create(ctx);
+    mp3tag_tag_t *tag = mp3tag_collection_add_tag(ctx, coll,
+                                                  MP3TAG_TARGET_ALBUM);
+    mp3tag_tag_add_simple(ctx, tag, "TITLE", "Counted Cycles");
+    mp3tag_open_rw(ctx, path);
+    mp3tag_write_tags(ctx, coll);
+    mp3tag_close(ctx);
+    mp3tag_collection_free(ctx, coll);
+
+    mp3tag_collection_t *tags = NULL;
+    for (int i = 0; i < 5; i++) {
+        mp3tag_open(ctx, path);
+        mp3tag_read_tags(ctx, &tags);
+        mp3tag_close(ctx);
+    }
+
+    mp3tag_perf_report_t rep;
+    CHECK_RC(mp3tag_perf_report(sw, MP3TAG_PERF_OP_OPEN, &rep),
+             "perf_report");
+    CHECK(rep.calls == 6 && rep.source == MP3TAG_PERF_SOFTWARE,
+          "opens counted in software");
+    CHECK(rep.wall_ns > 0 && rep.cycles == 0.0, "software fields only");
+    mp3tag_perf_report(sw, MP3TAG_PERF_OP_READ, &rep);
+    CHECK(rep.calls == 5 && rep.cpu_ns > 0, "reads counted with CPU time");
+    mp3tag_perf_report(sw, MP3TAG_PERF_OP_WRITE, &rep);
+    CHECK(rep.calls == 1, "write counted");
+    CHECK(mp3tag_perf_report(sw, MP3TAG_PERF_OP_COUNT, &rep) ==
+          MP3TAG_ERR_INVALID_ARG, "invalid op rejected");
+
+    /* Hardware counters where the kernel allows them, software otherwise */
+    mp3tag_set_perf(ctx, hw);
+    mp3tag_open(ctx, path);
+    mp3tag_read_tags(ctx, &tags);
+    mp3tag_close(ctx);
+    mp3tag_perf_report(hw, MP3TAG_PERF_OP_READ, &rep);
+    CHECK(rep.calls == 1, "hardware-requested read counted");
+    CHECK(rep.source == MP3TAG_PERF_SOFTWARE ||
+          (rep.cycles > 0 && rep.instructions > 0),
+          "hardware counters populated when available");
+    printf("  (source: %s)\n",
+           rep.source == MP3TAG_PERF_HARDWARE ? "hardware" : "software");
+
+    mp3tag_perf_reset(sw);
+    mp3tag_perf_report(sw, MP3TAG_PERF_OP_READ, &rep);
+    CHECK(rep.calls == 0 && rep.cpu_ns == 0.0, "perf_reset");
+
+    mp3tag_set_perf(ctx, NULL);
+    mp3tag_destroy(ctx);
+    mp3tag_perf_destroy(sw);
+    mp3tag_perf_destroy(hw);
+    remove(path);
+}
+
+static void test_iotrace(void)
+{
+    printf("\n--- I/O trace ---\n");
+
+    const char *path  = "/tmp/test_libmp3tag_iotrace.mp3";
+    const char *trace = "/tmp/test_libmp3tag_iotrace.trace";
+    create_mp3(path);
+
+    CHECK(mp3tag_iotrace_create("/nonexistent/dir/trace") == NULL,
+          "iotrace_create fails on a bad path");
+    mp3tag_iotrace_t *rec = mp3tag_iotrace_create(trace);
+    CHECK(rec != NULL, "iotrace_create");
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    CHECK_RC(mp3tag_set_iotrace(ctx, rec), "set_iotrace");
+    mp3tag_set_padding(ctx, 0);
+
+    mp3tag_collection_t *tags = NULL;
+    CHECK_RC(mp3tag_open_rw(ctx, path), "open under recorder");
+    mp3tag_read_tags(ctx, &tags);
+    CHECK_RC(mp3tag_set_tag_string(ctx, "TITLE", "Traced"),
+             "rewrite under recorder");
+    mp3tag_close(ctx);
+
+    /* Detached: nothing more is recorded */
+    mp3tag_set_iotrace(ctx, NULL);
+    mp3tag_open(ctx, path);
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+    CHECK_RC(mp3tag_iotrace_destroy(rec), "iotrace_destroy");
+
+    FILE *f = fopen(trace, "rb");
+    char head[8] = { 0 };
+    long size = 0;
+    if (f) {
+        CHECK(fread(head, 1, sizeof(head), f) == sizeof(head), "trace header");
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fclose(f);
+    }
+    CHECK(memcmp(head, "MP3TIOT", 7) == 0, "trace magic");
+    CHECK(size > (long)sizeof(head), "trace has records");
+
+    remove(path);
+    remove(trace);
+}
+
+/* Rendered metrics text, or NULL; the caller frees it */
+static char *render_metrics(const mp3tag_metrics_t *m)
+{
+    size_t len = mp3tag_metrics_render(m, NULL, 0);
+    char *text = malloc(len + 1);
+    if (text && mp3tag_metrics_render(m, text, len + 1) != len) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+static void test_metrics(void)
+{
+    printf("\n--- Metrics ---\n");
+
+    const char *path = "/tmp/test_libmp3tag_metrics.mp3";
+    const char *sock = "/tmp/test_libmp3tag_metrics.sock";
+    create_mp3(path);
+
+    mp3tag_metrics_t *m = mp3tag_metrics_create();
+    CHECK(m != NULL, "metrics_create");
+
+    /* Activity before attaching is not counted */
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open(ctx, path);
+    mp3tag_close(ctx);
+    CHECK_RC(mp3tag_set_metrics(ctx, m), "set_metrics");
+
+    mp3tag_collection_t *tags = NULL;
+    mp3tag_open_rw(ctx, path);
+    mp3tag_read_tags(ctx, &tags);
+    mp3tag_set_tag_string(ctx, "TITLE", "Scraped");
+    mp3tag_close(ctx);
+    CHECK(mp3tag_open(ctx, "/nonexistent/file.mp3") == MP3TAG_ERR_IO,
+          "failing open");
+
+    char *text = render_metrics(m);
+    CHECK(text != NULL, "metrics_render sizes like snprintf");
+    if (text) {
+        CHECK(strstr(text, "\nmp3tag_files_opened_total 1\n") != NULL,
+              "successful opens counted from attach");
+        CHECK(strstr(text, "mp3tag_calls_total{op=\"open\"} 2\n") != NULL,
+              "calls counted");
+        CHECK(strstr(text, "mp3tag_call_errors_total{op=\"open\","
+                           "code=\"MP3TAG_ERR_IO\"} 1\n") != NULL,
+              "errors by code");
+        CHECK(strstr(text, "# TYPE mp3tag_phase_seconds histogram") &&
+              !strstr(text, "mp3tag_phase_seconds_count"
+                            "{phase=\"serialize\"} 0\n"),
+              "phase histogram");
+        CHECK(!strstr(text, "mp3tag_syscalls_total{call=\"open\"} 0\n") &&
+              !strstr(text, "mp3tag_read_bytes_total 0\n"),
+              "context counters aggregated");
+    }
+    free(text);
+
+    char small[16];
+    size_t need = mp3tag_metrics_render(m, small, sizeof(small));
+    CHECK(need > sizeof(small) && strlen(small) == sizeof(small) - 1,
+          "metrics_render truncates");
+
+    /* Batch workers publish to the registry in the options */
+    const char *paths[] = { path, path };
+    mp3tag_batch_result_t results[2];
+    mp3tag_batch_options_t opts = { .thread_count = 2, .metrics = m };
+    mp3tag_read_batch(paths, 2, &opts, results);
+    mp3tag_batch_results_free(results, 2);
+    text = render_metrics(m);
+    CHECK(text && strstr(text, "\nmp3tag_files_opened_total 3\n"),
+          "batch reads counted");
+    free(text);
+
+    /* Unix-socket endpoint */
+    CHECK_RC(mp3tag_metrics_serve(m, sock), "metrics_serve");
+    CHECK(mp3tag_metrics_serve(m, sock) == MP3TAG_ERR_ALREADY_OPEN,
+          "serve once per registry");
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, sock, sizeof(addr.sun_path) - 1);
+    char reply[65536];
+    size_t got = 0;
+    if (fd >= 0 &&
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        const char *req = "GET /metrics HTTP/1.0\r\n\r\n";
+        if (write(fd, req, strlen(req)) == (ssize_t)strlen(req)) {
+            ssize_t n;
+            while (got < sizeof(reply) - 1 &&
+                   (n = read(fd, reply + got, sizeof(reply) - 1 - got)) > 0)
+                got += (size_t)n;
+        }
+    }
+    if (fd >= 0) close(fd);
+    reply[got] = '\0';
+    CHECK(strncmp(reply, "HTTP/1.0 200 OK\r\n", 17) == 0 &&
+          strstr(reply, "mp3tag_files_opened_total 3\n"),
+          "scrape over the socket");
+
+    mp3tag_set_metrics(ctx, NULL);
+    mp3tag_destroy(ctx);
+    mp3tag_metrics_destroy(m);
+    CHECK(access(sock, F_OK) != 0, "socket removed on destroy");
+    remove(path);
+}
+
 /* ------------------------------------------------------------------ */
 /*  Main                                                               */
 /* ------------------------------------------------------------------ */
@@ -312,6 +1732,23 @@ int main(void)
     test_format("AAC",  "/tmp/test_libmp3tag.aac",  create_aac);
     test_format("WAV",  "/tmp/test_libmp3tag.wav",  create_wav);
     test_format("AIFF", "/tmp/test_libmp3tag.aiff", create_aiff);
+    test_batch();
+    test_scan();
+    test_cache();
+    test_flat();
+    test_index();
+    test_watch();
+    test_lru();
+    test_snapshot();
+    test_revalidate();
+    test_writeback();
+    test_stats();
+    test_write_settings();
+    test_trace();
+    test_alloc_profile();
+    test_perf();
+    test_iotrace();
+    test_metrics();
 
     printf("\n==========================================\n");
     printf("Results: %d passed, %d failed\n", g_pass, g_fail);
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2025 Morgan Prior */
+
+/*
+ * Syscall budgets for representative operations on every format.
+ *
+ * Runs under LD_PRELOAD=libsyscount_preload.so, which counts file
+ * calls made through libc. Each operation is measured from a prepared
+ * fixture and compared with an upper bound per call type; exceeding a
+ * bound fails the test, so an extra seek per chunk, a re-read during
+ * probing or a read per frame shows up as a regression. When a change
+ * legitimately lowers a count, tighten the budget to match.
+ */
+
+#define _GNU_SOURCE         /* RTLD_DEFAULT */
+
+#include <mp3tag/mp3tag.h>
+#include "fixtures.h"
+#include "syscount.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned open, read, pread, lseek, write, fsync;
+} budget_t;
+
+typedef enum {
+    OP_PROBE,           /* open + close of a tagged file */
+    OP_READ,            /* open + read_tags + close */
+    OP_WRITE_INPLACE,   /* change a tag that fits the padding */
+    OP_WRITE_FIRST,     /* first tag on an untagged file */
+    OP_WRITE_GROW,      /* outgrow the padding of a tagged file */
+    OP_COUNT
+} op_t;
+
+static const char *const op_names[OP_COUNT] = {
+    "probe", "read", "write_inplace", "write_first", "write_grow"
+};
+
+typedef struct {
+    const char *label;
+    const char *path;
+    void      (*create)(const char *path);
+    budget_t    budgets[OP_COUNT];
+} format_t;
+
+/*
+ * Budgets equal the counts of the current implementation, including
+ * the libtag_common file layer; re-measure after updating it (every
+ * count is printed). Fixtures carry two text frames; writes go through
+ * set_tag_string(), which reads the existing tags first.
+ *                                open read pread lseek write fsync */
+static const format_t formats[] = {
+    { "MP3", "/tmp/test_syscalls.mp3", create_mp3, {
+        [OP_PROBE]         = { 1,  3, 0,  3,  0, 0 },
+        [OP_READ]          = { 1,  8, 0,  6,  0, 0 },
+        [OP_WRITE_INPLACE] = { 1, 11, 0, 10,  3, 1 },
+        [OP_WRITE_FIRST]   = { 5,  7, 0,  8,  4, 1 },
+        [OP_WRITE_GROW]    = { 5, 12, 0, 11,  4, 1 },
+    } },
+    { "AAC", "/tmp/test_syscalls.aac", create_aac, {
+        [OP_PROBE]         = { 1,  3, 0,  3,  0, 0 },
+        [OP_READ]          = { 1,  8, 0,  6,  0, 0 },
+        [OP_WRITE_INPLACE] = { 1, 11, 0, 10,  3, 1 },
+        [OP_WRITE_FIRST]   = { 5,  6, 0,  7,  4, 1 },
+        [OP_WRITE_GROW]    = { 5, 12, 0, 11,  4, 1 },
+    } },
+    { "WAV", "/tmp/test_syscalls.wav", create_wav, {
+        [OP_PROBE]         = { 1,  5, 0,  5,  0, 0 },
+        [OP_READ]          = { 1, 10, 0,  8,  0, 0 },
+        [OP_WRITE_INPLACE] = { 1, 15, 0, 14,  3, 1 },
+        [OP_WRITE_FIRST]   = { 1,  8, 0, 10,  3, 1 },
+        [OP_WRITE_GROW]    = { 4, 21, 0, 22,  7, 1 },
+    } },
+    { "AIFF", "/tmp/test_syscalls.aiff", create_aiff, {
+        [OP_PROBE]         = { 1,  5, 0,  5,  0, 0 },
+        [OP_READ]          = { 1, 10, 0,  8,  0, 0 },
+        [OP_WRITE_INPLACE] = { 1, 15, 0, 14,  3, 1 },
+        [OP_WRITE_FIRST]   = { 1,  8, 0, 10,  3, 1 },
+        [OP_WRITE_GROW]    = { 4, 21, 0, 22,  7, 1 },
+    } },
+};
+
+static syscount_get_fn g_get;
+static int g_fail = 0;
+
+/* ------------------------------------------------------------------ */
+/*  Fixtures and operations                                            */
+/* ------------------------------------------------------------------ */
+
+static void prepare(const format_t *fmt, op_t op)
+{
+    fmt->create(fmt->path);
+    if (op == OP_WRITE_FIRST) return;
+
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    mp3tag_open_rw(ctx, fmt->path);
+    mp3tag_set_tag_string(ctx, "TITLE", "Budget");
+    mp3tag_set_tag_string(ctx, "ARTIST", "Counter");
+    mp3tag_close(ctx);
+    mp3tag_destroy(ctx);
+}
+
+static int run(mp3tag_context_t *ctx, const char *path, op_t op)
+{
+    static char big[16384];
+    mp3tag_collection_t *tags = NULL;
+    int rc;
+
+    switch (op) {
+    case OP_PROBE:
+        rc = mp3tag_open(ctx, path);
+        break;
+    case OP_READ:
+        rc = mp3tag_open(ctx, path);
+        if (rc == MP3TAG_OK) rc = mp3tag_read_tags(ctx, &tags);
+        break;
+    case OP_WRITE_INPLACE:
+    case OP_WRITE_FIRST:
+        rc = mp3tag_open_rw(ctx, path);
+        if (rc == MP3TAG_OK)
+            rc = mp3tag_set_tag_string(ctx, "TITLE", "Within budget");
+        break;
+    case OP_WRITE_GROW:
+        memset(big, 'x', sizeof(big) - 1);
+        rc = mp3tag_open_rw(ctx, path);
+        if (rc == MP3TAG_OK)
+            rc = mp3tag_set_tag_string(ctx, "COMMENT", big);
+        break;
+    default:
+        rc = MP3TAG_ERR_INVALID_ARG;
+    }
+    mp3tag_close(ctx);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Budget checks                                                      */
+/* ------------------------------------------------------------------ */
+
+static void check(const char *label, const char *op, const char *call,
+                  uint64_t used, unsigned budget)
+{
+    int ok = used <= budget;
+    printf("  %s: %-5s %-13s %-6s %3llu / %u\n", ok ? "PASS" : "FAIL",
+           label, op, call, (unsigned long long)used, budget);
+    if (!ok) g_fail++;
+}
+
+static void measure(const format_t *fmt, op_t op)
+{
+    prepare(fmt, op);
+
+    /* The context is created outside the window: only file I/O counts */
+    mp3tag_context_t *ctx = mp3tag_create(NULL);
+    syscount_t before, after;
+    g_get(&before);
+    int rc = run(ctx, fmt->path, op);
+    g_get(&after);
+    mp3tag_destroy(ctx);
+
+    if (rc != MP3TAG_OK) {
+        printf("  FAIL: %-5s %-13s %s\n", fmt->label, op_names[op],
+               mp3tag_strerror(rc));
+        g_fail++;
+        return;
+    }
+
+    const budget_t *b = &fmt->budgets[op];
+    check(fmt->label, op_names[op], "open",  after.open  - before.open,
+          b->open);
+    check(fmt->label, op_names[op], "read",  after.read  - before.read,
+          b->read);
+    check(fmt->label, op_names[op], "pread", after.pread - before.pread,
+          b->pread);
+    check(fmt->label, op_names[op], "lseek", after.lseek - before.lseek,
+          b->lseek);
+    check(fmt->label, op_names[op], "write", after.write - before.write,
+          b->write);
+    check(fmt->label, op_names[op], "fsync", after.fsync - before.fsync,
+          b->fsync);
+}
+
+int main(void)
+{
+    g_get = (syscount_get_fn)(uintptr_t)dlsym(RTLD_DEFAULT,
+                                              SYSCOUNT_GET_SYMBOL);
+    if (!g_get) {
+        fprintf(stderr, "syscount interposer not preloaded "
+                        "(run with LD_PRELOAD=libsyscount_preload.so)\n");
+        return 1;
+    }
+
+    printf("libmp3tag v%s — syscall budgets\n", mp3tag_version());
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        printf("\n--- %s ---\n", formats[f].label);
+        for (int op = 0; op < OP_COUNT; op++)
+            measure(&formats[f], (op_t)op);
+        remove(formats[f].path);
+    }
+
+    printf("\n%s: %d budget(s) exceeded\n", g_fail ? "FAILED" : "OK",
+           g_fail);
+    return g_fail > 0 ? 1 : 0;
+}